@@ -1,42 +1,48 @@
 #version 410 core
 
-layout (location = 0) in vec3 position;
+// A marching cube only holds its index in the grid, the position is derived from it (see Marching_Cube).
+layout (location = 0) in int cube_index;
 
 // We need the vertex values in the geometry shader.
-// Input.
-layout (location = 2) in int value_vertex_0;
-layout (location = 3) in int value_vertex_1;
-layout (location = 4) in int value_vertex_2;
-layout (location = 5) in int value_vertex_3;
-layout (location = 6) in int value_vertex_4;
-layout (location = 7) in int value_vertex_5;
-layout (location = 8) in int value_vertex_6;
-layout (location = 9) in int value_vertex_7;
+// Input (half floats in the buffer, the GPU converts them).
+layout (location = 1) in vec4 values_vertex_0_to_3;
+layout (location = 2) in vec4 values_vertex_4_to_7;
 // Output.
-out int value_vertex_0_geom;
-out int value_vertex_1_geom;
-out int value_vertex_2_geom;
-out int value_vertex_3_geom;
-out int value_vertex_4_geom;
-out int value_vertex_5_geom;
-out int value_vertex_6_geom;
-out int value_vertex_7_geom;
+out float value_vertex_0_geom;
+out float value_vertex_1_geom;
+out float value_vertex_2_geom;
+out float value_vertex_3_geom;
+out float value_vertex_4_geom;
+out float value_vertex_5_geom;
+out float value_vertex_6_geom;
+out float value_vertex_7_geom;
 
 // The view and the projection matrix are set using uniforms.
 uniform mat4 u_view_matrix;
 uniform mat4 u_projection_matrix;
 
+// The grid of the marching cubes: the min corner of the first cube, the edge length and the number of cubes along x and y.
+uniform vec3 u_grid_origin;
+uniform float u_cube_edge_length;
+uniform int u_number_of_cells_x;
+uniform int u_number_of_cells_y;
+
 void main()
 {
     // Pass the vertex values to the geometry shader.
-    value_vertex_0_geom = value_vertex_0;
-    value_vertex_1_geom = value_vertex_1;
-    value_vertex_2_geom = value_vertex_2;
-    value_vertex_3_geom = value_vertex_3;
-    value_vertex_4_geom = value_vertex_4;
-    value_vertex_5_geom = value_vertex_5;
-    value_vertex_6_geom = value_vertex_6;
-    value_vertex_7_geom = value_vertex_7;
+    value_vertex_0_geom = values_vertex_0_to_3.x;
+    value_vertex_1_geom = values_vertex_0_to_3.y;
+    value_vertex_2_geom = values_vertex_0_to_3.z;
+    value_vertex_3_geom = values_vertex_0_to_3.w;
+    value_vertex_4_geom = values_vertex_4_to_7.x;
+    value_vertex_5_geom = values_vertex_4_to_7.y;
+    value_vertex_6_geom = values_vertex_4_to_7.z;
+    value_vertex_7_geom = values_vertex_4_to_7.w;
+    // The position of the min corner (the same as Marching_Cubes_Generator::get_position_from_grid_key_marching_cube).
+    int cell_index_x = cube_index % u_number_of_cells_x;
+    int cell_index_y = (cube_index / u_number_of_cells_x) % u_number_of_cells_y;
+    int cell_index_z = cube_index / (u_number_of_cells_x * u_number_of_cells_y);
+    vec3 position = u_grid_origin + vec3(cell_index_x, cell_index_y, cell_index_z) * u_cube_edge_length;
     // Within this project we do not need a model matrix, so only use the 
     // projection matrix and view matrix.
     gl_Position = vec4(position, 1.0);
@@ -1,12 +1,24 @@
 #version 410 core
 
-layout (location = 0) in vec3 position;
+// A marching cube only holds its index in the grid, the position is derived from it (see Marching_Cube).
+layout (location = 0) in int cube_index;
 
 uniform mat4 u_view_matrix;
 uniform mat4 u_projection_matrix;
 
+// The grid of the marching cubes: the min corner of the first cube, the edge length and the number of cubes along x and y.
+uniform vec3 u_grid_origin;
+uniform float u_cube_edge_length;
+uniform int u_number_of_cells_x;
+uniform int u_number_of_cells_y;
+
 void main()
 {
+    // The position of the min corner (the same as Marching_Cubes_Generator::get_position_from_grid_key_marching_cube).
+    int cell_index_x = cube_index % u_number_of_cells_x;
+    int cell_index_y = (cube_index / u_number_of_cells_x) % u_number_of_cells_y;
+    int cell_index_z = cube_index / (u_number_of_cells_x * u_number_of_cells_y);
+    vec3 position = u_grid_origin + vec3(cell_index_x, cell_index_y, cell_index_z) * u_cube_edge_length;
     // Within this project we do not need a model matrix, so only use the 
     // projection matrix and view matrix.
     gl_Position = u_projection_matrix * u_view_matrix * vec4(position, 1.0);
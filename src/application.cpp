@@ -8,9 +8,6 @@
 #include "imgui/imgui_impl_glfw.h"
 #include "imgui/imgui_impl_opengl3.h"
 
-// For more details see performance_test.h:
-std::unordered_map<std::string, std::vector<long long>> execution_times;
-
 Application_Handler application_handler;
 
 void rtgp_application()
@@ -48,43 +45,9 @@ void rtgp_application()
                 std::cout << "Initialize simulation handler." << std::endl;
                 // Register the available scenes.
                 // Remember to also add the scene loading to the input handler below.
-                application_handler.simulation_handler.register_new_scene(
-                    "cube in the middle",
-                    Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
-                    std::vector<Cuboid> {
-                        Cuboid(-0.5f, 0.5f, -0.5f, 0.5f, -0.5f, 0.5f)
-                    }
-                );
-                application_handler.simulation_handler.register_new_scene(
-                    "cube in the middle (big simulation space)",
-                    Cuboid(-3.0f, 3.0f, -1.0f, 3.0f, -1.0f, 1.0f),
-                    std::vector<Cuboid> {
-                        Cuboid(-0.5f, 0.5f, 1.5f, 2.5f, -0.5f, 0.5f)
-                    }
-                );
-                application_handler.simulation_handler.register_new_scene(
-                    "dam break scenario",
-                    Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
-                    std::vector<Cuboid> {
-                        Cuboid(-1.0f, -0.5f, -1.0f, 1.0f, -1.0f, 1.0f)
-                    }
-                );
-                application_handler.simulation_handler.register_new_scene(
-                    "double dam break scenario",
-                    Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
-                    std::vector<Cuboid> {
-                        Cuboid(-1.0f, -0.5f, -1.0f, 1.0f, -1.0f, 1.0f),
-                        Cuboid(0.5f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f)
-                    }
-                );
-                application_handler.simulation_handler.register_new_scene(
-                    "drop fall scenario",
-                    Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
-                    std::vector<Cuboid> {
-                        Cuboid(-1.0f, 1.0f, -1.0f, -0.6f, -1.0f, 1.0f),
-                        Cuboid(-0.2f, 0.2f, 0.5f, 0.9f, -0.2f, 0.2f)
-                    }
-                );
+                application_handler.simulation_handler.register_default_scenes();
+                // The scenes described by the scene files follow the default scenes (keys 6 - 9).
+                application_handler.simulation_handler.register_scene_files(SCENE_FILE_DIRECTORY);
                 // Announce the first scene (id = 0) as the next scene to be loaded.
                 // It will be loaded in the SIMULATION_INITIALIZATION state, so we do not need to 
                 // check here if the scene really exists.
@@ -117,16 +80,28 @@ void rtgp_application()
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_3, [] () { switch_scene(2); }, "LOAD SCENE 3") );
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_4, [] () { switch_scene(3); }, "LOAD SCENE 4") );
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_5, [] () { switch_scene(4); }, "LOAD SCENE 5") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_6, [] () { switch_scene(5); }, "LOAD SCENE 6") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_7, [] () { switch_scene(6); }, "LOAD SCENE 7") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_8, [] () { switch_scene(7); }, "LOAD SCENE 8") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_9, [] () { switch_scene(8); }, "LOAD SCENE 9") );
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_R, reload_scene, "RELOAD SCENE") );
                 // Simulation related input.
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_SPACE, pause_resume_simulation, "PAUSE / RESUME THE SIMULATION") );
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_S, simulate_one_step, "SIMULATE ONE STEP (IF PAUSED)") );
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_UP, increase_number_of_particles, "INCREASE NUMBER OF PARTICLES") );
                 ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_DOWN, decrease_number_of_particles, "DECREASE NUMBER OF PARTICLES") );
-                // We now want to be able to print this information also in an imgui window. So make the visualization handler aware of the key bindings.
-                // We are only interested in the simulation input behavior.
-                ASSERT( application_handler.input_handler.create_key_binding_list(INPUT_BEHAVIOR_SIMULATION, 
-                    application_handler.visualization_handler.key_list, application_handler.visualization_handler.reaction_description_list) );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_C, toggle_recording, "START / STOP RECORDING THE SIMULATION") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_SIMULATION, GLFW_KEY_P, start_replay, "REPLAY THE LAST RECORDING") );
+                // SIMULATION_REPLAY.
+                // During the replay the particles are not simulated, so only the playback can be controlled.
+                ASSERT( application_handler.input_handler.register_input_context(INPUT_BEHAVIOR_REPLAY, "INPUT BEHAVIOR DURING REPLAY:") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_REPLAY, GLFW_KEY_ESCAPE, exit_application, "EXIT APPLICATION") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_REPLAY, GLFW_KEY_P, stop_replay, "STOP THE REPLAY AND RETURN TO THE SIMULATION") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_REPLAY, GLFW_KEY_SPACE, pause_resume_replay, "PAUSE / RESUME THE REPLAY") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_REPLAY, GLFW_KEY_RIGHT, replay_step_forward, "NEXT FRAME") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_REPLAY, GLFW_KEY_LEFT, replay_step_backward, "PREVIOUS FRAME") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_REPLAY, GLFW_KEY_UP, increase_replay_speed, "INCREASE PLAYBACK SPEED") );
+                ASSERT( application_handler.input_handler.add_input_behaviour(INPUT_BEHAVIOR_REPLAY, GLFW_KEY_DOWN, decrease_replay_speed, "DECREASE PLAYBACK SPEED") );
                 // Activate the IDLE-input-context (this is used for everything but the running simulation).
                 if (application_handler.input_handler.change_input_context(INPUT_BEHAVIOR_IDLE) == false) {
                     // Something went wrong. Terminate the application.
@@ -140,20 +115,22 @@ void rtgp_application()
                 // Print informations about the available scenes for the user.
                 application_handler.simulation_handler.print_scene_information();
 
+                // Count the hardware events of the measured functions if the counters are available.
+                #ifdef PERFORMANCE_TEST
+                initialize_performance_counters();
+                #endif
+
                 // If all went good we arrived here. So the next step is to initialize the simulation.
                 application_handler.next_state = SIMULATION_INITIALIZATION;
                 break;
             case APPLICATION_TERMINATION:
                 // Terminate the application.
                 std::cout << "Terminate the application." << std::endl;
+                // Finish the recording if there is one running and close the replay.
+                application_handler.simulation_handler.simulation_recorder.stop_recording();
+                application_handler.simulation_handler.stop_replay();
                 // Free GPU ressources.
-                for (Scene_Information scene_information: application_handler.simulation_handler.available_scenes) {
-                    scene_information.simulation_space.free_gpu_resources();
-                    for (Cuboid fluid_starting_position: scene_information.fluid_starting_positions) {
-                        fluid_starting_position.free_gpu_resources();
-                    }
-                }
-                application_handler.simulation_handler.particle_system.free_gpu_resources();
+                application_handler.visualization_handler.free_gpu_resources();
                 // Delete the shaders.
                 application_handler.visualization_handler.delete_shaders();
                 // Terminate.
@@ -162,11 +139,16 @@ void rtgp_application()
                 #ifdef PERFORMANCE_TEST
                 save_exection_time_to_csv();
                 #endif
+                #ifdef TRACING
+                save_trace_to_json();
+                #endif
                 break;
             case SIMULATION_INITIALIZATION:
                 // This state is used for loading the new scene or reloading the current scene.
                 // When a scene change is requested, the scene_handler checks if the desired scene is available 
                 // but does not load it yet. It just saves the desired scene. So load it now.
+                // The grids of the marching cubes are part of the memory footprint of the scene.
+                application_handler.simulation_handler.marching_cubes_generator = &application_handler.visualization_handler.marching_cube_generator;
                 if (application_handler.simulation_handler.load_scene() == false) {
                     // Something went wrong. Terminate the application.
                     std::cout << "An error occured while loading the scene." << std::endl;
@@ -175,10 +157,17 @@ void rtgp_application()
                 }
                 // Activate the input behavior for the simulation.
                 ASSERT( application_handler.input_handler.change_input_context(INPUT_BEHAVIOR_SIMULATION) );
+                // We now want to be able to print this information also in an imgui window. So make the visualization handler aware of the key bindings.
+                // We are only interested in the active input behavior.
+                ASSERT( application_handler.input_handler.create_key_binding_list(INPUT_BEHAVIOR_SIMULATION, 
+                    application_handler.visualization_handler.key_list, application_handler.visualization_handler.reaction_description_list) );
                 // Load the references into the visualization handler.
                 application_handler.visualization_handler.simulation_space = application_handler.simulation_handler.get_pointer_to_simulation_space();
                 application_handler.visualization_handler.fluid_start_positions = application_handler.simulation_handler.get_pointer_to_fluid_starting_positions();
                 application_handler.visualization_handler.particle_system = application_handler.simulation_handler.get_pointer_to_particle_system();
+                application_handler.visualization_handler.simulation_recorder = application_handler.simulation_handler.get_pointer_to_simulation_recorder();
+                application_handler.visualization_handler.simulation_replayer = application_handler.simulation_handler.get_pointer_to_simulation_replayer();
+                application_handler.visualization_handler.initial_state_cache = application_handler.simulation_handler.get_pointer_to_initial_state_cache();
                 application_handler.visualization_handler.marching_cube_generator.particle_system = application_handler.simulation_handler.get_pointer_to_particle_system();
                 // Tell the marching cube generator that something changed.
                 application_handler.visualization_handler.marching_cube_generator.simulation_space_changed();
@@ -203,6 +192,35 @@ void rtgp_application()
                 // Therefore the only possible next application stage is the initialization of the simulation.
                 application_handler.next_state = SIMULATION_INITIALIZATION;
                 break;
+            case REPLAY_INITIALIZATION:
+                // Open the last recording. If this fails, we simply continue with the simulation.
+                if (application_handler.simulation_handler.start_replay() == false) {
+                    std::cout << "The replay could not be started." << std::endl;
+                    application_handler.next_state = SIMULATION_RUNNING;
+                    continue;
+                }
+                // Activate the input behavior for the replay and show its key bindings.
+                ASSERT( application_handler.input_handler.change_input_context(INPUT_BEHAVIOR_REPLAY) );
+                ASSERT( application_handler.input_handler.create_key_binding_list(INPUT_BEHAVIOR_REPLAY, 
+                    application_handler.visualization_handler.key_list, application_handler.visualization_handler.reaction_description_list) );
+                // Load the first frame. This also sets the simulation space and the number of particles stored in the recording.
+                application_handler.simulation_handler.replay();
+                // Load the references into the visualization handler (the particle system stays the same).
+                application_handler.visualization_handler.simulation_space = application_handler.simulation_handler.get_pointer_to_simulation_space();
+                application_handler.visualization_handler.fluid_start_positions = application_handler.simulation_handler.get_pointer_to_fluid_starting_positions();
+                application_handler.visualization_handler.marching_cube_generator.simulation_space_changed();
+                application_handler.visualization_handler.camera.scene_center = application_handler.simulation_handler.get_current_point_of_interest();
+                application_handler.next_state = SIMULATION_REPLAY;
+                break;
+            case SIMULATION_REPLAY:
+                // Instead of simulating, load the next frame of the recording.
+                if (application_handler.simulation_handler.replay() == true) {
+                    // The recording contains another scene from here on.
+                    application_handler.visualization_handler.marching_cube_generator.simulation_space_changed();
+                    application_handler.visualization_handler.camera.scene_center = application_handler.simulation_handler.get_current_point_of_interest();
+                }
+                application_handler.visualization_handler.visualize();
+                break;
             default:
                 // NEVER.
                 std::cout << "Error: Not implemented application state detected: " << application_handler.current_state << "." << std::endl;
@@ -224,6 +242,11 @@ void reload_scene ()
 
 void switch_scene (int scene_id) 
 {
+    // The keys 6 - 9 only have a scene if there are enough scene files.
+    if (scene_id >= application_handler.simulation_handler.available_scenes.size()) {
+        std::cout << "There is no scene " << scene_id + 1 << "." << std::endl;
+        return;
+    }
     application_handler.simulation_handler.next_scene_id = scene_id; 
     application_handler.next_state = SIMULATION_INITIALIZATION;
 }
@@ -241,6 +264,48 @@ void simulate_one_step ()
     }
 }
 
+void toggle_recording ()
+{
+    application_handler.simulation_handler.toggle_recording();
+}
+
+void start_replay ()
+{
+    application_handler.next_state = REPLAY_INITIALIZATION;
+}
+
+void stop_replay ()
+{
+    application_handler.simulation_handler.stop_replay();
+    // Go back to the simulation. This reloads the current scene.
+    application_handler.next_state = SIMULATION_TERMINATION;
+}
+
+void pause_resume_replay ()
+{
+    application_handler.simulation_handler.simulation_replayer.toggle_pause_resume();
+}
+
+void replay_step_forward ()
+{
+    application_handler.simulation_handler.simulation_replayer.step_forward();
+}
+
+void replay_step_backward ()
+{
+    application_handler.simulation_handler.simulation_replayer.step_backward();
+}
+
+void increase_replay_speed ()
+{
+    application_handler.simulation_handler.simulation_replayer.increase_playback_speed();
+}
+
+void decrease_replay_speed ()
+{
+    application_handler.simulation_handler.simulation_replayer.decrease_playback_speed();
+}
+
 void increase_number_of_particles ()
 {
     bool success = application_handler.simulation_handler.particle_system.increase_number_of_particles();
@@ -3,7 +3,8 @@
 // This enum type is used for the different input contexts.
 enum Input_Behavior {
     INPUT_BEHAVIOR_IDLE,
-    INPUT_BEHAVIOR_SIMULATION
+    INPUT_BEHAVIOR_SIMULATION,
+    INPUT_BEHAVIOR_REPLAY
 };
 
 // We need one global object of the application handler.
@@ -20,6 +21,14 @@ void reload_scene ();
 void switch_scene (int scene_id);
 void pause_resume_simulation ();
 void simulate_one_step ();
+void toggle_recording ();
+void start_replay ();
+void stop_replay ();
+void pause_resume_replay ();
+void replay_step_forward ();
+void replay_step_backward ();
+void increase_replay_speed ();
+void decrease_replay_speed ();
 void increase_number_of_particles ();
 void decrease_number_of_particles ();
 void exit_application ();
@@ -12,7 +12,8 @@ Application_Handler::Application_Handler()
     this->current_state = IDLE;
     this->next_state = APPLICATION_INITIALIZATION;
     this->window = nullptr;
-    this->simulation_handler = Simulation_Handler();
+    // Note that the simulation handler is not reassigned here since it owns non-copyable
+    // resources (e.g. the background thread of the recorder). It is default constructed.
     this->input_handler = Input_Handler();
 }
 
@@ -17,7 +17,9 @@ enum Application_State
     APPLICATION_TERMINATION,
     SIMULATION_INITIALIZATION,
     SIMULATION_RUNNING,
-    SIMULATION_TERMINATION
+    SIMULATION_TERMINATION,
+    REPLAY_INITIALIZATION,
+    SIMULATION_REPLAY
 };
 
 class Application_Handler
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+
+// The names of the phases measured by rtgp_bench. They are the functions that are measured (like the names of the
+// trace scopes), so they do not change when the code that calls them changes. The baseline of rtgp_bench_compare
+// is keyed by these names as well.
+#define BENCH_PHASE_GRID_BUILD                  "Particle_System::generate_spatial_grid"
+#define BENCH_PHASE_DENSITY_PRESSURE_GRID       "Particle_System::calculate_density_pressure_spatial_grid"
+#define BENCH_PHASE_ACCELERATION_GRID           "Particle_System::calculate_acceleration_spatial_grid"
+#define BENCH_PHASE_VERLET_STEP_GRID            "Particle_System::calculate_verlet_step_spatial_grid"
+#define BENCH_PHASE_UPDATE_PARTICLE_VECTOR      "Particle_System::update_particle_vector"
+#define BENCH_PHASE_DENSITY_PRESSURE_BRUTE      "Particle_System::calculate_density_pressure_brute_force"
+#define BENCH_PHASE_ACCELERATION_BRUTE          "Particle_System::calculate_acceleration_brute_force"
+#define BENCH_PHASE_VERLET_STEP_BRUTE           "Particle_System::calculate_verlet_step_brute_force"
+// The density estimation also includes the reset of the counts or the merge of the histograms.
+#define BENCH_PHASE_ESTIMATE_DENSITY            "Marching_Cubes_Generator::estimate_density"
+// With the color field this phase evaluates the color field instead (including the spatial grid if it has to be built).
+#define BENCH_PHASE_COLOR_FIELD                 "Marching_Cubes_Generator::update_color_field"
+// With incremental updates this phase also collects the dirty cubes and only calculates their vertex values.
+#define BENCH_PHASE_CALCULATE_VERTEX_VALUES     "Marching_Cubes_Generator::calculate_vertex_values"
+#define BENCH_PHASE_COMPACT_ACTIVE_CUBES        "Marching_Cubes_Generator::compact_active_cubes"
+#define BENCH_PHASE_EXTRACT_MESH                "Marching_Cubes_Generator::extract_mesh"
+// The whole sparse mesh extraction (always with the particle count as scalar field).
+#define BENCH_PHASE_SPARSE_MESH                 "Sparse_Marching_Cubes_Generator::generate_mesh"
+
+// The performance test (MEASURE_EXECUTION_TIME) names its measurements after the measured expression, and older
+// results of rtgp_bench used the same names. These are the phases they belong to, so such files can still be
+// compared with the results of rtgp_bench.
+struct Bench_Phase_Alias
+{
+    const char* measured_expression;
+    const char* phase;
+};
+
+inline constexpr Bench_Phase_Alias BENCH_PHASE_ALIASES[] = {
+    { "this->parallel_for(&Particle_System::generate_spatial_grid, this->number_of_particles)", BENCH_PHASE_GRID_BUILD },
+    { "this->parallel_for_grid(&Particle_System::calculate_density_pressure_spatial_grid)", BENCH_PHASE_DENSITY_PRESSURE_GRID },
+    { "this->parallel_for_grid(&Particle_System::calculate_acceleration_spatial_grid)", BENCH_PHASE_ACCELERATION_GRID },
+    { "this->parallel_for_grid(&Particle_System::calculate_verlet_step_spatial_grid)", BENCH_PHASE_VERLET_STEP_GRID },
+    { "this->update_particle_vector()", BENCH_PHASE_UPDATE_PARTICLE_VECTOR },
+    { "this->parallel_for(&Particle_System::calculate_density_pressure_brute_force, this->number_of_particles)", BENCH_PHASE_DENSITY_PRESSURE_BRUTE },
+    { "this->parallel_for(&Particle_System::calculate_acceleration_brute_force, this->number_of_particles)", BENCH_PHASE_ACCELERATION_BRUTE },
+    { "this->parallel_for(&Particle_System::calculate_verlet_step_brute_force, this->number_of_particles)", BENCH_PHASE_VERLET_STEP_BRUTE },
+    { "this->parallel_for(&Marching_Cubes_Generator::estimate_density, this->particle_system->number_of_particles)", BENCH_PHASE_ESTIMATE_DENSITY },
+    { "this->update_color_field()", BENCH_PHASE_COLOR_FIELD },
+    { "this->parallel_for(&Marching_Cubes_Generator::calculate_vertex_values, this->number_of_cells_marching_cubes)", BENCH_PHASE_CALCULATE_VERTEX_VALUES },
+    { "this->compact_active_cubes()", BENCH_PHASE_COMPACT_ACTIVE_CUBES },
+    { "this->extract_mesh()", BENCH_PHASE_EXTRACT_MESH }
+};
+
+// Returns the phase of the measured function (the function itself if it is not an alias).
+inline std::string get_bench_phase_name (const std::string& function)
+{
+    for (const Bench_Phase_Alias& alias : BENCH_PHASE_ALIASES) {
+        if (function == alias.measured_expression) {
+            return alias.phase;
+        }
+    }
+    return function;
+}
@@ -0,0 +1,337 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "bench_phases.h"
+
+// Compares two sets of measurements (e.g. the results of rtgp_bench against the checked-in baseline) and
+// reports the speedups and regressions of every phase. For every phase (and configuration) found in both
+// files the repetitions are compared with the Mann-Whitney U test. The test does not assume normally
+// distributed execution times (which they are not, there are always some outliers caused by the scheduler)
+// and only uses the ranks, so single slow repetitions do not dominate the result.
+// A phase is a regression if the current measurements are significantly slower than the baseline (one-sided
+// p-value below alpha) and the median got slower by more than the minimum change (small but significant
+// changes are common with many repetitions and not worth failing for).
+// The program exits with 1 if there is at least one regression, so it can be used as a gate.
+// Both the csv files of rtgp_bench and the csv files of the performance test (function;execution_times) are
+// understood. The configuration columns of rtgp_bench (if there are any) are used to match the rows, the names of the
+// performance test are translated to the phases of rtgp_bench (see bench_phases.h).
+#define COMPARE_DEFAULT_BASELINE_FILENAME       "./bench_baseline.csv"
+#define COMPARE_DEFAULT_CURRENT_FILENAME        "./bench_results.csv"
+#define COMPARE_DEFAULT_ALPHA                   0.01
+#define COMPARE_DEFAULT_MIN_CHANGE              0.10
+// The columns used to match the rows of the two files (the ones missing in a file are ignored).
+#define COMPARE_KEY_COLUMNS                     { "particle_set", "computation_mode", "number_of_particles", "number_of_threads", "cube_edge_length" }
+// The performance test drops the first measurements (the caches are still cold), so we do the same
+// for files without warm-up steps.
+#define COMPARE_SKIPPED_MEASUREMENTS_WITHOUT_WARMUP 5
+
+// The measurements of one row.
+struct Measurement
+{
+    std::string function;
+    std::string configuration;
+    std::string unit;
+    std::vector<double> execution_times;
+};
+
+// The result of the comparison of one row.
+struct Comparison
+{
+    const Measurement* baseline;
+    const Measurement* current;
+    double baseline_median;
+    double current_median;
+    // current / baseline - 1, so positive values mean slower.
+    double change;
+    // One-sided p-values: the current measurements are slower / faster than the baseline.
+    double p_value_slower;
+    double p_value_faster;
+    bool is_regression;
+    bool is_improvement;
+};
+
+// All settings that can be given on the command line.
+struct Compare_Settings
+{
+    std::string baseline_filename;
+    std::string current_filename;
+    double alpha;
+    double min_change;
+};
+
+void print_usage (const char* program_name)
+{
+    std::cout << "Usage: " << program_name << " [options] [<baseline csv> [<current csv>]]" << std::endl
+        << "Compares the current measurements against the baseline (default " << COMPARE_DEFAULT_BASELINE_FILENAME << " and " << std::endl
+        << COMPARE_DEFAULT_CURRENT_FILENAME << ") and exits with 1 if a phase got significantly slower." << std::endl
+        << "Options:" << std::endl
+        << "  --alpha <value>               significance level of the Mann-Whitney U test (default " << COMPARE_DEFAULT_ALPHA << ")" << std::endl
+        << "  --min-change <value>          minimum relative change of the median to be reported, e.g. 0.1 for" << std::endl
+        << "                                10% (default " << COMPARE_DEFAULT_MIN_CHANGE << ")" << std::endl
+        << "  --help                        show this information" << std::endl;
+}
+
+// Parses the command line. Returns false if the arguments are invalid (or the help was requested).
+bool parse_arguments (int argc, char* argv[], Compare_Settings& settings)
+{
+    std::vector<std::string> filenames;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--help") {
+            return false;
+        }
+        if ((argument.size() < 2) || (argument.substr(0, 2) != "--")) {
+            filenames.push_back(argument);
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cout << "ERROR: Missing value for option '" << argument << "'." << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        char* end;
+        double number = std::strtod(value.c_str(), &end);
+        if ((value.empty() == true) || (*end != '\0') || (number < 0.0)) {
+            std::cout << "ERROR: Invalid value '" << value << "' for option '" << argument << "'." << std::endl;
+            return false;
+        }
+        if (argument == "--alpha") {
+            settings.alpha = number;
+        }
+        else if (argument == "--min-change") {
+            settings.min_change = number;
+        }
+        else {
+            std::cout << "ERROR: Unknown option '" << argument << "'." << std::endl;
+            return false;
+        }
+    }
+    if (filenames.size() > 2) {
+        std::cout << "ERROR: Only two files can be compared." << std::endl;
+        return false;
+    }
+    if (filenames.size() >= 1) {
+        settings.baseline_filename = filenames[0];
+    }
+    if (filenames.size() == 2) {
+        settings.current_filename = filenames[1];
+    }
+    return true;
+}
+
+
+// ====================================== INPUT ======================================
+
+std::vector<std::string> split (const std::string& value, char delimiter)
+{
+    std::vector<std::string> elements;
+    std::stringstream stream(value);
+    std::string element;
+    while (std::getline(stream, element, delimiter)) {
+        elements.push_back(element);
+    }
+    return elements;
+}
+
+// Reads a csv file of rtgp_bench or of the performance test. Returns false if the file can not be read.
+bool load_measurements (const std::string& filename, std::vector<Measurement>& measurements)
+{
+    std::ifstream file (filename);
+    if (file.is_open() == false) {
+        std::cout << "Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    std::string line;
+    std::getline(file, line);
+    std::vector<std::string> header = split(line, ';');
+    std::map<std::string, size_t> columns;
+    for (size_t i = 0; i < header.size(); i++) {
+        columns[header[i]] = i;
+    }
+    if ((columns.count("function") == 0) || (columns.count("execution_times") == 0)) {
+        std::cout << "ERROR: '" << filename << "' has no 'function' and 'execution_times' columns." << std::endl;
+        return false;
+    }
+    while (std::getline(file, line)) {
+        if (line.empty() == true) {
+            continue;
+        }
+        std::vector<std::string> cells = split(line, ';');
+        if (cells.size() <= columns["execution_times"]) {
+            std::cout << "ERROR: Invalid row in '" << filename << "': '" << line << "'." << std::endl;
+            return false;
+        }
+        Measurement measurement;
+        measurement.function = get_bench_phase_name(cells[columns["function"]]);
+        // The performance test measures in milliseconds and has no unit column.
+        measurement.unit = ((columns.count("unit") == 1) && (cells.size() > columns["unit"])) ? cells[columns["unit"]] : "ms";
+        for (std::string key_column : COMPARE_KEY_COLUMNS) {
+            if ((columns.count(key_column) == 1) && (cells.size() > columns[key_column])) {
+                measurement.configuration += key_column + "=" + cells[columns[key_column]] + " ";
+            }
+        }
+        for (const std::string& value : split(cells[columns["execution_times"]], ',')) {
+            measurement.execution_times.push_back(std::atof(value.c_str()));
+        }
+        if (columns.count("warmup_steps") == 0) {
+            size_t skipped = std::min(measurement.execution_times.size(), (size_t)COMPARE_SKIPPED_MEASUREMENTS_WITHOUT_WARMUP);
+            measurement.execution_times.erase(measurement.execution_times.begin(), measurement.execution_times.begin() + skipped);
+        }
+        measurements.push_back(measurement);
+    }
+    return true;
+}
+
+
+// ====================================== STATISTICS ======================================
+
+double get_median (std::vector<double> values)
+{
+    if (values.empty() == true) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return (n % 2 == 1) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+// The Mann-Whitney U test using the normal approximation (with tie and continuity correction).
+// Writes the one-sided p-values for "b is larger than a" and "b is smaller than a".
+void mann_whitney_u_test (const std::vector<double>& a, const std::vector<double>& b, double& p_value_larger, double& p_value_smaller)
+{
+    p_value_larger = 1.0;
+    p_value_smaller = 1.0;
+    double n_a = a.size();
+    double n_b = b.size();
+    if ((n_a == 0) || (n_b == 0)) {
+        return;
+    }
+    // Rank all values together. Equal values get the average of their ranks.
+    std::vector<std::pair<double, bool>> values;
+    for (double value : a)  values.push_back({ value, false });
+    for (double value : b)  values.push_back({ value, true });
+    std::sort(values.begin(), values.end());
+    double n = values.size();
+    double rank_sum_b = 0.0;
+    double tie_correction = 0.0;
+    for (size_t i = 0; i < values.size(); ) {
+        size_t j = i;
+        while ((j < values.size()) && (values[j].first == values[i].first)) {
+            j++;
+        }
+        double number_of_ties = j - i;
+        double average_rank = (i + 1 + j) / 2.0;
+        for (size_t k = i; k < j; k++) {
+            if (values[k].second == true) {
+                rank_sum_b += average_rank;
+            }
+        }
+        tie_correction += number_of_ties * number_of_ties * number_of_ties - number_of_ties;
+        i = j;
+    }
+    double u_b = rank_sum_b - n_b * (n_b + 1.0) / 2.0;
+    double mean = n_a * n_b / 2.0;
+    double variance = n_a * n_b / 12.0 * ((n + 1.0) - tie_correction / (n * (n - 1.0)));
+    if (variance <= 0.0) {
+        // All values are the same.
+        return;
+    }
+    double standard_deviation = sqrt(variance);
+    double z_larger = (u_b - mean - 0.5) / standard_deviation;
+    double z_smaller = (mean - u_b - 0.5) / standard_deviation;
+    p_value_larger = 0.5 * erfc(z_larger / sqrt(2.0));
+    p_value_smaller = 0.5 * erfc(z_smaller / sqrt(2.0));
+}
+
+Comparison compare (const Measurement& baseline, const Measurement& current, Compare_Settings& settings)
+{
+    Comparison comparison;
+    comparison.baseline = &baseline;
+    comparison.current = &current;
+    comparison.baseline_median = get_median(baseline.execution_times);
+    comparison.current_median = get_median(current.execution_times);
+    comparison.change = (comparison.baseline_median > 0.0) ? comparison.current_median / comparison.baseline_median - 1.0 : 0.0;
+    mann_whitney_u_test(baseline.execution_times, current.execution_times, comparison.p_value_slower, comparison.p_value_faster);
+    comparison.is_regression = (comparison.p_value_slower < settings.alpha) && (comparison.change > settings.min_change);
+    comparison.is_improvement = (comparison.p_value_faster < settings.alpha) && (comparison.change < -settings.min_change);
+    return comparison;
+}
+
+
+// ====================================== MAIN ======================================
+
+int main (int argc, char* argv[])
+{
+    Compare_Settings settings {
+        COMPARE_DEFAULT_BASELINE_FILENAME,
+        COMPARE_DEFAULT_CURRENT_FILENAME,
+        COMPARE_DEFAULT_ALPHA,
+        COMPARE_DEFAULT_MIN_CHANGE
+    };
+    if (parse_arguments(argc, argv, settings) == false) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    std::vector<Measurement> baseline_measurements;
+    std::vector<Measurement> current_measurements;
+    if ((load_measurements(settings.baseline_filename, baseline_measurements) == false) ||
+        (load_measurements(settings.current_filename, current_measurements) == false)) {
+        return 1;
+    }
+
+    std::cout << "Comparing '" << settings.current_filename << "' against the baseline '" << settings.baseline_filename 
+        << "' (alpha " << settings.alpha << ", min. change " << settings.min_change * 100.0 << "%)" << std::endl;
+    unsigned int number_of_regressions = 0;
+    unsigned int number_of_improvements = 0;
+    unsigned int number_of_compared_phases = 0;
+    for (const Measurement& current : current_measurements) {
+        auto baseline = std::find_if(baseline_measurements.begin(), baseline_measurements.end(), [&current] (const Measurement& measurement) {
+            return (measurement.function == current.function) && (measurement.configuration == current.configuration);
+        });
+        std::cout << current.function << std::endl << "    " << current.configuration;
+        if (baseline == baseline_measurements.end()) {
+            std::cout << "not in the baseline" << std::endl;
+            continue;
+        }
+        if (baseline->unit != current.unit) {
+            std::cout << "different units (" << baseline->unit << " and " << current.unit << ")" << std::endl;
+            continue;
+        }
+        Comparison comparison = compare(*baseline, current, settings);
+        number_of_compared_phases++;
+        std::cout << std::endl << std::fixed << std::setprecision(2) << "    median " << comparison.baseline_median << " -> " 
+            << comparison.current_median << " " << current.unit << ", speedup " 
+            << ((comparison.current_median > 0.0) ? comparison.baseline_median / comparison.current_median : 0.0) << "x ("
+            << std::showpos << comparison.change * 100.0 << std::noshowpos << "%), " << std::setprecision(4) << "p(slower) " 
+            << comparison.p_value_slower << ", p(faster) " << comparison.p_value_faster << std::defaultfloat;
+        if (comparison.is_regression == true) {
+            std::cout << "  REGRESSION";
+            number_of_regressions++;
+        }
+        else if (comparison.is_improvement == true) {
+            std::cout << "  improvement";
+            number_of_improvements++;
+        }
+        std::cout << std::endl;
+    }
+    for (const Measurement& baseline : baseline_measurements) {
+        auto current = std::find_if(current_measurements.begin(), current_measurements.end(), [&baseline] (const Measurement& measurement) {
+            return (measurement.function == baseline.function) && (measurement.configuration == baseline.configuration);
+        });
+        if (current == current_measurements.end()) {
+            std::cout << baseline.function << std::endl << "    " << baseline.configuration << "not in the current measurements" << std::endl;
+        }
+    }
+
+    std::cout << number_of_compared_phases << " phase(s) compared: " << number_of_regressions << " regression(s), " 
+        << number_of_improvements << " improvement(s)." << std::endl;
+    return (number_of_regressions > 0) ? 1 : 0;
+}
\ No newline at end of file
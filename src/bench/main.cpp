@@ -0,0 +1,359 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+#include "phase_benchmark.h"
+#include "../simulation_handler/simulation_handler.h"
+#include "../utils/helper.h"
+#include "../utils/command_line.h"
+
+// The benchmark sweeps over particle sets, computation modes, thread counts and marching cubes edge lengths
+// and measures every phase on its own (see phase_benchmark.h). The results are written as csv file (in the
+// format of the performance test, extended by the configuration and the statistics) and as json file.
+#define BENCH_DEFAULT_PARTICLE_COUNTS           "216,512,1000,1728,4096,32768,262144,1000000"
+#define BENCH_DEFAULT_THREADS                   "1,8"
+#define BENCH_DEFAULT_CUBE_EDGE_LENGTHS         "0.1"
+#define BENCH_DEFAULT_CSV_FILENAME              "./bench_results.csv"
+#define BENCH_DEFAULT_JSON_FILENAME             "./bench_results.json"
+
+// All settings that can be given on the command line.
+struct Bench_Settings
+{
+    std::vector<float> particle_counts;
+    // If a scene is given, the particle sets are derived from the scene (one per spacing)
+    // instead of using the synthetic lattices.
+    int scene;
+    std::vector<float> particle_spacings;
+    std::vector<Computation_Mode> computation_modes;
+    std::vector<int> number_of_threads;
+    std::vector<float> cube_edge_lengths;
+    Density_Estimation_Mode density_estimation_mode;
+    Scalar_Field_Mode scalar_field_mode;
+    bool incremental_updates;
+    int warmup_steps;
+    int repetitions;
+    std::string csv_filename;
+    std::string json_filename;
+};
+
+void print_usage (const char* program_name, const std::string& shared_options_usage)
+{
+    std::cout << "Usage: " << program_name << " [options]" << std::endl
+        << "Options:" << std::endl
+        << "  --counts <list>               particle counts of the synthetic particle sets (cubes, so the" << std::endl
+        << "                                next cube number is used; default " << BENCH_DEFAULT_PARTICLE_COUNTS << ")" << std::endl
+        << "  --scene <id>                  use the particle sets of a scene (1 - 5) instead" << std::endl
+        << "  --spacings <list>             particle spacings for the scene (default " << PARTICLE_INITIAL_DISTANCE_INIT << ")" << std::endl
+        << "  --mode <grid|brute-force|all> computation mode(s) (default grid)" << std::endl
+        << shared_options_usage
+        << "  --cube-edge-lengths <list>    marching cubes edge lengths, 0 to skip the marching cubes" << std::endl
+        << "                                (default " << BENCH_DEFAULT_CUBE_EDGE_LENGTHS << ")" << std::endl
+        << "  --density-estimation <auto|atomic|histograms|spatial-grid>" << std::endl
+        << "                                how the marching cubes count the particles (default auto)" << std::endl
+        << "  --scalar-field <count|color-field>" << std::endl
+        << "                                the scalar field of the marching cubes (default count)" << std::endl
+        << "  --incremental <on|off>        only update the marching cubes that changed (default on)" << std::endl
+        << "  --warmup <number>             not measured steps per configuration (default " << BENCH_DEFAULT_WARMUP_STEPS << ")" << std::endl
+        << "  --repetitions <number>        measured steps per configuration (default " << BENCH_DEFAULT_REPETITIONS << ")" << std::endl
+        << "  --csv <file>                  csv output (default " << BENCH_DEFAULT_CSV_FILENAME << ")" << std::endl
+        << "  --json <file>                 json output (default " << BENCH_DEFAULT_JSON_FILENAME << ")" << std::endl
+        << "  --help                        show this information" << std::endl
+        << "Lists are comma separated, e.g. --threads 1,2,4,8" << std::endl;
+}
+
+// The options that the benchmark shares with the other tools (see command_line.h). The scene and the mode are not
+// shared, because the benchmark runs without a scene by default and can run both modes.
+Shared_Options get_shared_options (Bench_Settings& settings)
+{
+    Shared_Options shared_options;
+    shared_options.thread_counts = &settings.number_of_threads;
+    return shared_options;
+}
+
+// Parses an option of the benchmark.
+Option_Status parse_option (const std::string& option, const std::string& value, Bench_Settings& settings)
+{
+    if (option == "--counts") {
+        if (parse_list(value, settings.particle_counts) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--scene") {
+        settings.scene = std::atoi(value.c_str());
+    }
+    else if (option == "--spacings") {
+        if (parse_list(value, settings.particle_spacings) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--mode") {
+        if (value == "grid")                settings.computation_modes = { COMPUTATION_MODE_SPATIAL_GRID };
+        else if (value == "brute-force")    settings.computation_modes = { COMPUTATION_MODE_BRUTE_FORCE };
+        else if (value == "all")            settings.computation_modes = { COMPUTATION_MODE_BRUTE_FORCE, COMPUTATION_MODE_SPATIAL_GRID };
+        else                                return OPTION_INVALID;
+    }
+    else if (option == "--cube-edge-lengths") {
+        if (parse_list(value, settings.cube_edge_lengths) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--density-estimation") {
+        if (value == "auto")                settings.density_estimation_mode = DENSITY_ESTIMATION_AUTO;
+        else if (value == "atomic")         settings.density_estimation_mode = DENSITY_ESTIMATION_ATOMIC;
+        else if (value == "histograms")     settings.density_estimation_mode = DENSITY_ESTIMATION_PRIVATE_HISTOGRAMS;
+        else if (value == "spatial-grid")   settings.density_estimation_mode = DENSITY_ESTIMATION_SPATIAL_GRID;
+        else                                return OPTION_INVALID;
+    }
+    else if (option == "--scalar-field") {
+        if (value == "count")               settings.scalar_field_mode = SCALAR_FIELD_PARTICLE_COUNT;
+        else if (value == "color-field")    settings.scalar_field_mode = SCALAR_FIELD_COLOR_FIELD;
+        else                                return OPTION_INVALID;
+    }
+    else if (option == "--incremental") {
+        if (value == "on")                  settings.incremental_updates = true;
+        else if (value == "off")            settings.incremental_updates = false;
+        else                                return OPTION_INVALID;
+    }
+    else if (option == "--warmup") {
+        settings.warmup_steps = std::atoi(value.c_str());
+        if (settings.warmup_steps < 0) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--repetitions") {
+        settings.repetitions = std::atoi(value.c_str());
+        if (settings.repetitions < 1) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--csv") {
+        settings.csv_filename = value;
+    }
+    else if (option == "--json") {
+        settings.json_filename = value;
+    }
+    else {
+        return OPTION_UNKNOWN;
+    }
+    return OPTION_VALID;
+}
+
+
+// ====================================== OUTPUT ======================================
+
+const char* to_short_string (Computation_Mode computation_mode)
+{
+    return (computation_mode == COMPUTATION_MODE_BRUTE_FORCE) ? "brute_force" : "spatial_grid";
+}
+
+// The csv file uses the columns of the performance test (function;execution_times), so the notebook can read it.
+// The configuration and the statistics are appended as additional columns. All times are in nanoseconds.
+bool save_results_to_csv (const std::string& filename, std::vector<Phase_Result>& results)
+{
+    const char cell_delimiter = ';';
+    const char number_delimiter = ',';
+    std::ofstream file (filename);
+    if (file.is_open() == false) {
+        std::cout << "Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    file << "function" << cell_delimiter << "execution_times" << cell_delimiter << "unit" << cell_delimiter 
+        << "particle_set" << cell_delimiter << "computation_mode" << cell_delimiter << "number_of_particles" << cell_delimiter 
+        << "particle_spacing" << cell_delimiter << "number_of_threads" << cell_delimiter << "cube_edge_length" << cell_delimiter 
+        << "warmup_steps" << cell_delimiter << "repetitions" << cell_delimiter << "average" << cell_delimiter << "median" << cell_delimiter 
+        << "min" << cell_delimiter << "max" << cell_delimiter << "std" << cell_delimiter << "triangles" << cell_delimiter 
+        << "triangles_per_second" << cell_delimiter << "memory_bytes" << std::endl;
+    for (const Phase_Result& result : results) {
+        file << result.phase << cell_delimiter;
+        for (size_t i = 0; i < result.execution_times.size(); i++) {
+            file << result.execution_times[i];
+            if (i != result.execution_times.size() - 1) {
+                file << number_delimiter;
+            }
+        }
+        file << cell_delimiter << "ns" << cell_delimiter << result.particle_set << cell_delimiter << to_short_string(result.computation_mode) 
+            << cell_delimiter << result.number_of_particles << cell_delimiter << result.particle_initial_distance << cell_delimiter 
+            << result.number_of_threads << cell_delimiter << result.cube_edge_length << cell_delimiter << result.warmup_steps 
+            << cell_delimiter << result.repetitions << cell_delimiter << result.statistics.average << cell_delimiter 
+            << result.statistics.median << cell_delimiter << result.statistics.min << cell_delimiter << result.statistics.max 
+            << cell_delimiter << result.statistics.std << cell_delimiter << result.number_of_triangles << cell_delimiter 
+            << result.get_triangles_per_second() << cell_delimiter << result.memory_bytes << std::endl;
+    }
+    file.close();
+    std::cout << "csv file containing the benchmark results saved to: '" << filename << "'" << std::endl;
+    return true;
+}
+
+// Escapes the characters that are not allowed within a json string.
+std::string to_json_string (const std::string& value)
+{
+    std::string result = "\"";
+    for (char character : value) {
+        if ((character == '"') || (character == '\\')) {
+            result += '\\';
+        }
+        result += character;
+    }
+    return result + "\"";
+}
+
+bool save_results_to_json (const std::string& filename, std::vector<Phase_Result>& results)
+{
+    std::ofstream file (filename);
+    if (file.is_open() == false) {
+        std::cout << "Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    file << "{" << std::endl << "  \"unit\": \"ns\"," << std::endl << "  \"results\": [" << std::endl;
+    for (size_t r = 0; r < results.size(); r++) {
+        const Phase_Result& result = results[r];
+        file << "    {" << std::endl
+            << "      \"function\": " << to_json_string(result.phase) << "," << std::endl
+            << "      \"particle_set\": " << to_json_string(result.particle_set) << "," << std::endl
+            << "      \"computation_mode\": \"" << to_short_string(result.computation_mode) << "\"," << std::endl
+            << "      \"number_of_particles\": " << result.number_of_particles << "," << std::endl
+            << "      \"particle_spacing\": " << result.particle_initial_distance << "," << std::endl
+            << "      \"number_of_threads\": " << result.number_of_threads << "," << std::endl
+            << "      \"cube_edge_length\": " << result.cube_edge_length << "," << std::endl
+            << "      \"warmup_steps\": " << result.warmup_steps << "," << std::endl
+            << "      \"repetitions\": " << result.repetitions << "," << std::endl
+            << "      \"statistics\": { \"average\": " << result.statistics.average << ", \"median\": " << result.statistics.median 
+                << ", \"min\": " << result.statistics.min << ", \"max\": " << result.statistics.max << ", \"std\": " << result.statistics.std << " }," << std::endl
+            << "      \"triangles\": " << result.number_of_triangles << "," << std::endl
+            << "      \"triangles_per_second\": " << result.get_triangles_per_second() << "," << std::endl
+            << "      \"memory_bytes\": " << result.memory_bytes << "," << std::endl
+            << "      \"execution_times\": [";
+        for (size_t i = 0; i < result.execution_times.size(); i++) {
+            file << result.execution_times[i] << ((i != result.execution_times.size() - 1) ? ", " : "");
+        }
+        file << "]" << std::endl << "    }" << ((r != results.size() - 1) ? "," : "") << std::endl;
+    }
+    file << "  ]" << std::endl << "}" << std::endl;
+    file.close();
+    std::cout << "json file containing the benchmark results saved to: '" << filename << "'" << std::endl;
+    return true;
+}
+
+// Prints the median of every phase of the last configuration in microseconds.
+void print_results (std::vector<Phase_Result>& results, unsigned int first_index)
+{
+    for (unsigned int i = first_index; i < results.size(); i++) {
+        std::cout << "    " << results[i].phase;
+        if (results[i].cube_edge_length > 0.0f) {
+            std::cout << " (edge length " << results[i].cube_edge_length << ")";
+        }
+        std::cout << ": median " << results[i].statistics.median / 1000.0 << " us, std " 
+            << results[i].statistics.std / 1000.0 << " us";
+        if (results[i].number_of_triangles > 0) {
+            std::cout << ", " << to_string_with_separator(results[i].number_of_triangles) << " triangles, " 
+                << results[i].get_triangles_per_second() << " triangles/s, " 
+                << results[i].memory_bytes / (1024.0 * 1024.0) << " MiB";
+        }
+        std::cout << std::endl;
+    }
+}
+
+
+// ====================================== MAIN ======================================
+
+int main (int argc, char* argv[])
+{
+    Bench_Settings settings;
+    settings.scene = 0;
+    parse_list(BENCH_DEFAULT_PARTICLE_COUNTS, settings.particle_counts);
+    settings.particle_spacings = { PARTICLE_INITIAL_DISTANCE_INIT };
+    settings.computation_modes = { COMPUTATION_MODE_SPATIAL_GRID };
+    parse_list(BENCH_DEFAULT_THREADS, settings.number_of_threads);
+    parse_list(BENCH_DEFAULT_CUBE_EDGE_LENGTHS, settings.cube_edge_lengths);
+    settings.density_estimation_mode = DENSITY_ESTIMATION_AUTO;
+    settings.scalar_field_mode = SCALAR_FIELD_PARTICLE_COUNT;
+    settings.incremental_updates = true;
+    settings.warmup_steps = BENCH_DEFAULT_WARMUP_STEPS;
+    settings.repetitions = BENCH_DEFAULT_REPETITIONS;
+    settings.csv_filename = BENCH_DEFAULT_CSV_FILENAME;
+    settings.json_filename = BENCH_DEFAULT_JSON_FILENAME;
+    Shared_Options shared_options = get_shared_options(settings);
+    std::string shared_options_usage = get_shared_options_usage(shared_options);
+    bool valid = parse_command_line(argc, argv, shared_options, [&settings] (const std::string& option, const std::string& value) {
+        return parse_option(option, value, settings);
+    });
+    if (valid == false) {
+        print_usage(argv[0], shared_options_usage);
+        return 1;
+    }
+    // An edge length of zero means that the marching cubes are skipped.
+    std::vector<float> cube_edge_lengths;
+    for (float cube_edge_length : settings.cube_edge_lengths) {
+        if (cube_edge_length <= 0.0f) {
+            continue;
+        }
+        if ((cube_edge_length < MARCHING_CUBES_CUBE_EDGE_LENGTH_MIN) || (cube_edge_length > MARCHING_CUBES_CUBE_EDGE_LENGTH_MAX)) {
+            std::cout << "ERROR: The marching cubes edge length needs to be within [" << MARCHING_CUBES_CUBE_EDGE_LENGTH_MIN << "; " 
+                << MARCHING_CUBES_CUBE_EDGE_LENGTH_MAX << "]." << std::endl;
+            return 1;
+        }
+        cube_edge_lengths.push_back(cube_edge_length);
+    }
+
+    // The scenes are the same as in the application.
+    Simulation_Handler simulation_handler;
+    simulation_handler.register_default_scenes();
+    if ((settings.scene != 0) && ((settings.scene < 1) || (settings.scene > simulation_handler.available_scenes.size()))) {
+        std::cout << "ERROR: The scene id needs to be within [1; " << simulation_handler.available_scenes.size() << "]." << std::endl;
+        return 1;
+    }
+    unsigned int number_of_particle_sets = (settings.scene == 0) ? settings.particle_counts.size() : settings.particle_spacings.size();
+
+    std::vector<Phase_Result> results;
+    // The density estimation from the spatial grid is checked against counting the particles before every configuration.
+    bool density_counts_are_the_same = true;
+    Phase_Benchmark benchmark;
+    for (unsigned int set = 0; set < number_of_particle_sets; set++) {
+        bool loaded;
+        if (settings.scene == 0) {
+            // The synthetic particle sets are cubes, so use the next cube number.
+            unsigned int particles_per_axis = (unsigned int)ceil(cbrt(settings.particle_counts.at(set)) - 0.001);
+            loaded = benchmark.load_lattice(particles_per_axis);
+        }
+        else {
+            loaded = benchmark.load_scene(simulation_handler.available_scenes.at(settings.scene - 1), settings.particle_spacings.at(set));
+        }
+        if (loaded == false) {
+            return 1;
+        }
+        for (Computation_Mode computation_mode : settings.computation_modes) {
+            if ((computation_mode == COMPUTATION_MODE_BRUTE_FORCE) && (benchmark.get_number_of_particles() > BENCH_BRUTE_FORCE_MAX_PARTICLES)) {
+                std::cout << "Skipping the brute force implementation for " << to_string_with_separator(benchmark.get_number_of_particles()) 
+                    << " particles." << std::endl;
+                continue;
+            }
+            for (int number_of_threads : settings.number_of_threads) {
+                Benchmark_Configuration configuration {
+                    computation_mode,
+                    number_of_threads,
+                    cube_edge_lengths,
+                    settings.density_estimation_mode,
+                    settings.scalar_field_mode,
+                    settings.incremental_updates,
+                    settings.warmup_steps,
+                    settings.repetitions
+                };
+                std::cout << "Benchmarking " << to_string_with_separator(benchmark.get_number_of_particles()) << " particles, " 
+                    << to_string(computation_mode) << ", " << configuration.number_of_threads << " thread(s) ..." << std::endl;
+                if ((settings.scalar_field_mode == SCALAR_FIELD_PARTICLE_COUNT) && (benchmark.check_density_estimation(configuration) == false)) {
+                    density_counts_are_the_same = false;
+                }
+                unsigned int first_index = results.size();
+                benchmark.run(configuration, results);
+                print_results(results, first_index);
+            }
+        }
+    }
+
+    bool saved = save_results_to_csv(settings.csv_filename, results);
+    saved = save_results_to_json(settings.json_filename, results) && saved;
+    return ((saved == true) && (density_counts_are_the_same == true)) ? 0 : 1;
+}
\ No newline at end of file
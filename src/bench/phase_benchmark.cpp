@@ -0,0 +1,302 @@
+#include "phase_benchmark.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+
+// ====================================== STATISTICS ======================================
+
+void Phase_Statistics::calculate (const std::vector<long long>& execution_times)
+{
+    if (execution_times.empty() == true) {
+        this->average = this->median = this->min = this->max = this->std = 0.0;
+        return;
+    }
+    std::vector<long long> sorted_times = execution_times;
+    std::sort(sorted_times.begin(), sorted_times.end());
+    size_t n = sorted_times.size();
+    this->min = sorted_times.front();
+    this->max = sorted_times.back();
+    this->median = (n % 2 == 1) ? sorted_times[n / 2] : (sorted_times[n / 2 - 1] + sorted_times[n / 2]) / 2.0;
+    double sum = 0.0;
+    for (long long time : sorted_times) {
+        sum += time;
+    }
+    this->average = sum / n;
+    // The sample standard deviation (like the notebook, it is only defined for more than one value).
+    double sum_of_squares = 0.0;
+    for (long long time : sorted_times) {
+        sum_of_squares += (time - this->average) * (time - this->average);
+    }
+    this->std = (n > 1) ? sqrt(sum_of_squares / (n - 1)) : 0.0;
+}
+
+double Phase_Result::get_triangles_per_second () const
+{
+    if (this->statistics.median <= 0.0) {
+        return 0.0;
+    }
+    return this->number_of_triangles / (this->statistics.median / 1.0e9);
+}
+
+
+// ====================================== PARTICLE SETS ======================================
+
+Phase_Benchmark::Phase_Benchmark ()
+{
+    this->particle_initial_distance = PARTICLE_INITIAL_DISTANCE_INIT;
+    this->results = nullptr;
+    this->first_result_index = 0;
+    this->number_of_simulation_phases = 0;
+    // There is no cursor, so there are no external forces. The gravity always points down, so the
+    // results do not depend on the number of steps already simulated.
+    this->particle_system.external_forces_active = false;
+    this->particle_system.change_gravity_mode(GRAVITY_NORMAL);
+}
+
+bool Phase_Benchmark::load_lattice (unsigned int particles_per_axis)
+{
+    float particle_initial_distance = BENCH_LATTICE_EDGE_LENGTH / particles_per_axis;
+    if ((particle_initial_distance < PARTICLE_INITIAL_DISTANCE_MIN) || (particle_initial_distance > PARTICLE_INITIAL_DISTANCE_MAX)) {
+        std::cout << "ERROR: " << particles_per_axis << " particles per axis result in a particle spacing outside of [" 
+            << PARTICLE_INITIAL_DISTANCE_MIN << "; " << PARTICLE_INITIAL_DISTANCE_MAX << "]." << std::endl;
+        return false;
+    }
+    // The same setup as the first scene: the fluid cube in the middle of a simulation space twice as big.
+    this->particle_set = "lattice";
+    this->particle_initial_distance = particle_initial_distance;
+    this->simulation_space = Cuboid(-BENCH_LATTICE_EDGE_LENGTH, BENCH_LATTICE_EDGE_LENGTH, 
+        -BENCH_LATTICE_EDGE_LENGTH, BENCH_LATTICE_EDGE_LENGTH, -BENCH_LATTICE_EDGE_LENGTH, BENCH_LATTICE_EDGE_LENGTH);
+    this->fluid_starting_positions = std::vector<Cuboid> {
+        Cuboid(-BENCH_LATTICE_EDGE_LENGTH / 2, BENCH_LATTICE_EDGE_LENGTH / 2, -BENCH_LATTICE_EDGE_LENGTH / 2, 
+            BENCH_LATTICE_EDGE_LENGTH / 2, -BENCH_LATTICE_EDGE_LENGTH / 2, BENCH_LATTICE_EDGE_LENGTH / 2)
+    };
+    this->particle_system.set_particle_initial_distance(this->particle_initial_distance);
+    this->particle_system.set_simulation_space(&this->simulation_space);
+    this->particle_system.generate_initial_particles(this->fluid_starting_positions);
+    return true;
+}
+
+bool Phase_Benchmark::load_scene (Scene_Information& scene, float particle_initial_distance)
+{
+    if (this->particle_system.set_particle_initial_distance(particle_initial_distance) == false) {
+        std::cout << "ERROR: The particle spacing needs to be within [" << PARTICLE_INITIAL_DISTANCE_MIN << "; " 
+            << PARTICLE_INITIAL_DISTANCE_MAX << "]." << std::endl;
+        return false;
+    }
+    this->particle_set = scene.description;
+    this->particle_initial_distance = particle_initial_distance;
+    this->simulation_space = scene.simulation_space;
+    this->fluid_starting_positions = scene.fluid_starting_positions;
+    this->particle_system.set_simulation_space(&this->simulation_space);
+    this->particle_system.generate_initial_particles(this->fluid_starting_positions);
+    return true;
+}
+
+unsigned int Phase_Benchmark::get_number_of_particles ()
+{
+    return this->particle_system.number_of_particles;
+}
+
+
+// ====================================== PHASES ======================================
+
+void Phase_Benchmark::add_execution_time (unsigned int phase, std::chrono::steady_clock::time_point start)
+{
+    auto end = std::chrono::steady_clock::now();
+    if (this->results != nullptr) {
+        this->results->at(this->first_result_index + phase).execution_times.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+    }
+}
+
+void Phase_Benchmark::step_spatial_grid ()
+{
+    // The same as Particle_System::simulate_spatial_grid, but every phase is measured on its own.
+    this->particle_system.simulation_step++;
+    auto start = std::chrono::steady_clock::now();
+    this->particle_system.spatial_grid.clear();
+    this->particle_system.spatial_grid.resize(this->particle_system.number_of_cells);
+    this->particle_system.parallel_for(&Particle_System::generate_spatial_grid, this->particle_system.number_of_particles);
+    this->add_execution_time(0, start);
+    start = std::chrono::steady_clock::now();
+    this->particle_system.parallel_for_grid(&Particle_System::calculate_density_pressure_spatial_grid);
+    this->add_execution_time(1, start);
+    start = std::chrono::steady_clock::now();
+    this->particle_system.parallel_for_grid(&Particle_System::calculate_acceleration_spatial_grid);
+    this->add_execution_time(2, start);
+    start = std::chrono::steady_clock::now();
+    this->particle_system.parallel_for_grid(&Particle_System::calculate_verlet_step_spatial_grid);
+    this->add_execution_time(3, start);
+    start = std::chrono::steady_clock::now();
+    this->particle_system.update_particle_vector();
+    this->add_execution_time(4, start);
+    // Like after simulate_spatial_grid, the grid holds the current particles (e.g. for the color field).
+    this->particle_system.spatial_grid_is_current = true;
+}
+
+void Phase_Benchmark::step_brute_force ()
+{
+    // The same as Particle_System::simulate_brute_force, but every phase is measured on its own.
+    this->particle_system.simulation_step++;
+    auto start = std::chrono::steady_clock::now();
+    this->particle_system.parallel_for(&Particle_System::calculate_density_pressure_brute_force, this->particle_system.number_of_particles);
+    this->add_execution_time(0, start);
+    start = std::chrono::steady_clock::now();
+    this->particle_system.parallel_for(&Particle_System::calculate_acceleration_brute_force, this->particle_system.number_of_particles);
+    this->add_execution_time(1, start);
+    start = std::chrono::steady_clock::now();
+    this->particle_system.parallel_for(&Particle_System::calculate_verlet_step_brute_force, this->particle_system.number_of_particles);
+    this->add_execution_time(2, start);
+    this->particle_system.particles_changed();
+}
+
+void Phase_Benchmark::step_marching_cubes ()
+{
+    // The same as Marching_Cubes_Generator::generate_marching_cubes for an unchanged edge length.
+    for (unsigned int i = 0; i < this->marching_cubes_generators.size(); i++) {
+        Marching_Cubes_Generator& generator = *this->marching_cubes_generators.at(i);
+        unsigned int phase = this->number_of_simulation_phases + BENCH_NUMBER_OF_MARCHING_CUBES_PHASES * i;
+        auto start = std::chrono::steady_clock::now();
+        generator.update_scalar_field();
+        this->add_execution_time(phase, start);
+        start = std::chrono::steady_clock::now();
+        generator.update_vertex_values();
+        this->add_execution_time(phase + 1, start);
+        start = std::chrono::steady_clock::now();
+        generator.compact_active_cubes();
+        this->add_execution_time(phase + 2, start);
+        start = std::chrono::steady_clock::now();
+        generator.extract_mesh();
+        this->add_execution_time(phase + 3, start);
+        if (this->results != nullptr) {
+            this->results->at(this->first_result_index + phase + 3).number_of_triangles = generator.get_mesh().get_number_of_triangles();
+            this->results->at(this->first_result_index + phase + 3).memory_bytes = generator.get_memory_footprint();
+        }
+        Sparse_Marching_Cubes_Generator& sparse_generator = *this->sparse_marching_cubes_generators.at(i);
+        start = std::chrono::steady_clock::now();
+        sparse_generator.generate_mesh();
+        this->add_execution_time(phase + 4, start);
+        if (this->results != nullptr) {
+            this->results->at(this->first_result_index + phase + 4).number_of_triangles = sparse_generator.get_mesh().get_number_of_triangles();
+            this->results->at(this->first_result_index + phase + 4).memory_bytes = sparse_generator.get_memory_footprint();
+        }
+    }
+}
+
+
+// ====================================== RUN ======================================
+
+void Phase_Benchmark::run (Benchmark_Configuration& configuration, std::vector<Phase_Result>& results)
+{
+    // Start with the same particles for every configuration.
+    this->particle_system.generate_initial_particles(this->fluid_starting_positions);
+    this->particle_system.number_of_threads = configuration.number_of_threads;
+    this->particle_system.change_computation_mode(configuration.computation_mode);
+    // Create the marching cubes generators. The first generation allocates the grids, so it is not measured.
+    this->marching_cubes_generators.clear();
+    this->sparse_marching_cubes_generators.clear();
+    for (float cube_edge_length : configuration.cube_edge_lengths) {
+        this->marching_cubes_generators.push_back(std::make_unique<Marching_Cubes_Generator>());
+        Marching_Cubes_Generator& generator = *this->marching_cubes_generators.back();
+        generator.particle_system = &this->particle_system;
+        generator.new_cube_edge_length = cube_edge_length;
+        generator.density_estimation_mode = configuration.density_estimation_mode;
+        generator.scalar_field_mode = configuration.scalar_field_mode;
+        generator.incremental_updates = configuration.incremental_updates;
+        generator.generate_marching_cubes();
+        this->sparse_marching_cubes_generators.push_back(std::make_unique<Sparse_Marching_Cubes_Generator>());
+        Sparse_Marching_Cubes_Generator& sparse_generator = *this->sparse_marching_cubes_generators.back();
+        sparse_generator.particle_system = &this->particle_system;
+        sparse_generator.new_cube_edge_length = cube_edge_length;
+        sparse_generator.generate_mesh();
+    }
+
+    // Prepare one result per phase.
+    std::vector<std::string> phases;
+    if (configuration.computation_mode == COMPUTATION_MODE_SPATIAL_GRID) {
+        phases = { BENCH_PHASE_GRID_BUILD, BENCH_PHASE_DENSITY_PRESSURE_GRID, BENCH_PHASE_ACCELERATION_GRID,
+            BENCH_PHASE_VERLET_STEP_GRID, BENCH_PHASE_UPDATE_PARTICLE_VECTOR };
+    }
+    else {
+        phases = { BENCH_PHASE_DENSITY_PRESSURE_BRUTE, BENCH_PHASE_ACCELERATION_BRUTE, BENCH_PHASE_VERLET_STEP_BRUTE };
+    }
+    this->number_of_simulation_phases = phases.size();
+    for (unsigned int i = 0; i < configuration.cube_edge_lengths.size(); i++) {
+        phases.push_back((configuration.scalar_field_mode == SCALAR_FIELD_COLOR_FIELD) ? BENCH_PHASE_COLOR_FIELD : BENCH_PHASE_ESTIMATE_DENSITY);
+        phases.push_back(BENCH_PHASE_CALCULATE_VERTEX_VALUES);
+        phases.push_back(BENCH_PHASE_COMPACT_ACTIVE_CUBES);
+        phases.push_back(BENCH_PHASE_EXTRACT_MESH);
+        phases.push_back(BENCH_PHASE_SPARSE_MESH);
+    }
+    this->first_result_index = results.size();
+    for (unsigned int i = 0; i < phases.size(); i++) {
+        Phase_Result result;
+        result.phase = phases.at(i);
+        result.particle_set = this->particle_set;
+        result.computation_mode = configuration.computation_mode;
+        result.number_of_particles = this->particle_system.number_of_particles;
+        result.particle_initial_distance = this->particle_initial_distance;
+        result.number_of_threads = configuration.number_of_threads;
+        result.cube_edge_length = (i < this->number_of_simulation_phases) ? 0.0f : 
+            configuration.cube_edge_lengths.at((i - this->number_of_simulation_phases) / BENCH_NUMBER_OF_MARCHING_CUBES_PHASES);
+        result.warmup_steps = configuration.warmup_steps;
+        result.repetitions = configuration.repetitions;
+        result.execution_times.reserve(configuration.repetitions);
+        result.number_of_triangles = 0;
+        result.memory_bytes = 0;
+        results.push_back(result);
+    }
+
+    // Warm-up (not measured) and the measured repetitions.
+    for (int step = 0; step < configuration.warmup_steps + configuration.repetitions; step++) {
+        this->results = (step < configuration.warmup_steps) ? nullptr : &results;
+        if (configuration.computation_mode == COMPUTATION_MODE_SPATIAL_GRID) {
+            this->step_spatial_grid();
+        }
+        else {
+            this->step_brute_force();
+        }
+        this->step_marching_cubes();
+    }
+    this->results = nullptr;
+    this->marching_cubes_generators.clear();
+    this->sparse_marching_cubes_generators.clear();
+    for (unsigned int i = this->first_result_index; i < results.size(); i++) {
+        results.at(i).statistics.calculate(results.at(i).execution_times);
+    }
+}
+
+bool Phase_Benchmark::check_density_estimation (Benchmark_Configuration& configuration)
+{
+    this->particle_system.generate_initial_particles(this->fluid_starting_positions);
+    this->particle_system.number_of_threads = configuration.number_of_threads;
+    this->particle_system.change_computation_mode(configuration.computation_mode);
+    bool counts_are_the_same = true;
+    for (float cube_edge_length : configuration.cube_edge_lengths) {
+        // The spatial grid is built for the current particles (see Marching_Cubes_Generator::estimate_density_spatial_grid).
+        Marching_Cubes_Generator counting_generator;
+        Marching_Cubes_Generator spatial_grid_generator;
+        for (Marching_Cubes_Generator* generator : { &counting_generator, &spatial_grid_generator }) {
+            generator->particle_system = &this->particle_system;
+            generator->new_cube_edge_length = cube_edge_length;
+            generator->incremental_updates = false;
+        }
+        counting_generator.density_estimation_mode = DENSITY_ESTIMATION_ATOMIC;
+        spatial_grid_generator.density_estimation_mode = DENSITY_ESTIMATION_SPATIAL_GRID;
+        counting_generator.generate_marching_cubes();
+        spatial_grid_generator.generate_marching_cubes();
+        // Without an integer ratio the mode falls back to counting the particles.
+        if (spatial_grid_generator.used_density_estimation_mode != DENSITY_ESTIMATION_SPATIAL_GRID) {
+            continue;
+        }
+        int number_of_differing_cells = spatial_grid_generator.count_differing_density_cells(counting_generator);
+        if (number_of_differing_cells != 0) {
+            std::cout << "ERROR: With an edge length of " << cube_edge_length << " the counts taken from the spatial grid differ from " 
+                << "the counts of the particles in " << number_of_differing_cells << " cell(s)." << std::endl;
+            counts_are_the_same = false;
+        }
+    }
+    return counts_are_the_same;
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+
+#include "../simulation_handler/scene_information.h"
+#include "../utils/cuboid.h"
+#include "../utils/particle_system.h"
+#include "../utils/marching_cubes.h"
+#include "../utils/sparse_marching_cubes.h"
+#include "bench_phases.h"
+
+// The phase benchmarks measure every phase of a simulation step (and of the marching cubes) on its own.
+// In contrast to MEASURE_EXECUTION_TIME they do not need a rebuild with -DPERFORMANCE_TEST, measure in
+// nanoseconds and run every phase a given number of times after some warm-up steps (so the caches are
+// filled and the particles are no longer in their perfect starting lattice).
+// Between the measured phases the simulation keeps running, so every phase works on realistic data.
+#define BENCH_DEFAULT_WARMUP_STEPS              3
+#define BENCH_DEFAULT_REPETITIONS               30
+// The brute force implementation is O(n^2), so larger particle sets are skipped.
+#define BENCH_BRUTE_FORCE_MAX_PARTICLES         32768
+// The synthetic particle sets are cubes of particles in the middle of the simulation space (like scene 1).
+// The fluid cube has an edge length of 1, so the particle spacing is 1 / particles per axis.
+#define BENCH_LATTICE_EDGE_LENGTH               1.0f
+
+// The number of measured phases per marching cubes edge length (see bench_phases.h).
+#define BENCH_NUMBER_OF_MARCHING_CUBES_PHASES   5
+
+// Statistics over the repetitions of a phase (in nanoseconds).
+struct Phase_Statistics
+{
+    double average;
+    double median;
+    double min;
+    double max;
+    double std;
+
+    void calculate (const std::vector<long long>& execution_times);
+};
+
+// The measurements of one phase for one configuration.
+struct Phase_Result
+{
+    std::string phase;
+    std::string particle_set;
+    Computation_Mode computation_mode;
+    unsigned int number_of_particles;
+    float particle_initial_distance;
+    int number_of_threads;
+    // Only set for the marching cubes phases (0 otherwise).
+    float cube_edge_length;
+    int warmup_steps;
+    int repetitions;
+    std::vector<long long> execution_times;
+    Phase_Statistics statistics;
+    // Only set for the mesh extractions: the number of triangles of the last repetition (0 otherwise).
+    unsigned int number_of_triangles;
+    // Only set for the mesh extractions: the bytes of the grids the generator allocated (0 otherwise), so the dense and
+    // the sparse generator can be compared side by side.
+    size_t memory_bytes;
+
+    // The throughput of the mesh extraction based on the median.
+    double get_triangles_per_second () const;
+};
+
+// What to measure for one particle set.
+struct Benchmark_Configuration
+{
+    Computation_Mode computation_mode;
+    int number_of_threads;
+    // One marching cubes generator is used per edge length. Leave it empty to skip the marching cubes.
+    std::vector<float> cube_edge_lengths;
+    Density_Estimation_Mode density_estimation_mode;
+    Scalar_Field_Mode scalar_field_mode;
+    // If set, the marching cubes only count the particles that changed their cell and update the dirty cubes.
+    bool incremental_updates;
+    int warmup_steps;
+    int repetitions;
+};
+
+class Phase_Benchmark
+{
+    private:
+        // The particle set. The particles are generated again for every configuration, so all
+        // configurations start with the same particles.
+        std::string particle_set;
+        float particle_initial_distance;
+        Cuboid simulation_space;
+        std::vector<Cuboid> fluid_starting_positions;
+        Particle_System particle_system;
+        std::vector<std::unique_ptr<Marching_Cubes_Generator>> marching_cubes_generators;
+        // One sparse generator per edge length as well, to compare it with the dense mesh extraction.
+        std::vector<std::unique_ptr<Sparse_Marching_Cubes_Generator>> sparse_marching_cubes_generators;
+
+        // Where the measurements of the current configuration are stored. During the warm-up steps
+        // nothing is measured, so the pointer is null.
+        std::vector<Phase_Result>* results;
+        unsigned int first_result_index;
+        unsigned int number_of_simulation_phases;
+        // Adds the time since start to the measurements of the given phase (index within the configuration).
+        void add_execution_time (unsigned int phase, std::chrono::steady_clock::time_point start);
+        // One step of the simulation with the phases measured one by one.
+        void step_spatial_grid ();
+        void step_brute_force ();
+        // The scalar field, vertex value calculation, compaction and mesh extraction of all marching cubes generators
+        // and the sparse mesh extraction.
+        void step_marching_cubes ();
+
+    public:
+        Phase_Benchmark ();
+
+        // A synthetic particle set: a cube with the given number of particles per axis.
+        bool load_lattice (unsigned int particles_per_axis);
+        // A particle set derived from a scene.
+        bool load_scene (Scene_Information& scene, float particle_initial_distance);
+        unsigned int get_number_of_particles ();
+
+        // Measures all phases of the given configuration and appends the results.
+        void run (Benchmark_Configuration& configuration, std::vector<Phase_Result>& results);
+        // Checks that the counts taken from the spatial grid are the same as the counts of the particles (with the initial
+        // particles of the configuration) for every edge length the spatial grid can be used with. Returns false and prints
+        // the edge lengths if they differ.
+        bool check_density_estimation (Benchmark_Configuration& configuration);
+};
\ No newline at end of file
@@ -0,0 +1,363 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+
+#include "../simulation_handler/simulation_handler.h"
+#include "../utils/thread_pool.h"
+#include "../utils/helper.h"
+#include "../utils/command_line.h"
+
+// The ensemble runner simulates the same scene with many combinations of the fluid attributes (e.g. for parameter
+// studies) in one process. Small simulations (a few thousand particles) do not scale to many threads, but many of
+// them side by side keep all cores busy. All members share one thread pool (see thread_pool.h): every member is
+// a job of the pool and the chunks of its parallel for loops are chunks of the pool. So a member that runs alone
+// at the end still uses all idle threads, and there are never more threads than cores.
+// For comparison, the members can also be run one after another with threads of their own (sequential) or all at
+// the same time with threads of their own (oversubscribed, like one process per member).
+#define ENSEMBLE_DEFAULT_SCENE                  1
+#define ENSEMBLE_DEFAULT_STEPS                  500
+#define ENSEMBLE_DEFAULT_OUTPUT_FILENAME        "ensemble.csv"
+
+enum Ensemble_Schedule
+{
+    ENSEMBLE_SCHEDULE_POOL,
+    ENSEMBLE_SCHEDULE_SEQUENTIAL,
+    ENSEMBLE_SCHEDULE_OVERSUBSCRIBED,
+    _ENSEMBLE_SCHEDULE_COUNT
+};
+
+inline const char* to_string (Ensemble_Schedule ensemble_schedule)
+{
+    switch (ensemble_schedule) {
+        case ENSEMBLE_SCHEDULE_POOL:            return "pool";
+        case ENSEMBLE_SCHEDULE_SEQUENTIAL:      return "sequential";
+        case ENSEMBLE_SCHEDULE_OVERSUBSCRIBED:  return "oversubscribed";
+        default:                                return "unknown ensemble schedule";
+    }
+}
+
+// All settings that can be given on the command line.
+struct Ensemble_Settings
+{
+    int scene;
+    std::string scene_filename;
+    float particle_initial_distance;
+    int number_of_steps;
+    std::vector<float> viscosities;
+    std::vector<float> gas_constants;
+    // The number of threads of the pool (or of every member if the members have threads of their own).
+    int number_of_threads;
+    // The number of chunks of a parallel for loop of a member (0 means chosen by the number of members).
+    int number_of_member_chunks;
+    Ensemble_Schedule schedule;
+    Computation_Mode computation_mode;
+    Gravity_Mode gravity_mode;
+    std::string output_filename;
+};
+
+// One simulation of the ensemble and its statistics.
+struct Ensemble_Member
+{
+    float viscosity;
+    float gas_constant;
+    std::unique_ptr<Simulation_Handler> simulation_handler;
+    // In milliseconds relative to the start of the ensemble.
+    double start_time;
+    double end_time;
+    // The duration of every step in microseconds.
+    std::vector<long long> step_times;
+    // The state after the last step.
+    double mean_kinetic_energy;
+    double max_speed;
+    double mean_density;
+};
+
+void print_usage (const char* program_name, const std::string& shared_options_usage)
+{
+    std::cout << "Usage: " << program_name << " [options]" << std::endl
+        << "Every combination of the viscosities and gas constants is one member of the ensemble. The steps are the" << std::endl
+        << "steps of every member, the threads are the threads of the pool (or of every member if it has threads of its own)." << std::endl
+        << "Options (lists are comma separated):" << std::endl
+        << shared_options_usage
+        << "  --viscosities <list>          viscosities (" << SPH_VISCOSITY_MIN << " - " << SPH_VISCOSITY_MAX
+            << ", default " << SPH_VISCOSITY << ")" << std::endl
+        << "  --gas-constants <list>        gas constants (" << SPH_GAS_CONSTANT_MIN << " - " << SPH_GAS_CONSTANT_MAX
+            << ", default " << SPH_GAS_CONSTANT << ")" << std::endl
+        << "  --member-chunks <number>      chunks of a parallel for loop of a member (default: threads / members, at least 1)" << std::endl
+        << "  --schedule <pool|sequential|oversubscribed>" << std::endl
+        << "                                how the members are run (default pool)" << std::endl
+        << "  --help                        show this information" << std::endl;
+}
+
+// The options that the ensemble shares with the other tools (see command_line.h). The output is the csv file of the
+// statistics of the members.
+Shared_Options get_shared_options (Ensemble_Settings& settings)
+{
+    Shared_Options shared_options;
+    shared_options.scene = &settings.scene;
+    shared_options.scene_filename = &settings.scene_filename;
+    shared_options.particle_initial_distance = &settings.particle_initial_distance;
+    shared_options.number_of_steps = &settings.number_of_steps;
+    shared_options.number_of_threads = &settings.number_of_threads;
+    shared_options.computation_mode = &settings.computation_mode;
+    shared_options.gravity_mode = &settings.gravity_mode;
+    shared_options.output = &settings.output_filename;
+    return shared_options;
+}
+
+// Parses an option of the ensemble.
+Option_Status parse_option (const std::string& option, const std::string& value, Ensemble_Settings& settings)
+{
+    if (option == "--viscosities") {
+        if (parse_list(value, settings.viscosities, SPH_VISCOSITY_MIN, SPH_VISCOSITY_MAX) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--gas-constants") {
+        if (parse_list(value, settings.gas_constants, SPH_GAS_CONSTANT_MIN, SPH_GAS_CONSTANT_MAX) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--member-chunks") {
+        settings.number_of_member_chunks = std::atoi(value.c_str());
+        if (settings.number_of_member_chunks < 1) {
+            return OPTION_INVALID;
+        }
+    }
+    else if (option == "--schedule") {
+        if (value == "pool")                    settings.schedule = ENSEMBLE_SCHEDULE_POOL;
+        else if (value == "sequential")         settings.schedule = ENSEMBLE_SCHEDULE_SEQUENTIAL;
+        else if (value == "oversubscribed")     settings.schedule = ENSEMBLE_SCHEDULE_OVERSUBSCRIBED;
+        else                                    return OPTION_INVALID;
+    }
+    else {
+        return OPTION_UNKNOWN;
+    }
+    return OPTION_VALID;
+}
+
+
+// ====================================== MEMBERS ======================================
+
+// Creates the simulation of a member and loads the scene. Returns false if the scene cannot be loaded.
+bool load_member (Ensemble_Settings& settings, Ensemble_Member& member)
+{
+    member.simulation_handler = std::make_unique<Simulation_Handler>();
+    Simulation_Handler& simulation_handler = *member.simulation_handler;
+    simulation_handler.register_default_scenes();
+    simulation_handler.register_scene_files(SCENE_FILE_DIRECTORY);
+    int scene = settings.scene;
+    if (settings.scene_filename.empty() == false) {
+        if (simulation_handler.register_scene_file(settings.scene_filename) == false) {
+            return false;
+        }
+        scene = simulation_handler.available_scenes.size();
+    }
+    simulation_handler.next_scene_id = scene - 1;
+    Particle_System& particle_system = simulation_handler.particle_system;
+    if (particle_system.set_particle_initial_distance(settings.particle_initial_distance) == false) {
+        std::cout << "ERROR: The particle spacing needs to be within [" << PARTICLE_INITIAL_DISTANCE_MIN << "; "
+            << PARTICLE_INITIAL_DISTANCE_MAX << "]." << std::endl;
+        return false;
+    }
+    particle_system.change_computation_mode(settings.computation_mode);
+    particle_system.change_gravity_mode(settings.gravity_mode);
+    // There is no cursor, so there are no external forces.
+    particle_system.external_forces_active = false;
+    if (simulation_handler.load_scene() == false) {
+        return false;
+    }
+    // The attributes of the member win over the ones of a scene file.
+    particle_system.sph_viscosity = member.viscosity;
+    particle_system.sph_gas_constant = member.gas_constant;
+    return true;
+}
+
+// Simulates all steps of a member and collects its statistics.
+void run_member (Ensemble_Member& member, int number_of_steps, std::chrono::steady_clock::time_point ensemble_start)
+{
+    Particle_System& particle_system = member.simulation_handler->particle_system;
+    member.step_times.reserve(number_of_steps);
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < number_of_steps; step++) {
+        auto step_start = std::chrono::steady_clock::now();
+        member.simulation_handler->simulate();
+        auto step_end = std::chrono::steady_clock::now();
+        member.step_times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(step_end - step_start).count());
+    }
+    auto end = std::chrono::steady_clock::now();
+    member.start_time = std::chrono::duration<double, std::milli>(start - ensemble_start).count();
+    member.end_time = std::chrono::duration<double, std::milli>(end - ensemble_start).count();
+    // The state of the fluid after the last step.
+    double kinetic_energy = 0.0;
+    double density = 0.0;
+    member.max_speed = 0.0;
+    for (Particle& particle : particle_system.particles) {
+        double speed = glm::length(particle.velocity);
+        kinetic_energy += 0.5 * particle_system.sph_particle_mass * speed * speed;
+        density += particle.density;
+        member.max_speed = std::max(member.max_speed, speed);
+    }
+    unsigned int number_of_particles = std::max(particle_system.number_of_particles, 1u);
+    member.mean_kinetic_energy = kinetic_energy / number_of_particles;
+    member.mean_density = density / number_of_particles;
+}
+
+double get_mean (const std::vector<long long>& values)
+{
+    if (values.empty() == true) {
+        return 0.0;
+    }
+    long long sum = 0;
+    for (long long value : values) {
+        sum += value;
+    }
+    return (double)sum / values.size();
+}
+
+bool save_members_to_csv (std::string filename, std::vector<Ensemble_Member>& members)
+{
+    std::ofstream file(filename, std::ios::trunc);
+    if (file.is_open() == false) {
+        std::cout << "ERROR: Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    file << "member,viscosity,gas_constant,number_of_particles,number_of_steps,start_ms,end_ms,duration_ms,"
+        << "mean_step_ms,max_step_ms,mean_kinetic_energy,max_speed,mean_density" << std::endl;
+    for (size_t i = 0; i < members.size(); i++) {
+        Ensemble_Member& member = members.at(i);
+        file << i << "," << member.viscosity << "," << member.gas_constant << ","
+            << member.simulation_handler->particle_system.number_of_particles << "," << member.step_times.size() << ","
+            << member.start_time << "," << member.end_time << "," << member.end_time - member.start_time << ","
+            << get_mean(member.step_times) / 1000.0 << ","
+            << *std::max_element(member.step_times.begin(), member.step_times.end()) / 1000.0 << ","
+            << member.mean_kinetic_energy << "," << member.max_speed << "," << member.mean_density << std::endl;
+    }
+    std::cout << "Saved the statistics of the members to '" << filename << "'." << std::endl;
+    return true;
+}
+
+
+// ====================================== MAIN ======================================
+
+int main (int argc, char* argv[])
+{
+    Ensemble_Settings settings {
+        ENSEMBLE_DEFAULT_SCENE,
+        "",
+        PARTICLE_INITIAL_DISTANCE_INIT,
+        ENSEMBLE_DEFAULT_STEPS,
+        { SPH_VISCOSITY },
+        { SPH_GAS_CONSTANT },
+        std::max(1, (int)std::thread::hardware_concurrency()),
+        0,
+        ENSEMBLE_SCHEDULE_POOL,
+        COMPUTATION_MODE_SPATIAL_GRID,
+        GRAVITY_NORMAL,
+        ENSEMBLE_DEFAULT_OUTPUT_FILENAME
+    };
+    Shared_Options shared_options = get_shared_options(settings);
+    std::string shared_options_usage = get_shared_options_usage(shared_options);
+    bool valid = parse_command_line(argc, argv, shared_options, [&settings] (const std::string& option, const std::string& value) {
+        return parse_option(option, value, settings);
+    });
+    if (valid == false) {
+        print_usage(argv[0], shared_options_usage);
+        return 1;
+    }
+
+    // Create and load the members.
+    std::vector<Ensemble_Member> members;
+    for (float viscosity : settings.viscosities) {
+        for (float gas_constant : settings.gas_constants) {
+            Ensemble_Member member {};
+            member.viscosity = viscosity;
+            member.gas_constant = gas_constant;
+            members.push_back(std::move(member));
+        }
+    }
+    for (Ensemble_Member& member : members) {
+        if (load_member(settings, member) == false) {
+            std::cout << "An error occured while loading the scene." << std::endl;
+            return 1;
+        }
+    }
+    // With the pool, the threads are shared: if there are fewer members than threads, the members split their loops
+    // into more chunks, so the idle threads can help.
+    int number_of_member_chunks = settings.number_of_member_chunks;
+    if (settings.schedule != ENSEMBLE_SCHEDULE_POOL) {
+        number_of_member_chunks = settings.number_of_threads;
+    }
+    else if (number_of_member_chunks == 0) {
+        number_of_member_chunks = std::max(1, (int)((settings.number_of_threads + members.size() - 1) / members.size()));
+    }
+    unsigned int total_number_of_particles = 0;
+    for (Ensemble_Member& member : members) {
+        member.simulation_handler->particle_system.number_of_threads = number_of_member_chunks;
+        total_number_of_particles += member.simulation_handler->particle_system.number_of_particles;
+    }
+    std::cout << "Simulating " << members.size() << " member(s) with " << to_string_with_separator(total_number_of_particles)
+        << " particles in total for " << settings.number_of_steps << " steps using " << settings.number_of_threads << " thread(s) ("
+        << to_string(settings.schedule) << ", " << number_of_member_chunks << " chunk(s) per parallel for loop)." << std::endl;
+
+    // Run the members.
+    auto start = std::chrono::steady_clock::now();
+    if (settings.schedule == ENSEMBLE_SCHEDULE_POOL) {
+        Thread_Pool thread_pool(settings.number_of_threads);
+        for (Ensemble_Member& member : members) {
+            member.simulation_handler->particle_system.thread_pool = &thread_pool;
+            thread_pool.submit_job([&member, &settings, start] () {
+                run_member(member, settings.number_of_steps, start);
+            });
+        }
+        thread_pool.wait_until_idle();
+        // The pool is gone after this block.
+        for (Ensemble_Member& member : members) {
+            member.simulation_handler->particle_system.thread_pool = nullptr;
+        }
+    }
+    else if (settings.schedule == ENSEMBLE_SCHEDULE_SEQUENTIAL) {
+        for (Ensemble_Member& member : members) {
+            run_member(member, settings.number_of_steps, start);
+        }
+    }
+    else {
+        std::vector<std::thread> threads;
+        for (Ensemble_Member& member : members) {
+            threads.emplace_back(run_member, std::ref(member), settings.number_of_steps, start);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    // Print the summary.
+    double duration_s = std::chrono::duration<double>(end - start).count();
+    std::cout << "Finished after " << duration_s << " s (" << members.size() / duration_s << " members/s, "
+        << (double)total_number_of_particles * settings.number_of_steps / duration_s << " particle updates/s)." << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  member  viscosity  gas constant  duration [ms]  mean step [ms]  mean kinetic energy  max speed" << std::endl;
+    for (size_t i = 0; i < members.size(); i++) {
+        Ensemble_Member& member = members.at(i);
+        std::cout << std::setw(8) << i << std::setw(11) << member.viscosity << std::setw(14) << member.gas_constant
+            << std::setw(15) << member.end_time - member.start_time << std::setw(16) << get_mean(member.step_times) / 1000.0
+            << std::setw(21) << std::scientific << member.mean_kinetic_energy << std::fixed
+            << std::setw(11) << member.max_speed << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+    if (settings.output_filename.empty() == false) {
+        if (save_members_to_csv(settings.output_filename, members) == false) {
+            return 1;
+        }
+    }
+    return 0;
+}
\ No newline at end of file
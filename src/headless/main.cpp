@@ -0,0 +1,413 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+
+#include "../simulation_handler/simulation_handler.h"
+#include "../simulation_handler/frame_exporter.h"
+#include "../utils/performance_test.h"
+#include "../utils/trace.h"
+#include "../utils/helper.h"
+#include "../utils/command_line.h"
+#include "../utils/memory_accounting.h"
+#include "../utils/marching_cubes.h"
+#include "../utils/sparse_marching_cubes.h"
+
+// The headless simulation runs the SPH loop without a window and without OpenGL, so it can be used
+// on machines without GPU or display (e.g. compute nodes). The settings are given on the command line.
+#define HEADLESS_DEFAULT_SCENE          1
+#define HEADLESS_DEFAULT_STEPS          1000
+// How often the progress is printed (in percent of the steps).
+#define HEADLESS_PROGRESS_INTERVAL      10
+
+// All settings that can be given on the command line.
+struct Headless_Settings
+{
+    int scene;
+    std::string scene_filename;
+    std::string save_particles_filename;
+    float particle_initial_distance;
+    Seeding_Pattern seeding_pattern;
+    bool relaxed_initial_state;
+    std::string initial_state_cache_directory;
+    int number_of_threads;
+    int number_of_steps;
+    Computation_Mode computation_mode;
+    Gravity_Mode gravity_mode;
+    std::string recording_filename;
+    float velocity_precision;
+    std::string timings_filename;
+    std::string trace_filename;
+    bool count_hardware_events;
+    // 0 means the default budget (see memory_accounting.h).
+    size_t memory_budget;
+    Memory_Budget_Mode memory_budget_mode;
+    // The marching cubes edge length of the mesh extracted after the last step (0 for no mesh).
+    float mesh_cube_edge_length;
+    // Extract the mesh with the sparse generator (only allocates the bricks around the fluid).
+    bool sparse_mesh;
+    // The scalar field of the mesh (the sparse generator only supports the particle count).
+    Scalar_Field_Mode scalar_field_mode;
+    // The directory the frames are exported to (empty for no export) and how.
+    std::string export_directory;
+    Export_Format export_format;
+    int export_interval;
+    int export_writers;
+    Export_Backpressure_Mode export_backpressure_mode;
+};
+
+void print_usage (const char* program_name, const std::string& shared_options_usage)
+{
+    std::cout << "Usage: " << program_name << " [options]" << std::endl
+        << "Options:" << std::endl
+        << shared_options_usage
+        << "  --save-particles <file>       save the initial particles of the scene as particle block file (to be used by scene files)" << std::endl
+        << "  --seeding <cubic|jittered|hcp>" << std::endl
+        << "                                pattern of the initial particles (default cubic)" << std::endl
+        << "  --relaxed-start <on|off>      start with the relaxed initial particles (relaxed once, then cached, default off)" << std::endl
+        << "  --initial-state-cache <dir>   directory of the relaxed initial states (default " << INITIAL_STATE_CACHE_DIRECTORY << ")" << std::endl
+        << "  --record <file>               record the simulation to the given file" << std::endl
+        << "  --velocity-precision <value>  velocity precision of the recording (default " << RECORDER_VELOCITY_PRECISION << ")" << std::endl
+        << "  --timings <file>              save the execution time of every step as csv file" << std::endl
+        << "  --trace <file>                save the trace as Chrome trace event json file (needs a build with -DTRACING)" << std::endl
+        << "  --memory-budget <MiB>         refuse / warn if the scene needs more memory (default " 
+            << MEMORY_BUDGET_PHYSICAL_MEMORY_FRACTION * 100 << "% of the physical memory)" << std::endl
+        << "  --memory-budget-mode <warn|refuse>" << std::endl
+        << "                                what happens if the scene exceeds the memory budget (default refuse)" << std::endl
+        << "  --mesh <edge length>          extract the surface mesh after the last step with the given marching cubes edge length" << std::endl
+        << "  --mesh-mode <dense|sparse>    grid of the mesh extraction (default dense)" << std::endl
+        << "  --scalar-field <count|color-field>" << std::endl
+        << "                                the scalar field of the mesh (default count, sparse only supports count)" << std::endl
+        << "  --export <directory>          export the particles (and with --mesh the surface mesh) of the frames to the directory" << std::endl
+        << "  --export-format <ply|obj|raw> file format of the export (default ply)" << std::endl
+        << "  --export-interval <steps>     export every n-th step (default 1)" << std::endl
+        << "  --export-writers <number>     number of background threads writing the files (default " << EXPORTER_DEFAULT_NUMBER_OF_WRITERS << ")" << std::endl
+        << "  --export-backpressure <drop|throttle>" << std::endl
+        << "                                drop frames or wait for the writers if they are too slow (default drop)" << std::endl
+        << "  --help                        show this information" << std::endl;
+}
+
+// The options that the headless simulation shares with the other tools (see command_line.h).
+Shared_Options get_shared_options (Headless_Settings& settings)
+{
+    Shared_Options shared_options;
+    shared_options.scene = &settings.scene;
+    shared_options.scene_filename = &settings.scene_filename;
+    shared_options.particle_initial_distance = &settings.particle_initial_distance;
+    shared_options.number_of_steps = &settings.number_of_steps;
+    shared_options.number_of_threads = &settings.number_of_threads;
+    shared_options.computation_mode = &settings.computation_mode;
+    shared_options.gravity_mode = &settings.gravity_mode;
+    shared_options.count_hardware_events = &settings.count_hardware_events;
+    return shared_options;
+}
+
+// Parses an option of the headless simulation.
+Option_Status parse_option (const std::string& option, const std::string& value, Headless_Settings& settings)
+{
+    if (option == "--save-particles") {
+        settings.save_particles_filename = value;
+    }
+    else if (option == "--seeding") {
+        if (value == "cubic")           settings.seeding_pattern = SEEDING_PATTERN_CUBIC;
+        else if (value == "jittered")   settings.seeding_pattern = SEEDING_PATTERN_JITTERED;
+        else if (value == "hcp")        settings.seeding_pattern = SEEDING_PATTERN_HEXAGONAL_CLOSE_PACKED;
+        else                            return OPTION_INVALID;
+    }
+    else if (option == "--relaxed-start") {
+        settings.relaxed_initial_state = (value == "on");
+    }
+    else if (option == "--initial-state-cache") {
+        settings.initial_state_cache_directory = value;
+    }
+    else if (option == "--record") {
+        settings.recording_filename = value;
+    }
+    else if (option == "--velocity-precision") {
+        settings.velocity_precision = std::atof(value.c_str());
+    }
+    else if (option == "--timings") {
+        settings.timings_filename = value;
+    }
+    else if (option == "--trace") {
+        settings.trace_filename = value;
+    }
+    else if (option == "--memory-budget") {
+        long long memory_budget_mib = std::atoll(value.c_str());
+        if (memory_budget_mib < 1) {
+            std::cout << "ERROR: The memory budget needs to be at least 1 MiB." << std::endl;
+            return OPTION_ERROR;
+        }
+        settings.memory_budget = (size_t)memory_budget_mib * 1024 * 1024;
+    }
+    else if (option == "--memory-budget-mode") {
+        if (value == "warn")            settings.memory_budget_mode = MEMORY_BUDGET_MODE_WARN;
+        else if (value == "refuse")     settings.memory_budget_mode = MEMORY_BUDGET_MODE_REFUSE;
+        else                            return OPTION_INVALID;
+    }
+    else if (option == "--mesh") {
+        settings.mesh_cube_edge_length = std::atof(value.c_str());
+        if ((settings.mesh_cube_edge_length < MARCHING_CUBES_CUBE_EDGE_LENGTH_MIN) || 
+            (settings.mesh_cube_edge_length > MARCHING_CUBES_CUBE_EDGE_LENGTH_MAX)) {
+            std::cout << "ERROR: The marching cubes edge length needs to be within [" << MARCHING_CUBES_CUBE_EDGE_LENGTH_MIN << "; " 
+                << MARCHING_CUBES_CUBE_EDGE_LENGTH_MAX << "]." << std::endl;
+            return OPTION_ERROR;
+        }
+    }
+    else if (option == "--mesh-mode") {
+        if (value == "dense")           settings.sparse_mesh = false;
+        else if (value == "sparse")     settings.sparse_mesh = true;
+        else                            return OPTION_INVALID;
+    }
+    else if (option == "--scalar-field") {
+        if (value == "count")               settings.scalar_field_mode = SCALAR_FIELD_PARTICLE_COUNT;
+        else if (value == "color-field")    settings.scalar_field_mode = SCALAR_FIELD_COLOR_FIELD;
+        else                                return OPTION_INVALID;
+    }
+    else if (option == "--export") {
+        settings.export_directory = value;
+    }
+    else if (option == "--export-format") {
+        if (value == "ply")             settings.export_format = EXPORT_FORMAT_PLY;
+        else if (value == "obj")        settings.export_format = EXPORT_FORMAT_OBJ;
+        else if (value == "raw")        settings.export_format = EXPORT_FORMAT_RAW;
+        else                            return OPTION_INVALID;
+    }
+    else if (option == "--export-interval") {
+        settings.export_interval = std::atoi(value.c_str());
+        if (settings.export_interval < 1) {
+            std::cout << "ERROR: The export interval needs to be at least 1." << std::endl;
+            return OPTION_ERROR;
+        }
+    }
+    else if (option == "--export-writers") {
+        settings.export_writers = std::atoi(value.c_str());
+        if (settings.export_writers < 1) {
+            std::cout << "ERROR: The number of export writers needs to be at least 1." << std::endl;
+            return OPTION_ERROR;
+        }
+    }
+    else if (option == "--export-backpressure") {
+        if (value == "drop")            settings.export_backpressure_mode = EXPORT_BACKPRESSURE_DROP;
+        else if (value == "throttle")   settings.export_backpressure_mode = EXPORT_BACKPRESSURE_THROTTLE;
+        else                            return OPTION_INVALID;
+    }
+    else {
+        return OPTION_UNKNOWN;
+    }
+    return OPTION_VALID;
+}
+
+// Parses the command line. Returns false if the arguments are invalid (or the help was requested).
+bool parse_arguments (int argc, char* argv[], Shared_Options& shared_options, Headless_Settings& settings)
+{
+    bool valid = parse_command_line(argc, argv, shared_options, [&settings] (const std::string& option, const std::string& value) {
+        return parse_option(option, value, settings);
+    });
+    if (valid == false) {
+        return false;
+    }
+    if ((settings.sparse_mesh == true) && (settings.scalar_field_mode != SCALAR_FIELD_PARTICLE_COUNT)) {
+        std::cout << "ERROR: The sparse mesh extraction only supports the particle count as scalar field." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main (int argc, char* argv[])
+{
+    Headless_Settings settings {
+        HEADLESS_DEFAULT_SCENE,
+        "",
+        "",
+        PARTICLE_INITIAL_DISTANCE_INIT,
+        SEEDING_PATTERN_CUBIC,
+        false,
+        INITIAL_STATE_CACHE_DIRECTORY,
+        SIMULATION_NUMBER_OF_THREADS,
+        HEADLESS_DEFAULT_STEPS,
+        COMPUTATION_MODE_SPATIAL_GRID,
+        GRAVITY_WAVE,
+        "",
+        RECORDER_VELOCITY_PRECISION,
+        "",
+        "",
+        false,
+        0,
+        MEMORY_BUDGET_MODE_REFUSE,
+        0.0f,
+        false,
+        SCALAR_FIELD_PARTICLE_COUNT,
+        "",
+        EXPORT_FORMAT_PLY,
+        1,
+        EXPORTER_DEFAULT_NUMBER_OF_WRITERS,
+        EXPORT_BACKPRESSURE_DROP
+    };
+    Shared_Options shared_options = get_shared_options(settings);
+    std::string shared_options_usage = get_shared_options_usage(shared_options);
+    if (parse_arguments(argc, argv, shared_options, settings) == false) {
+        print_usage(argv[0], shared_options_usage);
+        return 1;
+    }
+
+    // Set up the simulation. The scene ids on the command line start at 1 (like the keys in the application).
+    Simulation_Handler simulation_handler;
+    simulation_handler.register_default_scenes();
+    simulation_handler.register_scene_files(SCENE_FILE_DIRECTORY);
+    if (settings.scene_filename.empty() == false) {
+        if (simulation_handler.register_scene_file(settings.scene_filename) == false) {
+            return 1;
+        }
+        settings.scene = simulation_handler.available_scenes.size();
+    }
+    simulation_handler.next_scene_id = settings.scene - 1;
+    Particle_System& particle_system = simulation_handler.particle_system;
+    if (particle_system.set_particle_initial_distance(settings.particle_initial_distance) == false) {
+        std::cout << "ERROR: The particle spacing needs to be within [" << PARTICLE_INITIAL_DISTANCE_MIN << "; " 
+            << PARTICLE_INITIAL_DISTANCE_MAX << "]." << std::endl;
+        return 1;
+    }
+    particle_system.number_of_threads = settings.number_of_threads;
+    particle_system.seeding_pattern = settings.seeding_pattern;
+    simulation_handler.initial_state_cache.is_active = settings.relaxed_initial_state;
+    simulation_handler.initial_state_cache.directory = settings.initial_state_cache_directory;
+    particle_system.change_computation_mode(settings.computation_mode);
+    particle_system.change_gravity_mode(settings.gravity_mode);
+    // There is no cursor, so there are no external forces.
+    particle_system.external_forces_active = false;
+    memory_accounting.budget = settings.memory_budget;
+    memory_accounting.budget_mode = settings.memory_budget_mode;
+    // The surface is generated on the CPU (there is no GPU), for the export and after the last step.
+    // Its grids are part of the memory footprint of the scene.
+    Marching_Cubes_Generator marching_cubes_generator;
+    marching_cubes_generator.particle_system = &particle_system;
+    marching_cubes_generator.new_cube_edge_length = settings.mesh_cube_edge_length;
+    marching_cubes_generator.scalar_field_mode = settings.scalar_field_mode;
+    Sparse_Marching_Cubes_Generator sparse_marching_cubes_generator;
+    sparse_marching_cubes_generator.particle_system = &particle_system;
+    sparse_marching_cubes_generator.new_cube_edge_length = settings.mesh_cube_edge_length;
+    if (settings.mesh_cube_edge_length > 0.0f) {
+        simulation_handler.marching_cubes_generator = &marching_cubes_generator;
+    }
+    if (simulation_handler.load_scene() == false) {
+        std::cout << "An error occured while loading the scene." << std::endl;
+        return 1;
+    }
+    if (settings.save_particles_filename.empty() == false) {
+        Particle_Block_File particle_block_file;
+        if (particle_block_file.save(settings.save_particles_filename, particle_system) == false) {
+            return 1;
+        }
+    }
+    if (settings.recording_filename.empty() == false) {
+        simulation_handler.simulation_recorder.velocity_precision = settings.velocity_precision;
+        if (simulation_handler.simulation_recorder.start_recording(settings.recording_filename) == false) {
+            return 1;
+        }
+    }
+    Frame_Exporter frame_exporter;
+    if (settings.export_directory.empty() == false) {
+        frame_exporter.export_format = settings.export_format;
+        frame_exporter.number_of_writers = settings.export_writers;
+        frame_exporter.backpressure_mode = settings.export_backpressure_mode;
+        if (frame_exporter.start_export(settings.export_directory) == false) {
+            return 1;
+        }
+    }
+    // Counting the events needs a thread pool (see performance_counters.h).
+    std::unique_ptr<Thread_Pool> thread_pool;
+    if (settings.count_hardware_events == true) {
+        #ifdef PERFORMANCE_TEST
+        initialize_performance_counters();
+        thread_pool = std::make_unique<Thread_Pool>(std::max(1, particle_system.number_of_threads - 1));
+        particle_system.thread_pool = thread_pool.get();
+        #else
+        std::cout << "Counting hardware events needs a build with -DPERFORMANCE_TEST." << std::endl;
+        #endif
+    }
+    std::cout << "Simulating " << settings.number_of_steps << " steps with " << particle_system.number_of_particles_as_string 
+        << " particles using " << particle_system.number_of_threads << " thread(s) (" << to_string(particle_system.computation_mode) << ")." << std::endl;
+
+    // Run the SPH loop as fast as possible.
+    int progress_interval = std::max(1, settings.number_of_steps * HEADLESS_PROGRESS_INTERVAL / 100);
+    long long total_duration_us = 0;
+    for (int step = 1; step <= settings.number_of_steps; step++) {
+        Performance_Counter_Values counters_start = read_performance_counters();
+        auto start = std::chrono::steady_clock::now();
+        simulation_handler.simulate();
+        auto end = std::chrono::steady_clock::now();
+        total_duration_us += std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        // Use the same key and unit as MEASURE_EXECUTION_TIME would, so the performance analysis can read it.
+        execution_times["simulation_handler.simulate()"].push_back(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+        add_performance_counter_values("simulation_handler.simulate()", counters_start);
+        // The export is not part of the measured step. Only the copy of the frame happens here, the writers do the rest.
+        // The mesh is only generated if the frame is not dropped.
+        if ((frame_exporter.is_exporting == true) && (step % settings.export_interval == 0) && (frame_exporter.reserve_frame() == true)) {
+            const Marching_Cubes_Mesh* mesh = nullptr;
+            if ((settings.mesh_cube_edge_length > 0.0f) && (settings.sparse_mesh == true)) {
+                sparse_marching_cubes_generator.generate_mesh();
+                mesh = &sparse_marching_cubes_generator.get_mesh();
+            }
+            else if (settings.mesh_cube_edge_length > 0.0f) {
+                marching_cubes_generator.generate_marching_cubes();
+                marching_cubes_generator.extract_mesh();
+                mesh = &marching_cubes_generator.get_mesh();
+            }
+            frame_exporter.export_frame(particle_system, mesh);
+        }
+        if ((step % progress_interval == 0) || (step == settings.number_of_steps)) {
+            std::cout << "  step " << step << " / " << settings.number_of_steps << std::endl;
+        }
+    }
+    simulation_handler.simulation_recorder.stop_recording();
+    frame_exporter.stop_export();
+
+    // Print the summary and save the timings if wished.
+    double total_duration_s = total_duration_us / 1.0e6;
+    std::cout << "Finished after " << total_duration_s << " s (" << (total_duration_us / 1000.0) / settings.number_of_steps 
+        << " ms per step, " << settings.number_of_steps / total_duration_s << " steps/s, "
+        << ((double)particle_system.number_of_particles * settings.number_of_steps) / total_duration_s << " particle updates/s)." << std::endl;
+    // The surface of the last step (there is no GPU, so the triangles are generated on the CPU). Both generators extract
+    // the same mesh with the particle count, so the one that was not used for the export is run as well to compare their
+    // time and memory.
+    if (settings.mesh_cube_edge_length > 0.0f) {
+        auto start = std::chrono::steady_clock::now();
+        marching_cubes_generator.generate_marching_cubes();
+        marching_cubes_generator.extract_mesh();
+        auto end = std::chrono::steady_clock::now();
+        double dense_time_ms = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+        bool compare_sparse_mesh = (settings.scalar_field_mode == SCALAR_FIELD_PARTICLE_COUNT);
+        if (compare_sparse_mesh == true) {
+            sparse_marching_cubes_generator.generate_mesh();
+        }
+        const Marching_Cubes_Mesh& mesh = (settings.sparse_mesh == true) ? sparse_marching_cubes_generator.get_mesh() : marching_cubes_generator.get_mesh();
+        std::cout << "Extracted a mesh with " << to_string_with_separator((unsigned int)mesh.get_number_of_vertices()) << " vertices and " 
+            << to_string_with_separator((unsigned int)mesh.get_number_of_triangles()) << " triangles ("
+            << ((settings.sparse_mesh == true) ? "sparse" : "dense") << ")." << std::endl;
+        std::cout << "  dense:  " << dense_time_ms << " ms, " 
+            << marching_cubes_generator.get_memory_footprint() / (1024.0 * 1024.0) << " MiB" << std::endl;
+        if (compare_sparse_mesh == true) {
+            // The particles are counted into all bricks around them, including the ones inside the fluid, which are
+            // skipped by the extraction afterwards. Their counts are the part of the memory that grows with the volume.
+            int number_of_interior_bricks = sparse_marching_cubes_generator.get_number_of_pool_bricks() - 
+                sparse_marching_cubes_generator.get_number_of_surface_bricks();
+            std::cout << "  sparse: " << sparse_marching_cubes_generator.get_generation_time() << " ms, " 
+                << sparse_marching_cubes_generator.get_memory_footprint() / (1024.0 * 1024.0) << " MiB ("
+                << to_string_with_separator((unsigned int)sparse_marching_cubes_generator.get_number_of_pool_bricks()) << " of " 
+                << to_string_with_separator((unsigned int)sparse_marching_cubes_generator.get_number_of_bricks()) << " bricks, "
+                << to_string_with_separator((unsigned int)number_of_interior_bricks) << " of them inside the fluid with "
+                << number_of_interior_bricks * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE * 
+                    SPARSE_MARCHING_CUBES_BRICK_SIZE * sizeof(int) / (1024.0 * 1024.0) << " MiB of counts)" << std::endl;
+        }
+    }
+    memory_accounting.print_report();
+    if (settings.timings_filename.empty() == false) {
+        save_exection_time_to_csv(settings.timings_filename);
+    }
+    if (settings.trace_filename.empty() == false) {
+        save_trace_to_json(settings.trace_filename);
+    }
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,391 @@
+#include "frame_exporter.h"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+
+#include "../utils/helper.h"
+#include "../utils/trace.h"
+
+
+// ====================================== STATISTICS ======================================
+
+void Export_Statistics::reset ()
+{
+    this->frames_submitted = 0;
+    this->frames_written = 0;
+    this->frames_dropped = 0;
+    this->write_errors = 0;
+    this->written_bytes = 0;
+    this->stall_count = 0;
+    this->stall_time_ns = 0;
+    this->copy_time_ns = 0;
+    this->queue_depth = 0;
+    this->max_queue_depth = 0;
+}
+
+
+// ====================================== EXPORTER ======================================
+
+Frame_Exporter::Frame_Exporter ()
+{
+    this->is_exporting = false;
+    this->next_frame_index = 0;
+    this->export_format = EXPORT_FORMAT_PLY;
+    this->backpressure_mode = EXPORT_BACKPRESSURE_DROP;
+    this->number_of_writers = EXPORTER_DEFAULT_NUMBER_OF_WRITERS;
+    this->number_of_buffers = EXPORTER_DEFAULT_NUMBER_OF_BUFFERS;
+    this->used_export_format = this->export_format;
+    this->used_number_of_buffers = 0;
+    this->statistics.reset();
+}
+
+Frame_Exporter::~Frame_Exporter ()
+{
+    // Make sure the writers are not running anymore when the exporter is destroyed.
+    if (this->is_exporting == true) {
+        this->stop_export();
+    }
+}
+
+bool Frame_Exporter::start_export (std::string directory)
+{
+    if (this->is_exporting == true) {
+        std::cout << "The frames are already being exported." << std::endl;
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if (error) {
+        std::cout << "ERROR: Failed to create the directory '" << directory << "': " << error.message() << std::endl;
+        return false;
+    }
+    this->directory = directory;
+    this->used_export_format = this->export_format;
+    this->used_number_of_buffers = std::max(1, this->number_of_buffers);
+    // Allocate the buffers. Both queues can hold all of them, so the buffers are never lost and pushing never blocks.
+    this->frame_queue.reset();
+    this->frame_queue.set_capacity(this->used_number_of_buffers);
+    this->free_frames.reset();
+    this->free_frames.set_capacity(this->used_number_of_buffers);
+    for (int i = 0; i < this->used_number_of_buffers; i++) {
+        this->free_frames.push(std::make_unique<Export_Frame>());
+    }
+    this->statistics.reset();
+    this->next_frame_index = 0;
+    for (int i = 0; i < std::max(1, this->number_of_writers); i++) {
+        this->writer_threads.emplace_back(&Frame_Exporter::write_frames, this);
+    }
+    this->is_exporting = true;
+    std::cout << "Started exporting the frames to '" << directory << "' (" << to_string(this->used_export_format) << ", "
+        << this->writer_threads.size() << " writer(s), " << this->used_number_of_buffers << " buffers, "
+        << to_string(this->backpressure_mode) << ")." << std::endl;
+    return true;
+}
+
+void Frame_Exporter::stop_export ()
+{
+    if (this->is_exporting == false) {
+        return;
+    }
+    // Closing the queue tells the writers to write the remaining frames and stop.
+    this->frame_queue.close();
+    for (std::thread& writer_thread : this->writer_threads) {
+        writer_thread.join();
+    }
+    this->writer_threads.clear();
+    // Free the buffers.
+    this->reserved_frame.reset();
+    this->free_frames.reset();
+    this->is_exporting = false;
+    std::cout << "Stopped exporting the frames." << std::endl;
+    this->print_statistics();
+}
+
+std::string Frame_Exporter::get_directory ()
+{
+    return this->directory;
+}
+
+bool Frame_Exporter::reserve_frame ()
+{
+    if (this->is_exporting == false) {
+        return false;
+    }
+    // The buffer of an earlier reservation was not used yet.
+    if (this->reserved_frame != nullptr) {
+        return true;
+    }
+    // Dropped frames keep their index, so the gaps in the file names show which frames are missing.
+    unsigned long long frame_index = this->next_frame_index++;
+    this->statistics.frames_submitted++;
+    std::unique_ptr<Export_Frame> frame;
+    if (this->free_frames.try_pop(frame) == false) {
+        // All buffers are in use, the writers are slower than the simulation.
+        if (this->backpressure_mode == EXPORT_BACKPRESSURE_DROP) {
+            this->statistics.frames_dropped++;
+            return false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        this->free_frames.pop(frame);
+        this->statistics.stall_count++;
+        this->statistics.stall_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+    frame->frame_index = frame_index;
+    this->reserved_frame = std::move(frame);
+    return true;
+}
+
+bool Frame_Exporter::export_frame (Particle_System& particle_system, const Marching_Cubes_Mesh* mesh)
+{
+    if ((this->is_exporting == false) || (particle_system.number_of_particles == 0)) {
+        return false;
+    }
+    TRACE_SCOPE("Frame_Exporter::export_frame");
+    if (this->reserve_frame() == false) {
+        return false;
+    }
+    std::unique_ptr<Export_Frame> frame = std::move(this->reserved_frame);
+    // Copy the frame. The vectors of the buffer keep their capacity, so this only allocates if the frame grew.
+    auto start = std::chrono::steady_clock::now();
+    frame->simulation_step = particle_system.get_simulation_step();
+    unsigned int n = particle_system.number_of_particles;
+    frame->particle_positions.resize(n);
+    frame->particle_velocities.resize(n);
+    frame->particle_is_copied.assign(n, false);
+    for (const Particle& particle : particle_system.particles) {
+        // An id outside of the particles would write behind the buffer, a duplicate id would overwrite another particle
+        // (and leave the slot of a missing id undefined). The frame cannot be sorted by id then, so it is not exported
+        // and the buffer goes back into the free list.
+        if ((particle.id >= n) || (frame->particle_is_copied[particle.id] == true)) {
+            this->statistics.write_errors++;
+            this->free_frames.push(std::move(frame));
+            return false;
+        }
+        frame->particle_is_copied[particle.id] = true;
+        frame->particle_positions[particle.id] = particle.position;
+        frame->particle_velocities[particle.id] = particle.velocity;
+    }
+    frame->has_mesh = (mesh != nullptr);
+    if (frame->has_mesh == true) {
+        frame->mesh_positions.assign(mesh->positions.begin(), mesh->positions.end());
+        frame->mesh_normals.assign(mesh->normals.begin(), mesh->normals.end());
+        frame->mesh_indices.assign(mesh->indices.begin(), mesh->indices.end());
+    }
+    this->statistics.copy_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    // There are never more frames than buffers, so this does not block.
+    this->frame_queue.push(std::move(frame));
+    unsigned int queue_depth = this->frame_queue.size();
+    this->statistics.queue_depth = queue_depth;
+    if (queue_depth > this->statistics.max_queue_depth) {
+        this->statistics.max_queue_depth = queue_depth;
+    }
+    return true;
+}
+
+
+// ====================================== WRITERS ======================================
+
+void Frame_Exporter::write_frames ()
+{
+    // Every writer has its own byte buffer, it keeps its capacity from one frame to the next.
+    std::vector<char> buffer;
+    std::unique_ptr<Export_Frame> frame;
+    while (this->frame_queue.pop(frame) == true) {
+        TRACE_SCOPE("Frame_Exporter::write_frame");
+        this->statistics.queue_depth = this->frame_queue.size();
+        bool success = true;
+        this->serialize_particles(*frame, buffer);
+        success = this->write_file(this->get_filename(frame->frame_index, "particles"), buffer) && success;
+        if (frame->has_mesh == true) {
+            this->serialize_mesh(*frame, buffer);
+            success = this->write_file(this->get_filename(frame->frame_index, "mesh"), buffer) && success;
+        }
+        if (success == true) {
+            this->statistics.frames_written++;
+        }
+        else {
+            this->statistics.write_errors++;
+        }
+        // The buffer can be used for the next frame again. There are never more buffers than places in the free
+        // list, so this does not block.
+        this->free_frames.push(std::move(frame));
+    }
+}
+
+std::string Frame_Exporter::get_filename (unsigned long long frame_index, const char* name)
+{
+    const char* extension = ".ply";
+    if (this->used_export_format == EXPORT_FORMAT_OBJ) {
+        extension = ".obj";
+    }
+    else if (this->used_export_format == EXPORT_FORMAT_RAW) {
+        extension = ".raw";
+    }
+    char filename[64];
+    std::snprintf(filename, sizeof(filename), "frame_%06llu_%s%s", frame_index, name, extension);
+    return (std::filesystem::path(this->directory) / filename).string();
+}
+
+bool Frame_Exporter::write_file (std::string filename, std::vector<char>& buffer)
+{
+    // Write to a temporary file first, so a renderer that watches the directory never reads a half written file.
+    std::string temporary_filename = filename + ".tmp";
+    std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+    if (file.is_open() == false) {
+        std::cout << "ERROR: Failed to open file: '" << temporary_filename << "'." << std::endl;
+        return false;
+    }
+    file.write(buffer.data(), buffer.size());
+    file.close();
+    if (file.fail() == true) {
+        std::cout << "ERROR: Failed to write file: '" << temporary_filename << "'." << std::endl;
+        return false;
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary_filename, filename, error);
+    if (error) {
+        std::cout << "ERROR: Failed to rename '" << temporary_filename << "' to '" << filename << "': " << error.message() << std::endl;
+        return false;
+    }
+    this->statistics.written_bytes += buffer.size();
+    return true;
+}
+
+
+// ====================================== SERIALISATION ======================================
+
+// Appends raw bytes to the buffer. The binary formats are little endian, like the memory of the machines we run on
+// (the recordings make the same assumption).
+static inline void append_bytes (std::vector<char>& buffer, const void* data, size_t size)
+{
+    const char* bytes = reinterpret_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+static inline void append_text (std::vector<char>& buffer, const char* text)
+{
+    append_bytes(buffer, text, std::strlen(text));
+}
+
+static void append_raw_header (std::vector<char>& buffer, bool is_mesh, size_t number_of_vertices, size_t number_of_triangles,
+    unsigned long long simulation_step)
+{
+    Export_Raw_File_Header file_header;
+    std::memset(&file_header, 0, sizeof(Export_Raw_File_Header));
+    std::memcpy(file_header.magic, EXPORTER_RAW_FILE_MAGIC, sizeof(EXPORTER_RAW_FILE_MAGIC));
+    file_header.version = EXPORTER_RAW_FILE_VERSION;
+    file_header.is_mesh = is_mesh;
+    file_header.number_of_vertices = number_of_vertices;
+    file_header.number_of_triangles = number_of_triangles;
+    file_header.simulation_step = simulation_step;
+    append_bytes(buffer, &file_header, sizeof(Export_Raw_File_Header));
+}
+
+void Frame_Exporter::serialize_particles (Export_Frame& frame, std::vector<char>& buffer)
+{
+    buffer.clear();
+    size_t n = frame.particle_positions.size();
+    char line[160];
+    if (this->used_export_format == EXPORT_FORMAT_PLY) {
+        std::snprintf(line, sizeof(line),
+            "ply\nformat binary_little_endian 1.0\ncomment rtgp-fluid-simulation particles, simulation step %llu\nelement vertex %zu\n",
+            frame.simulation_step, n);
+        append_text(buffer, line);
+        append_text(buffer, "property float x\nproperty float y\nproperty float z\n");
+        append_text(buffer, "property float vx\nproperty float vy\nproperty float vz\nend_header\n");
+        buffer.reserve(buffer.size() + n * 2 * sizeof(glm::vec3));
+        for (size_t i = 0; i < n; i++) {
+            append_bytes(buffer, &frame.particle_positions[i], sizeof(glm::vec3));
+            append_bytes(buffer, &frame.particle_velocities[i], sizeof(glm::vec3));
+        }
+    }
+    else if (this->used_export_format == EXPORT_FORMAT_OBJ) {
+        // OBJ has no velocities, so only the positions are written.
+        std::snprintf(line, sizeof(line), "# rtgp-fluid-simulation particles, simulation step %llu\n", frame.simulation_step);
+        append_text(buffer, line);
+        for (size_t i = 0; i < n; i++) {
+            const glm::vec3& position = frame.particle_positions[i];
+            std::snprintf(line, sizeof(line), "v %.6g %.6g %.6g\n", position.x, position.y, position.z);
+            append_text(buffer, line);
+        }
+    }
+    else {
+        append_raw_header(buffer, false, n, 0, frame.simulation_step);
+        append_bytes(buffer, frame.particle_positions.data(), n * sizeof(glm::vec3));
+        append_bytes(buffer, frame.particle_velocities.data(), n * sizeof(glm::vec3));
+    }
+}
+
+void Frame_Exporter::serialize_mesh (Export_Frame& frame, std::vector<char>& buffer)
+{
+    buffer.clear();
+    size_t number_of_vertices = frame.mesh_positions.size();
+    size_t number_of_triangles = frame.mesh_indices.size() / 3;
+    char line[160];
+    if (this->used_export_format == EXPORT_FORMAT_PLY) {
+        std::snprintf(line, sizeof(line),
+            "ply\nformat binary_little_endian 1.0\ncomment rtgp-fluid-simulation surface, simulation step %llu\nelement vertex %zu\n",
+            frame.simulation_step, number_of_vertices);
+        append_text(buffer, line);
+        append_text(buffer, "property float x\nproperty float y\nproperty float z\n");
+        append_text(buffer, "property float nx\nproperty float ny\nproperty float nz\n");
+        std::snprintf(line, sizeof(line), "element face %zu\nproperty list uchar uint vertex_indices\nend_header\n", number_of_triangles);
+        append_text(buffer, line);
+        buffer.reserve(buffer.size() + number_of_vertices * 2 * sizeof(glm::vec3) + number_of_triangles * (1 + 3 * sizeof(uint32_t)));
+        for (size_t i = 0; i < number_of_vertices; i++) {
+            append_bytes(buffer, &frame.mesh_positions[i], sizeof(glm::vec3));
+            append_bytes(buffer, &frame.mesh_normals[i], sizeof(glm::vec3));
+        }
+        for (size_t i = 0; i < number_of_triangles; i++) {
+            uint8_t number_of_indices = 3;
+            append_bytes(buffer, &number_of_indices, sizeof(uint8_t));
+            append_bytes(buffer, &frame.mesh_indices[3 * i], 3 * sizeof(uint32_t));
+        }
+    }
+    else if (this->used_export_format == EXPORT_FORMAT_OBJ) {
+        std::snprintf(line, sizeof(line), "# rtgp-fluid-simulation surface, simulation step %llu\n", frame.simulation_step);
+        append_text(buffer, line);
+        for (size_t i = 0; i < number_of_vertices; i++) {
+            const glm::vec3& position = frame.mesh_positions[i];
+            std::snprintf(line, sizeof(line), "v %.6g %.6g %.6g\n", position.x, position.y, position.z);
+            append_text(buffer, line);
+        }
+        for (size_t i = 0; i < number_of_vertices; i++) {
+            const glm::vec3& normal = frame.mesh_normals[i];
+            std::snprintf(line, sizeof(line), "vn %.6g %.6g %.6g\n", normal.x, normal.y, normal.z);
+            append_text(buffer, line);
+        }
+        // The indices of OBJ start at 1, every vertex has the normal with the same index.
+        for (size_t i = 0; i < number_of_triangles; i++) {
+            unsigned int a = frame.mesh_indices[3 * i] + 1;
+            unsigned int b = frame.mesh_indices[3 * i + 1] + 1;
+            unsigned int c = frame.mesh_indices[3 * i + 2] + 1;
+            std::snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u\n", a, a, b, b, c, c);
+            append_text(buffer, line);
+        }
+    }
+    else {
+        append_raw_header(buffer, true, number_of_vertices, number_of_triangles, frame.simulation_step);
+        append_bytes(buffer, frame.mesh_positions.data(), number_of_vertices * sizeof(glm::vec3));
+        append_bytes(buffer, frame.mesh_normals.data(), number_of_vertices * sizeof(glm::vec3));
+        append_bytes(buffer, frame.mesh_indices.data(), frame.mesh_indices.size() * sizeof(uint32_t));
+    }
+}
+
+void Frame_Exporter::print_statistics ()
+{
+    std::cout << "Export statistics:" << std::endl;
+    std::cout << "  frames submitted:   " << to_string_with_separator(this->statistics.frames_submitted) << std::endl;
+    std::cout << "  frames written:     " << to_string_with_separator(this->statistics.frames_written) << std::endl;
+    std::cout << "  frames dropped:     " << to_string_with_separator(this->statistics.frames_dropped) << std::endl;
+    std::cout << "  write errors:       " << to_string_with_separator(this->statistics.write_errors) << std::endl;
+    std::cout << "  written size:       " << to_string_with_separator(this->statistics.written_bytes / 1024) << " KiB" << std::endl;
+    std::cout << "  copy time:          " << this->statistics.copy_time_ns / 1000000 << " ms in total" << std::endl;
+    std::cout << "  simulation stalls:  " << this->statistics.stall_count << " ("
+        << this->statistics.stall_time_ns / 1000000 << " ms in total)" << std::endl;
+    std::cout << "  max. queue depth:   " << this->statistics.max_queue_depth << " / " << this->used_number_of_buffers << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "../utils/particle_system.h"
+#include "../utils/marching_cubes.h"
+#include "../utils/bounded_queue.h"
+#include "../utils/memory_accounting.h"
+
+// The exporter writes the particles (and the surface mesh if there is one) of single frames to files that can be
+// read by external renderers. Like for the recorder, the simulation loop only copies the data into a frame buffer,
+// the serialisation and the writing is done by a pool of background threads:
+// - A fixed number of frame buffers is allocated when the export starts. The free buffers are kept in a free list,
+//   so the vectors of a buffer keep their capacity and a frame usually does not allocate anything.
+// - The simulation loop takes a free buffer, copies the frame into it and pushes it into the queue of the writers.
+//   A writer serialises the frame into its own byte buffer, writes the files and puts the buffer back into the
+//   free list.
+// - If all buffers are in use, the writers cannot keep up with the simulation. In the mode DROP the frame is not
+//   exported (the simulation never waits for the disk), in the mode THROTTLE the simulation waits for the next
+//   free buffer (every frame is exported).
+// Every frame creates the files <directory>/frame_<index>_particles.<extension> and (with a mesh)
+// <directory>/frame_<index>_mesh.<extension>, so several writers can write different frames at the same time.
+#define EXPORTER_DEFAULT_DIRECTORY              "./export"
+#define EXPORTER_DEFAULT_NUMBER_OF_WRITERS      2
+// The number of frame buffers (frames that are copied but not written yet).
+#define EXPORTER_DEFAULT_NUMBER_OF_BUFFERS      4
+// The header of the raw format.
+#define EXPORTER_RAW_FILE_MAGIC                 "RTGPEXP"
+#define EXPORTER_RAW_FILE_VERSION               1
+
+enum Export_Format
+{
+    // Binary little endian PLY (particles with position and velocity, meshes with position, normal and faces).
+    EXPORT_FORMAT_PLY,
+    // Wavefront OBJ (text, particles as vertices without faces).
+    EXPORT_FORMAT_OBJ,
+    // A header followed by the arrays as they are in memory (see Export_Raw_File_Header).
+    EXPORT_FORMAT_RAW,
+    _EXPORT_FORMAT_COUNT
+};
+
+inline const char* to_string (Export_Format export_format)
+{
+    switch (export_format) {
+        case EXPORT_FORMAT_PLY:     return "PLY";
+        case EXPORT_FORMAT_OBJ:     return "OBJ";
+        case EXPORT_FORMAT_RAW:     return "RAW";
+        default:                    return "unknown export format";
+    }
+}
+
+// What happens if all frame buffers are in use?
+enum Export_Backpressure_Mode
+{
+    // The frame is not exported.
+    EXPORT_BACKPRESSURE_DROP,
+    // The simulation waits until a writer is done with a frame.
+    EXPORT_BACKPRESSURE_THROTTLE,
+    _EXPORT_BACKPRESSURE_MODE_COUNT
+};
+
+inline const char* to_string (Export_Backpressure_Mode export_backpressure_mode)
+{
+    switch (export_backpressure_mode) {
+        case EXPORT_BACKPRESSURE_DROP:      return "DROP";
+        case EXPORT_BACKPRESSURE_THROTTLE:  return "THROTTLE";
+        default:                            return "unknown backpressure mode";
+    }
+}
+
+// The header of a file in the raw format. It is followed by the positions (and velocities or normals, three
+// floats each) of all vertices and the indices of the triangles (three uint32 each, only for meshes).
+struct Export_Raw_File_Header
+{
+    char magic[8];
+    uint32_t version;
+    // 0 for particles (positions and velocities), 1 for meshes (positions, normals and indices).
+    uint32_t is_mesh;
+    uint32_t number_of_vertices;
+    uint32_t number_of_triangles;
+    uint64_t simulation_step;
+};
+
+// The copy of a frame handed over from the simulation loop to the writers. The particles are sorted by their id,
+// so the same particle is the same vertex in every file. The buffers are counted by the memory accounting.
+struct Export_Frame
+{
+    unsigned long long frame_index;
+    unsigned long long simulation_step;
+    Tracked_Vector<glm::vec3, MEMORY_SUBSYSTEM_FRAME_EXPORTER> particle_positions;
+    Tracked_Vector<glm::vec3, MEMORY_SUBSYSTEM_FRAME_EXPORTER> particle_velocities;
+    // Which ids were copied already (to find duplicate ids).
+    Tracked_Vector<unsigned char, MEMORY_SUBSYSTEM_FRAME_EXPORTER> particle_is_copied;
+    bool has_mesh;
+    Tracked_Vector<glm::vec3, MEMORY_SUBSYSTEM_FRAME_EXPORTER> mesh_positions;
+    Tracked_Vector<glm::vec3, MEMORY_SUBSYSTEM_FRAME_EXPORTER> mesh_normals;
+    Tracked_Vector<unsigned int, MEMORY_SUBSYSTEM_FRAME_EXPORTER> mesh_indices;
+};
+
+// Statistics about the export. They are written by the simulation loop and the writers, so use atomics.
+struct Export_Statistics
+{
+    std::atomic<unsigned long long> frames_submitted;
+    std::atomic<unsigned long long> frames_written;
+    std::atomic<unsigned long long> frames_dropped;
+    std::atomic<unsigned long long> write_errors;
+    std::atomic<unsigned long long> written_bytes;
+    // A stall is a frame where the simulation had to wait for a free buffer (only in the mode THROTTLE).
+    std::atomic<unsigned long long> stall_count;
+    std::atomic<unsigned long long> stall_time_ns;
+    // The time the simulation loop spent copying the frames into the buffers.
+    std::atomic<unsigned long long> copy_time_ns;
+    std::atomic<unsigned int> queue_depth;
+    std::atomic<unsigned int> max_queue_depth;
+
+    void reset ();
+};
+
+class Frame_Exporter
+{
+    private:
+        std::string directory;
+        std::vector<std::thread> writer_threads;
+        // The frames that wait for a writer and the buffers that are not in use. There are never more frames than
+        // buffers, so pushing into either queue never blocks.
+        Bounded_Queue<std::unique_ptr<Export_Frame>> frame_queue;
+        Bounded_Queue<std::unique_ptr<Export_Frame>> free_frames;
+        unsigned long long next_frame_index;
+        // The buffer taken by reserve_frame for the next export_frame call (or nullptr).
+        std::unique_ptr<Export_Frame> reserved_frame;
+        // The settings of the running export (the public ones may be changed in the meantime).
+        Export_Format used_export_format;
+        int used_number_of_buffers;
+
+        // The function executed by the writers.
+        void write_frames ();
+        // Serialises the vertices (and triangles) into the buffer in the used format.
+        void serialize_particles (Export_Frame& frame, std::vector<char>& buffer);
+        void serialize_mesh (Export_Frame& frame, std::vector<char>& buffer);
+        // Writes the buffer to the file. Returns false if the file could not be written.
+        bool write_file (std::string filename, std::vector<char>& buffer);
+        std::string get_filename (unsigned long long frame_index, const char* name);
+
+    public:
+        Frame_Exporter ();
+        ~Frame_Exporter ();
+
+        // Settings. They are applied when the export starts, except for the backpressure mode.
+        Export_Format export_format;
+        Export_Backpressure_Mode backpressure_mode;
+        int number_of_writers;
+        int number_of_buffers;
+
+        Export_Statistics statistics;
+
+        bool is_exporting;
+        // Creates the directory and starts the writers.
+        bool start_export (std::string directory = EXPORTER_DEFAULT_DIRECTORY);
+        // Writes the remaining frames and stops the writers.
+        void stop_export ();
+        // Takes a free buffer for the next frame (in the mode THROTTLE it waits for one). Returns false if the frame is
+        // dropped, so the caller can skip the work for it (e.g. the surface mesh). export_frame reserves the buffer
+        // itself if this was not called before.
+        bool reserve_frame ();
+        // Copies the particles (and the mesh, if given) and hands them over to the writers. Returns false if the
+        // frame was dropped.
+        bool export_frame (Particle_System& particle_system, const Marching_Cubes_Mesh* mesh = nullptr);
+
+        std::string get_directory ();
+        void print_statistics ();
+};
\ No newline at end of file
@@ -0,0 +1,155 @@
+#include "initial_state_cache.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <filesystem>
+
+
+Initial_State_Cache::Initial_State_Cache ()
+{
+    this->is_active = false;
+    this->directory = INITIAL_STATE_CACHE_DIRECTORY;
+    this->cache_hits = 0;
+    this->cache_misses = 0;
+}
+
+// The 64 bit FNV-1a hash. It is simple and good enough to tell configurations apart.
+static void hash_bytes (uint64_t& hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+}
+
+static void hash_cuboid (uint64_t& hash, Cuboid& cuboid)
+{
+    float values[6] = { cuboid.x_min, cuboid.x_max, cuboid.y_min, cuboid.y_max, cuboid.z_min, cuboid.z_max };
+    hash_bytes(hash, values, sizeof(values));
+}
+
+uint64_t Initial_State_Cache::get_key (Particle_System& particle_system, Cuboid& simulation_space, std::vector<Cuboid>& fluid_starting_positions)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    uint32_t version = INITIAL_STATE_CACHE_FILE_VERSION;
+    hash_bytes(hash, &version, sizeof(version));
+    // The scene.
+    hash_cuboid(hash, simulation_space);
+    uint32_t number_of_cuboids = fluid_starting_positions.size();
+    hash_bytes(hash, &number_of_cuboids, sizeof(number_of_cuboids));
+    for (Cuboid& cuboid : fluid_starting_positions) {
+        hash_cuboid(hash, cuboid);
+    }
+    // The particles and the fluid.
+    int32_t seeding_pattern = particle_system.seeding_pattern;
+    float values[] = {
+        particle_system.get_particle_initial_distance(),
+        particle_system.sph_particle_mass,
+        particle_system.sph_rest_density,
+        particle_system.sph_gas_constant,
+        particle_system.sph_viscosity,
+        particle_system.collision_reflexion_damping,
+        particle_system.collision_force_damping,
+        particle_system.collision_force_spring_constant,
+        particle_system.collision_force_distance_tolerance,
+        SPH_SIMULATION_TIME_STEP,
+        // The relaxation itself.
+        RELAXATION_VELOCITY_DAMPING,
+        RELAXATION_KINETIC_ENERGY_THRESHOLD
+    };
+    uint32_t relaxation_steps[] = { RELAXATION_MIN_STEPS, RELAXATION_MAX_STEPS };
+    hash_bytes(hash, &seeding_pattern, sizeof(seeding_pattern));
+    hash_bytes(hash, values, sizeof(values));
+    hash_bytes(hash, relaxation_steps, sizeof(relaxation_steps));
+    return hash;
+}
+
+std::string Initial_State_Cache::get_filename (uint64_t key)
+{
+    std::stringstream filename;
+    filename << this->directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << INITIAL_STATE_CACHE_FILE_EXTENSION;
+    return filename.str();
+}
+
+bool Initial_State_Cache::load (uint64_t key, Particle_System& particle_system)
+{
+    std::string filename = this->get_filename(key);
+    std::ifstream file(filename, std::ios::binary);
+    if (file.is_open() == false) {
+        this->cache_misses++;
+        return false;
+    }
+    Initial_State_File_Header file_header;
+    file.read(reinterpret_cast<char*>(&file_header), sizeof(Initial_State_File_Header));
+    if ((file.good() == false) ||
+        (std::memcmp(file_header.magic, INITIAL_STATE_CACHE_FILE_MAGIC, sizeof(INITIAL_STATE_CACHE_FILE_MAGIC)) != 0) ||
+        (file_header.version != INITIAL_STATE_CACHE_FILE_VERSION) ||
+        (file_header.key != key) ||
+        (file_header.particle_size != sizeof(Particle))) {
+        std::cout << "The cached initial state '" << filename << "' is invalid, it will be created again." << std::endl;
+        this->cache_misses++;
+        return false;
+    }
+    // The number of particles is used to allocate them, so make sure the file really holds them.
+    std::error_code error;
+    uintmax_t file_size = std::filesystem::file_size(filename, error);
+    if ((error) || (file_size < sizeof(Initial_State_File_Header) + (uintmax_t)sizeof(Particle) * file_header.number_of_particles)) {
+        std::cout << "The cached initial state '" << filename << "' is incomplete, it will be created again." << std::endl;
+        this->cache_misses++;
+        return false;
+    }
+    particle_system.set_number_of_particles(file_header.number_of_particles);
+    file.read(reinterpret_cast<char*>(particle_system.particles.data()), sizeof(Particle) * file_header.number_of_particles);
+    if (file.good() == false) {
+        std::cout << "The cached initial state '" << filename << "' is incomplete, it will be created again." << std::endl;
+        this->cache_misses++;
+        return false;
+    }
+    std::cout << "Loaded the relaxed initial state from '" << filename << "' (relaxed in " << file_header.relaxation_steps << " steps)." << std::endl;
+    this->cache_hits++;
+    return true;
+}
+
+bool Initial_State_Cache::save (uint64_t key, Particle_System& particle_system, unsigned int relaxation_steps)
+{
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+    if (error) {
+        std::cout << "ERROR: Failed to create the directory '" << this->directory << "': " << error.message() << std::endl;
+        return false;
+    }
+    // Write to a temporary file first, so a cancelled write never leaves a broken file with a valid name.
+    std::string filename = this->get_filename(key);
+    std::string temporary_filename = filename + ".tmp";
+    std::ofstream file(temporary_filename, std::ios::binary | std::ios::trunc);
+    if (file.is_open() == false) {
+        std::cout << "ERROR: Failed to open file: '" << temporary_filename << "'." << std::endl;
+        return false;
+    }
+    Initial_State_File_Header file_header;
+    std::memset(&file_header, 0, sizeof(Initial_State_File_Header));
+    std::memcpy(file_header.magic, INITIAL_STATE_CACHE_FILE_MAGIC, sizeof(INITIAL_STATE_CACHE_FILE_MAGIC));
+    file_header.version = INITIAL_STATE_CACHE_FILE_VERSION;
+    file_header.number_of_particles = particle_system.number_of_particles;
+    file_header.key = key;
+    file_header.particle_size = sizeof(Particle);
+    file_header.relaxation_steps = relaxation_steps;
+    file.write(reinterpret_cast<const char*>(&file_header), sizeof(Initial_State_File_Header));
+    file.write(reinterpret_cast<const char*>(particle_system.particles.data()), sizeof(Particle) * particle_system.number_of_particles);
+    file.close();
+    if (file.fail() == true) {
+        std::cout << "ERROR: Failed to write file: '" << temporary_filename << "'." << std::endl;
+        return false;
+    }
+    std::filesystem::rename(temporary_filename, filename, error);
+    if (error) {
+        std::cout << "ERROR: Failed to rename '" << temporary_filename << "' to '" << filename << "': " << error.message() << std::endl;
+        return false;
+    }
+    std::cout << "Saved the relaxed initial state to '" << filename << "'." << std::endl;
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "../utils/cuboid.h"
+#include "../utils/particle_system.h"
+
+// The relaxation of the initial particles (see Particle_System::relax_initial_particles) takes hundreds of
+// simulation steps. The result only depends on the scene, the particles and the fluid, so it is stored on the
+// disk and the next load of the same configuration simply reads the relaxed particles.
+// Every configuration is one file in the cache directory. Its name is a hash (the key) of everything the
+// relaxation depends on: the simulation space, the fluid starting positions, the particle distance, the seeding
+// pattern, the fluid and collision attributes and the relaxation settings. If one of these values changes, the
+// key changes and the particles are relaxed again. Old files are never deleted automatically, simply delete the
+// directory to clear the cache.
+#define INITIAL_STATE_CACHE_DIRECTORY           "./initial_state_cache"
+#define INITIAL_STATE_CACHE_FILE_EXTENSION      ".rtgpinit"
+#define INITIAL_STATE_CACHE_FILE_MAGIC          "RTGPINI"
+// Increase the version whenever the relaxation or the particle layout changes, so old files are not used anymore.
+#define INITIAL_STATE_CACHE_FILE_VERSION        2
+
+// The header of a cache file. It is followed by the particles (as they are in memory).
+struct Initial_State_File_Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t number_of_particles;
+    uint64_t key;
+    uint32_t particle_size;
+    uint32_t relaxation_steps;
+};
+
+class Initial_State_Cache
+{
+    public:
+        Initial_State_Cache ();
+
+        // If true, a scene starts with the relaxed (settled) particles instead of a perfect lattice.
+        bool is_active;
+        std::string directory;
+        // How often a relaxed state was loaded from the cache / had to be created.
+        unsigned int cache_hits;
+        unsigned int cache_misses;
+
+        // Returns the key of the configuration (the particle system gives the particle distance, the seeding pattern
+        // and the fluid and collision attributes).
+        uint64_t get_key (Particle_System& particle_system, Cuboid& simulation_space, std::vector<Cuboid>& fluid_starting_positions);
+        std::string get_filename (uint64_t key);
+        // Loads the relaxed particles into the particle system. Returns false if there is no (valid) file for the key.
+        bool load (uint64_t key, Particle_System& particle_system);
+        // Saves the particles of the particle system as the relaxed state of the configuration.
+        bool save (uint64_t key, Particle_System& particle_system, unsigned int relaxation_steps);
+};
\ No newline at end of file
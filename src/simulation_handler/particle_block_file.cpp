@@ -0,0 +1,181 @@
+#include "particle_block_file.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <thread>
+#include <algorithm>
+#include <filesystem>
+
+#include "../utils/trace.h"
+
+
+Particle_Block_File::Particle_Block_File ()
+{
+    this->read_failed = false;
+    this->block_queue.set_capacity(PARTICLE_BLOCK_QUEUE_CAPACITY);
+    std::memset(&this->header, 0, sizeof(Particle_Block_File_Header));
+}
+
+bool Particle_Block_File::read_header (std::string filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (file.is_open() == false) {
+        std::cout << "ERROR: Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    file.read(reinterpret_cast<char*>(&this->header), sizeof(Particle_Block_File_Header));
+    if ((file.good() == false) ||
+        (std::memcmp(this->header.magic, PARTICLE_BLOCK_FILE_MAGIC, sizeof(PARTICLE_BLOCK_FILE_MAGIC)) != 0)) {
+        std::cout << "ERROR: '" << filename << "' is not a particle block file." << std::endl;
+        return false;
+    }
+    if (this->header.version != PARTICLE_BLOCK_FILE_VERSION) {
+        std::cout << "ERROR: The particle block file '" << filename << "' has the version " << this->header.version
+            << ", but only version " << PARTICLE_BLOCK_FILE_VERSION << " is supported." << std::endl;
+        return false;
+    }
+    if ((this->header.particles_per_block == 0) ||
+        (this->header.particle_initial_distance < PARTICLE_INITIAL_DISTANCE_MIN) ||
+        (this->header.particle_initial_distance > PARTICLE_INITIAL_DISTANCE_MAX)) {
+        std::cout << "ERROR: The header of the particle block file '" << filename << "' is invalid." << std::endl;
+        return false;
+    }
+    // The number of particles is used to allocate them, so make sure the file really holds them.
+    std::error_code error;
+    uintmax_t file_size = std::filesystem::file_size(filename, error);
+    uintmax_t expected_file_size = sizeof(Particle_Block_File_Header) +
+        (uintmax_t)this->header.number_of_particles * PARTICLE_BLOCK_VALUES_PER_PARTICLE * sizeof(float);
+    if ((error) || (file_size < expected_file_size)) {
+        std::cout << "ERROR: The particle block file '" << filename << "' is too small for its " << this->header.number_of_particles
+            << " particles." << std::endl;
+        return false;
+    }
+    this->filename = filename;
+    return true;
+}
+
+bool Particle_Block_File::load (std::string filename, Particle_System& particle_system)
+{
+    if (this->read_header(filename) == false) {
+        return false;
+    }
+    TRACE_SCOPE("Particle_Block_File::load");
+    unsigned int number_of_particles = this->header.number_of_particles;
+    particle_system.set_number_of_particles(number_of_particles);
+    // Let the background thread read the blocks while we create the particles.
+    this->read_failed = false;
+    this->block_queue.reset();
+    std::thread reader_thread(&Particle_Block_File::read_blocks, this);
+    unsigned int number_of_loaded_particles = 0;
+    unsigned int number_of_outside_particles = 0;
+    Particle_Block block;
+    while (this->block_queue.pop(block) == true) {
+        unsigned int number_of_block_particles = block.values.size() / PARTICLE_BLOCK_VALUES_PER_PARTICLE;
+        const float* values = block.values.data();
+        for (unsigned int i = 0; i < number_of_block_particles; i++) {
+            // The particles were saved in the order of their ids and set_number_of_particles already set the ids.
+            Particle& particle = particle_system.particles[block.first_particle + i];
+            particle.position = glm::vec3(values[0], values[1], values[2]);
+            particle.velocity = glm::vec3(values[3], values[4], values[5]);
+            if ((particle_system.simulation_space != nullptr) && (particle_system.simulation_space->contains(particle.position) == false)) {
+                number_of_outside_particles++;
+            }
+            values += PARTICLE_BLOCK_VALUES_PER_PARTICLE;
+        }
+        number_of_loaded_particles += number_of_block_particles;
+    }
+    reader_thread.join();
+    if ((this->read_failed == true) || (number_of_loaded_particles != number_of_particles)) {
+        std::cout << "ERROR: The particle block file '" << filename << "' is incomplete (" << number_of_loaded_particles
+            << " of " << number_of_particles << " particles)." << std::endl;
+        particle_system.set_number_of_particles(0);
+        return false;
+    }
+    // The spatial grid only covers the simulation space, so the particles outside of it cannot be simulated.
+    if (number_of_outside_particles > 0) {
+        std::cout << "ERROR: " << number_of_outside_particles << " particles of the particle block file '" << filename
+            << "' are outside of the simulation space of the scene." << std::endl;
+        particle_system.set_number_of_particles(0);
+        return false;
+    }
+    std::cout << "Loaded " << particle_system.number_of_particles_as_string << " particles from '" << filename << "'." << std::endl;
+    return true;
+}
+
+void Particle_Block_File::read_blocks ()
+{
+    std::ifstream file(this->filename, std::ios::binary);
+    file.seekg(sizeof(Particle_Block_File_Header));
+    unsigned int first_particle = 0;
+    while ((first_particle < this->header.number_of_particles) && (file.good() == true)) {
+        unsigned int number_of_block_particles = std::min(this->header.particles_per_block, this->header.number_of_particles - first_particle);
+        Particle_Block block;
+        block.first_particle = first_particle;
+        block.values.resize(PARTICLE_BLOCK_VALUES_PER_PARTICLE * number_of_block_particles);
+        file.read(reinterpret_cast<char*>(block.values.data()), sizeof(float) * block.values.size());
+        if (file.good() == false) {
+            this->read_failed = true;
+            break;
+        }
+        this->block_queue.push(std::move(block));
+        first_particle += number_of_block_particles;
+    }
+    // Tells the loading thread that there are no more blocks.
+    this->block_queue.close();
+}
+
+bool Particle_Block_File::save (std::string filename, Particle_System& particle_system)
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (file.is_open() == false) {
+        std::cout << "ERROR: Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    // The particles vector gets reordered during the simulation (spatial grid), so find every particle by its id.
+    unsigned int number_of_particles = particle_system.number_of_particles;
+    std::vector<unsigned int> particle_indices(number_of_particles);
+    glm::vec3 bounds_min = glm::vec3(0.0f);
+    glm::vec3 bounds_max = glm::vec3(0.0f);
+    for (unsigned int i = 0; i < number_of_particles; i++) {
+        Particle& particle = particle_system.particles[i];
+        particle_indices.at(particle.id) = i;
+        bounds_min = (i == 0) ? particle.position : glm::min(bounds_min, particle.position);
+        bounds_max = (i == 0) ? particle.position : glm::max(bounds_max, particle.position);
+    }
+    Particle_Block_File_Header file_header;
+    std::memset(&file_header, 0, sizeof(Particle_Block_File_Header));
+    std::memcpy(file_header.magic, PARTICLE_BLOCK_FILE_MAGIC, sizeof(PARTICLE_BLOCK_FILE_MAGIC));
+    file_header.version = PARTICLE_BLOCK_FILE_VERSION;
+    file_header.number_of_particles = number_of_particles;
+    file_header.particles_per_block = PARTICLE_BLOCK_SIZE;
+    file_header.particle_initial_distance = particle_system.get_particle_initial_distance();
+    for (int axis = 0; axis < 3; axis++) {
+        file_header.bounds_min[axis] = bounds_min[axis];
+        file_header.bounds_max[axis] = bounds_max[axis];
+    }
+    file.write(reinterpret_cast<const char*>(&file_header), sizeof(Particle_Block_File_Header));
+    std::vector<float> values;
+    for (unsigned int first_particle = 0; first_particle < number_of_particles; first_particle += PARTICLE_BLOCK_SIZE) {
+        unsigned int number_of_block_particles = std::min((unsigned int)PARTICLE_BLOCK_SIZE, number_of_particles - first_particle);
+        values.resize(PARTICLE_BLOCK_VALUES_PER_PARTICLE * number_of_block_particles);
+        for (unsigned int i = 0; i < number_of_block_particles; i++) {
+            Particle& particle = particle_system.particles[particle_indices.at(first_particle + i)];
+            float* particle_values = &values[PARTICLE_BLOCK_VALUES_PER_PARTICLE * i];
+            particle_values[0] = particle.position.x;
+            particle_values[1] = particle.position.y;
+            particle_values[2] = particle.position.z;
+            particle_values[3] = particle.velocity.x;
+            particle_values[4] = particle.velocity.y;
+            particle_values[5] = particle.velocity.z;
+        }
+        file.write(reinterpret_cast<const char*>(values.data()), sizeof(float) * values.size());
+    }
+    file.close();
+    if (file.fail() == true) {
+        std::cout << "ERROR: Failed to write file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    std::cout << "Saved " << particle_system.number_of_particles_as_string << " particles to '" << filename << "'." << std::endl;
+    return true;
+}
\ No newline at end of file
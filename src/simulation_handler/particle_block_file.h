@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "../utils/particle_system.h"
+#include "../utils/bounded_queue.h"
+
+// Scenes with millions of particles do not have to generate their particles when they are loaded. Instead,
+// the particles can be generated once (e.g. relaxed, see initial_state_cache.h) and saved as a particle block
+// file, which a scene file refers to (see scene_information.h).
+// The file starts with a header followed by the blocks. Every block holds the position and the velocity of
+// PARTICLE_BLOCK_SIZE particles (the last block may hold fewer), in the order of the particle ids.
+// When the file is loaded, a background thread reads one block after the other and hands them over to the
+// loading thread, which creates the particles. So reading the file and creating the particles overlap, and
+// besides the particles themselves only a few blocks are in memory at the same time.
+#define PARTICLE_BLOCK_FILE_EXTENSION           ".rtgpparticles"
+#define PARTICLE_BLOCK_FILE_MAGIC               "RTGPPRT"
+#define PARTICLE_BLOCK_FILE_VERSION             1
+// The number of particles per block.
+#define PARTICLE_BLOCK_SIZE                     65536
+// The values per particle (position and velocity).
+#define PARTICLE_BLOCK_VALUES_PER_PARTICLE      6
+// How many blocks the background thread may read ahead.
+#define PARTICLE_BLOCK_QUEUE_CAPACITY           4
+
+struct Particle_Block_File_Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t number_of_particles;
+    uint32_t particles_per_block;
+    // The distance the particles were generated with. The kernel radius depends on it, so it is used for the simulation.
+    float particle_initial_distance;
+    // The bounding box of all particles.
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+// One block as it is handed over from the background thread to the loading thread.
+struct Particle_Block
+{
+    unsigned int first_particle;
+    std::vector<float> values;
+};
+
+class Particle_Block_File
+{
+    private:
+        std::string filename;
+        // The blocks read by the background thread.
+        Bounded_Queue<Particle_Block> block_queue;
+        // Set by the background thread if the file could not be read completely.
+        bool read_failed;
+        // The function executed by the background thread.
+        void read_blocks ();
+
+    public:
+        Particle_Block_File ();
+
+        Particle_Block_File_Header header;
+
+        // Reads and checks the header of the file (and that the file is as large as its number of particles needs).
+        // Returns false if the file cannot be used.
+        bool read_header (std::string filename);
+        // Streams the particles of the file into the particle system. The simulation space has to be set, a file with
+        // particles outside of it is rejected. Returns false if the file cannot be read (the particle system is left
+        // without particles then).
+        bool load (std::string filename, Particle_System& particle_system);
+        // Saves the particles of the particle system as a particle block file.
+        bool save (std::string filename, Particle_System& particle_system);
+};
\ No newline at end of file
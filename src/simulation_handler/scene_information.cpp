@@ -1,11 +1,45 @@
 #include <iostream>
+#include <fstream>
+#include <filesystem>
 
 #include "scene_information.h"
+#include "particle_block_file.h"
+
+// ====================================== SETTINGS ======================================
+
+void Scene_Settings::apply (Particle_System& particle_system)
+{
+    if (this->particle_initial_distance.has_value() == true) {
+        particle_system.set_particle_initial_distance(this->particle_initial_distance.value());
+    }
+    if (this->seeding_pattern.has_value() == true) {
+        particle_system.seeding_pattern = this->seeding_pattern.value();
+    }
+    particle_system.sph_particle_mass = this->sph_particle_mass.value_or(particle_system.sph_particle_mass);
+    particle_system.sph_rest_density = this->sph_rest_density.value_or(particle_system.sph_rest_density);
+    particle_system.sph_gas_constant = this->sph_gas_constant.value_or(particle_system.sph_gas_constant);
+    particle_system.sph_viscosity = this->sph_viscosity.value_or(particle_system.sph_viscosity);
+    particle_system.collision_reflexion_damping = this->collision_reflexion_damping.value_or(particle_system.collision_reflexion_damping);
+    particle_system.collision_force_damping = this->collision_force_damping.value_or(particle_system.collision_force_damping);
+    particle_system.collision_force_spring_constant = this->collision_force_spring_constant.value_or(particle_system.collision_force_spring_constant);
+    particle_system.collision_force_distance_tolerance = this->collision_force_distance_tolerance.value_or(particle_system.collision_force_distance_tolerance);
+    if (this->gravity_mode.has_value() == true) {
+        particle_system.change_gravity_mode(this->gravity_mode.value());
+    }
+    if (this->computation_mode.has_value() == true) {
+        particle_system.change_computation_mode(this->computation_mode.value());
+    }
+    particle_system.number_of_threads = this->number_of_threads.value_or(particle_system.number_of_threads);
+}
+
+
+// ====================================== SCENE ======================================
 
 Scene_Information::Scene_Information ()
 {
-    // No implementation. 
-    // This one is only needed for the from_json function to work.
+    // Used for the scenes that are loaded from a scene file.
+    this->number_of_file_particles = 0;
+    this->file_particle_initial_distance = 0.0f;
 }
 
 Scene_Information::Scene_Information (  std::string description,
@@ -15,6 +49,180 @@ Scene_Information::Scene_Information (  std::string description,
     this->description = description;
     this->simulation_space = simulation_space;
     this->fluid_starting_positions = fluid_starting_positions;
+    this->number_of_file_particles = 0;
+    this->file_particle_initial_distance = 0.0f;
+}
+
+// Reads a value of a setting and checks that it is within the given range (the same as the one of the user interface).
+template <typename T>
+static bool parse_setting (std::istringstream& values, T min, T max, std::optional<T>& setting)
+{
+    T value;
+    if ((values >> value) && (value >= min) && (value <= max)) {
+        setting = value;
+        return true;
+    }
+    return false;
+}
+
+static bool parse_cuboid (std::istringstream& values, Cuboid& cuboid)
+{
+    if (values >> cuboid.x_min >> cuboid.x_max >> cuboid.y_min >> cuboid.y_max >> cuboid.z_min >> cuboid.z_max) {
+        return (cuboid.x_min < cuboid.x_max) && (cuboid.y_min < cuboid.y_max) && (cuboid.z_min < cuboid.z_max);
+    }
+    return false;
+}
+
+bool Scene_Information::parse_scene_file_line (std::string keyword, std::istringstream& values, std::string directory)
+{
+    std::string value;
+    if (keyword == "description") {
+        std::getline(values >> std::ws, this->description);
+        return this->description.empty() == false;
+    }
+    if (keyword == "simulation_space") {
+        return parse_cuboid(values, this->simulation_space);
+    }
+    if (keyword == "fluid") {
+        Cuboid cuboid;
+        if (parse_cuboid(values, cuboid) == false) {
+            return false;
+        }
+        this->fluid_starting_positions.push_back(cuboid);
+        return true;
+    }
+    if (keyword == "particles") {
+        if (!(values >> value)) {
+            return false;
+        }
+        this->particles_filename = (std::filesystem::path(directory) / value).string();
+        return true;
+    }
+    if (keyword == "particle_distance") {
+        return parse_setting(values, PARTICLE_INITIAL_DISTANCE_MIN, PARTICLE_INITIAL_DISTANCE_MAX, this->settings.particle_initial_distance);
+    }
+    if (keyword == "seeding") {
+        values >> value;
+        if (value == "cubic")           this->settings.seeding_pattern = SEEDING_PATTERN_CUBIC;
+        else if (value == "jittered")   this->settings.seeding_pattern = SEEDING_PATTERN_JITTERED;
+        else if (value == "hcp")        this->settings.seeding_pattern = SEEDING_PATTERN_HEXAGONAL_CLOSE_PACKED;
+        else                            return false;
+        return true;
+    }
+    if (keyword == "particle_mass") {
+        return parse_setting(values, SPH_PARTICLE_MASS_MIN, SPH_PARTICLE_MASS_MAX, this->settings.sph_particle_mass);
+    }
+    if (keyword == "rest_density") {
+        return parse_setting(values, SPH_REST_DENSITY_MIN, SPH_REST_DENSITY_MAX, this->settings.sph_rest_density);
+    }
+    if (keyword == "gas_constant") {
+        return parse_setting(values, SPH_GAS_CONSTANT_MIN, SPH_GAS_CONSTANT_MAX, this->settings.sph_gas_constant);
+    }
+    if (keyword == "viscosity") {
+        return parse_setting(values, SPH_VISCOSITY_MIN, SPH_VISCOSITY_MAX, this->settings.sph_viscosity);
+    }
+    if (keyword == "collision_reflexion_damping") {
+        return parse_setting(values, SPH_COLLISION_REFLEXION_DAMPING_MIN, SPH_COLLISION_REFLEXION_DAMPING_MAX,
+            this->settings.collision_reflexion_damping);
+    }
+    if (keyword == "collision_force_damping") {
+        return parse_setting(values, SPH_COLLISION_FORCE_DAMPING_MIN, SPH_COLLISION_FORCE_DAMPING_MAX,
+            this->settings.collision_force_damping);
+    }
+    if (keyword == "collision_force_spring_constant") {
+        return parse_setting(values, SPH_COLLISION_FORCE_SPRING_CONSTANT_MIN, SPH_COLLISION_FORCE_SPRING_CONSTANT_MAX,
+            this->settings.collision_force_spring_constant);
+    }
+    if (keyword == "collision_force_distance_tolerance") {
+        return parse_setting(values, SPH_COLLISION_FORCE_DISTANCE_TOLERANCE_MIN, SPH_COLLISION_FORCE_DISTANCE_TOLERANCE_MAX,
+            this->settings.collision_force_distance_tolerance);
+    }
+    if (keyword == "gravity") {
+        values >> value;
+        if (value == "off")             this->settings.gravity_mode = GRAVITY_OFF;
+        else if (value == "normal")     this->settings.gravity_mode = GRAVITY_NORMAL;
+        else if (value == "rot-90")     this->settings.gravity_mode = GRAVITY_ROT_90;
+        else if (value == "wave")       this->settings.gravity_mode = GRAVITY_WAVE;
+        else                            return false;
+        return true;
+    }
+    if (keyword == "computation_mode") {
+        values >> value;
+        if (value == "grid")            this->settings.computation_mode = COMPUTATION_MODE_SPATIAL_GRID;
+        else if (value == "brute-force") this->settings.computation_mode = COMPUTATION_MODE_BRUTE_FORCE;
+        else                            return false;
+        return true;
+    }
+    if (keyword == "threads") {
+        return parse_setting(values, SIMULATION_NUMBER_OF_THREADS_MIN, SIMULATION_NUMBER_OF_THREADS_MAX, this->settings.number_of_threads);
+    }
+    if ((keyword == "emitter") || (keyword == "obstacle")) {
+        std::cout << "ERROR: The simulation does not support " << keyword << "s (only the simulation space is a boundary)." << std::endl;
+        return false;
+    }
+    std::cout << "ERROR: Unknown keyword '" << keyword << "'." << std::endl;
+    return false;
+}
+
+bool Scene_Information::load_from_file (std::string filename)
+{
+    std::ifstream file(filename);
+    if (file.is_open() == false) {
+        std::cout << "ERROR: Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    this->filename = filename;
+    this->description = std::filesystem::path(filename).stem().string();
+    std::string directory = std::filesystem::path(filename).parent_path().string();
+    bool has_simulation_space = false;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        // Remove the comment and skip empty lines.
+        line = line.substr(0, line.find('#'));
+        std::istringstream values(line);
+        std::string keyword;
+        if (!(values >> keyword)) {
+            continue;
+        }
+        // Every keyword has to be followed by exactly its values.
+        if ((this->parse_scene_file_line(keyword, values, directory) == false) ||
+            ((values >> std::ws).eof() == false)) {
+            std::cout << "ERROR: Invalid line " << line_number << " in scene file '" << filename << "': " << line << std::endl;
+            return false;
+        }
+        has_simulation_space |= (keyword == "simulation_space");
+    }
+    if (has_simulation_space == false) {
+        std::cout << "ERROR: The scene file '" << filename << "' has no simulation space." << std::endl;
+        return false;
+    }
+    if (this->has_file_particles() == true) {
+        // Only the header is read now, the particles are streamed when the scene is loaded.
+        Particle_Block_File particle_block_file;
+        if (particle_block_file.read_header(this->particles_filename) == false) {
+            return false;
+        }
+        this->number_of_file_particles = particle_block_file.header.number_of_particles;
+        this->file_particle_initial_distance = particle_block_file.header.particle_initial_distance;
+        // The bounding box of the particles is used as their starting position (e.g. for the point of interest).
+        this->fluid_starting_positions.clear();
+        this->fluid_starting_positions.push_back(Cuboid(
+            particle_block_file.header.bounds_min[0], particle_block_file.header.bounds_max[0],
+            particle_block_file.header.bounds_min[1], particle_block_file.header.bounds_max[1],
+            particle_block_file.header.bounds_min[2], particle_block_file.header.bounds_max[2]));
+    }
+    else if (this->fluid_starting_positions.empty() == true) {
+        std::cout << "ERROR: The scene file '" << filename << "' has neither fluid nor particles." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Scene_Information::has_file_particles ()
+{
+    return this->particles_filename.empty() == false;
 }
 
 bool Scene_Information::is_valid ()
@@ -29,5 +237,9 @@ bool Scene_Information::is_valid ()
 
 void Scene_Information::print_information ()
 {
-    std::cout << this->description << std::endl;
+    std::cout << this->description;
+    if (this->filename.empty() == false) {
+        std::cout << " [" << this->filename << "]";
+    }
+    std::cout << std::endl;
 }
\ No newline at end of file
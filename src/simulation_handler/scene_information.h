@@ -2,23 +2,82 @@
 
 #include <string>
 #include <vector>
+#include <optional>
+#include <sstream>
 
 #include "../utils/cuboid.h"
+#include "../utils/particle_system.h"
 
-class Scene_Information 
+// Besides the default scenes (see Simulation_Handler::register_default_scenes), scenes can be described in scene
+// files. Every file in the scene directory with the extension below is registered when the application starts.
+// A scene file is a text file with one keyword and its values per line ('#' starts a comment):
+//   description <text>                                 the description shown in the list of scenes
+//   simulation_space <x_min> <x_max> <y_min> <y_max> <z_min> <z_max>
+//   fluid <x_min> <x_max> <y_min> <y_max> <z_min> <z_max>  a cuboid filled with fluid (as often as needed)
+//   particles <file>                                   read the particles from a particle block file (relative to
+//                                                      the scene file, see particle_block_file.h) instead of
+//                                                      generating them, the particle distance is the one of the file
+//   particle_distance <distance>                       the initial distance between the particles
+//   seeding <cubic|jittered|hcp>
+//   particle_mass, rest_density, gas_constant, viscosity <value>
+//   collision_reflexion_damping, collision_force_damping, collision_force_spring_constant,
+//   collision_force_distance_tolerance <value>
+//   gravity <off|normal|rot-90|wave>
+//   computation_mode <grid|brute-force>
+//   threads <number>
+// Everything but the simulation space and the fluid (or the particles) is optional. The settings are applied when
+// the scene is loaded, but not when it is reloaded (so they can still be changed with the user interface).
+#define SCENE_FILE_DIRECTORY                    "./scenes"
+#define SCENE_FILE_EXTENSION                    ".rtgpscene"
+
+// The settings a scene file may contain. A setting without a value is left as it is.
+struct Scene_Settings
+{
+    std::optional<float> particle_initial_distance;
+    std::optional<Seeding_Pattern> seeding_pattern;
+    std::optional<float> sph_particle_mass;
+    std::optional<float> sph_rest_density;
+    std::optional<float> sph_gas_constant;
+    std::optional<float> sph_viscosity;
+    std::optional<float> collision_reflexion_damping;
+    std::optional<float> collision_force_damping;
+    std::optional<float> collision_force_spring_constant;
+    std::optional<float> collision_force_distance_tolerance;
+    std::optional<Gravity_Mode> gravity_mode;
+    std::optional<Computation_Mode> computation_mode;
+    std::optional<int> number_of_threads;
+
+    // Applies all settings that have a value to the particle system.
+    void apply (Particle_System& particle_system);
+};
+
+class Scene_Information
 {
     private:
+        // Parses one line of a scene file. Returns false if the line is invalid.
+        bool parse_scene_file_line (std::string keyword, std::istringstream& values, std::string directory);
 
     public:
         std::string description;
         Cuboid simulation_space;
         std::vector<Cuboid> fluid_starting_positions;
+        Scene_Settings settings;
+        // The scene file the scene was loaded from (empty for the default scenes).
+        std::string filename;
+        // If not empty, the particles are read from this particle block file instead of being generated.
+        std::string particles_filename;
+        // The number of particles and their distance in the particle block file (read when the scene file is loaded).
+        unsigned int number_of_file_particles;
+        float file_particle_initial_distance;
 
         Scene_Information ();
         Scene_Information ( std::string description,
                             Cuboid simulation_space,
                             std::vector<Cuboid> fluid_starting_positions);
-        
+
+        // Loads the scene from a scene file (see above). Returns false if the file cannot be read or is invalid.
+        bool load_from_file (std::string filename);
+        bool has_file_particles ();
         bool is_valid ();
         void print_information ();
 };
\ No newline at end of file
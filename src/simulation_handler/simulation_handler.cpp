@@ -2,8 +2,8 @@
 
 #include <iostream>
 #include <fstream>
-
-#include "../utils/debug.h"
+#include <filesystem>
+#include <algorithm>
 
 
 Simulation_Handler::Simulation_Handler()
@@ -12,6 +12,8 @@ Simulation_Handler::Simulation_Handler()
     this->simulate_one_step = false;
     this->current_scene_id = -1;
     this->next_scene_id = -1;
+    this->loaded_particle_initial_distance = 0.0f;
+    this->marching_cubes_generator = nullptr;
 }
 
 void Simulation_Handler::register_new_scene (   std::string description,
@@ -27,6 +29,87 @@ void Simulation_Handler::register_new_scene (   std::string description,
     }
 }
 
+void Simulation_Handler::register_default_scenes ()
+{
+    // The scenes available in the application (keys 1 - 5) and in the headless simulation.
+    this->register_new_scene(
+        "cube in the middle",
+        Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
+        std::vector<Cuboid> {
+            Cuboid(-0.5f, 0.5f, -0.5f, 0.5f, -0.5f, 0.5f)
+        }
+    );
+    this->register_new_scene(
+        "cube in the middle (big simulation space)",
+        Cuboid(-3.0f, 3.0f, -1.0f, 3.0f, -1.0f, 1.0f),
+        std::vector<Cuboid> {
+            Cuboid(-0.5f, 0.5f, 1.5f, 2.5f, -0.5f, 0.5f)
+        }
+    );
+    this->register_new_scene(
+        "dam break scenario",
+        Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
+        std::vector<Cuboid> {
+            Cuboid(-1.0f, -0.5f, -1.0f, 1.0f, -1.0f, 1.0f)
+        }
+    );
+    this->register_new_scene(
+        "double dam break scenario",
+        Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
+        std::vector<Cuboid> {
+            Cuboid(-1.0f, -0.5f, -1.0f, 1.0f, -1.0f, 1.0f),
+            Cuboid(0.5f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f)
+        }
+    );
+    this->register_new_scene(
+        "drop fall scenario",
+        Cuboid(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f),
+        std::vector<Cuboid> {
+            Cuboid(-1.0f, 1.0f, -1.0f, -0.6f, -1.0f, 1.0f),
+            Cuboid(-0.2f, 0.2f, 0.5f, 0.9f, -0.2f, 0.2f)
+        }
+    );
+}
+
+bool Simulation_Handler::register_scene_file (std::string filename)
+{
+    Scene_Information scene_information;
+    if (scene_information.load_from_file(filename) == false) {
+        std::cout << "ERROR: The scene file '" << filename << "' is not registered." << std::endl;
+        return false;
+    }
+    if (scene_information.is_valid() == false) {
+        std::cout << "ERROR: Scene with description '" << scene_information.description << "' is invalid." << std::endl;
+        return false;
+    }
+    this->available_scenes.push_back(scene_information);
+    return true;
+}
+
+int Simulation_Handler::register_scene_files (std::string directory)
+{
+    // Not having any scene files is fine.
+    std::error_code error;
+    if (std::filesystem::is_directory(directory, error) == false) {
+        return 0;
+    }
+    std::vector<std::string> filenames;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error)) {
+        if ((entry.is_regular_file() == true) && (entry.path().extension() == SCENE_FILE_EXTENSION)) {
+            filenames.push_back(entry.path().string());
+        }
+    }
+    // The order of the directory iterator is unspecified, but the scene ids should not change from run to run.
+    std::sort(filenames.begin(), filenames.end());
+    int number_of_registered_scenes = 0;
+    for (std::string& filename : filenames) {
+        if (this->register_scene_file(filename) == true) {
+            number_of_registered_scenes++;
+        }
+    }
+    return number_of_registered_scenes;
+}
+
 bool Simulation_Handler::delete_scene (int scene_id) 
 {
     if (scene_id > this->available_scenes.size() - 1) {
@@ -52,12 +135,123 @@ bool Simulation_Handler::load_scene ()
         std::cout << "scene_id " << this->next_scene_id << " is not registered." << std::endl; 
         return false;
     }
+    // A new scene brings its own particle distance (if it has one). The particles of a particle block file
+    // always have the distance they were generated with.
+    Scene_Information& scene = this->available_scenes.at(this->next_scene_id);
+    bool is_new_scene = (this->next_scene_id != this->current_scene_id);
+    float particle_initial_distance = this->particle_system.get_particle_initial_distance();
+    if (scene.has_file_particles() == true) {
+        if (particle_initial_distance != scene.file_particle_initial_distance) {
+            std::cout << "The particles of this scene are read from '" << scene.particles_filename 
+                << "', so the particle distance is " << scene.file_particle_initial_distance << "." << std::endl;
+        }
+        particle_initial_distance = scene.file_particle_initial_distance;
+    }
+    else if ((is_new_scene == true) && (scene.settings.particle_initial_distance.has_value() == true)) {
+        particle_initial_distance = scene.settings.particle_initial_distance.value();
+    }
+    // The same for the seeding pattern. The settings are applied after the budget check, so the pattern the scene
+    // will be seeded with is passed explicitly.
+    Seeding_Pattern seeding_pattern = this->particle_system.seeding_pattern;
+    if ((is_new_scene == true) && (scene.settings.seeding_pattern.has_value() == true)) {
+        seeding_pattern = scene.settings.seeding_pattern.value();
+    }
+    // Check if the scene fits into the memory budget before anything is allocated.
+    size_t predicted_bytes = this->predict_memory_footprint(this->next_scene_id, particle_initial_distance, seeding_pattern);
+    std::string description = "The scene with scene_id " + std::to_string(this->next_scene_id) + 
+        " and a particle distance of " + std::to_string(particle_initial_distance);
+    if (memory_accounting.check_budget(predicted_bytes, description) == false) {
+        if (this->current_scene_id < 0) {
+            std::cout << "ERROR: The scene exceeds the memory budget and is not loaded." << std::endl;
+            return false;
+        }
+        // Keep the scene we have. The particles of this scene are still there, so there is nothing to load.
+        std::cout << "The scene exceeds the memory budget and is not loaded. Keeping the current scene." << std::endl;
+        this->next_scene_id = this->current_scene_id;
+        this->particle_system.set_particle_initial_distance(this->loaded_particle_initial_distance);
+        return true;
+    }
+    if (is_new_scene == true) {
+        scene.settings.apply(this->particle_system);
+    }
+    this->particle_system.set_particle_initial_distance(particle_initial_distance);
     this->current_scene_id = this->next_scene_id;
-    this->particle_system.generate_initial_particles(this->available_scenes[current_scene_id].fluid_starting_positions);
-    this->particle_system.set_simulation_space(&this->available_scenes[current_scene_id].simulation_space);
+    this->loaded_particle_initial_distance = particle_initial_distance;
+    // The simulation space is set first, since the relaxation of the initial particles needs it.
+    this->particle_system.set_simulation_space(&scene.simulation_space);
+    if (this->generate_initial_particles(scene) == false) {
+        return false;
+    }
+    // If we are recording, the new scene has nothing in common with the previous frames.
+    // Start a new chunk so that the first frame of the new scene is a keyframe.
+    this->simulation_recorder.start_new_chunk();
     return true;
 }
 
+bool Simulation_Handler::generate_initial_particles (Scene_Information& scene)
+{
+    if (scene.has_file_particles() == true) {
+        Particle_Block_File particle_block_file;
+        return particle_block_file.load(scene.particles_filename, this->particle_system);
+    }
+    if (this->initial_state_cache.is_active == false) {
+        this->particle_system.generate_initial_particles(scene.fluid_starting_positions);
+        return true;
+    }
+    uint64_t key = this->initial_state_cache.get_key(this->particle_system, scene.simulation_space, scene.fluid_starting_positions);
+    if (this->initial_state_cache.load(key, this->particle_system) == true) {
+        return true;
+    }
+    std::cout << "There is no relaxed initial state for this configuration yet. Relaxing the initial particles..." << std::endl;
+    this->particle_system.generate_initial_particles(scene.fluid_starting_positions);
+    unsigned int relaxation_steps = this->particle_system.relax_initial_particles(scene.fluid_starting_positions);
+    this->initial_state_cache.save(key, this->particle_system, relaxation_steps);
+    return true;
+}
+
+size_t Simulation_Handler::predict_memory_footprint (int scene_id, float particle_initial_distance, Seeding_Pattern seeding_pattern)
+{
+    size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT] = {};
+    Scene_Information& scene = this->available_scenes.at(scene_id);
+    // The particles, the spatial grid and its mutexes. Note that the spatial grid is predicted even if the brute
+    // force mode is used at the moment, since the computation mode can be changed at any time.
+    if (scene.has_file_particles() == true) {
+        this->particle_system.predict_memory_footprint((size_t)scene.number_of_file_particles, scene.simulation_space, 
+            particle_initial_distance, predicted_bytes);
+    }
+    else {
+        this->particle_system.predict_memory_footprint(scene.fluid_starting_positions, scene.simulation_space, 
+            particle_initial_distance, seeding_pattern, predicted_bytes);
+    }
+    // If there is a visualization, the particles are also uploaded to the GPU (the particle and its index,
+    // see Particle_Renderer).
+    if (memory_accounting.get_current_bytes(MEMORY_SUBSYSTEM_GPU_PARTICLE_BUFFERS) > 0) {
+        predicted_bytes[MEMORY_SUBSYSTEM_GPU_PARTICLE_BUFFERS] = 
+            (predicted_bytes[MEMORY_SUBSYSTEM_PARTICLES] / sizeof(Particle)) * (sizeof(Particle) + sizeof(unsigned int));
+    }
+    // The grids of the marching cubes grow with the simulation space (and the cells of the particles with the particles).
+    bool marching_cubes_are_predicted = (this->marching_cubes_generator != nullptr) && (this->marching_cubes_generator->new_cube_edge_length > 0.0f);
+    if (marching_cubes_are_predicted == true) {
+        size_t number_of_particles = predicted_bytes[MEMORY_SUBSYSTEM_PARTICLES] / sizeof(Particle);
+        this->marching_cubes_generator->predict_memory_footprint(scene.simulation_space, this->marching_cubes_generator->new_cube_edge_length,
+            number_of_particles, this->particle_system.number_of_threads, predicted_bytes);
+    }
+    // The other subsystems (the mesh, the active cubes and their GPU buffers only hold the surface) are expected to
+    // stay as they are.
+    size_t total_bytes = 0;
+    for (int i = 0; i < _MEMORY_SUBSYSTEM_COUNT; i++) {
+        Memory_Subsystem memory_subsystem = (Memory_Subsystem)i;
+        bool is_predicted = 
+            (memory_subsystem == MEMORY_SUBSYSTEM_PARTICLES) || 
+            (memory_subsystem == MEMORY_SUBSYSTEM_SPATIAL_GRID) || 
+            (memory_subsystem == MEMORY_SUBSYSTEM_SPATIAL_GRID_MUTEXES) || 
+            (memory_subsystem == MEMORY_SUBSYSTEM_GPU_PARTICLE_BUFFERS) ||
+            ((marching_cubes_are_predicted == true) && (Marching_Cubes_Generator::predicts_memory_subsystem(memory_subsystem) == true));
+        total_bytes += (is_predicted == true) ? predicted_bytes[i] : memory_accounting.get_current_bytes(memory_subsystem);
+    }
+    return total_bytes;
+}
+
 void Simulation_Handler::print_scene_information () 
 {
     std::cout << std::endl << "Available scenes:" << std::endl;
@@ -73,26 +267,67 @@ void Simulation_Handler::toggle_pause_resume_simulation ()
     this->is_running = !this->is_running;
 }
 
+void Simulation_Handler::toggle_recording ()
+{
+    if (this->simulation_recorder.is_recording == true) {
+        this->simulation_recorder.stop_recording();
+    }
+    else {
+        this->simulation_recorder.start_recording();
+    }
+}
+
 void Simulation_Handler::simulate ()
 {
     if (this->is_running == true) {
         this->particle_system.simulate();
+        this->simulation_recorder.record_frame(this->particle_system);
     }
     // Maybe we just want to simulte one step.
     else if (this->simulate_one_step == true) {
         this->particle_system.simulate();
+        this->simulation_recorder.record_frame(this->particle_system);
         // Done. Reset the variable then.
         this->simulate_one_step = false;
     }
 }
 
+bool Simulation_Handler::start_replay ()
+{
+    // Replay the latest recording. If it is still being written, finish it first.
+    std::string filename = this->simulation_recorder.get_filename();
+    if (filename.empty() == true) {
+        filename = REPLAY_DEFAULT_FILENAME;
+    }
+    this->simulation_recorder.stop_recording();
+    return this->simulation_replayer.open(filename);
+}
+
+void Simulation_Handler::stop_replay ()
+{
+    this->simulation_replayer.close();
+}
+
+bool Simulation_Handler::replay ()
+{
+    this->simulation_replayer.update();
+    return this->simulation_replayer.load_current_frame(this->particle_system);
+}
+
 Cuboid* Simulation_Handler::get_pointer_to_simulation_space ()
 {
+    // During the replay the simulation space is the one stored in the recording.
+    if (this->simulation_replayer.is_open == true) {
+        return this->simulation_replayer.get_pointer_to_simulation_space();
+    }
     return &this->available_scenes[this->current_scene_id].simulation_space;
 }
 
 std::vector<Cuboid>* Simulation_Handler::get_pointer_to_fluid_starting_positions ()
 {
+    if (this->simulation_replayer.is_open == true) {
+        return this->simulation_replayer.get_pointer_to_fluid_starting_positions();
+    }
     return &this->available_scenes[this->current_scene_id].fluid_starting_positions;
 }
 
@@ -101,7 +336,25 @@ Particle_System* Simulation_Handler::get_pointer_to_particle_system ()
     return &this->particle_system;
 }
 
+Simulation_Recorder* Simulation_Handler::get_pointer_to_simulation_recorder ()
+{
+    return &this->simulation_recorder;
+}
+
+Simulation_Replayer* Simulation_Handler::get_pointer_to_simulation_replayer ()
+{
+    return &this->simulation_replayer;
+}
+
+Initial_State_Cache* Simulation_Handler::get_pointer_to_initial_state_cache ()
+{
+    return &this->initial_state_cache;
+}
+
 glm::vec3 Simulation_Handler::get_current_point_of_interest ()
 {
+    if (this->simulation_replayer.is_open == true) {
+        return this->simulation_replayer.get_pointer_to_simulation_space()->get_point_of_interest();
+    }
     return this->available_scenes[this->current_scene_id].simulation_space.get_point_of_interest();
 }
\ No newline at end of file
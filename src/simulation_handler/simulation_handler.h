@@ -4,13 +4,26 @@
 #include <vector>
 
 #include "scene_information.h"
+#include "simulation_recorder.h"
+#include "simulation_replayer.h"
+#include "initial_state_cache.h"
+#include "particle_block_file.h"
 #include "../utils/cuboid.h"
 #include "../utils/particle_system.h"
+#include "../utils/memory_accounting.h"
+#include "../utils/marching_cubes.h"
 
 class Simulation_Handler 
 {
     private:
         void calculate_initial_particle_positions ();
+        // The particle distance of the scene that is loaded at the moment. If a scene is refused because
+        // it exceeds the memory budget, we go back to this distance.
+        float loaded_particle_initial_distance;
+        // Creates the initial particles of the scene. If the initial state cache is active, the relaxed particles are
+        // loaded from the cache or relaxed (and stored in the cache). If the scene has a particle block file, the
+        // particles are streamed from the file instead. Returns false if the particle block file cannot be read.
+        bool generate_initial_particles (Scene_Information& scene);
 
     public:
         // The is_running bool is used to pause and resume the simulation.
@@ -23,6 +36,15 @@ class Simulation_Handler
         int next_scene_id;
         std::vector<Scene_Information> available_scenes;
         Particle_System particle_system;
+        // The cache of the relaxed initial states (used if it is active).
+        Initial_State_Cache initial_state_cache;
+        // The recorder captures every simulation step if the recording is active.
+        Simulation_Recorder simulation_recorder;
+        // The replayer plays back a recording instead of simulating.
+        Simulation_Replayer simulation_replayer;
+        // The marching cubes of the visualization (or nullptr if there are none). Their grids grow with the simulation
+        // space of the scene, so they are part of the predicted memory footprint.
+        Marching_Cubes_Generator* marching_cubes_generator;
 
         Simulation_Handler();
 
@@ -30,20 +52,45 @@ class Simulation_Handler
         void register_new_scene (   std::string description,
                                     Cuboid&& simulation_space,
                                     std::vector<Cuboid> fluid_starting_positions);
+        // Registers the scenes that come with the application.
+        void register_default_scenes ();
+        // Registers the scene described in a scene file (see scene_information.h). Returns false if it is invalid.
+        bool register_scene_file (std::string filename);
+        // Registers all scene files of the directory (sorted by their names). Returns the number of registered scenes.
+        int register_scene_files (std::string directory);
         bool delete_scene (int scene_id);
         void delete_all_scenes ();
+        // Loads the scene next_scene_id with the particle distance set in the particle system. If the scene is not the
+        // current scene, the settings of its scene file are applied first (see Scene_Settings). Before anything is
+        // allocated, the footprint of the scene is compared with the memory budget (see memory_accounting.h).
+        // If the budget is exceeded and the budget mode is REFUSE, the scene loaded before is kept (and the particle
+        // distance is reset to the one of that scene). If there is no scene loaded before, false is returned.
         bool load_scene ();
+        // Predicts the memory (in bytes, all subsystems) needed if the scene was loaded with the given particle distance
+        // and seeding pattern (including the grids of the marching cubes generator, if there is one).
+        size_t predict_memory_footprint (int scene_id, float particle_initial_distance, Seeding_Pattern seeding_pattern);
         void print_scene_information ();
 
         // Simulation handling.
         void toggle_pause_resume_simulation ();
+        void toggle_recording ();
         void simulate ();
 
+        // Replay handling. Starting the replay stops a running recording first (we replay the file we just wrote).
+        bool start_replay ();
+        void stop_replay ();
+        // Loads the current frame of the replay into the particle system. Returns true if the simulation space
+        // or the number of particles changed.
+        bool replay ();
+
 
         // Some functions that return pointers to the cuboids and other 
         // informations needed for rendering by the visualization handler.
         Cuboid* get_pointer_to_simulation_space ();
         std::vector<Cuboid>* get_pointer_to_fluid_starting_positions ();
         Particle_System* get_pointer_to_particle_system ();
+        Simulation_Recorder* get_pointer_to_simulation_recorder ();
+        Simulation_Replayer* get_pointer_to_simulation_replayer ();
+        Initial_State_Cache* get_pointer_to_initial_state_cache ();
         glm::vec3 get_current_point_of_interest ();
 };
\ No newline at end of file
@@ -0,0 +1,260 @@
+#include "simulation_recorder.h"
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+
+#include "../utils/helper.h"
+#include "../utils/trace.h"
+
+
+// ====================================== STATISTICS ======================================
+
+void Recording_Statistics::reset ()
+{
+    this->frames_recorded = 0;
+    this->frames_written = 0;
+    this->chunks_written = 0;
+    this->uncompressed_bytes = 0;
+    this->written_bytes = 0;
+    this->stall_count = 0;
+    this->stall_time_ns = 0;
+    this->queue_depth = 0;
+    this->max_queue_depth = 0;
+}
+
+float Recording_Statistics::get_compression_ratio ()
+{
+    if (this->written_bytes == 0) {
+        return 0.0f;
+    }
+    return (float)this->uncompressed_bytes / (float)this->written_bytes;
+}
+
+
+// ====================================== RECORDER ======================================
+
+Simulation_Recorder::Simulation_Recorder ()
+{
+    this->is_recording = false;
+    this->force_new_chunk = true;
+    this->velocity_precision = RECORDER_VELOCITY_PRECISION;
+    this->frames_per_chunk = RECORDER_FRAMES_PER_CHUNK;
+    this->number_of_written_frames = 0;
+    this->frame_queue.set_capacity(RECORDER_QUEUE_CAPACITY);
+    this->statistics.reset();
+}
+
+Simulation_Recorder::~Simulation_Recorder ()
+{
+    // Make sure the background thread is not running anymore when the recorder is destroyed.
+    if (this->is_recording == true) {
+        this->stop_recording();
+    }
+}
+
+bool Simulation_Recorder::start_recording (std::string filename)
+{
+    if (this->is_recording == true) {
+        std::cout << "The simulation is already being recorded." << std::endl;
+        return false;
+    }
+    this->file.open(filename, std::ios::binary | std::ios::trunc);
+    if (this->file.is_open() == false) {
+        std::cout << "Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    this->filename = filename;
+    // Write the file header.
+    Recording_File_Header file_header;
+    std::memset(&file_header, 0, sizeof(Recording_File_Header));
+    std::memcpy(file_header.magic, RECORDER_FILE_MAGIC, sizeof(RECORDER_FILE_MAGIC));
+    file_header.version = RECORDER_FILE_VERSION;
+    file_header.frames_per_chunk = this->frames_per_chunk;
+    this->file.write(reinterpret_cast<const char*>(&file_header), sizeof(Recording_File_Header));
+    // Reset everything and start the background thread.
+    this->statistics.reset();
+    this->statistics.written_bytes += sizeof(Recording_File_Header);
+    this->number_of_written_frames = 0;
+    this->current_chunk_payload.clear();
+    this->previous_frame_values.clear();
+    this->current_chunk_header.number_of_frames = 0;
+    this->force_new_chunk = true;
+    this->frame_queue.reset();
+    this->writer_thread = std::thread(&Simulation_Recorder::write_frames, this);
+    this->is_recording = true;
+    std::cout << "Started recording the simulation to '" << filename << "'." << std::endl;
+    return true;
+}
+
+void Simulation_Recorder::stop_recording ()
+{
+    if (this->is_recording == false) {
+        return;
+    }
+    // Closing the queue tells the background thread to write the remaining frames and stop.
+    this->frame_queue.close();
+    this->writer_thread.join();
+    this->file.close();
+    this->is_recording = false;
+    std::cout << "Stopped recording the simulation." << std::endl;
+    this->print_statistics();
+}
+
+void Simulation_Recorder::start_new_chunk ()
+{
+    this->force_new_chunk = true;
+}
+
+std::string Simulation_Recorder::get_filename ()
+{
+    return this->filename;
+}
+
+void Simulation_Recorder::record_frame (Particle_System& particle_system)
+{
+    if ((this->is_recording == false) || (particle_system.number_of_particles == 0)) {
+        return;
+    }
+    TRACE_SCOPE("Simulation_Recorder::record_frame");
+    Recording_Frame frame;
+    frame.start_new_chunk = this->force_new_chunk;
+    frame.number_of_particles = particle_system.number_of_particles;
+    frame.bounds_min = glm::vec3(
+        particle_system.simulation_space->x_min,
+        particle_system.simulation_space->y_min,
+        particle_system.simulation_space->z_min);
+    frame.bounds_max = glm::vec3(
+        particle_system.simulation_space->x_max,
+        particle_system.simulation_space->y_max,
+        particle_system.simulation_space->z_max);
+    frame.velocity_precision = this->velocity_precision;
+    // Quantise the particles. Sort them by their id so that the same particle is at the same
+    // position in every frame (otherwise the delta encoding would not make sense).
+    unsigned int n = frame.number_of_particles;
+    frame.quantized_values.resize(RECORDER_VALUES_PER_PARTICLE * n);
+    uint16_t* values = frame.quantized_values.data();
+    for (const Particle& particle : particle_system.particles) {
+        unsigned int id = particle.id;
+        // An id outside of the particles would write into the values of the next component (or behind the frame).
+        // The frame cannot be sorted by id then, so it is not recorded.
+        if (id >= n) {
+            std::cout << "ERROR: The particle id " << id << " is outside of the " << n << " particles, the frame is not recorded." << std::endl;
+            return;
+        }
+        values[0 * n + id] = quantize_position(particle.position.x, frame.bounds_min.x, frame.bounds_max.x);
+        values[1 * n + id] = quantize_position(particle.position.y, frame.bounds_min.y, frame.bounds_max.y);
+        values[2 * n + id] = quantize_position(particle.position.z, frame.bounds_min.z, frame.bounds_max.z);
+        values[3 * n + id] = quantize_velocity(particle.velocity.x, frame.velocity_precision);
+        values[4 * n + id] = quantize_velocity(particle.velocity.y, frame.velocity_precision);
+        values[5 * n + id] = quantize_velocity(particle.velocity.z, frame.velocity_precision);
+    }
+    this->force_new_chunk = false;
+    this->statistics.frames_recorded++;
+    this->statistics.uncompressed_bytes += sizeof(Particle) * n;
+    // Hand the frame over to the background thread. If the queue is full, we have to wait (stall).
+    std::chrono::nanoseconds waited_time;
+    this->frame_queue.push(std::move(frame), &waited_time);
+    if (waited_time.count() > 0) {
+        this->statistics.stall_count++;
+        this->statistics.stall_time_ns += waited_time.count();
+    }
+    unsigned int queue_depth = this->frame_queue.size();
+    this->statistics.queue_depth = queue_depth;
+    if (queue_depth > this->statistics.max_queue_depth) {
+        this->statistics.max_queue_depth = queue_depth;
+    }
+}
+
+
+// ====================================== BACKGROUND THREAD ======================================
+
+void Simulation_Recorder::write_frames ()
+{
+    Recording_Frame frame;
+    while (this->frame_queue.pop(frame) == true) {
+        this->statistics.queue_depth = this->frame_queue.size();
+        this->encode_frame(frame);
+    }
+    // The queue was closed. Write the last chunk.
+    this->flush_chunk();
+}
+
+void Simulation_Recorder::encode_frame (Recording_Frame& frame)
+{
+    TRACE_SCOPE("Simulation_Recorder::encode_frame");
+    // Check if this frame can be appended to the current chunk. A new chunk is needed if the chunk
+    // is full or if something changed that is needed to decode the frame.
+    bool new_chunk_needed =
+        (frame.start_new_chunk == true) ||
+        (this->current_chunk_header.number_of_frames == 0) ||
+        (this->current_chunk_header.number_of_frames >= this->frames_per_chunk) ||
+        (this->current_chunk_header.number_of_particles != frame.number_of_particles) ||
+        (this->current_chunk_header.velocity_precision != frame.velocity_precision) ||
+        (this->current_chunk_header.bounds_min[0] != frame.bounds_min.x) ||
+        (this->current_chunk_header.bounds_min[1] != frame.bounds_min.y) ||
+        (this->current_chunk_header.bounds_min[2] != frame.bounds_min.z) ||
+        (this->current_chunk_header.bounds_max[0] != frame.bounds_max.x) ||
+        (this->current_chunk_header.bounds_max[1] != frame.bounds_max.y) ||
+        (this->current_chunk_header.bounds_max[2] != frame.bounds_max.z);
+    if (new_chunk_needed == true) {
+        this->flush_chunk();
+        std::memset(&this->current_chunk_header, 0, sizeof(Recording_Chunk_Header));
+        this->current_chunk_header.magic = RECORDER_CHUNK_MAGIC;
+        this->current_chunk_header.first_frame = this->number_of_written_frames;
+        this->current_chunk_header.number_of_particles = frame.number_of_particles;
+        this->current_chunk_header.bounds_min[0] = frame.bounds_min.x;
+        this->current_chunk_header.bounds_min[1] = frame.bounds_min.y;
+        this->current_chunk_header.bounds_min[2] = frame.bounds_min.z;
+        this->current_chunk_header.bounds_max[0] = frame.bounds_max.x;
+        this->current_chunk_header.bounds_max[1] = frame.bounds_max.y;
+        this->current_chunk_header.bounds_max[2] = frame.bounds_max.z;
+        this->current_chunk_header.velocity_precision = frame.velocity_precision;
+        // The keyframe is encoded relative to zero.
+        this->previous_frame_values.assign(frame.quantized_values.size(), 0);
+    }
+    // Delta encode the frame. The 16 bit values are compared as unsigned values for the positions
+    // and as signed values for the velocities, so the difference fits into 17 bits in both cases.
+    unsigned int number_of_position_values = 3 * frame.number_of_particles;
+    for (size_t i = 0; i < frame.quantized_values.size(); i++) {
+        int32_t delta;
+        if (i < number_of_position_values) {
+            delta = (int32_t)frame.quantized_values[i] - (int32_t)this->previous_frame_values[i];
+        }
+        else {
+            delta = (int32_t)(int16_t)frame.quantized_values[i] - (int32_t)(int16_t)this->previous_frame_values[i];
+        }
+        varint_encode(zigzag_encode(delta), this->current_chunk_payload);
+    }
+    this->previous_frame_values.swap(frame.quantized_values);
+    this->current_chunk_header.number_of_frames++;
+    this->number_of_written_frames++;
+}
+
+void Simulation_Recorder::flush_chunk ()
+{
+    if (this->current_chunk_header.number_of_frames == 0) {
+        return;
+    }
+    this->current_chunk_header.payload_size = this->current_chunk_payload.size();
+    this->file.write(reinterpret_cast<const char*>(&this->current_chunk_header), sizeof(Recording_Chunk_Header));
+    this->file.write(reinterpret_cast<const char*>(this->current_chunk_payload.data()), this->current_chunk_payload.size());
+    this->statistics.written_bytes += sizeof(Recording_Chunk_Header) + this->current_chunk_payload.size();
+    this->statistics.frames_written += this->current_chunk_header.number_of_frames;
+    this->statistics.chunks_written++;
+    this->current_chunk_payload.clear();
+    this->current_chunk_header.number_of_frames = 0;
+}
+
+void Simulation_Recorder::print_statistics ()
+{
+    std::cout << "Recording statistics:" << std::endl;
+    std::cout << "  frames recorded:    " << to_string_with_separator(this->statistics.frames_recorded) << std::endl;
+    std::cout << "  chunks written:     " << to_string_with_separator(this->statistics.chunks_written) << std::endl;
+    std::cout << "  uncompressed size:  " << to_string_with_separator(this->statistics.uncompressed_bytes / 1024) << " KiB" << std::endl;
+    std::cout << "  written size:       " << to_string_with_separator(this->statistics.written_bytes / 1024) << " KiB" << std::endl;
+    std::cout << "  compression ratio:  " << this->statistics.get_compression_ratio() << std::endl;
+    std::cout << "  simulation stalls:  " << this->statistics.stall_count << " ("
+        << this->statistics.stall_time_ns / 1000000 << " ms in total)" << std::endl;
+    std::cout << "  max. queue depth:   " << this->statistics.max_queue_depth << " / " << RECORDER_QUEUE_CAPACITY << std::endl;
+}
\ No newline at end of file
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+
+#include "../utils/particle_system.h"
+#include "../utils/bounded_queue.h"
+
+// The recorder captures every simulation step of a run so that it can be analysed offline or replayed.
+// Writing the particles vector directly to the disk is not feasible (sizeof(Particle) bytes per particle
+// and frame), therefore the recorder reduces the data:
+// 1. The positions are quantised to 16 bit values relative to the bounds of the simulation space.
+// 2. The velocities are quantised to 16 bit values with a configurable precision.
+// 3. Every frame is stored as the difference to the previous frame (delta encoding). The differences are
+//    small numbers which are stored as variable length integers (zigzag + varint encoding).
+// The frames are grouped into chunks. The first frame of a chunk is stored relative to zero (keyframe),
+// so every chunk can be decoded independently of the other chunks.
+// The quantisation happens within the simulation loop, the encoding and writing to the disk is done by
+// a background thread.
+#define RECORDER_DEFAULT_FILENAME               "./simulation_recording.rtgprec"
+#define RECORDER_FRAMES_PER_CHUNK               32
+#define RECORDER_QUEUE_CAPACITY                 16
+// The precision of the velocity in m/s. With 16 bits, velocities up to 32767 * precision can be stored.
+#define RECORDER_VELOCITY_PRECISION             0.001f
+#define RECORDER_VELOCITY_PRECISION_MIN         0.0001f
+#define RECORDER_VELOCITY_PRECISION_MAX         0.1f
+#define RECORDER_VELOCITY_PRECISION_STEP        0.0001f
+// File format related defines.
+#define RECORDER_FILE_MAGIC                     "RTGPREC"
+#define RECORDER_FILE_VERSION                   1
+#define RECORDER_CHUNK_MAGIC                    0x4b484352  // "RCHK"
+// Every particle is stored with six 16 bit values (position x, y, z and velocity x, y, z).
+#define RECORDER_VALUES_PER_PARTICLE            6
+
+// The header at the beginning of a recording file.
+struct Recording_File_Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t frames_per_chunk;
+};
+
+// The header in front of every chunk. It contains everything needed to decode the chunk.
+struct Recording_Chunk_Header
+{
+    uint32_t magic;
+    uint32_t first_frame;
+    uint32_t number_of_frames;
+    uint32_t number_of_particles;
+    float bounds_min[3];
+    float bounds_max[3];
+    float velocity_precision;
+    uint32_t reserved;
+    uint64_t payload_size;
+};
+
+// A frame handed over from the simulation loop to the background thread.
+// The values are sorted by the particles id and stored component wise (all position x values,
+// then all position y values, ...) since this gives smaller differences and better compression.
+struct Recording_Frame
+{
+    bool start_new_chunk;
+    unsigned int number_of_particles;
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+    float velocity_precision;
+    std::vector<uint16_t> quantized_values;
+};
+
+// Statistics about the recording. They are written by two threads, so use atomics.
+struct Recording_Statistics
+{
+    std::atomic<unsigned long long> frames_recorded;
+    std::atomic<unsigned long long> frames_written;
+    std::atomic<unsigned long long> chunks_written;
+    std::atomic<unsigned long long> uncompressed_bytes;
+    std::atomic<unsigned long long> written_bytes;
+    // A stall is a frame where the simulation had to wait for the background thread.
+    std::atomic<unsigned long long> stall_count;
+    std::atomic<unsigned long long> stall_time_ns;
+    std::atomic<unsigned int> queue_depth;
+    std::atomic<unsigned int> max_queue_depth;
+
+    void reset ();
+    float get_compression_ratio ();
+};
+
+// Zigzag and varint encoding used for the differences between two frames.
+// Zigzag maps signed values to unsigned ones (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...), so small negative
+// values also result in small numbers. Varint stores 7 bits per byte, the highest bit indicates if
+// another byte follows.
+inline uint32_t zigzag_encode (int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t zigzag_decode (uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+inline void varint_encode (uint32_t value, std::vector<uint8_t>& buffer)
+{
+    while (value >= 0x80) {
+        buffer.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((uint8_t)value);
+}
+
+// Decodes one value and moves the pointer forward. Returns false if the buffer ended too early.
+inline bool varint_decode (const uint8_t*& data, const uint8_t* data_end, uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (data >= data_end) {
+            return false;
+        }
+        uint8_t byte = *data++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The quantisation functions. They are also used by the replay to restore the values.
+inline uint16_t quantize_position (float value, float bounds_min, float bounds_max)
+{
+    float normalized = (value - bounds_min) / (bounds_max - bounds_min);
+    normalized = std::min(std::max(normalized, 0.0f), 1.0f);
+    return (uint16_t)lroundf(normalized * 65535.0f);
+}
+
+inline float dequantize_position (uint16_t value, float bounds_min, float bounds_max)
+{
+    return bounds_min + (value / 65535.0f) * (bounds_max - bounds_min);
+}
+
+inline uint16_t quantize_velocity (float value, float precision)
+{
+    long quantized = lroundf(value / precision);
+    quantized = std::min(std::max(quantized, -32767L), 32767L);
+    return (uint16_t)(int16_t)quantized;
+}
+
+inline float dequantize_velocity (uint16_t value, float precision)
+{
+    return (int16_t)value * precision;
+}
+
+class Simulation_Recorder
+{
+    private:
+        // The file we write to. Only the background thread touches it while recording.
+        std::ofstream file;
+        std::string filename;
+        std::thread writer_thread;
+        Bounded_Queue<Recording_Frame> frame_queue;
+        // If the next frame shall start a new chunk (e.g. after a scene change).
+        bool force_new_chunk;
+
+        // The state of the chunk the background thread is currently building.
+        Recording_Chunk_Header current_chunk_header;
+        std::vector<uint8_t> current_chunk_payload;
+        std::vector<uint16_t> previous_frame_values;
+        unsigned int number_of_written_frames;
+
+        // The function executed by the background thread.
+        void write_frames ();
+        // Delta encodes a frame and appends it to the current chunk.
+        void encode_frame (Recording_Frame& frame);
+        // Writes the current chunk to the file.
+        void flush_chunk ();
+
+    public:
+        Simulation_Recorder ();
+        ~Simulation_Recorder ();
+
+        // Settings. The velocity precision is read for every frame, so it can be changed during
+        // the recording (a changed precision starts a new chunk).
+        float velocity_precision;
+        unsigned int frames_per_chunk;
+
+        Recording_Statistics statistics;
+
+        bool is_recording;
+        bool start_recording (std::string filename = RECORDER_DEFAULT_FILENAME);
+        void stop_recording ();
+        // Tells the recorder that the next frame should be a keyframe.
+        void start_new_chunk ();
+        // Quantises the current state of the particle system and hands it over to the background thread.
+        // This is called by the simulation handler after every simulation step.
+        void record_frame (Particle_System& particle_system);
+
+        std::string get_filename ();
+        void print_statistics ();
+};
\ No newline at end of file
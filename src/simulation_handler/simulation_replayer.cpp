@@ -0,0 +1,444 @@
+#include "simulation_replayer.h"
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+Simulation_Replayer::Simulation_Replayer ()
+{
+    this->file_descriptor = -1;
+    this->mapped_file = nullptr;
+    this->mapped_file_size = 0;
+    this->number_of_frames = 0;
+    this->stop_prefetching = true;
+    this->playhead_chunk = 0;
+    this->playback_direction = 1;
+    this->loaded_frame = -1;
+    this->playhead = 0.0f;
+    this->is_open = false;
+    this->is_playing = false;
+    this->playback_speed = REPLAY_PLAYBACK_SPEED;
+    this->chunks_prefetched = 0;
+    this->cache_hits = 0;
+    this->cache_misses = 0;
+}
+
+Simulation_Replayer::~Simulation_Replayer ()
+{
+    // Make sure the background thread is not running anymore and the file is unmapped.
+    this->close();
+}
+
+
+// ====================================== FILE HANDLING ======================================
+
+bool Simulation_Replayer::open (std::string filename)
+{
+    // Only one recording can be replayed at a time.
+    this->close();
+    // Map the whole file into memory.
+    this->file_descriptor = ::open(filename.c_str(), O_RDONLY);
+    if (this->file_descriptor < 0) {
+        std::cout << "Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    struct stat file_status;
+    if ((fstat(this->file_descriptor, &file_status) != 0) || (file_status.st_size < (off_t)sizeof(Recording_File_Header))) {
+        std::cout << "ERROR: '" << filename << "' is not a valid recording." << std::endl;
+        ::close(this->file_descriptor);
+        this->file_descriptor = -1;
+        return false;
+    }
+    this->mapped_file_size = file_status.st_size;
+    void* mapped_file = mmap(nullptr, this->mapped_file_size, PROT_READ, MAP_PRIVATE, this->file_descriptor, 0);
+    if (mapped_file == MAP_FAILED) {
+        std::cout << "ERROR: Failed to map file: '" << filename << "'." << std::endl;
+        ::close(this->file_descriptor);
+        this->file_descriptor = -1;
+        return false;
+    }
+    this->mapped_file = static_cast<const uint8_t*>(mapped_file);
+    this->filename = filename;
+    this->is_open = true;
+
+    // Check the file header.
+    Recording_File_Header file_header;
+    std::memcpy(&file_header, this->mapped_file, sizeof(Recording_File_Header));
+    if ((std::memcmp(file_header.magic, RECORDER_FILE_MAGIC, sizeof(RECORDER_FILE_MAGIC)) != 0) ||
+        (file_header.version != RECORDER_FILE_VERSION)) {
+        std::cout << "ERROR: '" << filename << "' is not a valid recording or was written by another version." << std::endl;
+        this->close();
+        return false;
+    }
+
+    // Find all chunks. We only read the chunk headers here, the payload is decoded when it is needed.
+    // If the recording was not finished properly, the last chunk may be incomplete. In this case we
+    // simply stop at the last complete chunk.
+    this->number_of_frames = 0;
+    size_t offset = sizeof(Recording_File_Header);
+    while (offset + sizeof(Recording_Chunk_Header) <= this->mapped_file_size) {
+        Replay_Chunk chunk;
+        std::memcpy(&chunk.header, this->mapped_file + offset, sizeof(Recording_Chunk_Header));
+        offset += sizeof(Recording_Chunk_Header);
+        if ((chunk.header.magic != RECORDER_CHUNK_MAGIC) || (chunk.header.payload_size > this->mapped_file_size - offset)) {
+            std::cout << "WARNING: The recording contains an incomplete chunk. The replay ends before this chunk." << std::endl;
+            break;
+        }
+        // The decoder and the particle system are sized by the counts of the header. Every value takes at least one
+        // byte of the payload (see varint_encode), so a chunk with more values than payload bytes is corrupt.
+        uint64_t maximum_number_of_particle_frames = chunk.header.payload_size / RECORDER_VALUES_PER_PARTICLE;
+        if ((chunk.header.number_of_particles == 0) || (chunk.header.number_of_particles > maximum_number_of_particle_frames) ||
+            (chunk.header.number_of_frames > maximum_number_of_particle_frames / chunk.header.number_of_particles)) {
+            std::cout << "WARNING: The recording contains a chunk with invalid particle or frame counts. The replay ends before this chunk." << std::endl;
+            break;
+        }
+        chunk.payload = this->mapped_file + offset;
+        // We count the frames ourselves, so we do not depend on the frame numbers written by the recorder.
+        chunk.header.first_frame = this->number_of_frames;
+        this->number_of_frames += chunk.header.number_of_frames;
+        this->chunks.push_back(chunk);
+        offset += chunk.header.payload_size;
+    }
+    if (this->number_of_frames == 0) {
+        std::cout << "ERROR: '" << filename << "' does not contain any frames." << std::endl;
+        this->close();
+        return false;
+    }
+
+    // Reset the playback and start the background thread.
+    this->playhead = 0.0f;
+    this->loaded_frame = -1;
+    this->is_playing = true;
+    this->playback_speed = REPLAY_PLAYBACK_SPEED;
+    this->playhead_chunk = 0;
+    this->playback_direction = 1;
+    this->chunks_prefetched = 0;
+    this->cache_hits = 0;
+    this->cache_misses = 0;
+    this->stop_prefetching = false;
+    this->prefetch_thread = std::thread(&Simulation_Replayer::prefetch_chunks, this);
+    std::cout << "Replaying '" << filename << "' (" << this->number_of_frames << " frames in "
+        << this->chunks.size() << " chunks)." << std::endl;
+    return true;
+}
+
+void Simulation_Replayer::close ()
+{
+    if (this->is_open == false) {
+        return;
+    }
+    // Stop the background thread.
+    if (this->prefetch_thread.joinable() == true) {
+        std::unique_lock<std::mutex> lock(this->mutex_decoded_chunks);
+        this->stop_prefetching = true;
+        lock.unlock();
+        this->condition_playhead_moved.notify_all();
+        this->prefetch_thread.join();
+    }
+    this->decoded_chunks.clear();
+    this->chunks.clear();
+    this->number_of_frames = 0;
+    // Unmap the file.
+    munmap(const_cast<uint8_t*>(this->mapped_file), this->mapped_file_size);
+    ::close(this->file_descriptor);
+    this->mapped_file = nullptr;
+    this->mapped_file_size = 0;
+    this->file_descriptor = -1;
+    this->is_open = false;
+}
+
+
+// ====================================== DECODING ======================================
+
+unsigned int Simulation_Replayer::get_chunk_index (unsigned int frame)
+{
+    // The chunks are sorted by their first frame, so we can use a binary search.
+    unsigned int index_start = 0;
+    unsigned int index_end = this->chunks.size() - 1;
+    while (index_start < index_end) {
+        unsigned int index_middle = (index_start + index_end + 1) / 2;
+        if (this->chunks[index_middle].header.first_frame <= frame) {
+            index_start = index_middle;
+        }
+        else {
+            index_end = index_middle - 1;
+        }
+    }
+    return index_start;
+}
+
+bool Simulation_Replayer::decode_chunk (unsigned int chunk_index, std::vector<uint16_t>& values)
+{
+    // This is the inverse of Simulation_Recorder::encode_frame. The first frame of the chunk
+    // is relative to zero, every other frame relative to its previous frame.
+    const Recording_Chunk_Header& header = this->chunks[chunk_index].header;
+    const uint8_t* data = this->chunks[chunk_index].payload;
+    const uint8_t* data_end = data + header.payload_size;
+    size_t number_of_values_per_frame = (size_t)RECORDER_VALUES_PER_PARTICLE * header.number_of_particles;
+    size_t number_of_position_values = 3 * (size_t)header.number_of_particles;
+    values.resize(number_of_values_per_frame * header.number_of_frames);
+    std::vector<uint16_t> zero_frame (number_of_values_per_frame, 0);
+    const uint16_t* previous_frame_values = zero_frame.data();
+    for (unsigned int frame = 0; frame < header.number_of_frames; frame++) {
+        uint16_t* frame_values = values.data() + frame * number_of_values_per_frame;
+        for (size_t i = 0; i < number_of_values_per_frame; i++) {
+            uint32_t encoded_delta;
+            if (varint_decode(data, data_end, encoded_delta) == false) {
+                return false;
+            }
+            int32_t delta = zigzag_decode(encoded_delta);
+            if (i < number_of_position_values) {
+                frame_values[i] = (uint16_t)((int32_t)previous_frame_values[i] + delta);
+            }
+            else {
+                frame_values[i] = (uint16_t)(int16_t)((int32_t)(int16_t)previous_frame_values[i] + delta);
+            }
+        }
+        previous_frame_values = frame_values;
+    }
+    return true;
+}
+
+void Simulation_Replayer::evict_chunks ()
+{
+    // Keep the chunks around the playhead (also behind it, so scrubbing back a little is cheap).
+    for (auto iterator = this->decoded_chunks.begin(); iterator != this->decoded_chunks.end(); ) {
+        int distance = std::abs((int)iterator->first - (int)this->playhead_chunk);
+        if (distance > REPLAY_PREFETCH_CHUNKS) {
+            iterator = this->decoded_chunks.erase(iterator);
+        }
+        else {
+            iterator++;
+        }
+    }
+}
+
+Decoded_Chunk Simulation_Replayer::get_decoded_chunk (unsigned int chunk_index)
+{
+    std::unique_lock<std::mutex> lock(this->mutex_decoded_chunks);
+    // Tell the background thread where the playhead is and in which direction it moves.
+    int playback_direction = (this->playback_speed < 0.0f) ? -1 : 1;
+    if ((this->playhead_chunk != chunk_index) || (this->playback_direction != playback_direction)) {
+        this->playhead_chunk = chunk_index;
+        this->playback_direction = playback_direction;
+        this->evict_chunks();
+        this->condition_playhead_moved.notify_one();
+    }
+    auto iterator = this->decoded_chunks.find(chunk_index);
+    if (iterator != this->decoded_chunks.end()) {
+        this->cache_hits++;
+        return iterator->second;
+    }
+    // The chunk was not prefetched (e.g. after a seek). Decode it now.
+    lock.unlock();
+    this->cache_misses++;
+    std::shared_ptr<std::vector<uint16_t>> values = std::make_shared<std::vector<uint16_t>>();
+    Decoded_Chunk decoded_chunk = nullptr;
+    if (this->decode_chunk(chunk_index, *values) == true) {
+        decoded_chunk = values;
+    }
+    else {
+        std::cout << "ERROR: Chunk " << chunk_index << " of the recording is corrupted." << std::endl;
+    }
+    lock.lock();
+    // The background thread may have decoded the same chunk in the meantime. Then keep its result.
+    return this->decoded_chunks.emplace(chunk_index, decoded_chunk).first->second;
+}
+
+void Simulation_Replayer::prefetch_chunks ()
+{
+    std::unique_lock<std::mutex> lock(this->mutex_decoded_chunks);
+    while (this->stop_prefetching == false) {
+        // Look for the next chunk in the direction of the playback that is not decoded yet.
+        long long next_chunk = -1;
+        for (int i = 0; i <= REPLAY_PREFETCH_CHUNKS; i++) {
+            long long chunk_index = (long long)this->playhead_chunk + this->playback_direction * i;
+            if ((chunk_index < 0) || (chunk_index >= (long long)this->chunks.size())) {
+                break;
+            }
+            if (this->decoded_chunks.contains(chunk_index) == false) {
+                next_chunk = chunk_index;
+                break;
+            }
+        }
+        // Nothing to do. Wait until the playhead moves.
+        if (next_chunk < 0) {
+            this->condition_playhead_moved.wait(lock);
+            continue;
+        }
+        // Decode the chunk without holding the lock, so the visualization is not blocked.
+        lock.unlock();
+        std::shared_ptr<std::vector<uint16_t>> values = std::make_shared<std::vector<uint16_t>>();
+        bool success = this->decode_chunk(next_chunk, *values);
+        lock.lock();
+        // A corrupted chunk is stored as nullptr so that we do not try to decode it again and again.
+        this->decoded_chunks.emplace(next_chunk, (success == true) ? values : nullptr);
+        this->chunks_prefetched++;
+        this->evict_chunks();
+    }
+}
+
+
+// ====================================== PLAYBACK ======================================
+
+void Simulation_Replayer::toggle_pause_resume ()
+{
+    // If the replay ended, start again from the beginning (or the end if playing backwards).
+    if ((this->is_playing == false) && (this->playback_speed > 0.0f) && (this->get_current_frame() == this->number_of_frames - 1)) {
+        this->seek(0);
+    }
+    else if ((this->is_playing == false) && (this->playback_speed < 0.0f) && (this->get_current_frame() == 0)) {
+        this->seek(this->number_of_frames - 1);
+    }
+    this->is_playing = !this->is_playing;
+}
+
+void Simulation_Replayer::seek (unsigned int frame)
+{
+    if (this->number_of_frames == 0) {
+        return;
+    }
+    this->playhead = (float)std::min(frame, this->number_of_frames - 1);
+}
+
+void Simulation_Replayer::step_forward ()
+{
+    this->is_playing = false;
+    this->seek(this->get_current_frame() + 1);
+}
+
+void Simulation_Replayer::step_backward ()
+{
+    this->is_playing = false;
+    if (this->get_current_frame() > 0) {
+        this->seek(this->get_current_frame() - 1);
+    }
+}
+
+void Simulation_Replayer::increase_playback_speed ()
+{
+    this->playback_speed = std::clamp(this->playback_speed * REPLAY_PLAYBACK_SPEED_FACTOR, REPLAY_PLAYBACK_SPEED_MIN, REPLAY_PLAYBACK_SPEED_MAX);
+}
+
+void Simulation_Replayer::decrease_playback_speed ()
+{
+    // The direction stays the same, only the speed approaches the slowest one.
+    float playback_speed = this->playback_speed / REPLAY_PLAYBACK_SPEED_FACTOR;
+    if (std::abs(playback_speed) < REPLAY_PLAYBACK_SPEED_SLOWEST) {
+        playback_speed = (this->playback_speed < 0.0f) ? -REPLAY_PLAYBACK_SPEED_SLOWEST : REPLAY_PLAYBACK_SPEED_SLOWEST;
+    }
+    this->playback_speed = playback_speed;
+}
+
+void Simulation_Replayer::update ()
+{
+    if ((this->is_open == false) || (this->is_playing == false)) {
+        return;
+    }
+    this->playhead += this->playback_speed;
+    // Stop at the end (or at the beginning if we play backwards).
+    if (this->playhead >= (float)(this->number_of_frames - 1)) {
+        this->playhead = (float)(this->number_of_frames - 1);
+        this->is_playing = false;
+    }
+    else if (this->playhead <= 0.0f) {
+        this->playhead = 0.0f;
+        this->is_playing = false;
+    }
+}
+
+bool Simulation_Replayer::load_current_frame (Particle_System& particle_system)
+{
+    if (this->is_open == false) {
+        return false;
+    }
+    unsigned int frame = this->get_current_frame();
+    if ((long long)frame == this->loaded_frame) {
+        // Nothing changed (e.g. the replay is paused).
+        return false;
+    }
+    unsigned int chunk_index = this->get_chunk_index(frame);
+    Decoded_Chunk values = this->get_decoded_chunk(chunk_index);
+    if (values == nullptr) {
+        return false;
+    }
+    const Recording_Chunk_Header& header = this->chunks[chunk_index].header;
+    // Update the simulation space and the number of particles if necessary. The first loaded
+    // frame always does this, since the particles vector of the particle system may be reordered.
+    bool particle_system_changed = false;
+    if ((this->loaded_frame < 0) ||
+        (this->simulation_space.x_min != header.bounds_min[0]) || (this->simulation_space.x_max != header.bounds_max[0]) ||
+        (this->simulation_space.y_min != header.bounds_min[1]) || (this->simulation_space.y_max != header.bounds_max[1]) ||
+        (this->simulation_space.z_min != header.bounds_min[2]) || (this->simulation_space.z_max != header.bounds_max[2])) {
+        this->simulation_space = Cuboid(
+            header.bounds_min[0], header.bounds_max[0],
+            header.bounds_min[1], header.bounds_max[1],
+            header.bounds_min[2], header.bounds_max[2]);
+        particle_system.set_simulation_space(&this->simulation_space);
+        particle_system_changed = true;
+    }
+    if ((this->loaded_frame < 0) || (particle_system.number_of_particles != header.number_of_particles)) {
+        particle_system.set_number_of_particles(header.number_of_particles);
+        particle_system_changed = true;
+    }
+    // Restore the positions and velocities. The particles vector is not reordered during the replay,
+    // so the particle with the id i is at index i.
+    unsigned int n = header.number_of_particles;
+    const uint16_t* frame_values = values->data() + (size_t)(frame - header.first_frame) * RECORDER_VALUES_PER_PARTICLE * n;
+    for (unsigned int i = 0; i < n; i++) {
+        Particle& particle = particle_system.particles[i];
+        particle.position.x = dequantize_position(frame_values[0 * n + i], header.bounds_min[0], header.bounds_max[0]);
+        particle.position.y = dequantize_position(frame_values[1 * n + i], header.bounds_min[1], header.bounds_max[1]);
+        particle.position.z = dequantize_position(frame_values[2 * n + i], header.bounds_min[2], header.bounds_max[2]);
+        particle.velocity.x = dequantize_velocity(frame_values[3 * n + i], header.velocity_precision);
+        particle.velocity.y = dequantize_velocity(frame_values[4 * n + i], header.velocity_precision);
+        particle.velocity.z = dequantize_velocity(frame_values[5 * n + i], header.velocity_precision);
+    }
+    // The spatial grid (used by the color field of the marching cubes) still holds the particles of the last frame.
+    particle_system.particles_changed();
+    this->loaded_frame = frame;
+    return particle_system_changed;
+}
+
+
+// ====================================== GETTER ======================================
+
+unsigned int Simulation_Replayer::get_number_of_frames ()
+{
+    return this->number_of_frames;
+}
+
+unsigned int Simulation_Replayer::get_current_frame ()
+{
+    if (this->number_of_frames == 0) {
+        return 0;
+    }
+    return std::min((unsigned int)std::floor(this->playhead), this->number_of_frames - 1);
+}
+
+unsigned int Simulation_Replayer::get_number_of_cached_chunks ()
+{
+    std::unique_lock<std::mutex> lock(this->mutex_decoded_chunks);
+    return this->decoded_chunks.size();
+}
+
+std::string Simulation_Replayer::get_filename ()
+{
+    return this->filename;
+}
+
+Cuboid* Simulation_Replayer::get_pointer_to_simulation_space ()
+{
+    return &this->simulation_space;
+}
+
+std::vector<Cuboid>* Simulation_Replayer::get_pointer_to_fluid_starting_positions ()
+{
+    return &this->fluid_starting_positions;
+}
\ No newline at end of file
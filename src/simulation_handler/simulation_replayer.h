@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+#include "simulation_recorder.h"
+#include "../utils/cuboid.h"
+#include "../utils/particle_system.h"
+
+// The replayer plays back a recording created by the simulation recorder (see simulation_recorder.h for
+// the file format). Instead of reading the file with streams, the recording is memory-mapped. The operating
+// system then loads only the pages we really touch, so seeking in a large recording is cheap.
+// Decoding a chunk (varint + delta decoding of all its frames) is done ahead of the playhead by a
+// background thread, so the visualization only has to copy the already decoded values into the particles.
+#define REPLAY_DEFAULT_FILENAME                 RECORDER_DEFAULT_FILENAME
+// How many chunks are decoded ahead of the playhead (in the direction of the playback).
+#define REPLAY_PREFETCH_CHUNKS                  4
+// The playback speed in recorded frames per rendered frame. Negative values play the recording backwards.
+#define REPLAY_PLAYBACK_SPEED                   1.0f
+#define REPLAY_PLAYBACK_SPEED_MIN               -8.0f
+#define REPLAY_PLAYBACK_SPEED_MAX               8.0f
+#define REPLAY_PLAYBACK_SPEED_STEP              0.05f
+// The factor used by the keys to increase / decrease the playback speed, and the slowest speed (in either
+// direction) the keys can reach.
+#define REPLAY_PLAYBACK_SPEED_FACTOR            2.0f
+#define REPLAY_PLAYBACK_SPEED_SLOWEST           0.125f
+
+// Where a chunk is located within the mapped file.
+struct Replay_Chunk
+{
+    Recording_Chunk_Header header;
+    const uint8_t* payload;
+};
+
+// A decoded chunk. It holds the quantised values of all frames of the chunk (frame after frame, each
+// frame in the layout of a Recording_Frame). It is shared between the background thread and the
+// visualization, so a chunk can be removed from the cache while it is still used for drawing.
+typedef std::shared_ptr<const std::vector<uint16_t>> Decoded_Chunk;
+
+class Simulation_Replayer
+{
+    private:
+        // The memory-mapped recording.
+        int file_descriptor;
+        const uint8_t* mapped_file;
+        size_t mapped_file_size;
+        std::string filename;
+        // All chunks of the recording, found when opening the file.
+        std::vector<Replay_Chunk> chunks;
+        unsigned int number_of_frames;
+
+        // The cache of the decoded chunks (chunk index -> decoded values) and everything the
+        // background thread needs to know to decide what to decode next.
+        std::map<unsigned int, Decoded_Chunk> decoded_chunks;
+        std::mutex mutex_decoded_chunks;
+        std::condition_variable condition_playhead_moved;
+        std::thread prefetch_thread;
+        bool stop_prefetching;
+        unsigned int playhead_chunk;
+        int playback_direction;
+        // The function executed by the background thread.
+        void prefetch_chunks ();
+        // Removes the chunks that are too far away from the playhead. The mutex has to be locked.
+        void evict_chunks ();
+        // Returns the decoded chunk. If it was not prefetched, it is decoded right away.
+        Decoded_Chunk get_decoded_chunk (unsigned int chunk_index);
+        // Varint + delta decodes all frames of a chunk. Returns false if the chunk is corrupted.
+        bool decode_chunk (unsigned int chunk_index, std::vector<uint16_t>& values);
+        unsigned int get_chunk_index (unsigned int frame);
+
+        // The simulation space of the frame shown at the moment. There are no starting positions
+        // of the fluid in a recording, so the vector is simply empty.
+        Cuboid simulation_space;
+        std::vector<Cuboid> fluid_starting_positions;
+        // The frame that was loaded into the particle system the last time (-1 if none).
+        long long loaded_frame;
+        // The position of the playhead. It is a float since the playback speed can be any value.
+        float playhead;
+
+    public:
+        Simulation_Replayer ();
+        ~Simulation_Replayer ();
+
+        bool is_open;
+        bool is_playing;
+        float playback_speed;
+        // Statistics about the prefetching. A miss is a frame whose chunk was not yet decoded by the
+        // background thread and had to be decoded while the visualization was waiting.
+        std::atomic<unsigned long long> chunks_prefetched;
+        std::atomic<unsigned long long> cache_hits;
+        std::atomic<unsigned long long> cache_misses;
+
+        // Maps the recording and starts the background thread.
+        bool open (std::string filename = REPLAY_DEFAULT_FILENAME);
+        // Stops the background thread and unmaps the recording.
+        void close ();
+
+        // Playback control.
+        void toggle_pause_resume ();
+        void seek (unsigned int frame);
+        void step_forward ();
+        void step_backward ();
+        void increase_playback_speed ();
+        void decrease_playback_speed ();
+        // Moves the playhead according to the playback speed (if playing). Call this once per rendered frame.
+        void update ();
+        // Writes the frame at the playhead into the particle system. If the number of particles or the
+        // simulation space changed, the particle system is updated as well and true is returned
+        // (so the caller knows that e.g. the marching cubes have to be informed).
+        bool load_current_frame (Particle_System& particle_system);
+
+        unsigned int get_number_of_frames ();
+        unsigned int get_current_frame ();
+        unsigned int get_number_of_cached_chunks ();
+        std::string get_filename ();
+        // The replayer owns the simulation space shown during the replay.
+        Cuboid* get_pointer_to_simulation_space ();
+        std::vector<Cuboid>* get_pointer_to_fluid_starting_positions ();
+};
\ No newline at end of file
@@ -0,0 +1,439 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <memory>
+
+#include "../simulation_handler/simulation_handler.h"
+#include "../utils/marching_cubes.h"
+#include "../utils/performance_test.h"
+#include "../utils/performance_counters.h"
+#include "../utils/helper.h"
+#include "../utils/command_line.h"
+
+// The sweep runs the headless simulation over a matrix of scenes, computation modes, thread counts, particle
+// counts / spacings and marching cubes edge lengths (for a fixed number of steps). For every configuration it
+// writes a csv file in the format of the performance test (the files in doc/performance_analysis/data), so the
+// notebook can be used on the results. Additionally the strong and weak scaling efficiency is calculated.
+// This executable is linked against a build of the core with PERFORMANCE_TEST defined, so the phases of the
+// simulation are measured by MEASURE_EXECUTION_TIME as in the application.
+// Without a window there is no rendering. The time of the visualization is therefore only the CPU part of the
+// marching cubes (zero if no edge length is given).
+#define SWEEP_DEFAULT_STEPS                     1000
+#define SWEEP_DEFAULT_OUTPUT_DIRECTORY          "./performance_data"
+// The first steps are not used for the scaling tables (like the notebook drops them).
+#define SWEEP_SKIPPED_STEPS                     5
+// Two configurations are compared for the weak scaling if their number of particles per thread
+// differs by at most this fraction.
+#define SWEEP_WEAK_SCALING_TOLERANCE            0.05
+// The names used by the performance test, so the notebook can read the files.
+#define SWEEP_FUNCTION_SIMULATE                 "application_handler.simulation_handler.simulate()"
+#define SWEEP_FUNCTION_VISUALIZE                "application_handler.visualization_handler.visualize()"
+
+// One matrix of configurations. Every combination of the values is run.
+struct Sweep_Matrix
+{
+    std::vector<int> scenes;
+    std::vector<Computation_Mode> computation_modes;
+    std::vector<int> number_of_threads;
+    // Either the particle counts or the spacings are used (the counts are converted to a spacing based on
+    // the volume of the fluid of the scene).
+    std::vector<unsigned int> particle_counts;
+    std::vector<float> particle_spacings;
+    // An edge length of zero means no marching cubes.
+    std::vector<float> cube_edge_lengths;
+};
+
+// The result of one configuration used for the scaling tables.
+struct Sweep_Result
+{
+    int scene;
+    Computation_Mode computation_mode;
+    int number_of_threads;
+    unsigned int number_of_particles;
+    float cube_edge_length;
+    // The median time of a simulation step in milliseconds (measured in microseconds).
+    double median_step_time;
+};
+
+// All settings that can be given on the command line.
+struct Sweep_Settings
+{
+    std::vector<Sweep_Matrix> matrices;
+    int number_of_steps;
+    std::string output_directory;
+    bool count_hardware_events;
+};
+
+// The configurations of the data in doc/performance_analysis: both computation modes with one and eight threads
+// for 216 - 4096 particles (scene 1), and the marching cubes edge lengths for 1728 particles.
+std::vector<Sweep_Matrix> get_performance_analysis_matrices ()
+{
+    Sweep_Matrix scaling_matrix {
+        { 1 },
+        { COMPUTATION_MODE_BRUTE_FORCE, COMPUTATION_MODE_SPATIAL_GRID },
+        { 1, 8 },
+        { 216, 512, 1000, 1728, 4096 },
+        { },
+        { 0.0f }
+    };
+    Sweep_Matrix marching_cubes_matrix {
+        { 1 },
+        { COMPUTATION_MODE_SPATIAL_GRID },
+        { 8 },
+        { 1728 },
+        { },
+        { 0.01f, 0.02f, 0.06f, 0.1f, 0.2f, 0.3f }
+    };
+    return { scaling_matrix, marching_cubes_matrix };
+}
+
+void print_usage (const char* program_name, const std::string& shared_options_usage)
+{
+    std::cout << "Usage: " << program_name << " [options]" << std::endl
+        << "Without matrix options (scenes, modes, threads, counts, spacings and edge lengths), the configurations of" << std::endl
+        << "doc/performance_analysis are run. The steps are the steps of every configuration and the output is the" << std::endl
+        << "directory the csv files are written to." << std::endl
+        << "Options (lists are comma separated, every combination is run):" << std::endl
+        << shared_options_usage
+        << "  --modes <list>                computation modes: grid, brute-force (default both)" << std::endl
+        << "  --counts <list>               particle counts (default 216,512,1000,1728,4096)" << std::endl
+        << "  --spacings <list>             particle spacings (instead of the counts)" << std::endl
+        << "  --cube-edge-lengths <list>    marching cubes edge lengths, 0 for none (default 0)" << std::endl
+        << "  --help                        show this information" << std::endl;
+}
+
+// The options that the sweep shares with the other tools (see command_line.h). The scenes and threads are the ones
+// of the matrix given on the command line.
+Shared_Options get_shared_options (Sweep_Settings& settings, Sweep_Matrix& matrix)
+{
+    Shared_Options shared_options;
+    shared_options.scenes = &matrix.scenes;
+    shared_options.number_of_steps = &settings.number_of_steps;
+    shared_options.minimum_number_of_steps = SWEEP_SKIPPED_STEPS + 1;
+    shared_options.thread_counts = &matrix.number_of_threads;
+    shared_options.output = &settings.output_directory;
+    shared_options.count_hardware_events = &settings.count_hardware_events;
+    return shared_options;
+}
+
+// Parses a matrix option of the sweep.
+Option_Status parse_option (const std::string& option, const std::string& value, Sweep_Matrix& matrix)
+{
+    if (option == "--modes") {
+        matrix.computation_modes.clear();
+        for (const std::string& mode : split_list(value)) {
+            if (mode == "grid")                 matrix.computation_modes.push_back(COMPUTATION_MODE_SPATIAL_GRID);
+            else if (mode == "brute-force")     matrix.computation_modes.push_back(COMPUTATION_MODE_BRUTE_FORCE);
+            else                                return OPTION_INVALID;
+        }
+    }
+    else if (option == "--counts") {
+        if (parse_list(value, matrix.particle_counts) == false) {
+            return OPTION_INVALID;
+        }
+        matrix.particle_spacings.clear();
+    }
+    else if (option == "--spacings") {
+        if (parse_list(value, matrix.particle_spacings) == false) {
+            return OPTION_INVALID;
+        }
+        matrix.particle_counts.clear();
+    }
+    else if (option == "--cube-edge-lengths") {
+        if (parse_list(value, matrix.cube_edge_lengths) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else {
+        return OPTION_UNKNOWN;
+    }
+    return OPTION_VALID;
+}
+
+// Parses the command line. All matrix options change one matrix, which starts with the values of the first
+// performance analysis matrix. Returns false if the arguments are invalid (or the help was requested).
+bool parse_arguments (int argc, char* argv[], Shared_Options& shared_options, Sweep_Settings& settings, Sweep_Matrix& matrix)
+{
+    bool matrix_changed = false;
+    bool valid = parse_command_line(argc, argv, shared_options, [&matrix, &matrix_changed] (const std::string& option, const std::string& value) {
+        Option_Status status = parse_option(option, value, matrix);
+        matrix_changed = matrix_changed || (status == OPTION_VALID);
+        return status;
+    });
+    if (valid == false) {
+        return false;
+    }
+    for (const std::string& option : shared_options.given_options) {
+        matrix_changed = matrix_changed || (option == "--scenes") || (option == "--threads");
+    }
+    if (matrix_changed == true) {
+        settings.matrices = { matrix };
+    }
+    return true;
+}
+
+
+// ====================================== HELPER ======================================
+
+// The file name follows the naming of the files in doc/performance_analysis/data,
+// e.g. spatial_grid_eight_threads_1728_particles_mc_size_0_1.csv.
+std::string get_filename (int scene, Computation_Mode computation_mode, int number_of_threads, unsigned int number_of_particles, float cube_edge_length)
+{
+    std::stringstream filename;
+    filename << ((computation_mode == COMPUTATION_MODE_BRUTE_FORCE) ? "brute_force" : "spatial_grid");
+    if (number_of_threads == 1) {
+        filename << "_one_thread";
+    }
+    else if (number_of_threads == 8) {
+        filename << "_eight_threads";
+    }
+    else {
+        filename << "_" << number_of_threads << "_threads";
+    }
+    filename << "_" << number_of_particles << "_particles";
+    if (cube_edge_length > 0.0f) {
+        std::stringstream edge_length;
+        edge_length << cube_edge_length;
+        std::string edge_length_string = edge_length.str();
+        std::replace(edge_length_string.begin(), edge_length_string.end(), '.', '_');
+        filename << "_mc_size_" << edge_length_string;
+    }
+    // The performance analysis only uses scene 1, so only the other scenes are named.
+    if (scene != 1) {
+        filename << "_scene_" << scene;
+    }
+    filename << ".csv";
+    return filename.str();
+}
+
+double get_median (std::vector<long long> values)
+{
+    if (values.empty() == true) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return (n % 2 == 1) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+float get_fluid_volume (Scene_Information& scene)
+{
+    float volume = 0.0f;
+    for (Cuboid& cuboid : scene.fluid_starting_positions) {
+        volume += cuboid.get_volume();
+    }
+    return volume;
+}
+
+
+// ====================================== RUN ======================================
+
+// Runs one configuration and saves its csv file. Returns false if the configuration could not be run.
+bool run_configuration (Sweep_Settings& settings, int scene, Computation_Mode computation_mode, int number_of_threads,
+    float particle_spacing, float cube_edge_length, std::vector<Sweep_Result>& results)
+{
+    // Every configuration starts with a new simulation.
+    Simulation_Handler simulation_handler;
+    simulation_handler.register_default_scenes();
+    simulation_handler.next_scene_id = scene - 1;
+    Particle_System& particle_system = simulation_handler.particle_system;
+    if (particle_system.set_particle_initial_distance(particle_spacing) == false) {
+        std::cout << "ERROR: The particle spacing " << particle_spacing << " is not within [" << PARTICLE_INITIAL_DISTANCE_MIN << "; " 
+            << PARTICLE_INITIAL_DISTANCE_MAX << "], skipping this configuration." << std::endl;
+        return false;
+    }
+    particle_system.number_of_threads = number_of_threads;
+    particle_system.change_computation_mode(computation_mode);
+    // Counting the events needs a thread pool (see performance_counters.h).
+    std::unique_ptr<Thread_Pool> thread_pool;
+    if (settings.count_hardware_events == true) {
+        thread_pool = std::make_unique<Thread_Pool>(std::max(1, number_of_threads - 1));
+        particle_system.thread_pool = thread_pool.get();
+    }
+    // There is no cursor, so there are no external forces.
+    particle_system.external_forces_active = false;
+    if (simulation_handler.load_scene() == false) {
+        return false;
+    }
+    Marching_Cubes_Generator marching_cubes_generator;
+    marching_cubes_generator.particle_system = &particle_system;
+    if (cube_edge_length > 0.0f) {
+        marching_cubes_generator.new_cube_edge_length = cube_edge_length;
+    }
+    std::cout << "Simulating " << particle_system.number_of_particles_as_string << " particles (scene " << scene << ", " 
+        << to_string(computation_mode) << ", " << number_of_threads << " thread(s)";
+    if (cube_edge_length > 0.0f) {
+        std::cout << ", marching cubes edge length " << cube_edge_length;
+    }
+    std::cout << ") ..." << std::endl;
+
+    // Measure every step. The milliseconds go into the csv file (like in the application), the microseconds
+    // are used for the scaling tables since the steps of small configurations take less than a millisecond.
+    execution_times.clear();
+    performance_counter_values.clear();
+    clear_parallel_region_values();
+    std::vector<long long> step_times;
+    for (int step = 0; step < settings.number_of_steps; step++) {
+        Performance_Counter_Values counters_start = read_performance_counters();
+        auto start = std::chrono::steady_clock::now();
+        simulation_handler.simulate();
+        auto end = std::chrono::steady_clock::now();
+        execution_times[SWEEP_FUNCTION_SIMULATE].push_back(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+        add_performance_counter_values(SWEEP_FUNCTION_SIMULATE, counters_start);
+        step_times.push_back(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        // The CPU part of the visualization.
+        counters_start = read_performance_counters();
+        start = std::chrono::steady_clock::now();
+        if (cube_edge_length > 0.0f) {
+            marching_cubes_generator.generate_marching_cubes();
+        }
+        end = std::chrono::steady_clock::now();
+        execution_times[SWEEP_FUNCTION_VISUALIZE].push_back(std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count());
+        add_performance_counter_values(SWEEP_FUNCTION_VISUALIZE, counters_start);
+    }
+    save_exection_time_to_csv(settings.output_directory + "/" + 
+        get_filename(scene, computation_mode, number_of_threads, particle_system.number_of_particles, cube_edge_length));
+
+    step_times.erase(step_times.begin(), step_times.begin() + SWEEP_SKIPPED_STEPS);
+    Sweep_Result result {
+        scene,
+        computation_mode,
+        number_of_threads,
+        particle_system.number_of_particles,
+        cube_edge_length,
+        get_median(step_times) / 1000.0
+    };
+    results.push_back(result);
+    return true;
+}
+
+
+// ====================================== SCALING ======================================
+
+// Strong scaling: the same problem with more threads. speedup = T(1) / T(p), efficiency = speedup / p.
+// Weak scaling: the same number of particles per thread. efficiency = T(1, n) / T(p, p * n).
+// The configurations are compared within the same scene, computation mode and marching cubes edge length.
+void save_scaling_tables (const std::string& output_directory, std::vector<Sweep_Result>& results)
+{
+    const char cell_delimiter = ';';
+    std::string strong_scaling_filename = output_directory + "/strong_scaling.csv";
+    std::ofstream strong_scaling_file (strong_scaling_filename);
+    std::string weak_scaling_filename = output_directory + "/weak_scaling.csv";
+    std::ofstream weak_scaling_file (weak_scaling_filename);
+    if ((strong_scaling_file.is_open() == false) || (weak_scaling_file.is_open() == false)) {
+        std::cout << "Failed to open file: '" << strong_scaling_filename << "' or '" << weak_scaling_filename << "'." << std::endl;
+        return;
+    }
+    strong_scaling_file << "scene" << cell_delimiter << "computation_mode" << cell_delimiter << "cube_edge_length" << cell_delimiter 
+        << "number_of_particles" << cell_delimiter << "number_of_threads" << cell_delimiter << "median_step_time_ms" << cell_delimiter 
+        << "speedup" << cell_delimiter << "efficiency" << std::endl;
+    weak_scaling_file << "scene" << cell_delimiter << "computation_mode" << cell_delimiter << "cube_edge_length" << cell_delimiter 
+        << "number_of_threads" << cell_delimiter << "number_of_particles" << cell_delimiter << "particles_per_thread" << cell_delimiter 
+        << "baseline_number_of_particles" << cell_delimiter << "median_step_time_ms" << cell_delimiter << "baseline_median_step_time_ms" 
+        << cell_delimiter << "efficiency" << std::endl;
+    strong_scaling_file << std::fixed << std::setprecision(4);
+    weak_scaling_file << std::fixed << std::setprecision(4);
+
+    for (const Sweep_Result& baseline : results) {
+        // The baseline is always the run with one thread.
+        if ((baseline.number_of_threads != 1) || (baseline.median_step_time <= 0.0)) {
+            continue;
+        }
+        for (const Sweep_Result& result : results) {
+            if ((result.scene != baseline.scene) || (result.computation_mode != baseline.computation_mode) ||
+                (floats_are_same(result.cube_edge_length, baseline.cube_edge_length, 1e-6f) == false) || (result.median_step_time <= 0.0)) {
+                continue;
+            }
+            if (result.number_of_particles == baseline.number_of_particles) {
+                double speedup = baseline.median_step_time / result.median_step_time;
+                strong_scaling_file << result.scene << cell_delimiter << to_string(result.computation_mode) << cell_delimiter 
+                    << result.cube_edge_length << cell_delimiter << result.number_of_particles << cell_delimiter << result.number_of_threads 
+                    << cell_delimiter << result.median_step_time << cell_delimiter << speedup << cell_delimiter 
+                    << speedup / result.number_of_threads << std::endl;
+            }
+            double particles_per_thread = (double)result.number_of_particles / result.number_of_threads;
+            if (fabs(particles_per_thread - baseline.number_of_particles) <= SWEEP_WEAK_SCALING_TOLERANCE * baseline.number_of_particles) {
+                weak_scaling_file << result.scene << cell_delimiter << to_string(result.computation_mode) << cell_delimiter 
+                    << result.cube_edge_length << cell_delimiter << result.number_of_threads << cell_delimiter << result.number_of_particles 
+                    << cell_delimiter << particles_per_thread << cell_delimiter << baseline.number_of_particles << cell_delimiter 
+                    << result.median_step_time << cell_delimiter << baseline.median_step_time << cell_delimiter 
+                    << baseline.median_step_time / result.median_step_time << std::endl;
+            }
+        }
+    }
+    std::cout << "Scaling tables saved to: '" << strong_scaling_filename << "' and '" << weak_scaling_filename << "'" << std::endl;
+}
+
+
+// ====================================== MAIN ======================================
+
+int main (int argc, char* argv[])
+{
+    Sweep_Settings settings {
+        get_performance_analysis_matrices(),
+        SWEEP_DEFAULT_STEPS,
+        SWEEP_DEFAULT_OUTPUT_DIRECTORY,
+        false
+    };
+    Sweep_Matrix matrix = get_performance_analysis_matrices().at(0);
+    Shared_Options shared_options = get_shared_options(settings, matrix);
+    std::string shared_options_usage = get_shared_options_usage(shared_options);
+    if (parse_arguments(argc, argv, shared_options, settings, matrix) == false) {
+        print_usage(argv[0], shared_options_usage);
+        return 1;
+    }
+    std::error_code error;
+    std::filesystem::create_directories(settings.output_directory, error);
+    if (error) {
+        std::cout << "ERROR: Could not create the directory '" << settings.output_directory << "'." << std::endl;
+        return 1;
+    }
+    if (settings.count_hardware_events == true) {
+        initialize_performance_counters();
+    }
+
+    // The scenes are needed to convert the particle counts into spacings.
+    Simulation_Handler simulation_handler;
+    simulation_handler.register_default_scenes();
+
+    std::vector<Sweep_Result> results;
+    unsigned int number_of_failed_configurations = 0;
+    for (Sweep_Matrix& matrix : settings.matrices) {
+        for (int scene : matrix.scenes) {
+            if ((scene < 1) || (scene > simulation_handler.available_scenes.size())) {
+                std::cout << "ERROR: The scene id needs to be within [1; " << simulation_handler.available_scenes.size() << "]." << std::endl;
+                return 1;
+            }
+            // The particles fill the fluid volume in a lattice, so n = volume / spacing^3.
+            std::vector<float> particle_spacings = matrix.particle_spacings;
+            for (unsigned int particle_count : matrix.particle_counts) {
+                particle_spacings.push_back(cbrt(get_fluid_volume(simulation_handler.available_scenes.at(scene - 1)) / particle_count));
+            }
+            for (float particle_spacing : particle_spacings) {
+                for (Computation_Mode computation_mode : matrix.computation_modes) {
+                    for (int number_of_threads : matrix.number_of_threads) {
+                        for (float cube_edge_length : matrix.cube_edge_lengths) {
+                            if (run_configuration(settings, scene, computation_mode, number_of_threads, particle_spacing, cube_edge_length, results) == false) {
+                                number_of_failed_configurations++;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+    save_scaling_tables(settings.output_directory, results);
+    if (number_of_failed_configurations > 0) {
+        std::cout << number_of_failed_configurations << " configuration(s) could not be run." << std::endl;
+        return 1;
+    }
+    return 0;
+}
\ No newline at end of file
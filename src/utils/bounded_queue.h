@@ -0,0 +1,133 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// A simple thread safe queue with a fixed capacity.
+// It is used to hand over work from the simulation loop to background threads (e.g. for writing
+// data to the disk). If the queue is full, the producer has to wait until the consumer took an
+// element out of the queue. We want to know how long the producer had to wait (this is time
+// the simulation is stalled), so the push function reports this time.
+template <typename T>
+class Bounded_Queue
+{
+    private:
+        std::deque<T> elements;
+        size_t capacity;
+        bool closed;
+        std::mutex mutex;
+        std::condition_variable condition_not_empty;
+        std::condition_variable condition_not_full;
+
+    public:
+        Bounded_Queue (size_t capacity = 1)
+        {
+            this->capacity = capacity;
+            this->closed = false;
+        }
+
+        // Changes the capacity. Only use this while no other thread is working on the queue.
+        void set_capacity (size_t capacity)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->capacity = (capacity > 0) ? capacity : 1;
+        }
+
+        // (Re-)opens the queue and removes all elements.
+        void reset ()
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->elements.clear();
+            this->closed = false;
+        }
+
+        // Pushes an element into the queue. If the queue is full, this function blocks until there
+        // is space again. The time waited is written to waited_time (if given).
+        // Returns false if the queue was closed.
+        bool push (T&& element, std::chrono::nanoseconds* waited_time = nullptr)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (waited_time != nullptr) {
+                *waited_time = std::chrono::nanoseconds(0);
+            }
+            if ((this->elements.size() >= this->capacity) && (this->closed == false)) {
+                auto start = std::chrono::steady_clock::now();
+                this->condition_not_full.wait(lock, [this] () {
+                    return (this->elements.size() < this->capacity) || (this->closed == true);
+                });
+                if (waited_time != nullptr) {
+                    *waited_time = std::chrono::steady_clock::now() - start;
+                }
+            }
+            if (this->closed == true) {
+                return false;
+            }
+            this->elements.push_back(std::move(element));
+            lock.unlock();
+            this->condition_not_empty.notify_one();
+            return true;
+        }
+
+        // Pushes an element only if there is space left. Never blocks.
+        bool try_push (T&& element)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if ((this->elements.size() >= this->capacity) || (this->closed == true)) {
+                return false;
+            }
+            this->elements.push_back(std::move(element));
+            lock.unlock();
+            this->condition_not_empty.notify_one();
+            return true;
+        }
+
+        // Takes the next element out of the queue. Blocks until an element is available.
+        // Returns false if the queue was closed and all elements were taken out.
+        bool pop (T& element)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->condition_not_empty.wait(lock, [this] () {
+                return (this->elements.empty() == false) || (this->closed == true);
+            });
+            if (this->elements.empty() == true) {
+                return false;
+            }
+            element = std::move(this->elements.front());
+            this->elements.pop_front();
+            lock.unlock();
+            this->condition_not_full.notify_one();
+            return true;
+        }
+
+        // Takes the next element out of the queue only if there is one. Never blocks.
+        bool try_pop (T& element)
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            if (this->elements.empty() == true) {
+                return false;
+            }
+            element = std::move(this->elements.front());
+            this->elements.pop_front();
+            lock.unlock();
+            this->condition_not_full.notify_one();
+            return true;
+        }
+
+        // Closes the queue. The consumer will still get the remaining elements.
+        void close ()
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->closed = true;
+            lock.unlock();
+            this->condition_not_empty.notify_all();
+            this->condition_not_full.notify_all();
+        }
+
+        size_t size ()
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            return this->elements.size();
+        }
+};
\ No newline at end of file
@@ -0,0 +1,168 @@
+#include "command_line.h"
+
+// The names of the modes on the command line.
+static const char* to_option_value (Computation_Mode computation_mode)
+{
+    return (computation_mode == COMPUTATION_MODE_BRUTE_FORCE) ? "brute-force" : "grid";
+}
+
+static const char* to_option_value (Gravity_Mode gravity_mode)
+{
+    switch (gravity_mode) {
+        case GRAVITY_OFF:       return "off";
+        case GRAVITY_NORMAL:    return "normal";
+        case GRAVITY_ROT_90:    return "rot-90";
+        case GRAVITY_WAVE:      return "wave";
+        default:                return "unknown gravity mode";
+    }
+}
+
+// Parses one shared option. Returns OPTION_UNKNOWN if the tool does not support it.
+static Option_Status parse_shared_option (const std::string& option, const std::string& value, Shared_Options& shared_options)
+{
+    if ((option == "--scene") && (shared_options.scene != nullptr)) {
+        *shared_options.scene = std::atoi(value.c_str());
+    }
+    else if ((option == "--scenes") && (shared_options.scenes != nullptr)) {
+        if (parse_list(value, *shared_options.scenes, 1.0) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else if ((option == "--scene-file") && (shared_options.scene_filename != nullptr)) {
+        *shared_options.scene_filename = value;
+    }
+    else if ((option == "--spacing") && (shared_options.particle_initial_distance != nullptr)) {
+        *shared_options.particle_initial_distance = std::atof(value.c_str());
+    }
+    else if ((option == "--steps") && (shared_options.number_of_steps != nullptr)) {
+        *shared_options.number_of_steps = std::atoi(value.c_str());
+        if (*shared_options.number_of_steps < shared_options.minimum_number_of_steps) {
+            std::cout << "ERROR: The number of steps needs to be at least " << shared_options.minimum_number_of_steps << "." << std::endl;
+            return OPTION_ERROR;
+        }
+    }
+    else if ((option == "--threads") && (shared_options.number_of_threads != nullptr)) {
+        *shared_options.number_of_threads = std::atoi(value.c_str());
+        if (*shared_options.number_of_threads < 1) {
+            std::cout << "ERROR: The number of threads needs to be at least 1." << std::endl;
+            return OPTION_ERROR;
+        }
+    }
+    else if ((option == "--threads") && (shared_options.thread_counts != nullptr)) {
+        if (parse_list(value, *shared_options.thread_counts, 1.0) == false) {
+            return OPTION_INVALID;
+        }
+    }
+    else if ((option == "--mode") && (shared_options.computation_mode != nullptr)) {
+        if (value == "grid")                *shared_options.computation_mode = COMPUTATION_MODE_SPATIAL_GRID;
+        else if (value == "brute-force")    *shared_options.computation_mode = COMPUTATION_MODE_BRUTE_FORCE;
+        else                                return OPTION_INVALID;
+    }
+    else if ((option == "--gravity") && (shared_options.gravity_mode != nullptr)) {
+        if (value == "off")                 *shared_options.gravity_mode = GRAVITY_OFF;
+        else if (value == "normal")         *shared_options.gravity_mode = GRAVITY_NORMAL;
+        else if (value == "rot-90")         *shared_options.gravity_mode = GRAVITY_ROT_90;
+        else if (value == "wave")           *shared_options.gravity_mode = GRAVITY_WAVE;
+        else                                return OPTION_INVALID;
+    }
+    else if ((option == "--output") && (shared_options.output != nullptr)) {
+        *shared_options.output = value;
+    }
+    else if ((option == "--counters") && (shared_options.count_hardware_events != nullptr)) {
+        if (value == "on")                  *shared_options.count_hardware_events = true;
+        else if (value == "off")            *shared_options.count_hardware_events = false;
+        else                                return OPTION_INVALID;
+    }
+    else {
+        return OPTION_UNKNOWN;
+    }
+    shared_options.given_options.push_back(option);
+    return OPTION_VALID;
+}
+
+bool parse_command_line (int argc, char* argv[], Shared_Options& shared_options,
+                         const std::function<Option_Status (const std::string& option, const std::string& value)>& parse_option)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--help") {
+            return false;
+        }
+        // All other options need a value.
+        if (i + 1 >= argc) {
+            std::cout << "ERROR: Missing value for option '" << option << "'." << std::endl;
+            return false;
+        }
+        std::string value = argv[++i];
+        Option_Status status = parse_shared_option(option, value, shared_options);
+        if (status == OPTION_UNKNOWN) {
+            status = parse_option(option, value);
+        }
+        if (status == OPTION_UNKNOWN) {
+            std::cout << "ERROR: Unknown option '" << option << "'." << std::endl;
+            return false;
+        }
+        if (status == OPTION_INVALID) {
+            std::cout << "ERROR: Invalid value '" << value << "' for option '" << option << "'." << std::endl;
+            return false;
+        }
+        if (status == OPTION_ERROR) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string get_shared_options_usage (const Shared_Options& shared_options)
+{
+    std::stringstream usage;
+    if (shared_options.scene != nullptr) {
+        usage << "  --scene <id>                  scene to simulate (1 - 5 and the loaded scene files, default " << *shared_options.scene << ")" << std::endl;
+    }
+    if (shared_options.scenes != nullptr) {
+        usage << "  --scenes <list>               scenes to simulate (default " << join_list(*shared_options.scenes) << ")" << std::endl;
+    }
+    if (shared_options.scene_filename != nullptr) {
+        usage << "  --scene-file <file>           simulate the scene described in the scene file" << std::endl;
+    }
+    if (shared_options.particle_initial_distance != nullptr) {
+        usage << "  --spacing <distance>          initial distance between the particles (" << PARTICLE_INITIAL_DISTANCE_MIN
+            << " - " << PARTICLE_INITIAL_DISTANCE_MAX << ", default " << *shared_options.particle_initial_distance << ")" << std::endl;
+    }
+    if (shared_options.number_of_steps != nullptr) {
+        usage << "  --steps <number>              number of simulation steps (at least " << shared_options.minimum_number_of_steps
+            << ", default " << *shared_options.number_of_steps << ")" << std::endl;
+    }
+    if (shared_options.number_of_threads != nullptr) {
+        usage << "  --threads <number>            number of threads (default " << *shared_options.number_of_threads << ")" << std::endl;
+    }
+    if (shared_options.thread_counts != nullptr) {
+        usage << "  --threads <list>              thread counts (default " << join_list(*shared_options.thread_counts) << ")" << std::endl;
+    }
+    if (shared_options.computation_mode != nullptr) {
+        usage << "  --mode <grid|brute-force>     computation mode (default " << to_option_value(*shared_options.computation_mode) << ")" << std::endl;
+    }
+    if (shared_options.gravity_mode != nullptr) {
+        usage << "  --gravity <off|normal|rot-90|wave>" << std::endl
+            << "                                gravity mode (default " << to_option_value(*shared_options.gravity_mode) << ")" << std::endl;
+    }
+    if (shared_options.output != nullptr) {
+        usage << "  --output <path>               where the results are written (default " << *shared_options.output << ")" << std::endl;
+    }
+    if (shared_options.count_hardware_events != nullptr) {
+        usage << "  --counters <on|off>           count hardware events with the timings (needs a build with -DPERFORMANCE_TEST, default "
+            << ((*shared_options.count_hardware_events == true) ? "on" : "off") << ")" << std::endl;
+    }
+    return usage.str();
+}
+
+std::vector<std::string> split_list (const std::string& value)
+{
+    std::vector<std::string> list;
+    std::stringstream stream(value);
+    std::string element;
+    while (std::getline(stream, element, ',')) {
+        list.push_back(element);
+    }
+    return list;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <limits>
+#include <functional>
+#include <iostream>
+#include <cstdlib>
+
+#include "particle_system.h"
+
+// The command line tools (headless, bench, sweep and ensemble) parse their arguments the same way: every option
+// except --help is followed by a value, and unknown options, missing and invalid values are reported the same way.
+// The options that several tools have (scene, spacing, steps, threads, computation and gravity mode, output and
+// hardware counters) are parsed, checked and documented here. A tool points the shared options it supports at its
+// settings (the others stay nullptr) and parses its own options in a callback.
+
+// The result of parsing one option of a tool.
+enum Option_Status
+{
+    OPTION_VALID,
+    // The value is invalid (reported by parse_command_line).
+    OPTION_INVALID,
+    // The value is invalid and the tool already printed why.
+    OPTION_ERROR,
+    OPTION_UNKNOWN,
+    _OPTION_STATUS_COUNT
+};
+
+// The shared options. The values they point at when the usage is created are shown as defaults.
+struct Shared_Options
+{
+    // --scene <id>
+    int* scene = nullptr;
+    // --scenes <list>
+    std::vector<int>* scenes = nullptr;
+    // --scene-file <file>
+    std::string* scene_filename = nullptr;
+    // --spacing <distance>
+    float* particle_initial_distance = nullptr;
+    // --steps <number> (at least minimum_number_of_steps)
+    int* number_of_steps = nullptr;
+    int minimum_number_of_steps = 1;
+    // --threads <number> or --threads <list>
+    int* number_of_threads = nullptr;
+    std::vector<int>* thread_counts = nullptr;
+    // --mode <grid|brute-force>
+    Computation_Mode* computation_mode = nullptr;
+    // --gravity <off|normal|rot-90|wave>
+    Gravity_Mode* gravity_mode = nullptr;
+    // --output <path>
+    std::string* output = nullptr;
+    // --counters <on|off>
+    bool* count_hardware_events = nullptr;
+    // The shared options found on the command line (e.g. to know if a default was overridden).
+    std::vector<std::string> given_options;
+};
+
+// Parses the command line. The shared options are written to the settings they point at, all others are passed
+// to parse_option. Returns false if the arguments are invalid (or the help was requested).
+bool parse_command_line (int argc, char* argv[], Shared_Options& shared_options,
+                         const std::function<Option_Status (const std::string& option, const std::string& value)>& parse_option);
+
+// Returns the usage of the shared options the tool supports (one or two lines per option, like the usage of the tools).
+std::string get_shared_options_usage (const Shared_Options& shared_options);
+
+// Splits a comma separated list.
+std::vector<std::string> split_list (const std::string& value);
+
+// Parses a comma separated list of numbers within [min; max]. Returns false if the list contains something else.
+template <typename T>
+bool parse_list (const std::string& value, std::vector<T>& list, double min = 0.0, double max = std::numeric_limits<double>::max())
+{
+    list.clear();
+    for (const std::string& element : split_list(value)) {
+        char* end;
+        double number = std::strtod(element.c_str(), &end);
+        if ((element.empty() == true) || (*end != '\0') || (number < min) || (number > max)) {
+            std::cout << "ERROR: '" << element << "' is not a valid list element";
+            if (max < std::numeric_limits<double>::max()) {
+                std::cout << " (needs to be within [" << min << "; " << max << "])";
+            }
+            std::cout << "." << std::endl;
+            return false;
+        }
+        list.push_back((T)number);
+    }
+    return list.empty() == false;
+}
+
+// Joins a list with commas (the inverse of parse_list, e.g. for the defaults in the usage).
+template <typename T>
+std::string join_list (const std::vector<T>& list)
+{
+    std::stringstream stream;
+    for (size_t i = 0; i < list.size(); i++) {
+        stream << ((i > 0) ? "," : "") << list[i];
+    }
+    return stream.str();
+}
@@ -1,11 +1,18 @@
 #include <cmath>
+#include <cstdint>
 
 #include "cuboid.h"
-#include "debug.h"
 
 Cuboid::Cuboid ()
+:
+    x_min { 0.0f },
+    x_max { 0.0f },
+    y_min { 0.0f },
+    y_max { 0.0f },
+    z_min { 0.0f },
+    z_max { 0.0f }
 {
-    this->vertex_array_object = 0;
+
 }
 
 Cuboid::Cuboid (float x_min, float x_max, float y_min, float y_max, float z_min, float z_max)
@@ -17,50 +24,7 @@ Cuboid::Cuboid (float x_min, float x_max, float y_min, float y_max, float z_min,
     z_min { z_min },
     z_max { z_max }
 {
-    this->vertices = std::vector<glm::vec3> {
-        glm::vec3 (x_min, y_min, z_min), // 0, back  left  bottom
-        glm::vec3 (x_max, y_min, z_min), // 1, back  right bottom 
-        glm::vec3 (x_min, y_max, z_min), // 2, back  left  top
-        glm::vec3 (x_max, y_max, z_min), // 3, back  right top
-        glm::vec3 (x_min, y_min, z_max), // 4, front left  bottom
-        glm::vec3 (x_max, y_min, z_max), // 5, front right bottom
-        glm::vec3 (x_min, y_max, z_max), // 6, front left  top
-        glm::vec3 (x_max, y_max, z_max)  // 7, front right top
-    };
-    this->indices = std::vector<GLuint> {
-        0, 1, 2,    // back face triangle 1
-        2, 3, 1,    // back face triangle 2
-        0, 4, 5,    // bottom face triangle 1
-        5, 1, 0,    // bootom face triangle 2
-        4, 5, 7,    // front face triangle 1
-        7, 6, 4,    // front face triangle 2
-        6, 7, 3,    // top face triangle 1
-        3, 2, 6,    // top face triangle 2
-        0, 2, 6,    // left face triangle 1
-        6, 4, 0,    // left face triangle 2
-        1, 3, 7,    // right face triangle 1
-        7, 5, 1     // right face triangle 2
-    };
 
-    // Generate the OpenGL buffers for this cuboid.
-    GLCall( glGenVertexArrays(1, &this->vertex_array_object) );
-    GLCall( glGenBuffers(1, &this->vertex_buffer_object) );
-    GLCall( glGenBuffers(1, &this->index_buffer_object) );
-
-    // Make vertex array object active.  
-    GLCall( glBindVertexArray(this->vertex_array_object) );
-    // Copy the data into the vertex buffer object.
-    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
-    GLCall( glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * this->vertices.size(), &this->vertices[0], GL_STATIC_DRAW) );
-    // Copy the indices into the index buffer object.
-    GLCall( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer_object) );
-    GLCall( glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * this->indices.size(), &this->indices[0], GL_STATIC_DRAW) );
-    // Describe the vertex buffer layout.
-    GLCall( glEnableVertexAttribArray(0) );
-    GLCall( glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0) );
-    // Unbind.
-    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
-    GLCall( glBindVertexArray(0) );
 }
 
 Cuboid::~Cuboid ()
@@ -109,35 +73,123 @@ glm::vec3 Cuboid::get_point_of_interest ()
     );
 }
 
-void Cuboid::fill_with_particles (float particle_distance, std::vector<Particle>& particles)
+// Returns the coordinate of the lattice point with the given index along one axis.
+static inline float get_lattice_coordinate (float min, float particle_distance, float spacing, unsigned int index)
+{
+    // We do not set the particles at the surface of the cuboid but only within (so the particles do not start
+    // at the borders). Calculating the coordinate from the index (instead of adding the spacing again and again)
+    // gives the same coordinates on every machine and for every thread.
+    return min + particle_distance / 2 + index * spacing;
+}
+
+// Returns the number of lattice points along one axis (all points with coordinate + max_offset < max).
+static unsigned int get_number_of_lattice_points (float min, float max, float particle_distance, float spacing, float max_offset)
 {
-    // In order to not have particles at the borders to begin with, we do not set the particles at the 
-    // surface of the cuboid but only within.
-    for (float x = this->x_min + particle_distance / 2; x < this->x_max; x += particle_distance) {
-        for (float y = this->y_min + particle_distance / 2; y < this->y_max; y += particle_distance) {
-            for (float z = this->z_min + particle_distance / 2; z < this->z_max; z += particle_distance) {
-                particles.push_back(get_default_particle(x, y ,z));
-            }
-        }
+    float length = max - min - particle_distance / 2 - max_offset;
+    if (length <= 0.0f) {
+        return 0;
+    }
+    long long number_of_points = (long long)ceil(length / spacing);
+    // The division is rounded, so check the last point against the coordinates we will really use and correct
+    // the number if necessary. This loops at most once.
+    while ((number_of_points > 0) && 
+        (get_lattice_coordinate(min, particle_distance, spacing, number_of_points - 1) + max_offset >= max)) {
+        number_of_points--;
     }
+    while (get_lattice_coordinate(min, particle_distance, spacing, number_of_points) + max_offset < max) {
+        number_of_points++;
+    }
+    return number_of_points;
+}
+
+// A reproducible random value in [-1; 1) for the given particle and axis (the jittered seeding must not depend
+// on the thread that creates the particle). This is the finalizer of the splitmix64 generator.
+static inline float get_jitter (unsigned int index, unsigned int axis)
+{
+    uint64_t value = ((uint64_t)index << 2) | axis;
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    value = value ^ (value >> 31);
+    return (value >> 40) / (float)(1ULL << 23) - 1.0f;
 }
 
-void Cuboid::draw (bool unbind)
+Seeding_Lattice Cuboid::get_seeding_lattice (float particle_distance, Seeding_Pattern seeding_pattern)
 {
-    GLCall( glBindVertexArray(this->vertex_array_object) );
-    GLCall( glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0) );
-    // In order to save a few unbind-calls, do this only if neccessary. 
-    // In our case, the visualization handler will handle the unbinding, so normally we will not unbind here.
-    if (unbind == true) {
-        GLCall( glBindVertexArray(0) );
+    Seeding_Lattice seeding_lattice;
+    seeding_lattice.seeding_pattern = seeding_pattern;
+    seeding_lattice.particle_distance = particle_distance;
+    switch (seeding_pattern) {
+        case SEEDING_PATTERN_JITTERED:
+            seeding_lattice.spacing = glm::vec3(particle_distance);
+            seeding_lattice.max_offset = glm::vec3(SEEDING_JITTER_AMPLITUDE * particle_distance);
+            break;
+        case SEEDING_PATTERN_HEXAGONAL_CLOSE_PACKED:
+            // The layers are stacked along the y axis. Within a layer the rows (along z) are shifted by half the
+            // particle distance along x, every second layer is shifted by half the particle distance along x
+            // and by a third of the row distance along z (ABAB stacking).
+            seeding_lattice.spacing = glm::vec3(
+                particle_distance, 
+                particle_distance * sqrt(6.0f) / 3.0f, 
+                particle_distance * sqrt(3.0f) / 2.0f);
+            seeding_lattice.max_offset = glm::vec3(
+                particle_distance / 2.0f, 
+                0.0f, 
+                particle_distance * sqrt(3.0f) / 6.0f);
+            break;
+        default:
+            seeding_lattice.spacing = glm::vec3(particle_distance);
+            seeding_lattice.max_offset = glm::vec3(0.0f);
+            break;
     }
+    seeding_lattice.number_of_particles_x = get_number_of_lattice_points(this->x_min, this->x_max, particle_distance, 
+        seeding_lattice.spacing.x, seeding_lattice.max_offset.x);
+    seeding_lattice.number_of_particles_y = get_number_of_lattice_points(this->y_min, this->y_max, particle_distance, 
+        seeding_lattice.spacing.y, seeding_lattice.max_offset.y);
+    seeding_lattice.number_of_particles_z = get_number_of_lattice_points(this->z_min, this->z_max, particle_distance, 
+        seeding_lattice.spacing.z, seeding_lattice.max_offset.z);
+    seeding_lattice.number_of_particles = seeding_lattice.number_of_particles_x * 
+        seeding_lattice.number_of_particles_y * seeding_lattice.number_of_particles_z;
+    return seeding_lattice;
+}
+
+unsigned int Cuboid::get_number_of_particles (float particle_distance, Seeding_Pattern seeding_pattern)
+{
+    return this->get_seeding_lattice(particle_distance, seeding_pattern).number_of_particles;
 }
 
-void Cuboid::free_gpu_resources ()
+glm::vec3 Cuboid::get_particle_position (const Seeding_Lattice& seeding_lattice, unsigned int index)
 {
-    if (this->vertex_array_object > 0) {
-        GLCall( glDeleteVertexArrays(1, &this->vertex_array_object) );
-        GLCall( glDeleteBuffers(1, &this->vertex_buffer_object) );
-        GLCall( glDeleteBuffers(1, &this->index_buffer_object) );
+    unsigned int index_z = index % seeding_lattice.number_of_particles_z;
+    unsigned int index_y = (index / seeding_lattice.number_of_particles_z) % seeding_lattice.number_of_particles_y;
+    unsigned int index_x = index / (seeding_lattice.number_of_particles_z * seeding_lattice.number_of_particles_y);
+    glm::vec3 position = glm::vec3(
+        get_lattice_coordinate(this->x_min, seeding_lattice.particle_distance, seeding_lattice.spacing.x, index_x),
+        get_lattice_coordinate(this->y_min, seeding_lattice.particle_distance, seeding_lattice.spacing.y, index_y),
+        get_lattice_coordinate(this->z_min, seeding_lattice.particle_distance, seeding_lattice.spacing.z, index_z));
+    if (seeding_lattice.seeding_pattern == SEEDING_PATTERN_JITTERED) {
+        position.x += seeding_lattice.max_offset.x * get_jitter(index, 0);
+        position.y += seeding_lattice.max_offset.y * get_jitter(index, 1);
+        position.z += seeding_lattice.max_offset.z * get_jitter(index, 2);
     }
+    else if (seeding_lattice.seeding_pattern == SEEDING_PATTERN_HEXAGONAL_CLOSE_PACKED) {
+        unsigned int layer_shift = index_y % 2;
+        position.x += ((index_z + layer_shift) % 2) * seeding_lattice.max_offset.x;
+        position.z += layer_shift * seeding_lattice.max_offset.z;
+    }
+    return position;
+}
+
+std::vector<glm::vec3> Cuboid::get_vertices ()
+{
+    return std::vector<glm::vec3> {
+        glm::vec3 (this->x_min, this->y_min, this->z_min), // 0, back  left  bottom
+        glm::vec3 (this->x_max, this->y_min, this->z_min), // 1, back  right bottom 
+        glm::vec3 (this->x_min, this->y_max, this->z_min), // 2, back  left  top
+        glm::vec3 (this->x_max, this->y_max, this->z_min), // 3, back  right top
+        glm::vec3 (this->x_min, this->y_min, this->z_max), // 4, front left  bottom
+        glm::vec3 (this->x_max, this->y_min, this->z_max), // 5, front right bottom
+        glm::vec3 (this->x_min, this->y_max, this->z_max), // 6, front left  top
+        glm::vec3 (this->x_max, this->y_max, this->z_max)  // 7, front right top
+    };
 }
\ No newline at end of file
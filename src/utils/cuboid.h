@@ -1,22 +1,61 @@
 #pragma once
 
-#include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <vector>
 
 #include "particle.h"
 
+// The amplitude of the random offset of the jittered seeding pattern (as a fraction of the particle distance).
+// It has to be less than 0.5, otherwise the particles of two neighboring lattice points could swap places.
+#define SEEDING_JITTER_AMPLITUDE                0.25f
+
+// How the cuboids of the fluid are filled with particles at the start of the simulation.
+enum Seeding_Pattern
+{
+    // A cubic lattice with the particle distance as edge length.
+    SEEDING_PATTERN_CUBIC,
+    // The cubic lattice but every particle is moved by a (reproducible) random offset. This breaks the
+    // symmetry of the lattice, so the fluid does not collapse layer by layer.
+    SEEDING_PATTERN_JITTERED,
+    // Hexagonal close packing. Every particle has twelve neighbors at the particle distance, so there are
+    // about sqrt(2) times more particles in the same volume than with the cubic lattice.
+    SEEDING_PATTERN_HEXAGONAL_CLOSE_PACKED,
+    _SEEDING_PATTERN_COUNT
+};
+
+inline const char* to_string (Seeding_Pattern seeding_pattern)
+{
+    switch (seeding_pattern) {
+        case SEEDING_PATTERN_CUBIC:                     return "CUBIC";
+        case SEEDING_PATTERN_JITTERED:                  return "JITTERED";
+        case SEEDING_PATTERN_HEXAGONAL_CLOSE_PACKED:    return "HEXAGONAL CLOSE PACKED";
+        default:                                        return "unknown seeding pattern";
+    }
+}
+
+// The lattice a cuboid is filled with. The particles are placed at the lattice points
+// (x_min + distance / 2 + i * spacing.x + offset, ...), so the position of every particle can be calculated
+// from its index alone. The number of lattice points of every axis is chosen so that also the points with the
+// maximal offset are within the cuboid.
+struct Seeding_Lattice
+{
+    Seeding_Pattern seeding_pattern;
+    float particle_distance;
+    glm::vec3 spacing;
+    glm::vec3 max_offset;
+    unsigned int number_of_particles_x;
+    unsigned int number_of_particles_y;
+    unsigned int number_of_particles_z;
+    unsigned int number_of_particles;
+};
+
 // Cuboid class for the definition of the simulation space
 // and the starting volume(s) of the fluid.
+// The cuboid only holds its geometry. It does not own any OpenGL resources, so it can also be used
+// without an OpenGL context (e.g. by the headless simulation). Drawing is done by the Cuboid_Renderer
+// of the visualization handler.
 class Cuboid
 {
-    private:
-        GLuint vertex_buffer_object;
-        GLuint index_buffer_object;
-        GLuint vertex_array_object;
-        std::vector<glm::vec3> vertices;
-        std::vector<GLuint> indices;
-
     public:
         float x_min;
         float x_max;
@@ -40,10 +79,14 @@ class Cuboid
         // the point of interest depending on the simulation space. This may be the center of the cuboid or 
         // something else. For the implemented formula check the function.
         glm::vec3 get_point_of_interest ();
-        // A function that fills a cuboid evenly with particles (for the start of the simulation).
-        void fill_with_particles (float particle_distance, std::vector<Particle>& particles);
-        // Draws the object. Note that the shader will be selected and activated by the visualization handler.
-        void draw (bool unbind = false);
-        // Deletes the GPU ressources (vertex array, vertex buffer, index buffer).
-        void free_gpu_resources ();
+        // The functions to fill a cuboid evenly with particles (for the start of the simulation).
+        // The number of particles is known before a single particle is created, so the particles vector can be
+        // allocated at once and filled by multiple threads (see Particle_System::generate_initial_particles).
+        Seeding_Lattice get_seeding_lattice (float particle_distance, Seeding_Pattern seeding_pattern);
+        unsigned int get_number_of_particles (float particle_distance, Seeding_Pattern seeding_pattern);
+        // Returns the position of the particle with the given index (0 to number_of_particles - 1) within the cuboid.
+        // The index is counted along z first, then y and then x.
+        glm::vec3 get_particle_position (const Seeding_Lattice& seeding_lattice, unsigned int index);
+        // Returns the eight corners of the cuboid (used for drawing).
+        std::vector<glm::vec3> get_vertices ();
 };
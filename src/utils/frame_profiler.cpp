@@ -0,0 +1,148 @@
+#include "frame_profiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// For more details see frame_profiler.h:
+Frame_Profiler frame_profiler;
+
+Frame_Profiler::Frame_Profiler ()
+{
+    this->frames.resize(PROFILER_HISTORY_CAPACITY);
+    this->is_active = false;
+    this->window_size = PROFILER_WINDOW_SIZE;
+    this->clear();
+}
+
+void Frame_Profiler::clear ()
+{
+    std::memset(this->frames.data(), 0, this->frames.size() * sizeof(Profiler_Frame));
+    this->next_frame = 0;
+    this->number_of_frames = 0;
+    this->current_phase = -1;
+    this->frame_start = std::chrono::steady_clock::now();
+}
+
+int Frame_Profiler::begin_phase (Profiler_Phase phase)
+{
+    auto now = std::chrono::steady_clock::now();
+    int previous_phase = this->current_phase;
+    // Pause the outer phase.
+    if (previous_phase != -1) {
+        this->frames[this->next_frame].phase_times[previous_phase] += 
+            std::chrono::duration<float, std::milli>(now - this->current_phase_start).count();
+    }
+    this->current_phase = phase;
+    this->current_phase_start = now;
+    return previous_phase;
+}
+
+void Frame_Profiler::end_phase (Profiler_Phase phase, int previous_phase)
+{
+    auto now = std::chrono::steady_clock::now();
+    this->frames[this->next_frame].phase_times[phase] += std::chrono::duration<float, std::milli>(now - this->current_phase_start).count();
+    // Continue the outer phase.
+    this->current_phase = previous_phase;
+    this->current_phase_start = now;
+}
+
+void Frame_Profiler::end_frame (unsigned int number_of_particles)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (this->is_active == false) {
+        // Start with a fresh frame once the profiler gets active again.
+        this->frame_start = now;
+        return;
+    }
+    Profiler_Frame& frame = this->frames[this->next_frame];
+    frame.frame_time = std::chrono::duration<float, std::milli>(now - this->frame_start).count();
+    frame.number_of_particles = number_of_particles;
+    // Everything not measured is the rest of the frame.
+    float measured_time = 0.0f;
+    for (int phase = 0; phase < PROFILER_PHASE_OTHER; phase++) {
+        measured_time += frame.phase_times[phase];
+    }
+    frame.phase_times[PROFILER_PHASE_OTHER] = std::max(frame.frame_time - measured_time, 0.0f);
+    // Next frame.
+    this->next_frame = (this->next_frame + 1) % PROFILER_HISTORY_CAPACITY;
+    this->number_of_frames = std::min(this->number_of_frames + 1, (unsigned int)PROFILER_HISTORY_CAPACITY);
+    std::memset(&this->frames[this->next_frame], 0, sizeof(Profiler_Frame));
+    this->frame_start = now;
+}
+
+
+// ====================================== STATISTICS ======================================
+
+unsigned int Frame_Profiler::get_number_of_frames_in_window ()
+{
+    unsigned int window_size = std::min(std::max(this->window_size, PROFILER_WINDOW_SIZE_MIN), PROFILER_WINDOW_SIZE_MAX);
+    return std::min(this->number_of_frames, window_size);
+}
+
+const Profiler_Frame& Frame_Profiler::get_frame_in_window (unsigned int i)
+{
+    unsigned int number_of_frames_in_window = this->get_number_of_frames_in_window();
+    unsigned int index = (this->next_frame + PROFILER_HISTORY_CAPACITY - number_of_frames_in_window + i) % PROFILER_HISTORY_CAPACITY;
+    return this->frames[index];
+}
+
+// Calculates the statistics of the given values (the values are sorted).
+Profiler_Statistics calculate_statistics (std::vector<float>& values)
+{
+    Profiler_Statistics statistics { 0.0f, 0.0f, 0.0f };
+    if (values.empty() == true) {
+        return statistics;
+    }
+    std::sort(values.begin(), values.end());
+    float sum = 0.0f;
+    for (float value : values) {
+        sum += value;
+    }
+    statistics.min = values.front();
+    statistics.average = sum / values.size();
+    // Nearest rank.
+    size_t rank = (size_t)ceil(0.99 * values.size());
+    statistics.p99 = values[std::max(rank, (size_t)1) - 1];
+    return statistics;
+}
+
+Profiler_Statistics Frame_Profiler::get_statistics (Profiler_Phase phase)
+{
+    std::vector<float> values;
+    unsigned int number_of_frames_in_window = this->get_number_of_frames_in_window();
+    values.reserve(number_of_frames_in_window);
+    for (unsigned int i = 0; i < number_of_frames_in_window; i++) {
+        values.push_back(this->get_frame_in_window(i).phase_times[phase]);
+    }
+    return calculate_statistics(values);
+}
+
+Profiler_Statistics Frame_Profiler::get_frame_time_statistics ()
+{
+    std::vector<float> values;
+    unsigned int number_of_frames_in_window = this->get_number_of_frames_in_window();
+    values.reserve(number_of_frames_in_window);
+    for (unsigned int i = 0; i < number_of_frames_in_window; i++) {
+        values.push_back(this->get_frame_in_window(i).frame_time);
+    }
+    return calculate_statistics(values);
+}
+
+float Frame_Profiler::get_simulation_throughput ()
+{
+    double particles = 0.0;
+    double simulation_time = 0.0;
+    unsigned int number_of_frames_in_window = this->get_number_of_frames_in_window();
+    for (unsigned int i = 0; i < number_of_frames_in_window; i++) {
+        const Profiler_Frame& frame = this->get_frame_in_window(i);
+        float frame_simulation_time = frame.phase_times[PROFILER_PHASE_GRID_BUILD] + frame.phase_times[PROFILER_PHASE_DENSITY] + 
+            frame.phase_times[PROFILER_PHASE_FORCES] + frame.phase_times[PROFILER_PHASE_INTEGRATION];
+        // Frames without simulation (e.g. during a replay or while paused) are not counted.
+        if (frame_simulation_time > 0.0f) {
+            particles += frame.number_of_particles;
+            simulation_time += frame_simulation_time;
+        }
+    }
+    return (simulation_time > 0.0) ? (float)(particles / (simulation_time / 1000.0)) : 0.0f;
+}
\ No newline at end of file
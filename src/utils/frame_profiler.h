@@ -0,0 +1,134 @@
+#pragma once
+
+#include <vector>
+#include <chrono>
+
+#include "trace.h"
+
+// The frame profiler collects the time of every phase of a frame (simulation and visualization) for the profiler
+// window of the application. It keeps a history of the last frames, so the window can show the phases over time
+// and calculate statistics (min, average, 99th percentile) over a configurable number of frames.
+// The phases are measured with PROFILE_PHASE on the main thread. Phases can be nested, the time of an inner phase
+// is not counted for the outer phase (e.g. the buffer upload within the drawing).
+// The profiler is only active while the profiler window is open. Otherwise a scope only checks a bool.
+#define PROFILER_HISTORY_CAPACITY               1000
+// The number of frames used for the statistics.
+#define PROFILER_WINDOW_SIZE                    240
+#define PROFILER_WINDOW_SIZE_MIN                10
+#define PROFILER_WINDOW_SIZE_MAX                PROFILER_HISTORY_CAPACITY
+
+enum Profiler_Phase
+{
+    PROFILER_PHASE_GRID_BUILD,
+    PROFILER_PHASE_DENSITY,
+    PROFILER_PHASE_FORCES,
+    PROFILER_PHASE_INTEGRATION,
+    PROFILER_PHASE_MARCHING_CUBES,
+    PROFILER_PHASE_BUFFER_UPLOAD,
+    PROFILER_PHASE_DRAW,
+    PROFILER_PHASE_IMGUI,
+    // The rest of the frame (e.g. waiting for the buffer swap).
+    PROFILER_PHASE_OTHER,
+    _PROFILER_PHASE_COUNT
+};
+
+inline const char* to_string (Profiler_Phase phase)
+{
+    switch (phase) {
+        case PROFILER_PHASE_GRID_BUILD:         return "grid build";
+        case PROFILER_PHASE_DENSITY:            return "density";
+        case PROFILER_PHASE_FORCES:             return "forces";
+        case PROFILER_PHASE_INTEGRATION:        return "integration";
+        case PROFILER_PHASE_MARCHING_CUBES:     return "marching cubes";
+        case PROFILER_PHASE_BUFFER_UPLOAD:      return "buffer upload";
+        case PROFILER_PHASE_DRAW:               return "draw";
+        case PROFILER_PHASE_IMGUI:              return "imgui";
+        case PROFILER_PHASE_OTHER:              return "other";
+        default:                                return "unknown phase";
+    }
+}
+
+// The times of all phases of one frame in milliseconds.
+struct Profiler_Frame
+{
+    float phase_times[_PROFILER_PHASE_COUNT];
+    float frame_time;
+    unsigned int number_of_particles;
+};
+
+// Statistics of one phase over the window (in milliseconds).
+struct Profiler_Statistics
+{
+    float min;
+    float average;
+    float p99;
+};
+
+class Frame_Profiler
+{
+    private:
+        // The history is a ring buffer, next_frame is the index the current frame is written to.
+        std::vector<Profiler_Frame> frames;
+        unsigned int next_frame;
+        unsigned int number_of_frames;
+        std::chrono::steady_clock::time_point frame_start;
+        // The phase that is measured at the moment (to pause it while an inner phase is measured).
+        int current_phase;
+        std::chrono::steady_clock::time_point current_phase_start;
+
+    public:
+        Frame_Profiler ();
+
+        // Set by the profiler window (only collect data while the window is visible).
+        bool is_active;
+        // The number of frames used for the statistics.
+        int window_size;
+
+        // Called at the start / end of a phase by the Profiler_Scope. Returns the phase measured before (or -1).
+        int begin_phase (Profiler_Phase phase);
+        void end_phase (Profiler_Phase phase, int previous_phase);
+        // Finishes the current frame. Call this once per frame.
+        void end_frame (unsigned int number_of_particles);
+        void clear ();
+
+        // The number of frames within the window (limited by the number of recorded frames).
+        unsigned int get_number_of_frames_in_window ();
+        // The i-th frame of the window, 0 is the oldest one.
+        const Profiler_Frame& get_frame_in_window (unsigned int i);
+        Profiler_Statistics get_statistics (Profiler_Phase phase);
+        Profiler_Statistics get_frame_time_statistics ();
+        // The average number of particles per second the simulation phases (grid build, density, forces and
+        // integration) can process.
+        float get_simulation_throughput ();
+};
+
+// The profiler of the application. It is defined in frame_profiler.cpp.
+extern Frame_Profiler frame_profiler;
+
+// Measures the rest of the enclosing block as the given phase (if the profiler is active).
+class Profiler_Scope
+{
+    private:
+        Profiler_Phase phase;
+        int previous_phase;
+        bool is_active;
+
+    public:
+        Profiler_Scope (Profiler_Phase phase)
+        {
+            this->is_active = frame_profiler.is_active;
+            if (this->is_active == true) {
+                this->phase = phase;
+                this->previous_phase = frame_profiler.begin_phase(phase);
+            }
+        }
+
+        ~Profiler_Scope ()
+        {
+            if (this->is_active == true) {
+                frame_profiler.end_phase(this->phase, this->previous_phase);
+            }
+        }
+};
+
+#define PROFILE_PHASE(phase) Profiler_Scope TRACE_CONCATENATE(profiler_scope_, __LINE__) (phase)
\ No newline at end of file
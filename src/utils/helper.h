@@ -2,6 +2,9 @@
 
 #include <glm/glm.hpp>
 #include <string>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
 
 // A function that converts a number to a string and adds thousand separator.
 // This is going to be used to print the number of particles more readable.
@@ -26,6 +29,44 @@ static std::string to_string (glm::vec3 vector)
         ", z: "  + std::to_string(vector.z);
 }
 
+// Converts a float into the bits of a half float (IEEE 754 binary16, as GL_HALF_FLOAT), rounded to the nearest half
+// float. Values beyond the largest half float (65504) are clamped to it instead of becoming infinite.
+static unsigned short float_to_half (float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(float));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    // 65520 and above (and NaN) would round to infinity.
+    if (magnitude >= 0x477FF000) {
+        return sign | 0x7BFF;
+    }
+    // Below 2^-14 the half float is subnormal, its mantissa counts multiples of 2^-24.
+    if (magnitude < 0x38800000) {
+        return sign | (uint32_t)std::nearbyint(std::fabs(value) * 16777216.0f);
+    }
+    // Move the exponent from the float bias (127) to the half float bias (15) and round the mantissa from 23 to 10
+    // bits (to the nearest, ties to even). A carry of the rounding correctly increases the exponent.
+    magnitude -= 0x38000000;
+    return sign | ((magnitude + 0x0FFF + ((magnitude >> 13) & 1)) >> 13);
+}
+
+// Converts the bits of a half float back into a float (exactly).
+static float half_to_float (unsigned short half)
+{
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0) {
+        float value = std::ldexp((float)mantissa, -24);
+        return (sign != 0) ? -value : value;
+    }
+    uint32_t bits = (exponent == 31) ? (sign | 0x7F800000 | (mantissa << 13)) : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+    float value;
+    std::memcpy(&value, &bits, sizeof(float));
+    return value;
+}
+
 // Simply comparing floats like a == b can result in wrong results.
 // Therefore create a function that compares floats depending on an allowed difference.
 static bool floats_are_same (float a, float b, float epsilon)
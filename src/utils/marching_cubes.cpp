@@ -0,0 +1,1177 @@
+#include "marching_cubes.h"
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <climits>
+
+#include "helper.h"
+#include "marching_cubes_tables.h"
+#include "marching_cubes_common.h"
+#include "trace.h"
+#include "performance_counters.h"
+
+
+// ====================================== MARCHING CUBES GENERATOR ======================================
+
+Marching_Cubes_Generator::Marching_Cubes_Generator ()
+{
+    this->cube_edge_length = -1.0f;
+    this->new_cube_edge_length = MARCHING_CUBES_CUBE_EDGE_LENGTH;
+    this->number_of_cells_density_estimator = 0;
+    this->number_of_cells_marching_cubes = 0;
+    this->generation = 0;
+    this->isovalue = MARCHING_CUBES_ISOVALUE;
+    this->isovalue_threshold = 0;
+    this->density_estimation_mode = DENSITY_ESTIMATION_AUTO;
+    this->used_density_estimation_mode = DENSITY_ESTIMATION_AUTO;
+    this->number_of_density_histograms = 0;
+    this->number_of_active_marching_cubes = 0;
+    this->color_field_radius_squared = 0.0f;
+    this->color_field_coefficient = 0.0f;
+    this->scalar_field_mode = SCALAR_FIELD_PARTICLE_COUNT;
+    this->used_scalar_field_mode = SCALAR_FIELD_PARTICLE_COUNT;
+    this->incremental_updates = true;
+    this->number_of_updated_marching_cubes = 0;
+    this->update_all_vertex_values = true;
+    this->vertex_values_changed = true;
+    this->compacted_isovalue = -1.0f;
+    this->changed_active_cubes_begin = 0;
+    this->changed_active_cubes_end = 0;
+    this->previous_number_of_active_marching_cubes = 0;
+    this->cells_per_spatial_grid_cell = 0;
+    this->spatial_grid_cells_per_cell = 0;
+    this->spatial_grid_counts_are_current = false;
+    this->collect_dirty_density_cells = false;
+}
+
+
+// ====================================== MULTITHREADING ======================================
+
+void Marching_Cubes_Generator::parallel_for (void (Marching_Cubes_Generator::* function)(unsigned int, unsigned int), int number_of_elements)
+{
+    // The elements are particles for the density estimation and cells or cubes otherwise.
+    bool elements_are_particles = (function == &Marching_Cubes_Generator::estimate_density_atomic) ||
+        (function == &Marching_Cubes_Generator::estimate_density_private_histograms) ||
+        (function == &Marching_Cubes_Generator::estimate_density_incremental) ||
+        (function == &Marching_Cubes_Generator::save_particle_density_cells);
+    marching_cubes_parallel_for(this, function, number_of_elements, this->particle_system->number_of_threads, elements_are_particles,
+        this->parallel_region_statistics, this->get_region_name(function), "Marching_Cubes_Generator worker", this->particle_system->thread_pool);
+}
+
+const char* Marching_Cubes_Generator::get_region_name (void (Marching_Cubes_Generator::* function)(unsigned int, unsigned int))
+{
+    if (function == &Marching_Cubes_Generator::set_cube_index)              return "set_cube_index";
+    if (function == &Marching_Cubes_Generator::estimate_density_atomic)     return "estimate_density_atomic";
+    if (function == &Marching_Cubes_Generator::estimate_density_private_histograms) return "estimate_density_private_histograms";
+    if (function == &Marching_Cubes_Generator::merge_density_histograms)    return "merge_density_histograms";
+    if (function == &Marching_Cubes_Generator::estimate_density_incremental) return "estimate_density_incremental";
+    if (function == &Marching_Cubes_Generator::save_particle_density_cells) return "save_particle_density_cells";
+    if (function == &Marching_Cubes_Generator::sum_spatial_grid_cells)      return "sum_spatial_grid_cells";
+    if (function == &Marching_Cubes_Generator::count_spatial_grid_cells)    return "count_spatial_grid_cells";
+    if (function == &Marching_Cubes_Generator::calculate_dirty_vertex_values) return "calculate_dirty_vertex_values";
+    if (function == &Marching_Cubes_Generator::evaluate_color_field)        return "evaluate_color_field";
+    if (function == &Marching_Cubes_Generator::calculate_vertex_values)     return "calculate_vertex_values";
+    if (function == &Marching_Cubes_Generator::count_active_cubes)          return "count_active_cubes";
+    if (function == &Marching_Cubes_Generator::copy_active_cubes)           return "copy_active_cubes";
+    if (function == &Marching_Cubes_Generator::count_mesh_elements)         return "count_mesh_elements";
+    if (function == &Marching_Cubes_Generator::write_mesh)                  return "write_mesh";
+    return "unknown region";
+}
+
+int Marching_Cubes_Generator::get_number_of_chunks (int number_of_elements)
+{
+    return get_marching_cubes_number_of_chunks(this->particle_system->number_of_threads, number_of_elements);
+}
+
+int Marching_Cubes_Generator::get_chunk_index (unsigned int index_start, int number_of_elements)
+{
+    return get_marching_cubes_chunk_index(index_start, number_of_elements, this->particle_system->number_of_threads);
+}
+
+
+// ====================================== INITIALIZATION FUNCTIONS ======================================
+
+void Marching_Cubes_Generator::calculate_number_of_grid_cells ()
+{
+    // At first we calculate the number of cells for the density estimator.
+    // We add one cube row before and one cube behind the simulation space to have good surfaces.
+    // We need this to be sure to have density values of zero at the borders.
+    this->number_of_cells_x_density_estimator = ceil((this->particle_system->simulation_space->x_max - this->particle_system->simulation_space->x_min) / 
+        this->cube_edge_length) + 2;
+    this->number_of_cells_y_density_estimator = ceil((this->particle_system->simulation_space->y_max - this->particle_system->simulation_space->y_min) / 
+        this->cube_edge_length) + 2;
+    this->number_of_cells_z_density_estimator = ceil((this->particle_system->simulation_space->z_max - this->particle_system->simulation_space->z_min) / 
+        this->cube_edge_length) + 2;
+    this->number_of_cells_density_estimator = this->number_of_cells_x_density_estimator * 
+        this->number_of_cells_y_density_estimator * this->number_of_cells_z_density_estimator;
+    // Replace the density estimator spatial grid (a std::atomic cannot be moved, so the vector cannot be resized).
+    // The new cells are zero.
+    Tracked_Vector<std::atomic<int>, MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR>(this->number_of_cells_density_estimator).swap(this->density_estimator);
+    // The private histograms no longer fit the grid, they are allocated again when they are used.
+    Tracked_Vector<int, MEMORY_SUBSYSTEM_DENSITY_HISTOGRAMS>().swap(this->density_histograms);
+    this->number_of_density_histograms = 0;
+    // The same for the color field.
+    Tracked_Vector<float, MEMORY_SUBSYSTEM_COLOR_FIELD>().swap(this->color_field);
+    // The counts are zero, so the particles have to be counted again.
+    this->particle_density_cells.clear();
+    this->spatial_grid_counts_are_current = false;
+
+    // Now do the same for the marching cubes. The number of cells of the marching cubes in each axis is one less
+    // than the number of the cells of the density estimator since it is shifted half the cubes edge length and ends
+    // half the cubes edge length earlier.
+    this->number_of_cells_x_marching_cubes = this->number_of_cells_x_density_estimator - 1;
+    this->number_of_cells_y_marching_cubes = this->number_of_cells_y_density_estimator - 1;
+    this->number_of_cells_z_marching_cubes = this->number_of_cells_z_density_estimator - 1;
+    this->number_of_cells_marching_cubes = this->number_of_cells_x_marching_cubes * 
+        this->number_of_cells_y_marching_cubes * this->number_of_cells_z_marching_cubes;
+    // Reset and resize the spatial grid of the marching cubes.
+    this->marching_cubes.clear();
+    this->marching_cubes.resize(this->number_of_cells_marching_cubes);
+    this->active_marching_cubes.clear();
+    this->number_of_active_marching_cubes = 0;
+    this->marching_cube_is_dirty.assign(this->number_of_cells_marching_cubes, 0);
+    // The marching cubes are written by one thread each, so they do not need to be atomic.
+}
+
+inline int Marching_Cubes_Generator::discretize_value (float value)
+{
+    // The cells of our grid have the edge length of the marching cubes.
+    return (int)floor(value / this->cube_edge_length);
+}
+
+inline int Marching_Cubes_Generator::get_grid_key_density_estimator (glm::vec3 position)
+{
+    // We move the particles position into positive values and also a little bit more because we have 
+    // the outer cubes.
+    position = position + this->particle_system->particle_offset + glm::vec3(this->cube_edge_length);
+    // Check if the position is within the density estimator grids volume.
+    if ((position.x < 0.0f) || (position.x > this->number_of_cells_x_density_estimator * this->cube_edge_length) ||
+        (position.y < 0.0f) || (position.y > this->number_of_cells_y_density_estimator * this->cube_edge_length) ||
+        (position.z < 0.0f) || (position.z > this->number_of_cells_z_density_estimator * this->cube_edge_length)) {
+            return -1;
+    }
+    return
+        (Marching_Cubes_Generator::discretize_value(position.x)) +
+        (Marching_Cubes_Generator::discretize_value(position.y) * this->number_of_cells_x_density_estimator) +
+        (Marching_Cubes_Generator::discretize_value(position.z) * this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator);
+}
+
+
+inline glm::vec3 Marching_Cubes_Generator::get_position_from_grid_key_marching_cube (int grid_key)
+{
+    // Get the position index values in respective to the x, y and z coordinates.
+    int cell_index_x = grid_key % this->number_of_cells_x_marching_cubes;
+    int cell_index_y = (grid_key / this->number_of_cells_x_marching_cubes) % this->number_of_cells_y_marching_cubes;
+    int cell_index_z = grid_key / (this->number_of_cells_x_marching_cubes * this->number_of_cells_y_marching_cubes);
+    // From this calculate the position (the same calculation as in the vertex shaders).
+    glm::vec3 position = glm::vec3(
+        cell_index_x * this->cube_edge_length,
+        cell_index_y * this->cube_edge_length,
+        cell_index_z * this->cube_edge_length
+    );
+    return this->get_grid_origin() + position;
+}
+
+
+void Marching_Cubes_Generator::set_cube_index (unsigned int index_start, unsigned int index_end) 
+{
+    for (int idx_cell = index_start; idx_cell <= index_end; idx_cell++) {
+        this->marching_cubes.at(idx_cell).cube_index = idx_cell;
+    }
+}
+
+void Marching_Cubes_Generator::simulation_space_changed ()
+{
+    // To inform the "generate_marching_cubes" function that a resizing of the spatial grid is needed, we simply
+    // set the cube_edge_length to a negative value, because this will trigger the recalculation.
+    this->cube_edge_length = -1.0f;
+}
+
+// ====================================== MARCHING CUBE ALGORITHM ======================================
+
+
+Density_Estimation_Mode Marching_Cubes_Generator::choose_density_estimation_mode ()
+{
+    int number_of_threads = this->particle_system->number_of_threads;
+    if ((this->density_estimation_mode == DENSITY_ESTIMATION_AUTO) || (this->density_estimation_mode == DENSITY_ESTIMATION_SPATIAL_GRID)) {
+        // The spatial grid can only be used if both grids fit together. In the mode AUTO it is only used if the simulation
+        // built it for the current particles anyway (not in the brute force mode or after a replay for example).
+        if ((this->calculate_spatial_grid_ratio() == true) && ((this->density_estimation_mode == DENSITY_ESTIMATION_SPATIAL_GRID) ||
+            (this->particle_system->spatial_grid_is_current == true))) {
+            return DENSITY_ESTIMATION_SPATIAL_GRID;
+        }
+    }
+    else {
+        return this->density_estimation_mode;
+    }
+    // Counting a particle in a private histogram is cheaper than an atomic add (especially if many particles fall into
+    // the same cell), but merging the histograms costs one read per cell and thread. A single thread does not need a
+    // histogram at all, its atomic adds are never contended.
+    size_t number_of_histogram_cells = (size_t)this->number_of_cells_density_estimator * number_of_threads;
+    if ((number_of_threads > 1) && 
+        (number_of_histogram_cells <= (size_t)this->particle_system->number_of_particles * MARCHING_CUBES_HISTOGRAM_CELLS_PER_PARTICLE)) {
+        return DENSITY_ESTIMATION_PRIVATE_HISTOGRAMS;
+    }
+    return DENSITY_ESTIMATION_ATOMIC;
+}
+
+void Marching_Cubes_Generator::update_density_estimator ()
+{
+    int number_of_particles = this->particle_system->number_of_particles;
+    Density_Estimation_Mode density_estimation_mode = this->choose_density_estimation_mode();
+    if (density_estimation_mode == DENSITY_ESTIMATION_SPATIAL_GRID) {
+        this->estimate_density_spatial_grid();
+        return;
+    }
+    this->spatial_grid_counts_are_current = false;
+    if ((this->incremental_updates == true) && (number_of_particles > 0) && 
+        (this->particle_density_cells.size() == (size_t)number_of_particles)) {
+        // The counts are up to date for the cells saved last time, so only the particles that changed their cell are moved.
+        this->dirty_density_cells_per_chunk.resize(this->get_number_of_chunks(number_of_particles));
+        for (std::vector<int>& dirty_density_cells : this->dirty_density_cells_per_chunk) {
+            dirty_density_cells.clear();
+        }
+        this->parallel_for(&Marching_Cubes_Generator::estimate_density_incremental, number_of_particles);
+        this->update_all_vertex_values = false;
+        return;
+    }
+    // Count all particles.
+    this->update_all_vertex_values = true;
+    this->used_density_estimation_mode = density_estimation_mode;
+    if (this->incremental_updates == true) {
+        this->particle_density_cells.resize(number_of_particles);
+        this->parallel_for(&Marching_Cubes_Generator::save_particle_density_cells, number_of_particles);
+    }
+    else {
+        this->particle_density_cells.clear();
+    }
+    if (this->used_density_estimation_mode == DENSITY_ESTIMATION_ATOMIC) {
+        // The histograms are not needed anymore, do not keep their memory.
+        if (this->number_of_density_histograms > 0) {
+            Tracked_Vector<int, MEMORY_SUBSYSTEM_DENSITY_HISTOGRAMS>().swap(this->density_histograms);
+            this->number_of_density_histograms = 0;
+        }
+        // The particles are added to the counts of the last run, so reset them to zero.
+        std::fill(this->density_estimator.begin(), this->density_estimator.end(), 0);
+        this->parallel_for(&Marching_Cubes_Generator::estimate_density_atomic, this->particle_system->number_of_particles);
+        return;
+    }
+    // One histogram per chunk of the parallel for loop. They only have to be allocated if the number of threads changed
+    // (or the grid was resized), otherwise they are still zero from the last merge.
+    if (this->number_of_density_histograms != this->particle_system->number_of_threads) {
+        this->number_of_density_histograms = this->particle_system->number_of_threads;
+        this->density_histograms.assign((size_t)this->number_of_density_histograms * this->number_of_cells_density_estimator, 0);
+    }
+    this->parallel_for(&Marching_Cubes_Generator::estimate_density_private_histograms, this->particle_system->number_of_particles);
+    // The merge overwrites every cell of the density estimator, so it does not need to be reset.
+    this->parallel_for(&Marching_Cubes_Generator::merge_density_histograms, this->number_of_cells_density_estimator);
+}
+
+void Marching_Cubes_Generator::estimate_density_atomic (unsigned int index_start, unsigned int index_end)
+{
+    for (int i = index_start; i <= index_end; i++) {
+        // Assign the particle based on its position to a grid cell. Get the index of this cell.
+        int grid_key = this->get_grid_key_density_estimator(this->particle_system->particles.at(i).position);
+        // A particle outside of the grid of the density estimator is not counted (the same in all modes).
+        if (grid_key < 0) {
+            continue;
+        }
+        // Only the final count matters, the order of the increments does not, so a relaxed add is enough.
+        this->density_estimator[grid_key].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Marching_Cubes_Generator::estimate_density_private_histograms (unsigned int index_start, unsigned int index_end)
+{
+    // Every chunk has a histogram of its own.
+    int histogram_index = this->get_chunk_index(index_start, this->particle_system->number_of_particles);
+    int* histogram = this->density_histograms.data() + (size_t)histogram_index * this->number_of_cells_density_estimator;
+    for (int i = index_start; i <= index_end; i++) {
+        int grid_key = this->get_grid_key_density_estimator(this->particle_system->particles.at(i).position);
+        if (grid_key < 0) {
+            continue;
+        }
+        // No other thread writes into this histogram.
+        histogram[grid_key]++;
+    }
+}
+
+void Marching_Cubes_Generator::estimate_density_incremental (unsigned int index_start, unsigned int index_end)
+{
+    std::vector<int>& dirty_density_cells = this->dirty_density_cells_per_chunk.at(this->get_chunk_index(index_start, 
+        this->particle_system->number_of_particles));
+    for (int i = index_start; i <= index_end; i++) {
+        const Particle& particle = this->particle_system->particles.at(i);
+        int grid_key = this->get_grid_key_density_estimator(particle.position);
+        // The particles vector is reordered by the simulation, but the id of a particle stays the same.
+        int& previous_grid_key = this->particle_density_cells.at(particle.id);
+        if (grid_key == previous_grid_key) {
+            continue;
+        }
+        // A particle outside of the grid was not counted (grid key -1, see estimate_density_atomic).
+        if (previous_grid_key >= 0) {
+            this->density_estimator[previous_grid_key].fetch_sub(1, std::memory_order_relaxed);
+            dirty_density_cells.push_back(previous_grid_key);
+        }
+        if (grid_key >= 0) {
+            this->density_estimator[grid_key].fetch_add(1, std::memory_order_relaxed);
+            dirty_density_cells.push_back(grid_key);
+        }
+        previous_grid_key = grid_key;
+    }
+}
+
+void Marching_Cubes_Generator::save_particle_density_cells (unsigned int index_start, unsigned int index_end)
+{
+    for (int i = index_start; i <= index_end; i++) {
+        const Particle& particle = this->particle_system->particles.at(i);
+        this->particle_density_cells.at(particle.id) = this->get_grid_key_density_estimator(particle.position);
+    }
+}
+
+void Marching_Cubes_Generator::merge_density_histograms (unsigned int index_start, unsigned int index_end)
+{
+    for (int idx_cell = index_start; idx_cell <= index_end; idx_cell++) {
+        int number_of_particles_within = 0;
+        for (int i = 0; i < this->number_of_density_histograms; i++) {
+            int& count = this->density_histograms[(size_t)i * this->number_of_cells_density_estimator + idx_cell];
+            number_of_particles_within += count;
+            // Leave the histograms zero for the next run.
+            count = 0;
+        }
+        // Every cell is merged by exactly one thread.
+        this->density_estimator.at(idx_cell).store(number_of_particles_within, std::memory_order_relaxed);
+    }
+}
+
+bool Marching_Cubes_Generator::calculate_spatial_grid_ratio ()
+{
+    this->cells_per_spatial_grid_cell = 0;
+    this->spatial_grid_cells_per_cell = 0;
+    float kernel_radius = this->particle_system->sph_kernel_radius;
+    // The longer of both cells has to be a whole number of the shorter ones, otherwise a cell of the density estimator
+    // would only partly cover an SPH cell.
+    bool cubes_are_longer = this->cube_edge_length >= kernel_radius * (1.0f - MARCHING_CUBES_SPATIAL_GRID_RATIO_TOLERANCE);
+    float ratio = (cubes_are_longer == true) ? this->cube_edge_length / kernel_radius : kernel_radius / this->cube_edge_length;
+    float rounded_ratio = round(ratio);
+    if (std::abs(ratio - rounded_ratio) > MARCHING_CUBES_SPATIAL_GRID_RATIO_TOLERANCE * rounded_ratio) {
+        return false;
+    }
+    if (cubes_are_longer == true) {
+        this->spatial_grid_cells_per_cell = (int)rounded_ratio;
+    }
+    else {
+        this->cells_per_spatial_grid_cell = (int)rounded_ratio;
+    }
+    return true;
+}
+
+void Marching_Cubes_Generator::estimate_density_spatial_grid ()
+{
+    this->used_density_estimation_mode = DENSITY_ESTIMATION_SPATIAL_GRID;
+    // The cells of the particles are not needed, the dirty cells are found by comparing the counts.
+    this->particle_density_cells.clear();
+    // The mode may be forced while the grid does not hold the current particles (e.g. in the brute force mode).
+    this->particle_system->update_spatial_grid();
+    // The cells in front of and behind the spatial grid are never written, so they have to be zero. After that, every
+    // cell can be compared with its count of the last estimation.
+    this->collect_dirty_density_cells = (this->incremental_updates == true) && (this->spatial_grid_counts_are_current == true);
+    if (this->spatial_grid_counts_are_current == false) {
+        std::fill(this->density_estimator.begin(), this->density_estimator.end(), 0);
+    }
+    void (Marching_Cubes_Generator::* function)(unsigned int, unsigned int) = &Marching_Cubes_Generator::sum_spatial_grid_cells;
+    int number_of_elements = this->number_of_cells_density_estimator;
+    if (this->cells_per_spatial_grid_cell > 1) {
+        function = &Marching_Cubes_Generator::count_spatial_grid_cells;
+        number_of_elements = this->particle_system->number_of_cells;
+        this->spatial_grid_block_counts_per_chunk.resize(this->get_number_of_chunks(number_of_elements));
+    }
+    this->dirty_density_cells_per_chunk.resize(this->get_number_of_chunks(number_of_elements));
+    for (std::vector<int>& dirty_density_cells : this->dirty_density_cells_per_chunk) {
+        dirty_density_cells.clear();
+    }
+    this->parallel_for(function, number_of_elements);
+    this->update_all_vertex_values = (this->collect_dirty_density_cells == false);
+    this->spatial_grid_counts_are_current = true;
+}
+
+inline void Marching_Cubes_Generator::set_density_count (int grid_key, int count, std::vector<int>& dirty_density_cells)
+{
+    // Every cell is written by one thread only.
+    std::atomic<int>& cell = this->density_estimator[grid_key];
+    if ((this->collect_dirty_density_cells == true) && (cell.load(std::memory_order_relaxed) != count)) {
+        dirty_density_cells.push_back(grid_key);
+    }
+    cell.store(count, std::memory_order_relaxed);
+}
+
+void Marching_Cubes_Generator::sum_spatial_grid_cells (unsigned int index_start, unsigned int index_end)
+{
+    Particle_System& particle_system = *this->particle_system;
+    std::vector<int>& dirty_density_cells = this->dirty_density_cells_per_chunk.at(this->get_chunk_index(index_start, 
+        this->number_of_cells_density_estimator));
+    int ratio = this->spatial_grid_cells_per_cell;
+    for (int idx_cell = index_start; idx_cell <= index_end; idx_cell++) {
+        int x = idx_cell % this->number_of_cells_x_density_estimator;
+        int y = (idx_cell / this->number_of_cells_x_density_estimator) % this->number_of_cells_y_density_estimator;
+        int z = idx_cell / (this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator);
+        // The first cell lies in front of the spatial grid, the cell x covers the SPH cells (x - 1) * ratio to x * ratio - 1
+        // (the last cells may reach beyond the spatial grid).
+        int count = 0;
+        int grid_z_end = std::min(z * ratio, particle_system.number_of_cells_z);
+        int grid_y_end = std::min(y * ratio, particle_system.number_of_cells_y);
+        int grid_x_end = std::min(x * ratio, particle_system.number_of_cells_x);
+        for (int grid_z = std::max(0, (z - 1) * ratio); grid_z < grid_z_end; grid_z++) {
+            for (int grid_y = std::max(0, (y - 1) * ratio); grid_y < grid_y_end; grid_y++) {
+                int offset_yz = (grid_z * particle_system.number_of_cells_y + grid_y) * particle_system.number_of_cells_x;
+                for (int grid_x = std::max(0, (x - 1) * ratio); grid_x < grid_x_end; grid_x++) {
+                    count += particle_system.spatial_grid[offset_yz + grid_x].size();
+                }
+            }
+        }
+        this->set_density_count(idx_cell, count, dirty_density_cells);
+    }
+}
+
+void Marching_Cubes_Generator::count_spatial_grid_cells (unsigned int index_start, unsigned int index_end)
+{
+    Particle_System& particle_system = *this->particle_system;
+    int chunk_index = this->get_chunk_index(index_start, particle_system.number_of_cells);
+    std::vector<int>& dirty_density_cells = this->dirty_density_cells_per_chunk.at(chunk_index);
+    int ratio = this->cells_per_spatial_grid_cell;
+    std::vector<int>& block_counts = this->spatial_grid_block_counts_per_chunk.at(chunk_index);
+    block_counts.resize(ratio * ratio * ratio);
+    for (int grid_key = index_start; grid_key <= index_end; grid_key++) {
+        int grid_x = grid_key % particle_system.number_of_cells_x;
+        int grid_y = (grid_key / particle_system.number_of_cells_x) % particle_system.number_of_cells_y;
+        int grid_z = grid_key / (particle_system.number_of_cells_x * particle_system.number_of_cells_y);
+        // Count the particles into the block of cells of the SPH cell. The cell is calculated like in the other modes (the
+        // density estimator starts one cell earlier), so a particle on the border of two cells ends up in the same cell. A
+        // particle that left the SPH cell within the last step is counted in the closest cell of the block.
+        std::fill(block_counts.begin(), block_counts.end(), 0);
+        for (const Particle& particle : particle_system.spatial_grid[grid_key]) {
+            glm::vec3 position = particle.position + particle_system.particle_offset + glm::vec3(this->cube_edge_length);
+            int block_x = std::clamp(this->discretize_value(position.x) - 1 - grid_x * ratio, 0, ratio - 1);
+            int block_y = std::clamp(this->discretize_value(position.y) - 1 - grid_y * ratio, 0, ratio - 1);
+            int block_z = std::clamp(this->discretize_value(position.z) - 1 - grid_z * ratio, 0, ratio - 1);
+            block_counts[block_x + block_y * ratio + block_z * ratio * ratio]++;
+        }
+        // The block starts one cell later in the density estimator (it has one cell in front of the simulation space).
+        // The last SPH cells may reach beyond the density estimator, but no particle is counted there.
+        for (int block_z = 0; block_z < ratio; block_z++) {
+            int z = grid_z * ratio + block_z + 1;
+            for (int block_y = 0; block_y < ratio; block_y++) {
+                int y = grid_y * ratio + block_y + 1;
+                for (int block_x = 0; block_x < ratio; block_x++) {
+                    int x = grid_x * ratio + block_x + 1;
+                    if ((x >= this->number_of_cells_x_density_estimator) || (y >= this->number_of_cells_y_density_estimator) ||
+                        (z >= this->number_of_cells_z_density_estimator)) {
+                        continue;
+                    }
+                    this->set_density_count(x + y * this->number_of_cells_x_density_estimator + 
+                        z * this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator, 
+                        block_counts[block_x + block_y * ratio + block_z * ratio * ratio], dirty_density_cells);
+                }
+            }
+        }
+    }
+}
+
+void Marching_Cubes_Generator::update_color_field ()
+{
+    // Allocate the color field if it was not used before (or the grid was resized). Every cell is overwritten.
+    if (this->color_field.size() != (size_t)this->number_of_cells_density_estimator) {
+        this->color_field.assign(this->number_of_cells_density_estimator, 0.0f);
+    }
+    // The neighbor search needs the spatial grid of the particle system. After a step of the simulation with the
+    // spatial grid this does nothing.
+    this->particle_system->update_spatial_grid();
+    // The poly6 kernel like in the simulation, but with the radius of the color field. Inside of the fluid the sum of the
+    // kernel times the volume of a particle is about one.
+    float radius = this->particle_system->sph_kernel_radius * MARCHING_CUBES_COLOR_FIELD_RADIUS_FACTOR;
+    float particle_volume = pow(this->particle_system->get_particle_initial_distance(), 3);
+    this->color_field_radius_squared = radius * radius;
+    this->color_field_coefficient = particle_volume * 315.0f / (64.0f * M_PI * pow(radius, 9));
+    this->parallel_for(&Marching_Cubes_Generator::evaluate_color_field, this->number_of_cells_density_estimator);
+}
+
+void Marching_Cubes_Generator::evaluate_color_field (unsigned int index_start, unsigned int index_end)
+{
+    Particle_System& particle_system = *this->particle_system;
+    // The cells of the density estimator are the vertices of the marching cubes (see create_edge_vertex).
+    glm::vec3 origin = -particle_system.particle_offset - glm::vec3(this->cube_edge_length / 2);
+    for (int idx_cell = index_start; idx_cell <= index_end; idx_cell++) {
+        int x = idx_cell % this->number_of_cells_x_density_estimator;
+        int y = (idx_cell / this->number_of_cells_x_density_estimator) % this->number_of_cells_y_density_estimator;
+        int z = idx_cell / (this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator);
+        glm::vec3 position = origin + this->cube_edge_length * glm::vec3(x, y, z);
+        // The cell of the spatial grid the position is in. The density estimator overlaps the simulation space, so the
+        // cell may be outside of the spatial grid, but its neighbors may not.
+        glm::vec3 grid_position = (position + particle_system.particle_offset) / particle_system.sph_kernel_radius;
+        int grid_x = (int)floor(grid_position.x);
+        int grid_y = (int)floor(grid_position.y);
+        int grid_z = (int)floor(grid_position.z);
+        float value = 0.0f;
+        for (int look_z = std::max(grid_z - 1, 0); look_z <= std::min(grid_z + 1, particle_system.number_of_cells_z - 1); look_z++) {
+            for (int look_y = std::max(grid_y - 1, 0); look_y <= std::min(grid_y + 1, particle_system.number_of_cells_y - 1); look_y++) {
+                for (int look_x = std::max(grid_x - 1, 0); look_x <= std::min(grid_x + 1, particle_system.number_of_cells_x - 1); look_x++) {
+                    int grid_key = look_x + look_y * particle_system.number_of_cells_x + 
+                        look_z * particle_system.number_of_cells_x * particle_system.number_of_cells_y;
+                    for (const Particle& particle : particle_system.spatial_grid[grid_key]) {
+                        glm::vec3 distance_vector = position - particle.position;
+                        float distance_squared = glm::dot(distance_vector, distance_vector);
+                        if (distance_squared < this->color_field_radius_squared) {
+                            float difference = this->color_field_radius_squared - distance_squared;
+                            value += difference * difference * difference;
+                        }
+                    }
+                }
+            }
+        }
+        // Every cell is written by one thread only.
+        this->color_field[idx_cell] = this->color_field_coefficient * value;
+    }
+}
+
+void Marching_Cubes_Generator::update_scalar_field ()
+{
+    this->used_scalar_field_mode = this->scalar_field_mode;
+    if (this->used_scalar_field_mode == SCALAR_FIELD_COLOR_FIELD) {
+        // Every movement of a particle changes the color field, so all vertex values are calculated. The counts of the
+        // density estimator are no longer kept up to date.
+        this->particle_density_cells.clear();
+        this->spatial_grid_counts_are_current = false;
+        this->update_all_vertex_values = true;
+        this->update_color_field();
+        return;
+    }
+    // The color field is not needed anymore, do not keep its memory.
+    if (this->color_field.empty() == false) {
+        Tracked_Vector<float, MEMORY_SUBSYSTEM_COLOR_FIELD>().swap(this->color_field);
+    }
+    this->update_density_estimator();
+}
+
+inline float Marching_Cubes_Generator::get_field_value (int grid_key)
+{
+    if (this->used_scalar_field_mode == SCALAR_FIELD_COLOR_FIELD) {
+        return this->color_field[grid_key];
+    }
+    return (float)this->density_estimator[grid_key].load(std::memory_order_relaxed);
+}
+
+inline unsigned short Marching_Cubes_Generator::get_vertex_value (int grid_key)
+{
+    return float_to_half(this->get_field_value(grid_key));
+}
+
+void Marching_Cubes_Generator::calculate_vertex_values (unsigned int index_start, unsigned int index_end)
+{
+    // We will look into the density estimator for all the vertices of the cube. How the vertices are indexed is 
+    // shown here. It is important to keep this indexing since we will use the same in the geometry shader for the
+    // marching cubes algorithm.
+    //
+    //        4 +--------+ 5
+    //         /|       /|
+    //        / |      / |
+    //     7 +--------+ 6|
+    //       |  |     |  |
+    //       |0 +-----|--+ 1
+    //       | /      | /
+    //       |/       |/
+    //     3 +--------+ 2
+
+    int number_of_cells_xy_density_estimator = this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator;
+    int idx_cell = index_start;
+    while (idx_cell <= (int)index_end) {
+        int x = idx_cell % this->number_of_cells_x_marching_cubes;
+        int y = (idx_cell / this->number_of_cells_x_marching_cubes) % this->number_of_cells_y_marching_cubes;
+        int z = idx_cell / (this->number_of_cells_x_marching_cubes * this->number_of_cells_y_marching_cubes);
+        // The last cube of this row within the range.
+        int idx_row_end = std::min((int)index_end, idx_cell + this->number_of_cells_x_marching_cubes - 1 - x);
+        // The grid keys of the cells (x, y, z), (x, y + 1, z), (x, y, z + 1) and (x, y + 1, z + 1). The density estimator has
+        // one cell more than the marching cubes along every axis, so the cells at x + 1, y + 1 and z + 1 always exist.
+        int key = x + y * this->number_of_cells_x_density_estimator + z * number_of_cells_xy_density_estimator;
+        int key_y = key + this->number_of_cells_x_density_estimator;
+        int key_z = key + number_of_cells_xy_density_estimator;
+        int key_yz = key_y + number_of_cells_xy_density_estimator;
+        // The values of the left face of the first cube.
+        unsigned short value = this->get_vertex_value(key);
+        unsigned short value_y = this->get_vertex_value(key_y);
+        unsigned short value_z = this->get_vertex_value(key_z);
+        unsigned short value_yz = this->get_vertex_value(key_yz);
+        for (; idx_cell <= idx_row_end; idx_cell++) {
+            key++;
+            key_y++;
+            key_z++;
+            key_yz++;
+            // The values of the right face.
+            unsigned short value_x = this->get_vertex_value(key);
+            unsigned short value_xy = this->get_vertex_value(key_y);
+            unsigned short value_xz = this->get_vertex_value(key_z);
+            unsigned short value_xyz = this->get_vertex_value(key_yz);
+            unsigned short* vertex_values = this->marching_cubes[idx_cell].vertex_values;
+            vertex_values[0] = value;
+            vertex_values[1] = value_x;
+            vertex_values[2] = value_xz;
+            vertex_values[3] = value_z;
+            vertex_values[4] = value_y;
+            vertex_values[5] = value_xy;
+            vertex_values[6] = value_xyz;
+            vertex_values[7] = value_yz;
+            // The right face is the left face of the next cube.
+            value = value_x;
+            value_y = value_xy;
+            value_z = value_xz;
+            value_yz = value_xyz;
+        }
+    }
+}
+
+void Marching_Cubes_Generator::calculate_dirty_vertex_values (unsigned int index_start, unsigned int index_end)
+{
+    int i = index_start;
+    while (i <= (int)index_end) {
+        // Find the end of the run of consecutive cubes.
+        int i_end = i;
+        while ((i_end < (int)index_end) && (this->dirty_marching_cubes[i_end + 1] == this->dirty_marching_cubes[i_end] + 1)) {
+            i_end++;
+        }
+        this->calculate_vertex_values(this->dirty_marching_cubes[i], this->dirty_marching_cubes[i_end]);
+        i = i_end + 1;
+    }
+}
+
+void Marching_Cubes_Generator::update_vertex_values ()
+{
+    if (this->update_all_vertex_values == false) {
+        // Collect the cubes that have a dirty cell as one of their vertices. A cell is a vertex of the (up to) eight cubes
+        // with the same index or an index one less in every axis (see get_position_from_grid_key_marching_cube).
+        this->dirty_marching_cubes.clear();
+        int max_number_of_dirty_cubes = (int)(MARCHING_CUBES_INCREMENTAL_MAX_DIRTY_FRACTION * this->number_of_cells_marching_cubes);
+        for (const std::vector<int>& dirty_density_cells : this->dirty_density_cells_per_chunk) {
+            for (int grid_key : dirty_density_cells) {
+                int x = grid_key % this->number_of_cells_x_density_estimator;
+                int y = (grid_key / this->number_of_cells_x_density_estimator) % this->number_of_cells_y_density_estimator;
+                int z = grid_key / (this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator);
+                for (int cube_z = std::max(z - 1, 0); cube_z <= std::min(z, this->number_of_cells_z_marching_cubes - 1); cube_z++) {
+                    for (int cube_y = std::max(y - 1, 0); cube_y <= std::min(y, this->number_of_cells_y_marching_cubes - 1); cube_y++) {
+                        for (int cube_x = std::max(x - 1, 0); cube_x <= std::min(x, this->number_of_cells_x_marching_cubes - 1); cube_x++) {
+                            int idx_cell = cube_x + cube_y * this->number_of_cells_x_marching_cubes + 
+                                cube_z * this->number_of_cells_x_marching_cubes * this->number_of_cells_y_marching_cubes;
+                            if (this->marching_cube_is_dirty[idx_cell] == 0) {
+                                this->marching_cube_is_dirty[idx_cell] = 1;
+                                this->dirty_marching_cubes.push_back(idx_cell);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        for (int idx_cell : this->dirty_marching_cubes) {
+            this->marching_cube_is_dirty[idx_cell] = 0;
+        }
+        // Too many cubes changed, then one pass over all cubes is cheaper.
+        this->update_all_vertex_values = (int)this->dirty_marching_cubes.size() > max_number_of_dirty_cubes;
+    }
+    if (this->update_all_vertex_values == true) {
+        this->parallel_for(&Marching_Cubes_Generator::calculate_vertex_values, this->number_of_cells_marching_cubes);
+        this->number_of_updated_marching_cubes = this->number_of_cells_marching_cubes;
+    }
+    else {
+        // Walk through the cubes in the order of the grid.
+        std::sort(this->dirty_marching_cubes.begin(), this->dirty_marching_cubes.end());
+        this->parallel_for(&Marching_Cubes_Generator::calculate_dirty_vertex_values, this->dirty_marching_cubes.size());
+        this->number_of_updated_marching_cubes = this->dirty_marching_cubes.size();
+    }
+    this->vertex_values_changed |= (this->number_of_updated_marching_cubes > 0);
+}
+
+inline bool Marching_Cubes_Generator::is_active_cube (const Marching_Cube& marching_cube)
+{
+    // The geometry shader sets a bit of the cube index for every vertex below the isovalue. The cube produces triangles
+    // if the index is neither 0 nor 255, so if the smallest value is below and the largest value is not.
+    const unsigned short* vertex_values = marching_cube.vertex_values;
+    unsigned short min_value = std::min({ vertex_values[0], vertex_values[1], vertex_values[2], vertex_values[3], 
+        vertex_values[4], vertex_values[5], vertex_values[6], vertex_values[7] });
+    unsigned short max_value = std::max({ vertex_values[0], vertex_values[1], vertex_values[2], vertex_values[3], 
+        vertex_values[4], vertex_values[5], vertex_values[6], vertex_values[7] });
+    return (min_value < this->isovalue_threshold) && (max_value >= this->isovalue_threshold);
+}
+
+bool Marching_Cubes_Generator::compact_active_cubes ()
+{
+    // Neither the cubes nor the test changed, so the active cubes are the same as before.
+    if ((this->vertex_values_changed == false) && (this->isovalue == this->compacted_isovalue)) {
+        this->changed_active_cubes_begin = 0;
+        this->changed_active_cubes_end = 0;
+        return false;
+    }
+    this->previous_number_of_active_marching_cubes = this->number_of_active_marching_cubes;
+    // The smallest half float that is not below the isovalue (see is_active_cube). The nearest half float is at most
+    // one step too small.
+    this->isovalue_threshold = float_to_half(this->isovalue);
+    if (half_to_float(this->isovalue_threshold) < this->isovalue) {
+        this->isovalue_threshold++;
+    }
+    // Count the active cubes of every chunk.
+    this->number_of_active_cubes_per_chunk.assign(this->get_number_of_chunks(this->number_of_cells_marching_cubes), 0);
+    this->parallel_for(&Marching_Cubes_Generator::count_active_cubes, this->number_of_cells_marching_cubes);
+    // The exclusive prefix sum over the chunks. There is only one value per thread, so it is not worth to parallelize it.
+    this->active_cubes_offset_per_chunk.resize(this->number_of_active_cubes_per_chunk.size());
+    this->number_of_active_marching_cubes = 0;
+    for (unsigned int i = 0; i < this->number_of_active_cubes_per_chunk.size(); i++) {
+        this->active_cubes_offset_per_chunk.at(i) = this->number_of_active_marching_cubes;
+        this->number_of_active_marching_cubes += this->number_of_active_cubes_per_chunk.at(i);
+    }
+    // The vector keeps its capacity, so it only allocates if the surface grows beyond its largest size so far.
+    this->active_marching_cubes.resize(this->number_of_active_marching_cubes);
+    // Every chunk copies its active cubes to its offset (in the same order as in the grid) and remembers the range of
+    // the ones that differ from the cubes at the same position before.
+    int number_of_chunks = this->get_number_of_chunks(this->number_of_cells_marching_cubes);
+    this->changed_active_cubes_begin_per_chunk.assign(number_of_chunks, INT_MAX);
+    this->changed_active_cubes_end_per_chunk.assign(number_of_chunks, 0);
+    this->parallel_for(&Marching_Cubes_Generator::copy_active_cubes, this->number_of_cells_marching_cubes);
+    this->changed_active_cubes_begin = *std::min_element(this->changed_active_cubes_begin_per_chunk.begin(), 
+        this->changed_active_cubes_begin_per_chunk.end());
+    this->changed_active_cubes_end = *std::max_element(this->changed_active_cubes_end_per_chunk.begin(), 
+        this->changed_active_cubes_end_per_chunk.end());
+    if (this->changed_active_cubes_begin >= this->changed_active_cubes_end) {
+        this->changed_active_cubes_begin = 0;
+        this->changed_active_cubes_end = 0;
+    }
+    this->vertex_values_changed = false;
+    this->compacted_isovalue = this->isovalue;
+    // The number of active cubes may have changed even if no copied cube did (if the last ones were removed).
+    return (this->changed_active_cubes_end > 0) || (this->number_of_active_marching_cubes != this->previous_number_of_active_marching_cubes);
+}
+
+void Marching_Cubes_Generator::count_active_cubes (unsigned int index_start, unsigned int index_end)
+{
+    int number_of_active_cubes = 0;
+    for (int idx_cell = index_start; idx_cell <= index_end; idx_cell++) {
+        if (this->is_active_cube(this->marching_cubes[idx_cell]) == true) {
+            number_of_active_cubes++;
+        }
+    }
+    this->number_of_active_cubes_per_chunk.at(this->get_chunk_index(index_start, this->number_of_cells_marching_cubes)) = number_of_active_cubes;
+}
+
+void Marching_Cubes_Generator::copy_active_cubes (unsigned int index_start, unsigned int index_end)
+{
+    int chunk_index = this->get_chunk_index(index_start, this->number_of_cells_marching_cubes);
+    int idx_active_cube = this->active_cubes_offset_per_chunk.at(chunk_index);
+    int changed_begin = INT_MAX;
+    int changed_end = 0;
+    for (int idx_cell = index_start; idx_cell <= index_end; idx_cell++) {
+        if (this->is_active_cube(this->marching_cubes[idx_cell]) == true) {
+            // Only write (and upload) the cubes that differ. The cubes behind the old end were never uploaded.
+            if ((idx_active_cube >= this->previous_number_of_active_marching_cubes) ||
+                (std::memcmp(&this->active_marching_cubes[idx_active_cube], &this->marching_cubes[idx_cell], sizeof(Marching_Cube)) != 0)) {
+                this->active_marching_cubes[idx_active_cube] = this->marching_cubes[idx_cell];
+                changed_begin = std::min(changed_begin, idx_active_cube);
+                changed_end = idx_active_cube + 1;
+            }
+            idx_active_cube++;
+        }
+    }
+    this->changed_active_cubes_begin_per_chunk.at(chunk_index) = changed_begin;
+    this->changed_active_cubes_end_per_chunk.at(chunk_index) = changed_end;
+}
+
+void Marching_Cubes_Generator::generate_marching_cubes ()
+{
+    TRACE_SCOPE("Marching_Cubes_Generator::generate_marching_cubes");
+    // Check if the new resolution is different from before. If so, also resize the density estimator.
+    if (this->new_cube_edge_length < 0.0f) {
+        std::cout << "ERROR: Set the cube edge length for the marching cubes algorithm first." << std::endl;
+        return;
+    }
+    if ((floats_are_same(this->cube_edge_length, this->new_cube_edge_length, MARCHING_CUBES_CUBE_EDGE_LENGTH_STEP) == false) &&
+        (this->cube_edge_length > 0.0f) && (this->fits_into_memory_budget(this->new_cube_edge_length) == false)) {
+        // Keep the grid we have (a new scene was already checked with the edge length, see Simulation_Handler::load_scene).
+        std::cout << "The marching cubes with a grid size of " << this->new_cube_edge_length << " exceed the memory budget. "
+            << "Keeping the grid size of " << this->cube_edge_length << "." << std::endl;
+        this->new_cube_edge_length = this->cube_edge_length;
+    }
+    if (floats_are_same(this->cube_edge_length, this->new_cube_edge_length, MARCHING_CUBES_CUBE_EDGE_LENGTH_STEP) == false) {
+        // The cube length changed. Calculate the new number of cells. 
+        // This call also replaces the density estimator, therefore it makes sense to only do it if the values changed.
+        this->cube_edge_length = this->new_cube_edge_length;
+        this->calculate_number_of_grid_cells();
+        // The marching cubes vector was resized and refilled with empty marching cubes. These no longer hold
+        // information about their position in space, so we need to update this once.
+        this->parallel_for(&Marching_Cubes_Generator::set_cube_index, this->number_of_cells_marching_cubes);
+        // Since we cleared the whole marching cubes grid we do not need to reset the information stored within these
+    }
+    // Calculate the scalar field (the number of particles within each cube or the color field). The values of the last
+    // run are overwritten by this call.
+    {
+        TRACE_SCOPE("Marching_Cubes_Generator::update_scalar_field");
+        this->update_scalar_field();
+    }
+    // Now update the vertex values of the cubes (all or only the dirty ones). Every cube is written by one thread only.
+    {
+        TRACE_SCOPE("Marching_Cubes_Generator::update_vertex_values");
+        this->update_vertex_values();
+    }
+    // Only the cubes the surface passes through are uploaded and drawn.
+    bool active_cubes_changed;
+    {
+        TRACE_SCOPE("Marching_Cubes_Generator::compact_active_cubes");
+        active_cubes_changed = this->compact_active_cubes();
+    }
+    // If the data changed, inform the renderer to update the data.
+    if (active_cubes_changed == true) {
+        this->generation++;
+    }
+}
+
+
+// ====================================== MESH EXTRACTION ======================================
+
+inline float Marching_Cubes_Generator::get_field_value (int x, int y, int z)
+{
+    return this->get_field_value(x + y * this->number_of_cells_x_density_estimator + 
+        z * this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator);
+}
+
+inline bool Marching_Cubes_Generator::is_crossing_edge (int x, int y, int z, int axis)
+{
+    // The same test as for the cube index: is one of the vertices below the isovalue and the other one not?
+    float value_a = this->get_field_value(x, y, z);
+    float value_b = this->get_field_value(x + (axis == 0), y + (axis == 1), z + (axis == 2));
+    return (value_a < this->isovalue) != (value_b < this->isovalue);
+}
+
+void Marching_Cubes_Generator::create_edge_vertex (int x, int y, int z, int axis, int vertex_index)
+{
+    // The cells of the density estimator are the vertices of the marching cubes, so their position is the min corner
+    // of the marching cube with the same index (see get_position_from_grid_key_marching_cube).
+    auto get_field_value = [this] (int x, int y, int z) { return this->get_field_value(x, y, z); };
+    this->mesh.positions[vertex_index] = create_marching_cubes_edge_vertex(get_field_value, x, y, z, axis,
+        this->number_of_cells_x_density_estimator, this->number_of_cells_y_density_estimator, this->number_of_cells_z_density_estimator,
+        this->get_grid_origin(), this->cube_edge_length, this->isovalue, this->mesh.normals[vertex_index]);
+}
+
+void Marching_Cubes_Generator::process_edge_layer_xy (int z, int* edge_cache_x, int* edge_cache_y, int& next_vertex_index, bool create_vertices)
+{
+    // The order has to be the same for all threads (see the description in the header).
+    for (int y = 0; y < this->number_of_cells_y_density_estimator; y++) {
+        for (int x = 0; x < this->number_of_cells_x_density_estimator; x++) {
+            int cell = x + y * this->number_of_cells_x_density_estimator;
+            if ((x < this->number_of_cells_x_density_estimator - 1) && (this->is_crossing_edge(x, y, z, 0) == true)) {
+                edge_cache_x[cell] = next_vertex_index;
+                if (create_vertices == true) {
+                    this->create_edge_vertex(x, y, z, 0, next_vertex_index);
+                }
+                next_vertex_index++;
+            }
+            if ((y < this->number_of_cells_y_density_estimator - 1) && (this->is_crossing_edge(x, y, z, 1) == true)) {
+                edge_cache_y[cell] = next_vertex_index;
+                if (create_vertices == true) {
+                    this->create_edge_vertex(x, y, z, 1, next_vertex_index);
+                }
+                next_vertex_index++;
+            }
+        }
+    }
+}
+
+void Marching_Cubes_Generator::process_edge_layer_z (int z, int* edge_cache_z, int& next_vertex_index)
+{
+    for (int y = 0; y < this->number_of_cells_y_density_estimator; y++) {
+        for (int x = 0; x < this->number_of_cells_x_density_estimator; x++) {
+            if (this->is_crossing_edge(x, y, z, 2) == true) {
+                edge_cache_z[x + y * this->number_of_cells_x_density_estimator] = next_vertex_index;
+                this->create_edge_vertex(x, y, z, 2, next_vertex_index);
+                next_vertex_index++;
+            }
+        }
+    }
+}
+
+void Marching_Cubes_Generator::count_mesh_elements (unsigned int index_start, unsigned int index_end)
+{
+    int number_of_vertices = 0;
+    int number_of_triangles = 0;
+    for (int z = index_start; z <= index_end; z++) {
+        // The vertices this slab owns (see the description in the header).
+        bool is_last_slab = (z == this->number_of_cells_z_marching_cubes - 1);
+        for (int y = 0; y < this->number_of_cells_y_density_estimator; y++) {
+            for (int x = 0; x < this->number_of_cells_x_density_estimator; x++) {
+                bool has_edge_x = (x < this->number_of_cells_x_density_estimator - 1);
+                bool has_edge_y = (y < this->number_of_cells_y_density_estimator - 1);
+                number_of_vertices += (has_edge_x == true) && (this->is_crossing_edge(x, y, z, 0) == true);
+                number_of_vertices += (has_edge_y == true) && (this->is_crossing_edge(x, y, z, 1) == true);
+                number_of_vertices += this->is_crossing_edge(x, y, z, 2);
+                if (is_last_slab == true) {
+                    number_of_vertices += (has_edge_x == true) && (this->is_crossing_edge(x, y, z + 1, 0) == true);
+                    number_of_vertices += (has_edge_y == true) && (this->is_crossing_edge(x, y, z + 1, 1) == true);
+                }
+            }
+        }
+        // The triangles of the cubes of this slab.
+        for (int y = 0; y < this->number_of_cells_y_marching_cubes; y++) {
+            for (int x = 0; x < this->number_of_cells_x_marching_cubes; x++) {
+                int cube_index = 0;
+                for (int vertex = 0; vertex < 8; vertex++) {
+                    if (this->get_field_value(x + marching_cubes_vertex_offsets[vertex][0], y + marching_cubes_vertex_offsets[vertex][1], 
+                        z + marching_cubes_vertex_offsets[vertex][2]) < this->isovalue) {
+                        cube_index |= (1 << vertex);
+                    }
+                }
+                for (int i = 0; (i < 15) && (marching_cubes_triangle_table[cube_index][i] != -1); i += 3) {
+                    number_of_triangles++;
+                }
+            }
+        }
+    }
+    int chunk_index = this->get_chunk_index(index_start, this->number_of_cells_z_marching_cubes);
+    this->number_of_mesh_vertices_per_chunk.at(chunk_index) = number_of_vertices;
+    this->number_of_mesh_triangles_per_chunk.at(chunk_index) = number_of_triangles;
+}
+
+void Marching_Cubes_Generator::write_mesh (unsigned int index_start, unsigned int index_end)
+{
+    int chunk_index = this->get_chunk_index(index_start, this->number_of_cells_z_marching_cubes);
+    int number_of_cells_layer = this->number_of_cells_x_density_estimator * this->number_of_cells_y_density_estimator;
+    Tracked_Vector<int, MEMORY_SUBSYSTEM_MARCHING_CUBES_MESH>& edge_cache = this->edge_caches.at(chunk_index);
+    edge_cache.resize(5 * number_of_cells_layer);
+    int* bottom_x = edge_cache.data();
+    int* bottom_y = bottom_x + number_of_cells_layer;
+    int* top_x = bottom_y + number_of_cells_layer;
+    int* top_y = top_x + number_of_cells_layer;
+    int* edge_cache_z = top_y + number_of_cells_layer;
+    int next_vertex_index = this->mesh_vertex_offset_per_chunk.at(chunk_index);
+    unsigned int* indices = this->mesh.indices.data() + 3 * (size_t)this->mesh_triangle_offset_per_chunk.at(chunk_index);
+    // The bottom layer of the first slab belongs to this chunk.
+    this->process_edge_layer_xy(index_start, bottom_x, bottom_y, next_vertex_index, true);
+    for (int z = index_start; z <= index_end; z++) {
+        this->process_edge_layer_z(z, edge_cache_z, next_vertex_index);
+        if ((z < index_end) || (z == this->number_of_cells_z_marching_cubes - 1)) {
+            this->process_edge_layer_xy(z + 1, top_x, top_y, next_vertex_index, true);
+        }
+        else {
+            // The top layer of the last slab belongs to the next chunk, which starts its vertices with this layer.
+            int next_chunk_vertex_index = this->mesh_vertex_offset_per_chunk.at(chunk_index + 1);
+            this->process_edge_layer_xy(z + 1, top_x, top_y, next_chunk_vertex_index, false);
+        }
+        // Create the triangles of the cubes of this slab from the vertices in the edge cache.
+        for (int y = 0; y < this->number_of_cells_y_marching_cubes; y++) {
+            for (int x = 0; x < this->number_of_cells_x_marching_cubes; x++) {
+                int cube_index = 0;
+                for (int vertex = 0; vertex < 8; vertex++) {
+                    if (this->get_field_value(x + marching_cubes_vertex_offsets[vertex][0], y + marching_cubes_vertex_offsets[vertex][1], 
+                        z + marching_cubes_vertex_offsets[vertex][2]) < this->isovalue) {
+                        cube_index |= (1 << vertex);
+                    }
+                }
+                if (marching_cubes_edge_table[cube_index] == 0) {
+                    continue;
+                }
+                // Look up the vertex of every edge of the cube the surface passes through.
+                int edge_vertices[12];
+                for (int edge = 0; edge < 12; edge++) {
+                    if ((marching_cubes_edge_table[cube_index] & (1 << edge)) == 0) {
+                        continue;
+                    }
+                    // The edge starts at the vertex with the smaller offset and goes along the axis the offsets differ in.
+                    const int* offset_a = marching_cubes_vertex_offsets[marching_cubes_edge_vertices[edge][0]];
+                    const int* offset_b = marching_cubes_vertex_offsets[marching_cubes_edge_vertices[edge][1]];
+                    int cell = (x + std::min(offset_a[0], offset_b[0])) + (y + std::min(offset_a[1], offset_b[1])) * this->number_of_cells_x_density_estimator;
+                    bool is_top = (std::min(offset_a[2], offset_b[2]) == 1);
+                    if (offset_a[0] != offset_b[0])         edge_vertices[edge] = (is_top == true) ? top_x[cell] : bottom_x[cell];
+                    else if (offset_a[1] != offset_b[1])    edge_vertices[edge] = (is_top == true) ? top_y[cell] : bottom_y[cell];
+                    else                                    edge_vertices[edge] = edge_cache_z[cell];
+                }
+                for (int i = 0; (i < 15) && (marching_cubes_triangle_table[cube_index][i] != -1); i += 3) {
+                    // The geometry shader uses AC x AB as normal, so A, C, B is counter-clockwise seen from outside.
+                    *(indices++) = edge_vertices[marching_cubes_triangle_table[cube_index][i]];
+                    *(indices++) = edge_vertices[marching_cubes_triangle_table[cube_index][i + 2]];
+                    *(indices++) = edge_vertices[marching_cubes_triangle_table[cube_index][i + 1]];
+                }
+            }
+        }
+        std::swap(bottom_x, top_x);
+        std::swap(bottom_y, top_y);
+    }
+}
+
+void Marching_Cubes_Generator::extract_mesh ()
+{
+    TRACE_SCOPE("Marching_Cubes_Generator::extract_mesh");
+    if (this->number_of_cells_marching_cubes == 0) {
+        std::cout << "ERROR: Generate the marching cubes before extracting the mesh." << std::endl;
+        return;
+    }
+    // Count the vertices and triangles of every chunk.
+    int number_of_chunks = this->get_number_of_chunks(this->number_of_cells_z_marching_cubes);
+    this->number_of_mesh_vertices_per_chunk.assign(number_of_chunks, 0);
+    this->number_of_mesh_triangles_per_chunk.assign(number_of_chunks, 0);
+    this->parallel_for(&Marching_Cubes_Generator::count_mesh_elements, this->number_of_cells_z_marching_cubes);
+    // The exclusive prefix sums give the position of every chunk within the mesh.
+    this->mesh_vertex_offset_per_chunk.resize(number_of_chunks);
+    this->mesh_triangle_offset_per_chunk.resize(number_of_chunks);
+    int number_of_vertices = 0;
+    int number_of_triangles = 0;
+    for (int i = 0; i < number_of_chunks; i++) {
+        this->mesh_vertex_offset_per_chunk.at(i) = number_of_vertices;
+        this->mesh_triangle_offset_per_chunk.at(i) = number_of_triangles;
+        number_of_vertices += this->number_of_mesh_vertices_per_chunk.at(i);
+        number_of_triangles += this->number_of_mesh_triangles_per_chunk.at(i);
+    }
+    this->mesh.positions.resize(number_of_vertices);
+    this->mesh.normals.resize(number_of_vertices);
+    this->mesh.indices.resize(3 * (size_t)number_of_triangles);
+    // The edge caches are kept, so they only allocate if the grid grows.
+    this->edge_caches.resize(number_of_chunks);
+    this->parallel_for(&Marching_Cubes_Generator::write_mesh, this->number_of_cells_z_marching_cubes);
+}
+
+// ====================================== GETTER ======================================
+
+const Marching_Cube_Vector& Marching_Cubes_Generator::get_marching_cubes ()
+{
+    return this->marching_cubes;
+}
+
+int Marching_Cubes_Generator::get_number_of_marching_cubes ()
+{
+    return this->number_of_cells_marching_cubes;
+}
+
+const Marching_Cube_Vector& Marching_Cubes_Generator::get_active_marching_cubes ()
+{
+    return this->active_marching_cubes;
+}
+
+int Marching_Cubes_Generator::get_number_of_active_marching_cubes ()
+{
+    return this->number_of_active_marching_cubes;
+}
+
+const Marching_Cubes_Mesh& Marching_Cubes_Generator::get_mesh ()
+{
+    return this->mesh;
+}
+
+int Marching_Cubes_Generator::count_differing_density_cells (Marching_Cubes_Generator& other)
+{
+    if ((this->number_of_cells_x_density_estimator != other.number_of_cells_x_density_estimator) ||
+        (this->number_of_cells_y_density_estimator != other.number_of_cells_y_density_estimator) ||
+        (this->number_of_cells_z_density_estimator != other.number_of_cells_z_density_estimator)) {
+        return -1;
+    }
+    int number_of_differing_cells = 0;
+    for (int grid_key = 0; grid_key < this->number_of_cells_density_estimator; grid_key++) {
+        if (this->density_estimator[grid_key].load(std::memory_order_relaxed) != other.density_estimator[grid_key].load(std::memory_order_relaxed)) {
+            number_of_differing_cells++;
+        }
+    }
+    return number_of_differing_cells;
+}
+
+int Marching_Cubes_Generator::get_changed_active_marching_cubes_begin ()
+{
+    return this->changed_active_cubes_begin;
+}
+
+int Marching_Cubes_Generator::get_changed_active_marching_cubes_end ()
+{
+    return this->changed_active_cubes_end;
+}
+
+int Marching_Cubes_Generator::get_number_of_updated_marching_cubes ()
+{
+    return this->number_of_updated_marching_cubes;
+}
+
+glm::vec3 Marching_Cubes_Generator::get_grid_origin ()
+{
+    // We need to translate the position back to the global coordinates since we moved the position to
+    // only allow position values. 
+    // We will not shift for the whole cube edge length but only for the half since the marching cubes are 
+    // shifted halb the cube edge length in comparison to the density estimator.
+    return -this->particle_system->particle_offset - glm::vec3(this->cube_edge_length / 2);
+}
+
+int Marching_Cubes_Generator::get_number_of_cells_x_marching_cubes ()
+{
+    return this->number_of_cells_x_marching_cubes;
+}
+
+int Marching_Cubes_Generator::get_number_of_cells_y_marching_cubes ()
+{
+    return this->number_of_cells_y_marching_cubes;
+}
+
+unsigned long long Marching_Cubes_Generator::get_generation ()
+{
+    return this->generation;
+}
+
+size_t Marching_Cubes_Generator::get_memory_footprint ()
+{
+    size_t memory_footprint = this->density_estimator.capacity() * sizeof(std::atomic<int>) +
+        this->density_histograms.capacity() * sizeof(int) + this->color_field.capacity() * sizeof(float) +
+        this->particle_density_cells.capacity() * sizeof(int) +
+        (this->marching_cubes.capacity() + this->active_marching_cubes.capacity()) * sizeof(Marching_Cube);
+    for (auto& edge_cache : this->edge_caches) {
+        memory_footprint += edge_cache.capacity() * sizeof(int);
+    }
+    return memory_footprint;
+}
+
+void Marching_Cubes_Generator::predict_memory_footprint (   Cuboid& simulation_space, float cube_edge_length, size_t number_of_particles,
+                                                            int number_of_threads, size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT])
+{
+    // The same calculation as in calculate_number_of_grid_cells.
+    size_t number_of_cells_x = (size_t)ceil((simulation_space.x_max - simulation_space.x_min) / cube_edge_length) + 2;
+    size_t number_of_cells_y = (size_t)ceil((simulation_space.y_max - simulation_space.y_min) / cube_edge_length) + 2;
+    size_t number_of_cells_z = (size_t)ceil((simulation_space.z_max - simulation_space.z_min) / cube_edge_length) + 2;
+    size_t number_of_cells = number_of_cells_x * number_of_cells_y * number_of_cells_z;
+    size_t number_of_cubes = (number_of_cells_x - 1) * (number_of_cells_y - 1) * (number_of_cells_z - 1);
+    predicted_bytes[MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR] += number_of_cells * sizeof(std::atomic<int>);
+    // The cell of every particle (see particle_density_cells).
+    if (this->incremental_updates == true) {
+        predicted_bytes[MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR] += number_of_particles * sizeof(int);
+    }
+    // The histograms are used under the same conditions as in choose_density_estimation_mode (without the spatial grid).
+    bool uses_histograms = (this->density_estimation_mode == DENSITY_ESTIMATION_PRIVATE_HISTOGRAMS) ||
+        ((this->density_estimation_mode == DENSITY_ESTIMATION_AUTO) && (number_of_threads > 1) &&
+        (number_of_cells * number_of_threads <= number_of_particles * MARCHING_CUBES_HISTOGRAM_CELLS_PER_PARTICLE));
+    if (uses_histograms == true) {
+        predicted_bytes[MEMORY_SUBSYSTEM_DENSITY_HISTOGRAMS] += number_of_cells * number_of_threads * sizeof(int);
+    }
+    if (this->scalar_field_mode == SCALAR_FIELD_COLOR_FIELD) {
+        predicted_bytes[MEMORY_SUBSYSTEM_COLOR_FIELD] += number_of_cells * sizeof(float);
+    }
+    predicted_bytes[MEMORY_SUBSYSTEM_MARCHING_CUBES] += number_of_cubes * sizeof(Marching_Cube);
+}
+
+bool Marching_Cubes_Generator::predicts_memory_subsystem (Memory_Subsystem memory_subsystem)
+{
+    return (memory_subsystem == MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR) ||
+        (memory_subsystem == MEMORY_SUBSYSTEM_DENSITY_HISTOGRAMS) ||
+        (memory_subsystem == MEMORY_SUBSYSTEM_COLOR_FIELD) ||
+        (memory_subsystem == MEMORY_SUBSYSTEM_MARCHING_CUBES);
+}
+
+bool Marching_Cubes_Generator::fits_into_memory_budget (float cube_edge_length)
+{
+    size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT] = {};
+    this->predict_memory_footprint(*this->particle_system->simulation_space, cube_edge_length, 
+        this->particle_system->number_of_particles, this->particle_system->number_of_threads, predicted_bytes);
+    // The other subsystems stay as they are.
+    size_t total_bytes = 0;
+    for (int i = 0; i < _MEMORY_SUBSYSTEM_COUNT; i++) {
+        Memory_Subsystem memory_subsystem = (Memory_Subsystem)i;
+        total_bytes += (predicts_memory_subsystem(memory_subsystem) == true) ? predicted_bytes[i] : memory_accounting.get_current_bytes(memory_subsystem);
+    }
+    return memory_accounting.check_budget(total_bytes, "The marching cubes with a grid size of " + std::to_string(cube_edge_length));
+}
@@ -0,0 +1,433 @@
+#pragma once
+
+//        4 +--------+ 5
+//         /|       /|
+//        / |      / |
+//     7 +--------+ 6|
+//       |  |     |  |
+//       |0 +-----|--+ 1
+//       | /      | /
+//       |/       |/
+//     3 +--------+ 2
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <atomic>
+#include <memory>
+
+#include "particle_system.h"
+#include "memory_accounting.h"
+
+// The edge length of a single marching cube. The less the edge length, the higher the resolution.
+#define MARCHING_CUBES_CUBE_EDGE_LENGTH         0.1f
+#define MARCHING_CUBES_CUBE_EDGE_LENGTH_MIN     0.01f
+#define MARCHING_CUBES_CUBE_EDGE_LENGTH_MAX     0.3f
+#define MARCHING_CUBES_CUBE_EDGE_LENGTH_STEP    0.0001f
+// The isovalue used in the marching cubes algorithm to determine if a vertex is within the object
+// or outside. For the particle count (see Scalar_Field_Mode) the values of the vertices are whole numbers, for the
+// color field they are about one inside of the fluid and zero outside, so the default works for both.
+// Note that the step is not really the step the value can take but more the sensitivity for the imgui window.
+#define MARCHING_CUBES_ISOVALUE                 0.5f
+#define MARCHING_CUBES_ISOVALUE_MIN             0.1f
+#define MARCHING_CUBES_ISOVALUE_MAX             20.0f
+#define MARCHING_CUBES_ISOVALUE_STEP            0.01f
+// In the mode DENSITY_ESTIMATION_AUTO (see below), the private histograms are used if the histograms of all threads
+// together have at most this many cells per particle. Every particle is counted with a plain increment, but every
+// cell of every histogram has to be merged, so for fine grids (or few particles) the atomics are cheaper.
+#define MARCHING_CUBES_HISTOGRAM_CELLS_PER_PARTICLE 2
+// The radius of the kernel of the color field as a fraction of the SPH kernel radius (so it is twice the initial
+// distance of the particles). The color field searches the particles in the spatial grid of the particle system, whose
+// cells have the edge length of the SPH kernel radius. After a step of the simulation the particles are still in the
+// cells of the start of the step, so as long as no particle moved further than the SPH kernel radius minus this radius
+// within the step, the 3 x 3 x 3 neighboring cells of a sample point still contain all particles within the radius.
+#define MARCHING_CUBES_COLOR_FIELD_RADIUS_FACTOR    0.5f
+// With incremental updates (see Marching_Cubes_Generator), only the vertex values of the cubes around the cells whose
+// number of particles changed are calculated again. If more than this fraction of all cubes is affected, the vertex
+// values of all cubes are calculated (one pass over the grid is cheaper than collecting that many cubes).
+#define MARCHING_CUBES_INCREMENTAL_MAX_DIRTY_FRACTION   0.25f
+// The SPH kernel radius and the cube edge length have an integer ratio (see DENSITY_ESTIMATION_SPATIAL_GRID) if the
+// ratio differs from the nearest integer by at most this fraction of it.
+#define MARCHING_CUBES_SPATIAL_GRID_RATIO_TOLERANCE     0.002f
+
+// The scalar field the surface is extracted from.
+enum Scalar_Field_Mode
+{
+    // The number of particles within the cell of every vertex (see Density_Estimation_Mode). The values jump from cell
+    // to cell, so the surface is blocky unless the cubes are small.
+    SCALAR_FIELD_PARTICLE_COUNT,
+    // The SPH color field: the sum of the poly6 kernel of all particles within the radius above, weighted with the volume
+    // of a particle of the initial lattice. It is smooth, so the cubes can be a few times larger for the same quality.
+    SCALAR_FIELD_COLOR_FIELD,
+    _SCALAR_FIELD_MODE_COUNT
+};
+
+inline const char* to_string (Scalar_Field_Mode scalar_field_mode)
+{
+    switch (scalar_field_mode) {
+        case SCALAR_FIELD_PARTICLE_COUNT:   return "PARTICLE COUNT";
+        case SCALAR_FIELD_COLOR_FIELD:      return "COLOR FIELD";
+        default:                            return "unknown scalar field mode";
+    }
+}
+
+// How the threads count the particles per cell of the density estimator. Before, every cell had a mutex that was
+// locked for every particle just to increment an int.
+enum Density_Estimation_Mode
+{
+    // Chooses one of the modes below by comparing the number of cells with the number of particles.
+    DENSITY_ESTIMATION_AUTO,
+    // The cells are atomics, every thread increments them with a relaxed atomic add.
+    DENSITY_ESTIMATION_ATOMIC,
+    // Every thread counts its particles in a private histogram (one int per cell). The histograms are summed
+    // up afterwards by a parallel reduction over the cells.
+    DENSITY_ESTIMATION_PRIVATE_HISTOGRAMS,
+    // The counts are taken from the spatial grid of the particle system, which the simulation builds anyway. The cells of
+    // both grids start at the same position (the density estimator has one more cell in front):
+    // - If a cube is a whole number of SPH cells long, the count of a cell is the sum of the SPH cells it covers. The
+    //   particles are not touched at all, so the cost scales with the number of cells.
+    // - If an SPH cell is a whole number of cubes long, the particles of every SPH cell are counted into the block of
+    //   cells it covers. This needs the positions of the particles, so it is still one pass over the particles, but every
+    //   cell belongs to one SPH cell only, so the threads need neither atomics nor histograms.
+    // - Without an integer ratio a cell would only partly cover some SPH cells, so its count could only be estimated.
+    //   AUTO does not choose this mode then (and a forced mode falls back to counting the particles), so the counts are
+    //   always the ones of counting the particles.
+    // Every cell is written by one thread, which compares the count with the previous one, so the dirty cells for the
+    // incremental updates are found without remembering the cell of every particle.
+    // After a step of the simulation the particles are still in the SPH cells of the start of the step, so a particle
+    // that left its SPH cell within the step is counted in its old SPH cell (like the color field, which searches the
+    // particles in the same grid).
+    DENSITY_ESTIMATION_SPATIAL_GRID,
+    _DENSITY_ESTIMATION_MODE_COUNT
+};
+
+inline const char* to_string (Density_Estimation_Mode density_estimation_mode)
+{
+    switch (density_estimation_mode) {
+        case DENSITY_ESTIMATION_AUTO:               return "AUTO";
+        case DENSITY_ESTIMATION_ATOMIC:             return "ATOMIC";
+        case DENSITY_ESTIMATION_PRIVATE_HISTOGRAMS: return "PRIVATE HISTOGRAMS";
+        case DENSITY_ESTIMATION_SPATIAL_GRID:       return "SPATIAL GRID";
+        default:                                    return "unknown density estimation mode";
+    }
+}
+
+// The marching cubes are uploaded as they are into the vertex buffer (see Marching_Cubes_Renderer), so they are packed
+// into 20 bytes:
+// - The position of a cube follows from its index in the grid, so only the index (a GLint) is stored. The vertex shader
+//   derives the position from it and the origin and size of the grid (see Marching_Cubes_Generator::get_grid_origin).
+// - The values of the vertices are half floats (GL_HALF_FLOAT, see float_to_half). They are exact for the particle
+//   counts (up to 2048) and keep about three decimal digits of the color field.
+// A vertex attribute has at most 4 components, so the values are passed to the shader as two vec4.
+// https://registry.khronos.org/OpenGL-Refpages/gl4/html/glVertexAttribPointer.xhtml
+struct Marching_Cube
+{
+    int cube_index;
+    unsigned short vertex_values[8];
+};
+
+// The vector holding the marching cubes. Its memory is counted by the memory accounting.
+typedef Tracked_Vector<Marching_Cube, MEMORY_SUBSYSTEM_MARCHING_CUBES> Marching_Cube_Vector;
+
+// The surface of the fluid as indexed triangle mesh (see Marching_Cubes_Generator::extract_mesh). Every point where the
+// surface crosses an edge of the grid is one vertex, no matter how many cubes share the edge.
+struct Marching_Cubes_Mesh
+{
+    Tracked_Vector<glm::vec3, MEMORY_SUBSYSTEM_MARCHING_CUBES_MESH> positions;
+    // The normals are derived from the gradient of the scalar field and show out of the fluid.
+    Tracked_Vector<glm::vec3, MEMORY_SUBSYSTEM_MARCHING_CUBES_MESH> normals;
+    // Three indices per triangle, counter-clockwise seen from outside of the fluid.
+    Tracked_Vector<unsigned int, MEMORY_SUBSYSTEM_MARCHING_CUBES_MESH> indices;
+
+    size_t get_number_of_vertices () const { return this->positions.size(); }
+    size_t get_number_of_triangles () const { return this->indices.size() / 3; }
+};
+
+// The marching cubes generator only calculates the marching cubes on the CPU. It does not own any OpenGL
+// resources, so it can also be used without an OpenGL context (e.g. by the benchmarks). The cubes are
+// drawn by the Marching_Cubes_Renderer of the visualization handler.
+class Marching_Cubes_Generator
+{
+    // The phase benchmarks measure the steps of the algorithm one by one.
+    friend class Phase_Benchmark;
+
+    private:
+        // Parallel for loops (see marching_cubes_parallel_for).
+        void parallel_for (void (Marching_Cubes_Generator::* function)(unsigned int, unsigned int), int number_of_elements);
+        const char* get_region_name (void (Marching_Cubes_Generator::* function)(unsigned int, unsigned int));
+        // Returns the number of chunks parallel_for splits the elements into (at most one per element).
+        int get_number_of_chunks (int number_of_elements);
+        // Returns the index of the chunk (and thread) that starts with the given element. Used by the functions that
+        // keep data per chunk (the private histograms, the counts of the compaction and of the mesh extraction).
+        int get_chunk_index (unsigned int index_start, int number_of_elements);
+
+        // We need two spatial grids.
+        // One will estimate the density of the particles. This spatial grid divides the simulation space in cubes and counts
+        // the number of particles within these cubes. This spatial grid needs to overlap the simulation space by one cube in
+        // every direction so we can have a density of value 0 outside of the simulation space.
+        // We will call this spatial grid the density estimator.
+        int number_of_cells_density_estimator;
+        int number_of_cells_x_density_estimator;
+        int number_of_cells_y_density_estimator;
+        int number_of_cells_z_density_estimator;
+        // Multiple threads could add a value to the density of the same grid cell, so the cells are atomics (see
+        // Density_Estimation_Mode). Like the mutexes of the particle system, they cannot be moved, so the vector is
+        // replaced instead of resized.
+        Tracked_Vector<std::atomic<int>, MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR> density_estimator;
+        // The private histograms of the threads, one after another (number_of_threads * number_of_cells_density_estimator
+        // ints). They are only allocated while they are used and are all zero between two density estimations.
+        Tracked_Vector<int, MEMORY_SUBSYSTEM_DENSITY_HISTOGRAMS> density_histograms;
+        int number_of_density_histograms;
+        // The color field at the cells of the density estimator (the same grid, so the marching cubes do not care which
+        // field they read). Every cell is written by one thread only. It is only allocated while it is used.
+        Tracked_Vector<float, MEMORY_SUBSYSTEM_COLOR_FIELD> color_field;
+        // The radius of the kernel of the color field (squared) and the factor of its sum (the volume of a particle times
+        // the coefficient of the poly6 kernel). Both are set before the color field is evaluated.
+        float color_field_radius_squared;
+        float color_field_coefficient;
+        // The scalar field the values of the last generate_marching_cubes call were taken from.
+        Scalar_Field_Mode used_scalar_field_mode;
+
+        // Incremental updates. Most particles of a fluid at rest stay in their cell of the density estimator from one frame
+        // to the next. So instead of counting all particles again, the cell every particle was counted in is kept (indexed by
+        // the id of the particle) and only the particles that moved to another cell change the counts (with atomics). Both
+        // cells become dirty, and only the cubes that have a dirty cell as vertex get new vertex values. If nothing changed,
+        // the active cubes are not copied again and the generation stays the same, so nothing is uploaded either.
+        // The cells are empty if the counts of the density estimator are not up to date (e.g. after the grid was resized or
+        // while the color field is used, which changes with every movement of a particle), then everything is calculated.
+        Tracked_Vector<int, MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR> particle_density_cells;
+        // The cells that changed, one list per chunk of the parallel for loop (so no thread has to lock anything).
+        std::vector<std::vector<int>> dirty_density_cells_per_chunk;
+        // The cubes that need new vertex values (sorted) and a flag per cube to collect every cube only once.
+        std::vector<int> dirty_marching_cubes;
+        std::vector<unsigned char> marching_cube_is_dirty;
+        int number_of_updated_marching_cubes;
+        // True if the vertex values of all cubes have to be calculated (set by the density estimation).
+        bool update_all_vertex_values;
+        // True if vertex values changed since the last compaction, and the isovalue of the last compaction.
+        bool vertex_values_changed;
+        float compacted_isovalue;
+        // The range of the active cubes that changed with the last compaction (the end is exclusive), one per chunk and in total.
+        std::vector<int> changed_active_cubes_begin_per_chunk;
+        std::vector<int> changed_active_cubes_end_per_chunk;
+        int changed_active_cubes_begin;
+        int changed_active_cubes_end;
+        // The number of active cubes before the compaction (the cubes behind it are new).
+        int previous_number_of_active_marching_cubes;
+
+        // The second spatial grid is basically the vector of the marching cubes. We do not need to divide the space again since
+        // this already happened with the first spatial grid. A marching cube grid has one cube less in every axis than the previous
+        // spatial grid and this grid is shifted by half of the cube length so the vertices of the marching cube lay at the center
+        // of a cell of the first spatial grid. The density values of the first spatial grid are then mapped to the respective 
+        // vertices of a marching cubes.
+        // We will call this simply marching cubes.
+        int number_of_cells_marching_cubes;
+        int number_of_cells_x_marching_cubes;
+        int number_of_cells_y_marching_cubes;
+        int number_of_cells_z_marching_cubes;
+        Marching_Cube_Vector marching_cubes;
+
+        // Almost all marching cubes are completely inside or outside of the fluid and do not produce any triangle. After
+        // the vertex values are calculated, the cubes the surface passes through (the active cubes) are copied into a
+        // vector of their own, so only these cubes have to be uploaded and drawn. The copy is done in parallel: every chunk
+        // counts its active cubes, an exclusive prefix sum over the counts gives the position of every chunk in the vector
+        // and then every chunk copies its active cubes to this position.
+        Marching_Cube_Vector active_marching_cubes;
+        int number_of_active_marching_cubes;
+        std::vector<int> number_of_active_cubes_per_chunk;
+        std::vector<int> active_cubes_offset_per_chunk;
+        
+        // This function calculates the number of grid cells for both spatial grids mentioned above as well as resizes them.
+        void calculate_number_of_grid_cells ();
+        // Compares the memory with the grids of the given edge length with the memory budget (see memory_accounting.h).
+        // Returns false if the budget is exceeded and the budget mode is REFUSE.
+        bool fits_into_memory_budget (float cube_edge_length);
+        // This function will be used to get the grid key for the density estimator spatial grid. It simply discretizes a given float value.
+        int discretize_value (float value);
+        // This function returns based on the position in 3d space to what cell (grid key) in the density estimator spatial grid
+        // this position belongs. We will need this for the density estimation itself (to what cell does a particle count) as well as 
+        // to set the vertex values of a marching cube.
+        int get_grid_key_density_estimator (glm::vec3 position);
+        // This function does the reverse of the function above. Given a grid key it returns the 3d position in space (the center)
+        // of the grid cell. But note that this function operates on the marching cube grid. It returns the position of the min
+        // corner of a marching cube (the vertex shader does the same with the index of the cube).
+        glm::vec3 get_position_from_grid_key_marching_cube (int grid_key);
+        // The index of a marching cube only needs to be set when the number of grid cells change (so when the resolution changes or
+        // when the simulation space changes).
+        void set_cube_index (unsigned int index_start, unsigned int index_end);
+        // Returns the mode that is used for the next density estimation (resolves DENSITY_ESTIMATION_AUTO).
+        Density_Estimation_Mode choose_density_estimation_mode ();
+        // This function estimates the density of all grid cells within the density estimator. We simply count the number of particles within
+        // each grid cell. Depending on the mode, the counts are either added to the density estimator directly or to the private
+        // histograms that are merged afterwards.
+        void update_density_estimator ();
+        void estimate_density_atomic (unsigned int index_start, unsigned int index_end);
+        void estimate_density_private_histograms (unsigned int index_start, unsigned int index_end);
+        // Moves the particles that changed their cell since the last density estimation (see incremental updates above).
+        void estimate_density_incremental (unsigned int index_start, unsigned int index_end);
+        // Saves the cell of every particle after a full density estimation (if incremental updates are enabled).
+        void save_particle_density_cells (unsigned int index_start, unsigned int index_end);
+        // Sums up the private histograms of the given cells into the density estimator and resets them to zero.
+        void merge_density_histograms (unsigned int index_start, unsigned int index_end);
+        // The number of cells of the density estimator per SPH cell along an axis if a cube is shorter than an SPH cell
+        // (see DENSITY_ESTIMATION_SPATIAL_GRID), zero if the cells are summed up from the SPH cells.
+        int cells_per_spatial_grid_cell;
+        // The number of SPH cells per cell of the density estimator along an axis if a cube is at least as long as an SPH
+        // cell, zero if the particles of the SPH cells are counted into the cells.
+        int spatial_grid_cells_per_cell;
+        // Calculates the ratios above. Returns false if the counts cannot be taken from the spatial grid.
+        bool calculate_spatial_grid_ratio ();
+        // True if the density estimator holds the counts of the last estimation from the spatial grid (false after the grid
+        // was resized or the color field was used).
+        bool spatial_grid_counts_are_current;
+        // If the changed cells are collected while the counts are taken from the spatial grid.
+        bool collect_dirty_density_cells;
+        // The counts of the block of cells of an SPH cell, one block per chunk.
+        std::vector<std::vector<int>> spatial_grid_block_counts_per_chunk;
+        // Takes the counts from the spatial grid (only if calculate_spatial_grid_ratio returned true).
+        void estimate_density_spatial_grid ();
+        // The elements are the cells of the density estimator (a cell is the sum of the SPH cells it covers).
+        void sum_spatial_grid_cells (unsigned int index_start, unsigned int index_end);
+        // The elements are the cells of the spatial grid (an SPH cell covers several cells of the density estimator).
+        void count_spatial_grid_cells (unsigned int index_start, unsigned int index_end);
+        // Writes a count into the density estimator and collects the cell if the count changed.
+        void set_density_count (int grid_key, int count, std::vector<int>& dirty_density_cells);
+        // Evaluates the color field at the cells of the density estimator. The neighbors of a cell are searched in the spatial
+        // grid of the particle system, which is only built again if the particles changed since the last step of the simulation
+        // (see Particle_System::update_spatial_grid). A cell far from the particles has no particles in its neighboring cells.
+        void update_color_field ();
+        void evaluate_color_field (unsigned int index_start, unsigned int index_end);
+        // Updates the scalar field of the current mode (the density estimator or the color field).
+        void update_scalar_field ();
+        // The value of the current scalar field at the cell of the density estimator with the given grid key.
+        float get_field_value (int grid_key);
+        // The value of the current scalar field at the cell with the given grid key as half float (see Marching_Cube).
+        unsigned short get_vertex_value (int grid_key);
+        // This function takes the marching cubes and looks for every corner / vertex of a cube what the value within the density estimator
+        // grid is for this position. We do not need to reset the values for the next run since they will be overwritten in the next run.
+        // The corner (x, y, z) of a cube is the cell (x, y, z) of the density estimator, so the cubes are walked row by row along x
+        // with the grid keys of the four cells at the left face of the cube. The right face is loaded and becomes the left face
+        // of the next cube, so every value of a row is read and converted once instead of twice.
+        void calculate_vertex_values (unsigned int index_start, unsigned int index_end);
+        // The same for the dirty cubes only (the indices are the ones of the list of dirty cubes). The list is sorted, so
+        // consecutive cubes are passed to calculate_vertex_values as one range.
+        void calculate_dirty_vertex_values (unsigned int index_start, unsigned int index_end);
+        // Calculates the vertex values of all cubes or only of the cubes around the dirty cells of the density estimator.
+        void update_vertex_values ();
+        // A cube is active if at least one of its vertices is inside and one outside (the same test as in the geometry shader).
+        // The values are never negative, and for non-negative half floats the order of the bits is the order of the values.
+        // So instead of converting the values, they are compared with the smallest half float that is not below the isovalue.
+        bool is_active_cube (const Marching_Cube& marching_cube);
+        unsigned short isovalue_threshold;
+        // Copies the active cubes into the vector of the active cubes (see above). Only the cubes that differ from the ones
+        // already in the vector are written. Returns false if nothing changed (then nothing is copied at all).
+        bool compact_active_cubes ();
+        void count_active_cubes (unsigned int index_start, unsigned int index_end);
+        void copy_active_cubes (unsigned int index_start, unsigned int index_end);
+
+        // The mesh extraction (see extract_mesh) works on the scalar field directly. The threads process slabs of
+        // cubes along the z axis. Every point where the surface crosses an edge of the grid becomes one vertex, and every
+        // vertex is created by exactly one thread:
+        // - the edges along x and y that lie in the bottom layer of a slab of cubes belong to the slab (the ones in the
+        //   last layer of the grid belong to the last slab),
+        // - the edges along z belong to the slab they go through.
+        // Like in the compaction, the vertices and triangles of every chunk are counted first, so a prefix sum gives the
+        // position of every chunk within the mesh. While a thread walks through its slabs, it keeps the indices of the
+        // vertices on the edges of the current bottom and top layer in an edge cache (one int per edge). The edges of the
+        // top layer of its last slab belong to the next chunk, but since the vertices are created in the same order by
+        // every thread, their indices follow from the offset of the next chunk.
+        Marching_Cubes_Mesh mesh;
+        std::vector<int> number_of_mesh_vertices_per_chunk;
+        std::vector<int> number_of_mesh_triangles_per_chunk;
+        std::vector<int> mesh_vertex_offset_per_chunk;
+        std::vector<int> mesh_triangle_offset_per_chunk;
+        // Five layers per chunk: the edges along x and y of the bottom and the top layer and the edges along z between them.
+        std::vector<Tracked_Vector<int, MEMORY_SUBSYSTEM_MARCHING_CUBES_MESH>> edge_caches;
+
+        // The value of the scalar field at the given cell (the cells are the vertices of the marching cubes).
+        float get_field_value (int x, int y, int z);
+        // Returns true if the surface crosses the edge from the given cell to its neighbor along the axis (0 = x, 1 = y, 2 = z).
+        bool is_crossing_edge (int x, int y, int z, int axis);
+        // Calculates the position and the normal of the vertex on the given edge (see create_marching_cubes_edge_vertex).
+        void create_edge_vertex (int x, int y, int z, int axis, int vertex_index);
+        // Assigns the next vertex indices to the crossed edges of a layer of the grid and creates their vertices if the
+        // layer belongs to the chunk. The layer is either the edges along x and y in the layer z or the edges along z from
+        // the layer z to the next one.
+        void process_edge_layer_xy (int z, int* edge_cache_x, int* edge_cache_y, int& next_vertex_index, bool create_vertices);
+        void process_edge_layer_z (int z, int* edge_cache_z, int& next_vertex_index);
+        // The chunk functions of the mesh extraction, the elements are the slabs of marching cubes along the z axis.
+        void count_mesh_elements (unsigned int index_start, unsigned int index_end);
+        void write_mesh (unsigned int index_start, unsigned int index_end);
+
+        // Counts the calls of generate_marching_cubes. The renderer may draw the marching cubes twice per frame
+        // (once for the grid and once for the generated surface). To not pass the new data twice to the buffer,
+        // it compares this value with the one of the last upload.
+        unsigned long long generation;
+
+    public:
+        Marching_Cubes_Generator ();
+
+        // We need a simulation space reference to know how big our grid has to be.
+        Particle_System* particle_system;
+        // This function is used to manually inform the marching cube generator that the
+        // simulation space of the particle system changed. Using this we can skip that the 
+        // generator has to check this everytime by himself.
+        void simulation_space_changed ();
+
+        // This function calculates the marching cubes.
+        void generate_marching_cubes ();
+        // Extracts the surface of the last generate_marching_cubes call as indexed triangle mesh on the CPU (with the same
+        // lookup tables as the geometry shader), e.g. to measure or export it or on machines without GPU.
+        void extract_mesh ();
+
+        // We save the last cube edge length to determine if we have to regenerate the density estimator.
+        float cube_edge_length;
+        // A public variable that can be changed using imgui.
+        float new_cube_edge_length;
+        // A value that will be passed as an uniform to the geometry shader for the marching cubes algorithm.
+        float isovalue;
+        // How the particles are counted (can be changed using imgui) and the mode the last density estimation used.
+        Density_Estimation_Mode density_estimation_mode;
+        Density_Estimation_Mode used_density_estimation_mode;
+        // The scalar field the surface is extracted from (can be changed using imgui).
+        Scalar_Field_Mode scalar_field_mode;
+        // Only update the cells, cubes and active cubes that changed since the last frame (can be changed using imgui).
+        bool incremental_updates;
+
+        // The per-thread work, idle times and load imbalance of every parallel for loop.
+        Parallel_Region_Statistics parallel_region_statistics;
+
+        // Access for the renderer.
+        const Marching_Cube_Vector& get_marching_cubes ();
+        int get_number_of_marching_cubes ();
+        // The position of the min corner of the first marching cube and the number of cubes along x and y. The shaders
+        // derive the positions of the cubes from their indices with these (see Marching_Cube).
+        glm::vec3 get_grid_origin ();
+        int get_number_of_cells_x_marching_cubes ();
+        int get_number_of_cells_y_marching_cubes ();
+        // Only the cubes the surface passes through (for the current isovalue).
+        const Marching_Cube_Vector& get_active_marching_cubes ();
+        int get_number_of_active_marching_cubes ();
+        // The range of the active cubes that changed with the last generation (the end is exclusive). The renderer only
+        // uploads this range if it uploaded the generation before.
+        int get_changed_active_marching_cubes_begin ();
+        int get_changed_active_marching_cubes_end ();
+        // The number of cubes that got new vertex values in the last generate_marching_cubes call.
+        int get_number_of_updated_marching_cubes ();
+        // The mesh of the last extract_mesh call.
+        const Marching_Cubes_Mesh& get_mesh ();
+        // The number of cells of the density estimator whose count differs from the one of the other generator (-1 if the
+        // grids differ), e.g. to compare two density estimation modes.
+        int count_differing_density_cells (Marching_Cubes_Generator& other);
+        unsigned long long get_generation ();
+        // The bytes of the grids (density estimator, histograms, color field, marching cubes and the edge caches of the
+        // mesh extraction) without the mesh, to compare it with Sparse_Marching_Cubes_Generator::get_memory_footprint.
+        size_t get_memory_footprint ();
+        // Adds the memory the grids would need for the given simulation space, edge length and particles (with the current
+        // settings) to predicted_bytes: the density estimator (and the cells of the particles for incremental updates),
+        // the private histograms, the color field and the marching cubes. The active cubes and the mesh only hold the
+        // cubes near the surface and are not predicted.
+        void predict_memory_footprint ( Cuboid& simulation_space, float cube_edge_length, size_t number_of_particles,
+                                        int number_of_threads, size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT]);
+        // If the subsystem is predicted by predict_memory_footprint.
+        static bool predicts_memory_subsystem (Memory_Subsystem memory_subsystem);
+};
\ No newline at end of file
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+
+#include "parallel_region_metrics.h"
+#include "performance_counters.h"
+#include "thread_pool.h"
+#include "trace.h"
+
+// The parts of the marching cubes that the dense Marching_Cubes_Generator and the Sparse_Marching_Cubes_Generator share.
+// Both generators use the same grid (the cells of the density estimator are the vertices of the marching cubes), so
+// the same functions on the same scalar field give the same mesh. The scalar field is passed as a callable
+// float (int x, int y, int z), so the dense grid and the bricks can be read without a virtual call.
+
+
+// ====================================== PARALLEL FOR LOOPS ======================================
+
+// The number of chunks a parallel for loop splits the elements into (one per thread, at most one per element).
+inline int get_marching_cubes_number_of_chunks (int number_of_threads, int number_of_elements)
+{
+    return std::max(1, std::min(number_of_threads, number_of_elements));
+}
+
+// The index of the chunk (and thread) that starts with the given element. All chunks have the same size, only the last
+// one goes until the end.
+inline int get_marching_cubes_chunk_index (unsigned int index_start, int number_of_elements, int number_of_threads)
+{
+    int number_of_chunks = get_marching_cubes_number_of_chunks(number_of_threads, number_of_elements);
+    int chunk_size = std::max(1, number_of_elements / number_of_chunks);
+    return std::min((int)index_start / chunk_size, number_of_chunks - 1);
+}
+
+// Executes the function for one chunk. Like in the particle system, this makes the chunk visible in the trace, counts
+// the hardware events of the thread and records it in the metrics of the parallel region.
+template <typename Generator>
+void execute_marching_cubes_chunk ( Generator* generator, void (Generator::* function)(unsigned int, unsigned int),
+                                    unsigned int index_start, unsigned int index_end, Parallel_Thread_Metrics* metrics,
+                                    const char* worker_name)
+{
+    TRACE_SCOPE_RANGE(worker_name, index_start, index_end);
+    COUNT_WORKER_PERFORMANCE_EVENTS();
+    begin_parallel_thread(metrics);
+    (generator->*function)(index_start, index_end);
+    end_parallel_thread(metrics);
+}
+
+// The parallel for loop of the generators (the chunk functions iterate up to and including the end index). If the
+// elements are particles, they are also counted as the particles of the threads in the metrics of the region. Like the
+// parallel for loops of the particle system, the chunks run on the thread pool if there is one (e.g. the one of the
+// particle system), otherwise every chunk starts its own thread.
+template <typename Generator>
+void marching_cubes_parallel_for (  Generator* generator, void (Generator::* function)(unsigned int, unsigned int),
+                                    int number_of_elements, int number_of_threads_requested, bool elements_are_particles,
+                                    Parallel_Region_Statistics& parallel_region_statistics, const char* region_name,
+                                    const char* worker_name, Thread_Pool* thread_pool)
+{
+    // There is nothing to do.
+    if (number_of_elements <= 0) {
+        return;
+    }
+    // Every thread needs at least one element.
+    int number_of_threads = get_marching_cubes_number_of_chunks(number_of_threads_requested, number_of_elements);
+    Parallel_Region_Metrics* region = parallel_region_statistics.begin_region(region_name, number_of_threads);
+    if (number_of_threads == 1) {
+        // Just execute the function if only one thread is desired.
+        region->threads[0].number_of_elements = number_of_elements;
+        region->threads[0].number_of_particles = (elements_are_particles == true) ? number_of_elements : 0;
+        execute_marching_cubes_chunk(generator, function, 0, number_of_elements - 1, &region->threads[0], worker_name);
+        parallel_region_statistics.end_region(1);
+        return;
+    }
+    int chunk_size = number_of_elements / number_of_threads;
+    std::vector<std::thread> threads;
+    threads.reserve(number_of_threads);
+    Task_Group task_group;
+    for (int i = 0; i < number_of_threads; i++) {
+        int chunk_start = i * chunk_size;
+        // The last chunk goes until the end.
+        int chunk_end = (i == number_of_threads - 1) ? number_of_elements - 1 : chunk_start + chunk_size - 1;
+        Parallel_Thread_Metrics* metrics = &region->threads[i];
+        metrics->number_of_elements = chunk_end - chunk_start + 1;
+        metrics->number_of_particles = (elements_are_particles == true) ? chunk_end - chunk_start + 1 : 0;
+        if (thread_pool != nullptr) {
+            thread_pool->submit_chunk(task_group, [generator, function, chunk_start, chunk_end, metrics, worker_name] () {
+                execute_marching_cubes_chunk(generator, function, chunk_start, chunk_end, metrics, worker_name);
+            });
+        }
+        else {
+            threads.emplace_back(&execute_marching_cubes_chunk<Generator>, generator, function, chunk_start, chunk_end,
+                metrics, worker_name);
+        }
+    }
+    // Wait for the threads to finish.
+    if (thread_pool != nullptr) {
+        thread_pool->wait(task_group);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    parallel_region_statistics.end_region(number_of_threads);
+}
+
+
+// ====================================== MESH EXTRACTION ======================================
+
+// The gradient of the scalar field at the given cell (central differences, one-sided at the border of the grid).
+template <typename Field>
+glm::vec3 get_marching_cubes_field_gradient (   const Field& get_field_value, int x, int y, int z,
+                                                int number_of_cells_x, int number_of_cells_y, int number_of_cells_z)
+{
+    // At the border of the grid we only have one neighbor, so use it instead of the missing one.
+    int x_min = std::max(x - 1, 0), x_max = std::min(x + 1, number_of_cells_x - 1);
+    int y_min = std::max(y - 1, 0), y_max = std::min(y + 1, number_of_cells_y - 1);
+    int z_min = std::max(z - 1, 0), z_max = std::min(z + 1, number_of_cells_z - 1);
+    return glm::vec3(
+        (get_field_value(x_max, y, z) - get_field_value(x_min, y, z)) / (x_max - x_min),
+        (get_field_value(x, y_max, z) - get_field_value(x, y_min, z)) / (y_max - y_min),
+        (get_field_value(x, y, z_max) - get_field_value(x, y, z_min)) / (z_max - z_min)
+    );
+}
+
+// Calculates the position and the normal of the vertex on the edge from the given cell to its neighbor along the axis
+// (0 = x, 1 = y, 2 = z), like the geometry shader does. The origin is the position of the cell (0, 0, 0).
+template <typename Field>
+glm::vec3 create_marching_cubes_edge_vertex (   const Field& get_field_value, int x, int y, int z, int axis,
+                                                int number_of_cells_x, int number_of_cells_y, int number_of_cells_z,
+                                                glm::vec3 origin, float cube_edge_length, float isovalue, glm::vec3& normal)
+{
+    // The second cell of the edge.
+    int x_b = x + (axis == 0), y_b = y + (axis == 1), z_b = z + (axis == 2);
+    float value_a = get_field_value(x, y, z);
+    float value_b = get_field_value(x_b, y_b, z_b);
+    glm::vec3 position_a = origin + cube_edge_length * glm::vec3(x, y, z);
+    glm::vec3 position_b = origin + cube_edge_length * glm::vec3(x_b, y_b, z_b);
+    // Interpolate the position where the value is equal to the isovalue (like interpolate_point in the geometry shader).
+    float factor = 0.0f;
+    if (std::abs(isovalue - value_a) < 0.001f) {
+        factor = 0.0f;
+    }
+    else if (std::abs(isovalue - value_b) < 0.001f) {
+        factor = 1.0f;
+    }
+    else {
+        factor = (isovalue - value_a) / (value_b - value_a);
+    }
+    // The density increases towards the fluid, so the normal is the negative gradient.
+    glm::vec3 gradient = glm::mix(
+        get_marching_cubes_field_gradient(get_field_value, x, y, z, number_of_cells_x, number_of_cells_y, number_of_cells_z),
+        get_marching_cubes_field_gradient(get_field_value, x_b, y_b, z_b, number_of_cells_x, number_of_cells_y, number_of_cells_z),
+        factor);
+    if (glm::length(gradient) > 1.0e-6f) {
+        normal = -glm::normalize(gradient);
+    }
+    else {
+        // The gradients of both cells cancel out. The edge goes from inside to outside (or the other way round),
+        // so use its direction instead.
+        normal = glm::vec3(0.0f);
+        normal[axis] = (value_a >= isovalue) ? 1.0f : -1.0f;
+    }
+    return glm::mix(position_a, position_b, factor);
+}
@@ -0,0 +1,117 @@
+#include "memory_accounting.h"
+
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+
+// For more details see memory_accounting.h:
+Memory_Accounting memory_accounting;
+
+size_t get_physical_memory_size ()
+{
+    long number_of_pages = sysconf(_SC_PHYS_PAGES);
+    long page_size = sysconf(_SC_PAGE_SIZE);
+    if ((number_of_pages <= 0) || (page_size <= 0)) {
+        return 0;
+    }
+    return (size_t)number_of_pages * (size_t)page_size;
+}
+
+// Converts bytes to MiB for printing.
+static double to_mib (size_t bytes)
+{
+    return bytes / (1024.0 * 1024.0);
+}
+
+void Memory_Accounting::update_peak (std::atomic<long long>& peak, long long value)
+{
+    long long current_peak = peak.load(std::memory_order_relaxed);
+    while ((value > current_peak) && (peak.compare_exchange_weak(current_peak, value, std::memory_order_relaxed) == false)) {
+        // compare_exchange_weak loaded the new peak into current_peak, so simply try again.
+    }
+}
+
+void Memory_Accounting::memory_allocated (Memory_Subsystem memory_subsystem, size_t bytes)
+{
+    long long current = this->current_bytes[memory_subsystem].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    Memory_Accounting::update_peak(this->peak_bytes[memory_subsystem], current);
+    long long total = this->total_current_bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    Memory_Accounting::update_peak(this->total_peak_bytes, total);
+}
+
+void Memory_Accounting::memory_freed (Memory_Subsystem memory_subsystem, size_t bytes)
+{
+    this->current_bytes[memory_subsystem].fetch_sub(bytes, std::memory_order_relaxed);
+    this->total_current_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+size_t Memory_Accounting::get_current_bytes (Memory_Subsystem memory_subsystem)
+{
+    return this->current_bytes[memory_subsystem].load(std::memory_order_relaxed);
+}
+
+size_t Memory_Accounting::get_peak_bytes (Memory_Subsystem memory_subsystem)
+{
+    return this->peak_bytes[memory_subsystem].load(std::memory_order_relaxed);
+}
+
+size_t Memory_Accounting::get_total_current_bytes ()
+{
+    return this->total_current_bytes.load(std::memory_order_relaxed);
+}
+
+size_t Memory_Accounting::get_total_peak_bytes ()
+{
+    return this->total_peak_bytes.load(std::memory_order_relaxed);
+}
+
+void Memory_Accounting::reset_peaks ()
+{
+    for (int i = 0; i < _MEMORY_SUBSYSTEM_COUNT; i++) {
+        this->peak_bytes[i].store(this->current_bytes[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+    this->total_peak_bytes.store(this->total_current_bytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+size_t Memory_Accounting::get_budget ()
+{
+    if (this->budget > 0) {
+        return this->budget;
+    }
+    size_t physical_memory_size = get_physical_memory_size();
+    if (physical_memory_size == 0) {
+        return MEMORY_BUDGET_FALLBACK;
+    }
+    return (size_t)(physical_memory_size * MEMORY_BUDGET_PHYSICAL_MEMORY_FRACTION);
+}
+
+bool Memory_Accounting::check_budget (size_t predicted_bytes, std::string what)
+{
+    size_t budget = this->get_budget();
+    if (predicted_bytes <= budget) {
+        return true;
+    }
+    std::cout << std::fixed << std::setprecision(1) << "WARNING: " << what << " needs about " << to_mib(predicted_bytes)
+        << " MiB, but the memory budget is " << to_mib(budget) << " MiB." << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+    return this->budget_mode != MEMORY_BUDGET_MODE_REFUSE;
+}
+
+void Memory_Accounting::print_report ()
+{
+    std::cout << std::fixed << std::setprecision(2) << "Memory usage (current / peak):" << std::endl;
+    for (int i = 0; i < _MEMORY_SUBSYSTEM_COUNT; i++) {
+        Memory_Subsystem memory_subsystem = (Memory_Subsystem)i;
+        std::cout << "  " << std::left << std::setw(28) << (std::string(to_string(memory_subsystem)) + ":") << std::right
+            << std::setw(10) << to_mib(this->get_current_bytes(memory_subsystem)) << " / "
+            << std::setw(10) << to_mib(this->get_peak_bytes(memory_subsystem)) << " MiB" << std::endl;
+    }
+    std::cout << "  " << std::left << std::setw(28) << "total:" << std::right
+        << std::setw(10) << to_mib(this->get_total_current_bytes()) << " / "
+        << std::setw(10) << to_mib(this->get_total_peak_bytes()) << " MiB" << std::endl;
+    std::cout << "  " << std::left << std::setw(28) << "budget:" << std::right
+        << std::setw(10) << to_mib(this->get_budget()) << " MiB (" << to_string(this->budget_mode) << ")" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+}
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstddef>
+
+// The memory accounting keeps track of how many bytes the big containers of the simulation and the
+// visualization use. Every container belongs to a subsystem. The containers use the tracked allocator
+// (see below), so every allocation and deallocation is counted. The GPU buffers are not allocated on
+// our heap, so the renderers report their buffer sizes by calling the hooks themselves.
+// For every subsystem the current and the peak number of bytes are known, so the profiler window and
+// the headless simulation can show where the memory went.
+// Before a scene is loaded (which also happens when the number of particles changes), the simulation
+// handler predicts the footprint of the new scene and compares it with the memory budget.
+// The default budget is a fraction of the physical memory of the machine.
+#define MEMORY_BUDGET_PHYSICAL_MEMORY_FRACTION  0.75
+// Used if the size of the physical memory cannot be determined (in bytes).
+#define MEMORY_BUDGET_FALLBACK                  (4ULL * 1024 * 1024 * 1024)
+// The limits of the budget slider of the profiler window in MiB.
+#define MEMORY_BUDGET_MIB_MIN                   64
+#define MEMORY_BUDGET_MIB_MAX                   65536
+
+enum Memory_Subsystem
+{
+    MEMORY_SUBSYSTEM_PARTICLES,
+    MEMORY_SUBSYSTEM_SPATIAL_GRID,
+    MEMORY_SUBSYSTEM_SPATIAL_GRID_MUTEXES,
+    MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR,
+    MEMORY_SUBSYSTEM_DENSITY_HISTOGRAMS,
+    MEMORY_SUBSYSTEM_COLOR_FIELD,
+    MEMORY_SUBSYSTEM_MARCHING_CUBES,
+    MEMORY_SUBSYSTEM_MARCHING_CUBES_MESH,
+    MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES,
+    MEMORY_SUBSYSTEM_FRAME_EXPORTER,
+    MEMORY_SUBSYSTEM_GPU_PARTICLE_BUFFERS,
+    MEMORY_SUBSYSTEM_GPU_MARCHING_CUBES_BUFFERS,
+    _MEMORY_SUBSYSTEM_COUNT
+};
+
+inline const char* to_string (Memory_Subsystem memory_subsystem)
+{
+    switch (memory_subsystem) {
+        case MEMORY_SUBSYSTEM_PARTICLES:                    return "particles";
+        case MEMORY_SUBSYSTEM_SPATIAL_GRID:                 return "spatial grid";
+        case MEMORY_SUBSYSTEM_SPATIAL_GRID_MUTEXES:         return "spatial grid mutexes";
+        case MEMORY_SUBSYSTEM_DENSITY_ESTIMATOR:            return "density estimator";
+        case MEMORY_SUBSYSTEM_DENSITY_HISTOGRAMS:           return "density histograms";
+        case MEMORY_SUBSYSTEM_COLOR_FIELD:                  return "color field";
+        case MEMORY_SUBSYSTEM_MARCHING_CUBES:               return "marching cubes";
+        case MEMORY_SUBSYSTEM_MARCHING_CUBES_MESH:          return "marching cubes mesh";
+        case MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES:        return "sparse marching cubes";
+        case MEMORY_SUBSYSTEM_FRAME_EXPORTER:               return "frame exporter";
+        case MEMORY_SUBSYSTEM_GPU_PARTICLE_BUFFERS:         return "GPU particle buffers";
+        case MEMORY_SUBSYSTEM_GPU_MARCHING_CUBES_BUFFERS:   return "GPU marching cubes buffers";
+        default:                                            return "unknown memory subsystem";
+    }
+}
+
+// What happens if a scene would exceed the memory budget?
+enum Memory_Budget_Mode
+{
+    // Only print a warning and load the scene anyway.
+    MEMORY_BUDGET_MODE_WARN,
+    // Do not load the scene.
+    MEMORY_BUDGET_MODE_REFUSE,
+    _MEMORY_BUDGET_MODE_COUNT
+};
+
+inline const char* to_string (Memory_Budget_Mode memory_budget_mode)
+{
+    switch (memory_budget_mode) {
+        case MEMORY_BUDGET_MODE_WARN:       return "WARN";
+        case MEMORY_BUDGET_MODE_REFUSE:     return "REFUSE";
+        default:                            return "unknown memory budget mode";
+    }
+}
+
+// Returns the size of the physical memory in bytes (0 if it cannot be determined).
+size_t get_physical_memory_size ();
+
+// The counters are updated by all worker threads (e.g. the spatial grid cells grow while the grid is
+// generated in parallel), so they are atomics. The class has no constructor on purpose: all members are
+// initialized with constants, so the global object is ready before any other global object allocates
+// something (no matter in what order the translation units are initialized).
+class Memory_Accounting
+{
+    private:
+        std::atomic<long long> current_bytes[_MEMORY_SUBSYSTEM_COUNT] = {};
+        std::atomic<long long> peak_bytes[_MEMORY_SUBSYSTEM_COUNT] = {};
+        // The peak of the sum of all subsystems (which is not the sum of the peaks).
+        std::atomic<long long> total_current_bytes {0};
+        std::atomic<long long> total_peak_bytes {0};
+        // Raises the peak to the given value if it is higher.
+        static void update_peak (std::atomic<long long>& peak, long long value);
+
+    public:
+        // The budget in bytes. 0 means the default budget (a fraction of the physical memory).
+        size_t budget = 0;
+        Memory_Budget_Mode budget_mode = MEMORY_BUDGET_MODE_REFUSE;
+
+        // The hooks. They are called by the tracked allocator and by everything that allocates memory
+        // that is not on our heap (the GPU buffers).
+        void memory_allocated (Memory_Subsystem memory_subsystem, size_t bytes);
+        void memory_freed (Memory_Subsystem memory_subsystem, size_t bytes);
+
+        size_t get_current_bytes (Memory_Subsystem memory_subsystem);
+        size_t get_peak_bytes (Memory_Subsystem memory_subsystem);
+        size_t get_total_current_bytes ();
+        size_t get_total_peak_bytes ();
+        // The peaks start again at the current values.
+        void reset_peaks ();
+
+        size_t get_budget ();
+        // Compares the predicted footprint with the budget. If the budget is exceeded a warning is printed.
+        // Returns false if the budget is exceeded and the budget mode is REFUSE.
+        bool check_budget (size_t predicted_bytes, std::string what);
+
+        // Prints the current and peak bytes of every subsystem.
+        void print_report ();
+};
+
+// The memory accounting of the application.
+extern Memory_Accounting memory_accounting;
+
+// An allocator that reports every allocation and deallocation of a container to the memory accounting.
+// The subsystem is a template parameter, so the allocator has no state and does not make the
+// containers bigger. Since the subsystem is not a type, std::allocator_traits cannot rebind the
+// allocator by itself, so rebind is defined explicitly.
+template <typename T, Memory_Subsystem memory_subsystem>
+class Tracked_Allocator
+{
+    public:
+        typedef T value_type;
+
+        template <typename U>
+        struct rebind
+        {
+            typedef Tracked_Allocator<U, memory_subsystem> other;
+        };
+
+        Tracked_Allocator () noexcept {}
+
+        template <typename U>
+        Tracked_Allocator (const Tracked_Allocator<U, memory_subsystem>&) noexcept {}
+
+        T* allocate (size_t n)
+        {
+            T* pointer = std::allocator<T>().allocate(n);
+            memory_accounting.memory_allocated(memory_subsystem, n * sizeof(T));
+            return pointer;
+        }
+
+        void deallocate (T* pointer, size_t n) noexcept
+        {
+            memory_accounting.memory_freed(memory_subsystem, n * sizeof(T));
+            std::allocator<T>().deallocate(pointer, n);
+        }
+};
+
+template <typename T, typename U, Memory_Subsystem memory_subsystem>
+inline bool operator== (const Tracked_Allocator<T, memory_subsystem>&, const Tracked_Allocator<U, memory_subsystem>&)
+{
+    return true;
+}
+
+template <typename T, typename U, Memory_Subsystem memory_subsystem>
+inline bool operator!= (const Tracked_Allocator<T, memory_subsystem>&, const Tracked_Allocator<U, memory_subsystem>&)
+{
+    return false;
+}
+
+// A vector whose memory is counted for the given subsystem.
+template <typename T, Memory_Subsystem memory_subsystem>
+using Tracked_Vector = std::vector<T, Tracked_Allocator<T, memory_subsystem>>;
\ No newline at end of file
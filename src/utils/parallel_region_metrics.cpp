@@ -0,0 +1,125 @@
+#include "parallel_region_metrics.h"
+
+#include <algorithm>
+#include <mutex>
+
+// For more details see parallel_region_metrics.h:
+thread_local const Parallel_Region_Metrics* last_parallel_region = nullptr;
+thread_local unsigned long long number_of_finished_parallel_regions = 0;
+std::map<const char*, std::vector<Parallel_Region_Values>, Parallel_Region_Name_Less> parallel_region_values;
+std::mutex parallel_region_values_mutex;
+
+inline long long get_steady_clock_nanoseconds ()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void begin_parallel_thread (Parallel_Thread_Metrics* metrics)
+{
+    if (metrics != nullptr) {
+        metrics->start = get_steady_clock_nanoseconds();
+    }
+}
+
+void end_parallel_thread (Parallel_Thread_Metrics* metrics)
+{
+    if (metrics != nullptr) {
+        metrics->end = get_steady_clock_nanoseconds();
+    }
+}
+
+
+// ====================================== STATISTICS ======================================
+
+Parallel_Region_Statistics::Parallel_Region_Statistics ()
+{
+    this->region_start = 0;
+    this->current_region = nullptr;
+}
+
+Parallel_Region_Metrics* Parallel_Region_Statistics::begin_region (const char* name, unsigned int number_of_threads_requested)
+{
+    auto region = this->regions.find(name);
+    if (region == this->regions.end()) {
+        Parallel_Region_Metrics metrics {};
+        metrics.name = name;
+        region = this->regions.emplace(name, metrics).first;
+    }
+    this->current_region = &region->second;
+    this->current_region->number_of_threads_requested = number_of_threads_requested;
+    // Resizing does not allocate after the first execution (as long as the number of threads stays the same).
+    this->current_region->threads.assign(number_of_threads_requested, Parallel_Thread_Metrics {});
+    this->region_start = get_steady_clock_nanoseconds();
+    return this->current_region;
+}
+
+void Parallel_Region_Statistics::end_region (unsigned int number_of_threads_launched)
+{
+    long long region_end = get_steady_clock_nanoseconds();
+    Parallel_Region_Metrics& region = *this->current_region;
+    region.number_of_threads_launched = number_of_threads_launched;
+    region.duration = region_end - this->region_start;
+    // The threads that were not launched are removed from the list (they are still counted for the utilisation).
+    region.threads.resize(number_of_threads_launched);
+    long long sum_busy_time = 0;
+    long long max_busy_time = 0;
+    region.idle_time = 0;
+    for (Parallel_Thread_Metrics& thread : region.threads) {
+        thread.idle_time = region_end - thread.end;
+        thread.start -= this->region_start;
+        thread.end -= this->region_start;
+        long long busy_time = thread.end - thread.start;
+        sum_busy_time += busy_time;
+        max_busy_time = std::max(max_busy_time, busy_time);
+        region.idle_time += thread.idle_time;
+    }
+    double mean_busy_time = (number_of_threads_launched > 0) ? (double)sum_busy_time / number_of_threads_launched : 0.0;
+    region.imbalance_factor = (mean_busy_time > 0.0) ? max_busy_time / mean_busy_time : 1.0;
+    region.utilisation = ((region.duration > 0) && (region.number_of_threads_requested > 0)) ? 
+        (double)sum_busy_time / ((double)region.duration * region.number_of_threads_requested) : 1.0;
+    // The first execution initializes the smoothed values.
+    if (region.number_of_executions == 0) {
+        region.average_imbalance_factor = region.imbalance_factor;
+        region.average_utilisation = region.utilisation;
+    }
+    else {
+        region.average_imbalance_factor += PARALLEL_REGION_SMOOTHING_FACTOR * (region.imbalance_factor - region.average_imbalance_factor);
+        region.average_utilisation += PARALLEL_REGION_SMOOTHING_FACTOR * (region.utilisation - region.average_utilisation);
+    }
+    region.number_of_executions++;
+    last_parallel_region = &region;
+    number_of_finished_parallel_regions++;
+    this->current_region = nullptr;
+}
+
+void Parallel_Region_Statistics::clear ()
+{
+    this->regions.clear();
+    this->current_region = nullptr;
+    last_parallel_region = nullptr;
+}
+
+
+// ====================================== MEASURED FUNCTIONS ======================================
+
+void add_parallel_region_values (const char* function, const Parallel_Region_Metrics& region)
+{
+    std::lock_guard<std::mutex> lock(parallel_region_values_mutex);
+    parallel_region_values[function].push_back({ region.imbalance_factor, region.utilisation });
+}
+
+std::vector<Parallel_Region_Values> get_parallel_region_values (const std::string& function)
+{
+    std::lock_guard<std::mutex> lock(parallel_region_values_mutex);
+    auto values = parallel_region_values.find(function.c_str());
+    if (values == parallel_region_values.end()) {
+        return {};
+    }
+    return values->second;
+}
+
+void clear_parallel_region_values ()
+{
+    std::lock_guard<std::mutex> lock(parallel_region_values_mutex);
+    parallel_region_values.clear();
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <cstring>
+
+// Metrics about the parallel regions (every call of a parallel for loop). A parallel for loop splits the work
+// into chunks and starts one thread per chunk. If the chunks do not need the same time, the threads that are
+// done early are idle until the last thread is joined. parallel_for_grid additionally assigns the chunks based
+// on the number of particles in the grid cells and stops early if the particles are concentrated in a few cells,
+// so fewer threads than requested may be launched.
+// For every region we record the work (elements and particles), the start and end of every thread and the idle
+// time until the join. From this two values are derived:
+// - The imbalance factor: the longest busy time of a thread divided by the mean busy time (1 is perfect).
+// - The utilisation: the sum of the busy times divided by (requested threads * duration of the region). Threads
+//   that were not launched count as idle.
+// Collecting the metrics only needs two clock reads per thread, so it is always active.
+// How much the last execution of a region counts for the smoothed values (exponential moving average).
+#define PARALLEL_REGION_SMOOTHING_FACTOR        0.05
+
+// The metrics of one thread (chunk) of a parallel region.
+struct Parallel_Thread_Metrics
+{
+    unsigned int number_of_elements;
+    unsigned int number_of_particles;
+    // In nanoseconds relative to the start of the region. The thread writes start and end itself (as time since
+    // the epoch of the steady clock), they are made relative when the region ends.
+    long long start;
+    long long end;
+    // The time from the end of the thread until the join of the region (in nanoseconds).
+    long long idle_time;
+};
+
+// The metrics of one parallel region. The values are from the last execution of the region, except for the
+// smoothed ones.
+struct Parallel_Region_Metrics
+{
+    const char* name;
+    unsigned int number_of_threads_requested;
+    unsigned int number_of_threads_launched;
+    std::vector<Parallel_Thread_Metrics> threads;
+    // In nanoseconds, from the start of the region until the last thread was joined.
+    long long duration;
+    long long idle_time;
+    double imbalance_factor;
+    double utilisation;
+    // Smoothed over the executions.
+    double average_imbalance_factor;
+    double average_utilisation;
+    unsigned long long number_of_executions;
+};
+
+// The regions and the measured functions are named by string literals (see get_region_name of the particle system
+// and MEASURE_EXECUTION_TIME), so they are keyed by the pointers and compared by their characters. Looking up a
+// region does not create a string.
+struct Parallel_Region_Name_Less
+{
+    bool operator() (const char* a, const char* b) const { return std::strcmp(a, b) < 0; }
+};
+
+// Keeps the metrics of all parallel regions of an object (e.g. the particle system). The regions of an object are
+// started and ended by the thread that owns the object (only the chunks run on other threads).
+class Parallel_Region_Statistics
+{
+    private:
+        long long region_start;
+        Parallel_Region_Metrics* current_region;
+
+    public:
+        Parallel_Region_Statistics ();
+
+        // The metrics of all regions sorted by their name.
+        std::map<const char*, Parallel_Region_Metrics, Parallel_Region_Name_Less> regions;
+
+        // Starts a region. The name has to outlive the statistics (a string literal). The returned metrics have one entry
+        // per requested thread (so the threads can write into their entry without synchronization). The caller sets the
+        // work of the threads it launches.
+        Parallel_Region_Metrics* begin_region (const char* name, unsigned int number_of_threads_requested);
+        // Called after the join. Calculates the idle times, the imbalance factor and the utilisation.
+        void end_region (unsigned int number_of_threads_launched);
+        void clear ();
+};
+
+// Called by the threads at the start and at the end of their chunk (metrics may be nullptr).
+void begin_parallel_thread (Parallel_Thread_Metrics* metrics);
+void end_parallel_thread (Parallel_Thread_Metrics* metrics);
+
+// The region finished last by the calling thread and the number of regions it finished so far. The performance
+// test uses this to save the imbalance factor of a measured function (if it consists of exactly one region).
+extern thread_local const Parallel_Region_Metrics* last_parallel_region;
+extern thread_local unsigned long long number_of_finished_parallel_regions;
+
+// The imbalance factor and the utilisation of every measured function (one entry per call, like the execution times).
+struct Parallel_Region_Values
+{
+    double imbalance_factor;
+    double utilisation;
+};
+
+// The values are kept per measured function for the whole program. Several simulations may be measured by different
+// threads at the same time (e.g. the members of an ensemble), so the values are only accessed through these functions,
+// which hold a mutex. The function is the measured expression (a string literal).
+void add_parallel_region_values (const char* function, const Parallel_Region_Metrics& region);
+std::vector<Parallel_Region_Values> get_parallel_region_values (const std::string& function);
+void clear_parallel_region_values ();
\ No newline at end of file
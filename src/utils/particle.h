@@ -1,23 +1,27 @@
 #pragma once
 
-#include <GL/glew.h>
 #include <glm/glm.hpp>
 
+#include "memory_accounting.h"
+
 // Particle.
 struct Particle 
 {
     glm::vec3 position;
-    GLfloat density;
-    GLfloat pressure;
+    float density;
+    float pressure;
     glm::vec3 velocity;
     glm::vec3 acceleration;
     // For the velocity verlet integration we also need the old acceleration.
     glm::vec3 old_acceleration;
+    // The particles vector gets reordered during the simulation (spatial grid), so we
+    // need a stable identifier for each particle (e.g. for recording the simulation).
+    unsigned int id;
 };
 
+// The vector holding the particles of the particle system. Its memory is counted by the memory accounting.
+typedef Tracked_Vector<Particle, MEMORY_SUBSYSTEM_PARTICLES> Particle_Vector;
+
 // A function that returns particle based on the given x, y, z position.
 // All other values are set to their default values.
-Particle get_default_particle(float x, float y, float z);
-
-// Describe the layout for the vertex buffer object.
-void describe_particle_memory_layout ();
\ No newline at end of file
+Particle get_default_particle(float x, float y, float z, unsigned int id = 0);
\ No newline at end of file
@@ -1,16 +1,19 @@
 #include "particle_system.h"
 
 #include <math.h>
+#include <iostream>
 #include <thread>
 #include <algorithm>
 
-#include "debug.h"
 #include "performance_test.h"
+#include "trace.h"
+#include "performance_counters.h"
+#include "frame_profiler.h"
 #include "helper.h"
 
 Particle_System::Particle_System ()
 {
-    this->vertex_array_object = 0;
+    this->simulation_space = nullptr;
     this->number_of_particles = 0;
     this->number_of_particles_as_string = to_string_with_separator(this->number_of_particles);
     this->particle_initial_distance = PARTICLE_INITIAL_DISTANCE_INIT;
@@ -18,12 +21,16 @@ Particle_System::Particle_System ()
     this->reset_fluid_attributes();
     this->reset_collision_attributes();
     this->number_of_cells = 0;
+    this->spatial_grid_is_current = false;
     this->gravity_mode = GRAVITY_WAVE;
     this->external_forces_active = true;
     this->external_force_radius = SPH_EXTERNAL_FORCE_RADIUS;
     this->external_force_direction = EXTERNAL_FORCE_REPELLENT;
     this->computation_mode = COMPUTATION_MODE_SPATIAL_GRID;
     this->number_of_threads = SIMULATION_NUMBER_OF_THREADS;
+    this->thread_pool = nullptr;
+    this->seeding_pattern = SEEDING_PATTERN_CUBIC;
+    this->seeding_cuboids = nullptr;
 }
 
 
@@ -31,50 +38,128 @@ Particle_System::Particle_System ()
 
 void Particle_System::generate_initial_particles (std::vector<Cuboid>& cuboids)
 {
-    // Free the memory if it was used before.
-    this->particles.clear();
-    // Fill all cuboids with particles.
+    // Calculate the lattice of every cuboid. This gives us the number of particles of every cuboid and so
+    // the index of the first particle of every cuboid within the particles vector.
+    this->seeding_cuboids = &cuboids;
+    this->seeding_lattices.clear();
+    this->seeding_first_particle_indices.clear();
+    unsigned int number_of_particles = 0;
     for (int i = 0; i < cuboids.size(); i++) {
-        cuboids.at(i).fill_with_particles(this->particle_initial_distance, this->particles);
+        this->seeding_lattices.push_back(cuboids.at(i).get_seeding_lattice(this->particle_initial_distance, this->seeding_pattern));
+        this->seeding_first_particle_indices.push_back(number_of_particles);
+        number_of_particles += this->seeding_lattices.back().number_of_particles;
+    }
+    // Free the memory if it was used before and allocate exactly the memory we need, so the memory accounting
+    // sees the footprint that was predicted (see predict_memory_footprint).
+    this->particles.clear();
+    this->particles.shrink_to_fit();
+    this->particles.resize(number_of_particles);
+    this->number_of_particles = number_of_particles;
+    // Every particle can be created from its index alone, so fill the particles vector using multiple threads.
+    // The parallel for needs at least one particle per thread.
+    if (this->number_of_particles >= this->number_of_threads) {
+        this->parallel_for(&Particle_System::seed_particles, this->number_of_particles);
+    }
+    else if (this->number_of_particles > 0) {
+        this->seed_particles(0, this->number_of_particles - 1);
     }
-    // Get the number of particles.
-    this->number_of_particles = this->particles.size();
+    this->seeding_cuboids = nullptr;
     this->number_of_particles_as_string = to_string_with_separator(this->number_of_particles);
+    this->particles_changed();
 
-    // Clear the buffers if there is something to clear.
-    this->free_gpu_resources();
+    // Reset the simulation time.
+    this->simulation_step = 0;
+}
 
-    // Generate the OpenGL buffers for the particle system.
-    GLCall( glGenVertexArrays(1, &this->vertex_array_object) );
-    GLCall( glGenBuffers(1, &this->vertex_buffer_object) );
-    GLCall( glGenBuffers(1, &this->index_buffer_object) );
+void Particle_System::seed_particles (unsigned int index_start, unsigned int index_end)
+{
+    // Find the cuboid of the first particle of the chunk (the last cuboid that starts at or before it).
+    unsigned int cuboid_index = std::upper_bound(this->seeding_first_particle_indices.begin(),
+        this->seeding_first_particle_indices.end(), index_start) - this->seeding_first_particle_indices.begin() - 1;
+    for (unsigned int i = index_start; i <= index_end; i++) {
+        // Move on to the next cuboid (skipping the cuboids without particles) if the current one is full.
+        while ((cuboid_index + 1 < this->seeding_first_particle_indices.size()) && 
+            (i >= this->seeding_first_particle_indices.at(cuboid_index + 1))) {
+            cuboid_index++;
+        }
+        glm::vec3 position = this->seeding_cuboids->at(cuboid_index).get_particle_position(this->seeding_lattices.at(cuboid_index), 
+            i - this->seeding_first_particle_indices.at(cuboid_index));
+        // The index is also the identifier of the particle.
+        this->particles[i] = get_default_particle(position.x, position.y, position.z, i);
+    }
+}
 
-    // Make vertex array object active.  
-    GLCall( glBindVertexArray(this->vertex_array_object) );
+unsigned int Particle_System::get_seeding_cuboid_index (Particle& particle)
+{
+    return std::upper_bound(this->seeding_first_particle_indices.begin(),
+        this->seeding_first_particle_indices.end(), particle.id) - this->seeding_first_particle_indices.begin() - 1;
+}
 
-    // Copy the data into the vertex buffer object.
-    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
-    GLCall( glBufferData(GL_ARRAY_BUFFER, sizeof(Particle) * this->number_of_particles, &this->particles.at(0), GL_STATIC_DRAW) );
+unsigned int Particle_System::relax_initial_particles (std::vector<Cuboid>& cuboids)
+{
+    // Save the settings we change for the relaxation. There is nothing the user could interact with yet.
+    Gravity_Mode gravity_mode = this->gravity_mode;
+    bool external_forces_active = this->external_forces_active;
+    this->gravity_mode = GRAVITY_NORMAL;
+    this->external_forces_active = false;
+    unsigned int step = 0;
+    float kinetic_energy = 0.0f;
+    while (step < RELAXATION_MAX_STEPS) {
+        this->simulate();
+        step++;
+        kinetic_energy = 0.0f;
+        for (Particle& particle : this->particles) {
+            particle.velocity *= (1.0f - RELAXATION_VELOCITY_DAMPING);
+            // Keep the particle within its cuboid (like a wall that is removed when the simulation starts).
+            Cuboid& cuboid = cuboids.at(this->get_seeding_cuboid_index(particle));
+            glm::vec3 cuboid_min = glm::vec3(cuboid.x_min, cuboid.y_min, cuboid.z_min);
+            glm::vec3 cuboid_max = glm::vec3(cuboid.x_max, cuboid.y_max, cuboid.z_max);
+            for (int axis = 0; axis < 3; axis++) {
+                if (particle.position[axis] < cuboid_min[axis]) {
+                    particle.position[axis] = cuboid_min[axis];
+                    particle.velocity[axis] = std::max(particle.velocity[axis], 0.0f);
+                }
+                else if (particle.position[axis] > cuboid_max[axis]) {
+                    particle.position[axis] = cuboid_max[axis];
+                    particle.velocity[axis] = std::min(particle.velocity[axis], 0.0f);
+                }
+            }
+            kinetic_energy += 0.5f * this->sph_particle_mass * glm::dot(particle.velocity, particle.velocity);
+        }
+        kinetic_energy /= std::max(this->number_of_particles, 1u);
+        if ((step >= RELAXATION_MIN_STEPS) && (kinetic_energy < RELAXATION_KINETIC_ENERGY_THRESHOLD)) {
+            break;
+        }
+    }
+    std::cout << "Relaxed the initial particles in " << step << " steps (mean kinetic energy " << kinetic_energy << " J)." << std::endl;
+    // The simulation starts now.
+    this->gravity_mode = gravity_mode;
+    this->external_forces_active = external_forces_active;
+    this->simulation_step = 0;
+    // The particles were moved back into their cuboids after the last step.
+    this->particles_changed();
+    return step;
+}
 
-    // Copy the indices into the index buffer object.
-    GLCall( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer_object) );
-    this->particle_indices.clear();
+void Particle_System::set_number_of_particles (unsigned int number_of_particles)
+{
+    // Used when the particles are not generated by the particle system itself (e.g. by the replay
+    // of a recording). The particles get their default values and the caller fills in the data.
+    this->particles.assign(number_of_particles, get_default_particle(0.0f, 0.0f, 0.0f));
+    this->number_of_particles = number_of_particles;
     for (unsigned int i = 0; i < this->number_of_particles; i++) {
-        this->particle_indices.push_back(i);
+        this->particles.at(i).id = i;
     }
-    GLCall( glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * this->number_of_particles, &this->particle_indices.at(0), GL_STATIC_DRAW) );
-
-    // Describe the vertex buffer layout of a particle.
-    describe_particle_memory_layout();
-
-    // Unbind.
-    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
-    GLCall( glBindVertexArray(0) );
-
-    // Reset the simulation time.
+    this->number_of_particles_as_string = to_string_with_separator(this->number_of_particles);
+    this->particles_changed();
     this->simulation_step = 0;
 }
 
+void Particle_System::particles_changed ()
+{
+    this->spatial_grid_is_current = false;
+}
+
 void Particle_System::calculate_kernel_radius ()
 {
     this->sph_kernel_radius = 4 * this->particle_initial_distance;
@@ -156,6 +241,30 @@ bool Particle_System::decrease_number_of_particles ()
     }
 }
 
+bool Particle_System::set_particle_initial_distance (float particle_initial_distance)
+{
+    if ((particle_initial_distance < PARTICLE_INITIAL_DISTANCE_MIN) || (particle_initial_distance > PARTICLE_INITIAL_DISTANCE_MAX)) {
+        return false;
+    }
+    this->particle_initial_distance = particle_initial_distance;
+    this->calculate_kernel_radius();
+    // The grid can only be calculated if we already know the simulation space.
+    if (this->simulation_space != nullptr) {
+        this->calculate_number_of_grid_cells();
+    }
+    return true;
+}
+
+float Particle_System::get_particle_initial_distance ()
+{
+    return this->particle_initial_distance;
+}
+
+unsigned int Particle_System::get_simulation_step ()
+{
+    return this->simulation_step;
+}
+
 
 // ====================================== SPH KERNEL FUNCTIONS ======================================
 
@@ -380,12 +489,18 @@ void Particle_System::parallel_for (void (Particle_System::* function)(unsigned
     // Calculate the chunk size (it depends whether we operate on the particles vector itself or the spatial grid).
     if (this->number_of_threads == 1) {
         // Just execute the function if only one thread is desired.
-        (this->*function)(0, number_of_elements - 1);
+        Parallel_Region_Metrics* region = this->parallel_region_statistics.begin_region(this->get_region_name(function), 1);
+        region->threads[0].number_of_elements = number_of_elements;
+        region->threads[0].number_of_particles = number_of_elements;
+        this->execute_chunk(function, 0, number_of_elements - 1, &region->threads[0]);
+        this->parallel_region_statistics.end_region(1);
         return;
     }
+    Parallel_Region_Metrics* region = this->parallel_region_statistics.begin_region(this->get_region_name(function), this->number_of_threads);
     int chunk_size = number_of_elements / this->number_of_threads;
     std::vector<std::thread> threads;
     threads.reserve(this->number_of_threads);
+    Task_Group task_group;
     // Create the threads.
     for (int i = 0; i < this->number_of_threads; i++) {
         int chunk_start = i * chunk_size;
@@ -394,14 +509,14 @@ void Particle_System::parallel_for (void (Particle_System::* function)(unsigned
         if (i == this->number_of_threads - 1) {
             chunk_end = number_of_elements - 1;
         }
-        // With the following call we not only append the thread to the vector but with 
-        // creating the thread it also starts.
-        threads.emplace_back(function, this, chunk_start, chunk_end);
+        // The elements are the particles here.
+        region->threads[i].number_of_elements = chunk_end - chunk_start + 1;
+        region->threads[i].number_of_particles = chunk_end - chunk_start + 1;
+        this->start_chunk(function, chunk_start, chunk_end, &region->threads[i], threads, task_group);
     }
     // Wait for the threads to finish.
-    for (auto& thread : threads) {
-        thread.join();
-    }
+    this->join_chunks(threads, task_group);
+    this->parallel_region_statistics.end_region(this->number_of_threads);
 }
 
 void Particle_System::parallel_for_grid (void (Particle_System::* function)(unsigned int, unsigned int))
@@ -414,12 +529,20 @@ void Particle_System::parallel_for_grid (void (Particle_System::* function)(unsi
     // Calculate the chunk size not on the number of grid cells (evenly), but on the number of particles.
     if (this->number_of_threads == 1) {
         // Just execute the function if only one thread is desired.
-        (this->*function)(0, this->number_of_cells - 1);
+        Parallel_Region_Metrics* region = this->parallel_region_statistics.begin_region(this->get_region_name(function), 1);
+        region->threads[0].number_of_elements = this->number_of_cells;
+        region->threads[0].number_of_particles = this->number_of_particles;
+        this->execute_chunk(function, 0, this->number_of_cells - 1, &region->threads[0]);
+        this->parallel_region_statistics.end_region(1);
         return;
     }
+    // The metrics show how many threads were really launched (see the early exits below).
+    Parallel_Region_Metrics* region = this->parallel_region_statistics.begin_region(this->get_region_name(function), this->number_of_threads);
     int evenly_distributed_number_of_particles = this->number_of_particles / this->number_of_threads;
     std::vector<std::thread> threads;
     threads.reserve(this->number_of_threads);
+    Task_Group task_group;
+    int number_of_chunks = 0;
     // Create the threads.
     int chunk_number_of_particles = 0;
     int already_assigned_number_of_particles = 0;
@@ -429,7 +552,10 @@ void Particle_System::parallel_for_grid (void (Particle_System::* function)(unsi
         chunk_number_of_particles += this->spatial_grid.at(idx_cell).size();
         if (chunk_number_of_particles >= evenly_distributed_number_of_particles) {
             chunk_end = idx_cell;
-            threads.emplace_back(function, this, chunk_start, chunk_end);
+            Parallel_Thread_Metrics* thread_metrics = &region->threads[number_of_chunks++];
+            thread_metrics->number_of_elements = chunk_end - chunk_start + 1;
+            thread_metrics->number_of_particles = chunk_number_of_particles;
+            this->start_chunk(function, chunk_start, chunk_end, thread_metrics, threads, task_group);
             chunk_start = idx_cell + 1;
             already_assigned_number_of_particles += chunk_number_of_particles;
             chunk_number_of_particles = 0;
@@ -442,18 +568,100 @@ void Particle_System::parallel_for_grid (void (Particle_System::* function)(unsi
         // Check if we are now in for the last thread. If so, just assign the task.
         // It can also be that the particles are so unevenly distributed that e.g. after 6/8 threads most of 
         // the particles are assigned to the threads and a seventh one would not be filled up completely. Check this case too.
-        if ((threads.size() == (this->number_of_threads - 1)) || 
+        if ((number_of_chunks == (this->number_of_threads - 1)) || 
             ((this->number_of_particles - already_assigned_number_of_particles) < evenly_distributed_number_of_particles)) {
-            threads.emplace_back(function, this, chunk_start, this->number_of_cells - 1);
+            Parallel_Thread_Metrics* thread_metrics = &region->threads[number_of_chunks++];
+            thread_metrics->number_of_elements = this->number_of_cells - chunk_start;
+            thread_metrics->number_of_particles = this->number_of_particles - already_assigned_number_of_particles;
+            this->start_chunk(function, chunk_start, this->number_of_cells - 1, thread_metrics, threads, task_group);
             break;
         }
     }
     // Wait for the threads to finish.
+    this->join_chunks(threads, task_group);
+    this->parallel_region_statistics.end_region(number_of_chunks);
+}
+
+void Particle_System::start_chunk ( void (Particle_System::* function)(unsigned int, unsigned int), unsigned int index_start, unsigned int index_end, 
+                                    Parallel_Thread_Metrics* metrics, std::vector<std::thread>& threads, Task_Group& task_group)
+{
+    if (this->thread_pool != nullptr) {
+        this->thread_pool->submit_chunk(task_group, [this, function, index_start, index_end, metrics] () {
+            this->execute_chunk(function, index_start, index_end, metrics);
+        });
+        return;
+    }
+    // With the following call we not only append the thread to the vector but with 
+    // creating the thread it also starts.
+    threads.emplace_back(&Particle_System::execute_chunk, this, function, index_start, index_end, metrics);
+}
+
+void Particle_System::join_chunks (std::vector<std::thread>& threads, Task_Group& task_group)
+{
+    if (this->thread_pool != nullptr) {
+        this->thread_pool->wait(task_group);
+        return;
+    }
     for (auto& thread : threads) {
         thread.join();
     }
 }
 
+void Particle_System::execute_chunk (void (Particle_System::* function)(unsigned int, unsigned int), unsigned int index_start, unsigned int index_end, 
+    Parallel_Thread_Metrics* metrics)
+{
+    TRACE_SCOPE_RANGE("Particle_System worker", index_start, index_end);
+    COUNT_WORKER_PERFORMANCE_EVENTS();
+    begin_parallel_thread(metrics);
+    (this->*function)(index_start, index_end);
+    end_parallel_thread(metrics);
+}
+
+void Particle_System::predict_memory_footprint (    std::vector<Cuboid>& cuboids, 
+                                                    Cuboid& simulation_space, 
+                                                    float particle_initial_distance, 
+                                                    Seeding_Pattern seeding_pattern, 
+                                                    size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT])
+{
+    size_t number_of_particles = 0;
+    for (int i = 0; i < cuboids.size(); i++) {
+        number_of_particles += cuboids.at(i).get_number_of_particles(particle_initial_distance, seeding_pattern);
+    }
+    this->predict_memory_footprint(number_of_particles, simulation_space, particle_initial_distance, predicted_bytes);
+}
+
+void Particle_System::predict_memory_footprint (    size_t number_of_particles, 
+                                                    Cuboid& simulation_space, 
+                                                    float particle_initial_distance, 
+                                                    size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT])
+{
+    // The same calculation as in calculate_kernel_radius and calculate_number_of_grid_cells.
+    float kernel_radius = 4 * particle_initial_distance;
+    size_t number_of_cells = 
+        (size_t)ceil((simulation_space.x_max - simulation_space.x_min) / kernel_radius) * 
+        (size_t)ceil((simulation_space.y_max - simulation_space.y_min) / kernel_radius) * 
+        (size_t)ceil((simulation_space.z_max - simulation_space.z_min) / kernel_radius);
+    // The particles vector gets exactly the memory it needs (see generate_initial_particles and update_particle_vector).
+    predicted_bytes[MEMORY_SUBSYSTEM_PARTICLES] += number_of_particles * sizeof(Particle);
+    // A grid cell doubles its capacity when it is full, so its capacity is less than twice its number of particles.
+    predicted_bytes[MEMORY_SUBSYSTEM_SPATIAL_GRID] += number_of_cells * sizeof(Tracked_Vector<Particle, MEMORY_SUBSYSTEM_SPATIAL_GRID>) + 
+        2 * number_of_particles * sizeof(Particle);
+    predicted_bytes[MEMORY_SUBSYSTEM_SPATIAL_GRID_MUTEXES] += number_of_cells * sizeof(std::mutex);
+}
+
+const char* Particle_System::get_region_name (void (Particle_System::* function)(unsigned int, unsigned int))
+{
+    if (function == &Particle_System::generate_spatial_grid)                          return "generate_spatial_grid";
+    if (function == &Particle_System::calculate_density_pressure_spatial_grid)        return "calculate_density_pressure_spatial_grid";
+    if (function == &Particle_System::calculate_acceleration_spatial_grid)            return "calculate_acceleration_spatial_grid";
+    if (function == &Particle_System::calculate_verlet_step_spatial_grid)             return "calculate_verlet_step_spatial_grid";
+    if (function == &Particle_System::calculate_density_pressure_brute_force)         return "calculate_density_pressure_brute_force";
+    if (function == &Particle_System::calculate_acceleration_brute_force)             return "calculate_acceleration_brute_force";
+    if (function == &Particle_System::calculate_verlet_step_brute_force)              return "calculate_verlet_step_brute_force";
+    if (function == &Particle_System::seed_particles)                                 return "seed_particles";
+    return "unknown region";
+}
+
 // ===================================== SPH BRUTE FORCE IMPLEMENTATION ===================================
 
 void Particle_System::calculate_density_pressure_brute_force (unsigned int index_start, unsigned int index_end)
@@ -526,11 +734,22 @@ void Particle_System::calculate_verlet_step_brute_force (unsigned int index_star
 void Particle_System::simulate_brute_force ()
 {
     // Calculate the density and the pressure for each particle.
-    MEASURE_EXECUTION_TIME( this->parallel_for(&Particle_System::calculate_density_pressure_brute_force, this->number_of_particles) );
+    {
+        PROFILE_PHASE(PROFILER_PHASE_DENSITY);
+        MEASURE_EXECUTION_TIME( this->parallel_for(&Particle_System::calculate_density_pressure_brute_force, this->number_of_particles) );
+    }
     // Calculate the forces and acceleration.
-    MEASURE_EXECUTION_TIME( this->parallel_for(&Particle_System::calculate_acceleration_brute_force, this->number_of_particles) );
+    {
+        PROFILE_PHASE(PROFILER_PHASE_FORCES);
+        MEASURE_EXECUTION_TIME( this->parallel_for(&Particle_System::calculate_acceleration_brute_force, this->number_of_particles) );
+    }
     // Calculate the new positions and velocities.
-    MEASURE_EXECUTION_TIME( this->parallel_for(&Particle_System::calculate_verlet_step_brute_force, this->number_of_particles) );
+    {
+        PROFILE_PHASE(PROFILER_PHASE_INTEGRATION);
+        MEASURE_EXECUTION_TIME( this->parallel_for(&Particle_System::calculate_verlet_step_brute_force, this->number_of_particles) );
+    }
+    // The spatial grid is not used in this mode.
+    this->particles_changed();
 }
 
 
@@ -545,13 +764,11 @@ void Particle_System::calculate_number_of_grid_cells ()
     this->number_of_cells_z = ceil((this->simulation_space->z_max - this->simulation_space->z_min) / 
         this->sph_kernel_radius);
     this->number_of_cells = this->number_of_cells_x * this->number_of_cells_y * this->number_of_cells_z;
-    // Resize the mutex vector.
-    // Iterate over each element in the vector and assign a newly created std::mutex using std::make_unique.
-    this->mutex_spatial_grid.clear();
-    this->mutex_spatial_grid.resize(this->number_of_cells);
-    for (auto& mutex : this->mutex_spatial_grid) {
-        mutex = std::make_unique<std::mutex>();
-    }
+    // Replace the mutex vector. A std::mutex can neither be copied nor moved, so the vector cannot be resized.
+    // Instead we create a new vector with the right number of mutexes and swap it with the old one.
+    Tracked_Vector<std::mutex, MEMORY_SUBSYSTEM_SPATIAL_GRID_MUTEXES>(this->number_of_cells).swap(this->mutex_spatial_grid);
+    // The cells of the spatial grid no longer match.
+    this->spatial_grid_is_current = false;
 }
 
 inline int Particle_System::discretize_value (float value)
@@ -604,7 +821,7 @@ void Particle_System::generate_spatial_grid (unsigned int index_start, unsigned
         // Assign the particle based on its position to a grid cell. Get the index of this cell.
         int grid_key = this->get_grid_key(this->particles.at(i).position);
         // Lock the spatial grid cell for the insertion of the particle.
-        std::unique_lock<std::mutex> lock(*this->mutex_spatial_grid.at(grid_key));
+        std::unique_lock<std::mutex> lock(this->mutex_spatial_grid.at(grid_key));
         this->spatial_grid.at(grid_key).push_back(this->particles.at(i));
         lock.unlock();
     }
@@ -730,22 +947,59 @@ void Particle_System::update_particle_vector ()
 void Particle_System::simulate_spatial_grid ()
 {
     // Create the spatial grid.
-    this->spatial_grid.clear();
-    this->spatial_grid.resize(this->number_of_cells);
-    this->parallel_for(&Particle_System::generate_spatial_grid, this->number_of_particles);
+    {
+        TRACE_SCOPE("Particle_System::generate_spatial_grid");
+        PROFILE_PHASE(PROFILER_PHASE_GRID_BUILD);
+        this->spatial_grid.clear();
+        this->spatial_grid.resize(this->number_of_cells);
+        this->parallel_for(&Particle_System::generate_spatial_grid, this->number_of_particles);
+    }
     // Calculate the density and the pressure for each particle using multiple threads.
-    MEASURE_EXECUTION_TIME( this->parallel_for_grid(&Particle_System::calculate_density_pressure_spatial_grid) );
+    {
+        PROFILE_PHASE(PROFILER_PHASE_DENSITY);
+        MEASURE_EXECUTION_TIME( this->parallel_for_grid(&Particle_System::calculate_density_pressure_spatial_grid) );
+    }
     // Calculate the forces and acceleration using multiple threads.
-    MEASURE_EXECUTION_TIME( this->parallel_for_grid(&Particle_System::calculate_acceleration_spatial_grid) );
+    {
+        PROFILE_PHASE(PROFILER_PHASE_FORCES);
+        MEASURE_EXECUTION_TIME( this->parallel_for_grid(&Particle_System::calculate_acceleration_spatial_grid) );
+    }
     // Calculate the new positions and apply collision handling using multiple threads.
-    MEASURE_EXECUTION_TIME( this->parallel_for_grid(&Particle_System::calculate_verlet_step_spatial_grid) );
+    {
+        PROFILE_PHASE(PROFILER_PHASE_INTEGRATION);
+        MEASURE_EXECUTION_TIME( this->parallel_for_grid(&Particle_System::calculate_verlet_step_spatial_grid) );
+    }
     // Get the updated particles vector. We operated until here on the grid.
     // Another solution was to update the grid itself (so iterate over all grid cells and over
     // their particles and check if a particle has to be moved to another cell after this step).
     // This was also implemented and compared to the clear-and-generate-new-method we use now it
     // had no benefit in execution time. The last commit the update-grid-method was still implemented
     // is "f1ab3e1".
-    this->update_particle_vector();
+    {
+        TRACE_SCOPE("Particle_System::update_particle_vector");
+        PROFILE_PHASE(PROFILER_PHASE_GRID_BUILD);
+        this->update_particle_vector();
+    }
+    // The grid and the particles vector hold the same particles now.
+    this->spatial_grid_is_current = true;
+}
+
+void Particle_System::update_spatial_grid ()
+{
+    if (this->spatial_grid_is_current == true) {
+        return;
+    }
+    TRACE_SCOPE("Particle_System::update_spatial_grid");
+    this->spatial_grid.clear();
+    this->spatial_grid.resize(this->number_of_cells);
+    // The parallel for needs at least one particle per thread (like in generate_initial_particles).
+    if (this->number_of_particles >= this->number_of_threads) {
+        this->parallel_for(&Particle_System::generate_spatial_grid, this->number_of_particles);
+    }
+    else if (this->number_of_particles > 0) {
+        this->generate_spatial_grid(0, this->number_of_particles - 1);
+    }
+    this->spatial_grid_is_current = true;
 }
 
 
@@ -754,6 +1008,7 @@ void Particle_System::simulate_spatial_grid ()
 
 void Particle_System::simulate ()
 {
+    TRACE_SCOPE("Particle_System::simulate");
     // Next simulation step (we need this for some gravity modes).
     this->simulation_step++;
     // Simulate depending on the selected computation mode.
@@ -788,32 +1043,4 @@ void Particle_System::change_computation_mode (Computation_Mode computation_mode
     }
     this->computation_mode = computation_mode;
     std::cout << "Activated computation mode '" << to_string(this->computation_mode) << "'." << std::endl;
-}
-
-
-// ====================================== RENDERING RELATED FUNCTIONS ======================================
-
-void Particle_System::draw (bool unbind)
-{
-    // Update the particles data in the vertex buffer object.
-    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
-    GLCall( glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Particle) * this->number_of_particles, &this->particles.at(0)) );
-    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
-    // Draw the particles using the vertex array object.
-    GLCall( glBindVertexArray(this->vertex_array_object) );
-    GLCall( glDrawElements(GL_POINTS, this->number_of_particles, GL_UNSIGNED_INT, 0) );
-    // In order to save a few unbind-calls, do this only if neccessary. 
-    // In our case, the visualization handler will handle the unbinding, so normally we will not unbind here.
-    if (unbind == true) {
-        GLCall( glBindVertexArray(0) );
-    }
-}
-
-void Particle_System::free_gpu_resources ()
-{
-    if (this->vertex_array_object > 0) {
-        GLCall( glDeleteVertexArrays(1, &this->vertex_array_object) );
-        GLCall( glDeleteBuffers(1, &this->vertex_buffer_object) );
-        GLCall( glDeleteBuffers(1, &this->index_buffer_object) );
-    }
 }
\ No newline at end of file
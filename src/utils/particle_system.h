@@ -1,6 +1,5 @@
 #pragma once
 
-#include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <string>
 #include <mutex>
@@ -8,6 +7,9 @@
 
 #include "particle.h"
 #include "cuboid.h"
+#include "parallel_region_metrics.h"
+#include "memory_accounting.h"
+#include "thread_pool.h"
 
 
 // The number of initial particles depends on the fluids cuboids
@@ -76,6 +78,14 @@
 #define SPH_COLLISION_FORCE_DISTANCE_TOLERANCE_STEP 0.001f
 // Simulation time defines.
 #define SPH_SIMULATION_TIME_STEP                0.03f
+// Relaxation of the initial particles (see relax_initial_particles). The relaxation stops as soon as the
+// mean kinetic energy of the particles (in J) is below the threshold, but not before the min number of steps
+// (at the start all particles are at rest) and not after the max number of steps.
+// The damping is the fraction of the velocity that is removed after every step.
+#define RELAXATION_MIN_STEPS                    50
+#define RELAXATION_MAX_STEPS                    2000
+#define RELAXATION_VELOCITY_DAMPING             0.05f
+#define RELAXATION_KINETIC_ENERGY_THRESHOLD     1.0e-7f
 // Multithreading defines.
 #define SIMULATION_NUMBER_OF_THREADS            8
 #define SIMULATION_NUMBER_OF_THREADS_MIN        1
@@ -130,13 +140,12 @@ inline const char* to_string (Computation_Mode computation_mode)
 // Particle System.
 class Particle_System 
 {
-    private:
-        // Render related.
-        GLuint vertex_array_object;
-        GLuint vertex_buffer_object;
-        GLuint index_buffer_object;
-        std::vector<unsigned int> particle_indices;
+    // The phase benchmarks measure the steps of the simulation one by one.
+    friend class Phase_Benchmark;
+    // The color field of the marching cubes searches the neighbors of its sample points in the spatial grid.
+    friend class Marching_Cubes_Generator;
 
+    private:
         // Settings.
         float particle_initial_distance;
         float sph_kernel_radius;
@@ -163,6 +172,16 @@ class Particle_System
         glm::vec3 kernel_w_spiky_gradient (glm::vec3 distance_vector);
         float kernel_w_viscosity_laplacian (glm::vec3 distance_vector);
 
+        // The initial particles. While the particles are generated, these are the cuboids that are filled, their lattices
+        // and the index of the first particle of each cuboid within the particles vector.
+        std::vector<Cuboid>* seeding_cuboids;
+        std::vector<Seeding_Lattice> seeding_lattices;
+        std::vector<unsigned int> seeding_first_particle_indices;
+        // Creates the particles of the given range (executed by multiple threads).
+        void seed_particles (unsigned int index_start, unsigned int index_end);
+        // Returns the index of the cuboid the particle was seeded in (the particles id tells us where it was created).
+        unsigned int get_seeding_cuboid_index (Particle& particle);
+
         // Returns the gravity vector based on the selected gravity mode.
         glm::vec3 get_gravity_vector ();
 
@@ -176,6 +195,18 @@ class Particle_System
         // Multithreading.
         void parallel_for (void (Particle_System::* function)(unsigned int, unsigned int), int number_of_elements);
         void parallel_for_grid (void (Particle_System::* function)(unsigned int, unsigned int));
+        // Executes the function for one chunk. The worker threads call this instead of the function itself,
+        // so the chunk shows up in the trace (see trace.h) and its start and end are recorded in the metrics
+        // of the parallel region (see parallel_region_metrics.h).
+        void execute_chunk (void (Particle_System::* function)(unsigned int, unsigned int), unsigned int index_start, unsigned int index_end, 
+            Parallel_Thread_Metrics* metrics);
+        // Starts a chunk of a parallel for loop, either on a thread of its own or as chunk of the thread pool (if the
+        // particle system uses one). join_chunks waits for all chunks started this way.
+        void start_chunk (  void (Particle_System::* function)(unsigned int, unsigned int), unsigned int index_start, unsigned int index_end, 
+                            Parallel_Thread_Metrics* metrics, std::vector<std::thread>& threads, Task_Group& task_group);
+        void join_chunks (std::vector<std::thread>& threads, Task_Group& task_group);
+        // The name of the parallel region executing the function.
+        const char* get_region_name (void (Particle_System::* function)(unsigned int, unsigned int));
 
         // Brute force implementation (used also for the multithreading variant).
         // Note for the following functions: index_end is included in the for loop.
@@ -192,8 +223,13 @@ class Particle_System
         int number_of_cells_y;
         int number_of_cells_z;
         void calculate_number_of_grid_cells ();
-        std::vector<std::vector<Particle>> spatial_grid;
-        std::vector<std::unique_ptr<std::mutex>> mutex_spatial_grid;
+        // The memory of the grid cells and of the mutexes is counted by the memory accounting. The mutexes are
+        // stored directly in the vector (a mutex cannot be moved, so the vector is never resized but replaced).
+        Tracked_Vector<Tracked_Vector<Particle, MEMORY_SUBSYSTEM_SPATIAL_GRID>, MEMORY_SUBSYSTEM_SPATIAL_GRID> spatial_grid;
+        Tracked_Vector<std::mutex, MEMORY_SUBSYSTEM_SPATIAL_GRID_MUTEXES> mutex_spatial_grid;
+        // True if the spatial grid holds the current particles (see update_spatial_grid). After a step of the simulation
+        // the particles are still in the cells of the start of the step, but their positions are the new ones.
+        bool spatial_grid_is_current;
         int discretize_value (float value);
         int get_grid_key (glm::vec3 position);
         std::vector<int> get_neighbor_cells_indices (glm::vec3 position); 
@@ -205,7 +241,7 @@ class Particle_System
         void simulate_spatial_grid ();
 
     public:
-        std::vector<Particle> particles;
+        Particle_Vector particles;
         unsigned int number_of_particles;
         // The visualization handler will show the number of particles at the title
         // of the window. In order to make it more readable we save in this string
@@ -222,9 +258,24 @@ class Particle_System
 
         // This function creates the initial particles based on the given spaces that have
         // to be filled an the particle_initial_distance.
-        // It also generates the OpenGL needed buffers like the vertex array object.
         void generate_initial_particles (std::vector<Cuboid>& cuboids);
+        // The pattern used by generate_initial_particles. Changing it takes effect with the next (re)load of the scene.
+        Seeding_Pattern seeding_pattern;
+        // A perfect lattice is not a resting fluid: the particles collapse and oscillate for a few hundred steps. This function
+        // simulates the particles generated by generate_initial_particles (with the same cuboids) with normal gravity and
+        // damped velocities until the fluid has settled. The particles are kept within the cuboid they were created in,
+        // so the shape of the scene stays the same. The simulation space has to be set. Returns the number of steps.
+        unsigned int relax_initial_particles (std::vector<Cuboid>& cuboids);
+        // Resizes the particles vector to the given number of default particles (with the ids 0 to n - 1).
+        // The positions and velocities have to be set by the caller.
+        void set_number_of_particles (unsigned int number_of_particles);
         void set_simulation_space (Cuboid* simulation_space);
+        // This function is used to manually inform the particle system that the particles were changed from outside
+        // (e.g. by the replay of a recording or by reading them from a file), so the spatial grid no longer holds them.
+        void particles_changed ();
+        // Builds the spatial grid from the particles vector if it does not hold the current particles (e.g. in the brute
+        // force mode or after particles_changed). After a step with the spatial grid there is nothing to do.
+        void update_spatial_grid ();
 
         // Note that these functions do not call the generate_initial_particles function, this
         // has to be done by the application. It simply increases / decreases the distance between
@@ -233,6 +284,12 @@ class Particle_System
         // possible and if the call to generate_initial_particles makes sense or not.
         bool increase_number_of_particles ();
         bool decrease_number_of_particles ();
+        // Sets the distance between the initial particles directly (e.g. from the command line of the headless
+        // simulation). Returns false if the distance is not within the allowed range.
+        bool set_particle_initial_distance (float particle_initial_distance);
+        float get_particle_initial_distance ();
+        // The number of steps simulated since the particles were generated (e.g. for the names of exported frames).
+        unsigned int get_simulation_step ();
 
         // Simulation fluid settings. The values are public in order to allow imgui to change them.
         float sph_particle_mass;
@@ -269,15 +326,30 @@ class Particle_System
         void next_computation_mode ();
         void change_computation_mode (Computation_Mode computation_mode);
 
-        // Multithreading.
+        // Multithreading. The number of threads is the number of chunks of a parallel for loop. If a thread pool is set
+        // (see thread_pool.h), the chunks are executed by the pool instead of threads of their own.
         int number_of_threads;
+        Thread_Pool* thread_pool;
+        // The per-thread work, idle times and load imbalance of every parallel for loop.
+        Parallel_Region_Statistics parallel_region_statistics;
 
         // Simulate the next step. What computation mode is internally used is determined by the 
         // setted computation mode.
         void simulate ();
 
-        // Draws the particles. Note that the shader will be selected and activated by the visualization handler.
-        void draw (bool unbind = false);
-        // Deletes the GPU ressources (vertex array, vertex buffer, index buffer).
-        void free_gpu_resources ();
+        // Predicts the memory the particles, the spatial grid and its mutexes would need (in bytes) if the given
+        // cuboids were filled with particles of the given distance and seeding pattern within the given simulation
+        // space (the seeding pattern of the particle system is not used, a scene may bring its own). The values
+        // are added to the respective subsystems of predicted_bytes. The spatial grid cells grow while the grid is
+        // generated, so for them the worst case is predicted.
+        void predict_memory_footprint ( std::vector<Cuboid>& cuboids, 
+                                        Cuboid& simulation_space, 
+                                        float particle_initial_distance, 
+                                        Seeding_Pattern seeding_pattern, 
+                                        size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT]);
+        // The same for a known number of particles (e.g. particles that are read from a file).
+        void predict_memory_footprint ( size_t number_of_particles, 
+                                        Cuboid& simulation_space, 
+                                        float particle_initial_distance, 
+                                        size_t predicted_bytes[_MEMORY_SUBSYSTEM_COUNT]);
 };
\ No newline at end of file
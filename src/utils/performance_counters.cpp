@@ -0,0 +1,300 @@
+#include "performance_counters.h"
+
+#include <iostream>
+#include <cstring>
+#include <atomic>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+// For more details see performance_counters.h:
+std::unordered_map<std::string, std::vector<Performance_Counter_Values>> performance_counter_values;
+
+static bool performance_counters_active = false;
+static bool performance_counters_available[_COUNTER_COUNT] = { false };
+static std::thread::id measuring_thread_id;
+// The events of the finished worker chunks.
+static std::atomic<uint64_t> worker_totals[_COUNTER_COUNT];
+
+
+// ====================================== COUNTER GROUP ======================================
+
+// The counters of one thread. The first opened counter is the group leader.
+class Performance_Counter_Group
+{
+    private:
+        int leader_file_descriptor;
+        int file_descriptors[_COUNTER_COUNT];
+        // The position of the counters within the values read from the group (-1 if not opened).
+        int positions[_COUNTER_COUNT];
+        int number_of_opened_counters;
+
+    public:
+        Performance_Counter_Group ()
+        {
+            this->leader_file_descriptor = -1;
+            this->number_of_opened_counters = 0;
+            for (int i = 0; i < _COUNTER_COUNT; i++) {
+                this->file_descriptors[i] = -1;
+                this->positions[i] = -1;
+            }
+        }
+
+        ~Performance_Counter_Group ()
+        {
+            this->close();
+        }
+
+        bool is_open ()
+        {
+            return this->leader_file_descriptor >= 0;
+        }
+
+        // Opens all available counters for the calling thread. They start counting right away if enabled is true,
+        // otherwise only with reset_and_enable.
+        bool open (bool enabled)
+        {
+#ifdef __linux__
+            for (int i = 0; i < _COUNTER_COUNT; i++) {
+                struct perf_event_attr attributes;
+                std::memset(&attributes, 0, sizeof(attributes));
+                attributes.size = sizeof(attributes);
+                switch ((Performance_Counter)i) {
+                    case COUNTER_CYCLES:
+                        attributes.type = PERF_TYPE_HARDWARE;
+                        attributes.config = PERF_COUNT_HW_CPU_CYCLES;
+                        break;
+                    case COUNTER_INSTRUCTIONS:
+                        attributes.type = PERF_TYPE_HARDWARE;
+                        attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+                        break;
+                    case COUNTER_LLC_LOAD_MISSES:
+                        attributes.type = PERF_TYPE_HW_CACHE;
+                        attributes.config = PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                        break;
+                    case COUNTER_BRANCH_MISSES:
+                        attributes.type = PERF_TYPE_HARDWARE;
+                        attributes.config = PERF_COUNT_HW_BRANCH_MISSES;
+                        break;
+                    case COUNTER_DTLB_LOAD_MISSES:
+                        attributes.type = PERF_TYPE_HW_CACHE;
+                        attributes.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+                        break;
+                    default:
+                        continue;
+                }
+                // Only count the user space of the calling thread (this is allowed with the default perf_event_paranoid).
+                attributes.disabled = (this->leader_file_descriptor < 0) ? 1 : 0;
+                attributes.exclude_kernel = 1;
+                attributes.exclude_hv = 1;
+                // The time enabled / running is needed if the kernel has to multiplex the counters.
+                attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                int file_descriptor = syscall(__NR_perf_event_open, &attributes, 0, -1, this->leader_file_descriptor, 0);
+                if (file_descriptor < 0) {
+                    // This event is not supported, try the others.
+                    continue;
+                }
+                if (this->leader_file_descriptor < 0) {
+                    this->leader_file_descriptor = file_descriptor;
+                }
+                this->file_descriptors[i] = file_descriptor;
+                this->positions[i] = this->number_of_opened_counters++;
+            }
+            if (this->leader_file_descriptor < 0) {
+                return false;
+            }
+            if (enabled == true) {
+                this->reset_and_enable();
+            }
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        // Sets all counters of the group to zero and starts counting.
+        void reset_and_enable ()
+        {
+#ifdef __linux__
+            ioctl(this->leader_file_descriptor, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(this->leader_file_descriptor, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+
+        // Stops counting, the values stay until the next reset.
+        void disable ()
+        {
+#ifdef __linux__
+            ioctl(this->leader_file_descriptor, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+
+        void close ()
+        {
+#ifdef __linux__
+            for (int i = 0; i < _COUNTER_COUNT; i++) {
+                if (this->file_descriptors[i] >= 0) {
+                    ::close(this->file_descriptors[i]);
+                    this->file_descriptors[i] = -1;
+                    this->positions[i] = -1;
+                }
+            }
+#endif
+            this->leader_file_descriptor = -1;
+            this->number_of_opened_counters = 0;
+        }
+
+        bool is_opened (Performance_Counter counter)
+        {
+            return this->positions[counter] >= 0;
+        }
+
+        // Reads all counters of the group. Counters that are not opened are zero.
+        bool read (Performance_Counter_Values& counter_values)
+        {
+            std::memset(&counter_values, 0, sizeof(Performance_Counter_Values));
+#ifdef __linux__
+            if (this->leader_file_descriptor < 0) {
+                return false;
+            }
+            // The layout of a group read: number of counters, time enabled, time running, the values.
+            uint64_t buffer[3 + _COUNTER_COUNT];
+            ssize_t size = ::read(this->leader_file_descriptor, buffer, sizeof(buffer));
+            if (size < (ssize_t)(3 * sizeof(uint64_t))) {
+                return false;
+            }
+            uint64_t time_enabled = buffer[1];
+            uint64_t time_running = buffer[2];
+            for (int i = 0; i < _COUNTER_COUNT; i++) {
+                if ((this->positions[i] < 0) || (this->positions[i] >= (int)buffer[0])) {
+                    continue;
+                }
+                uint64_t value = buffer[3 + this->positions[i]];
+                // Scale the value if the counters were not running all the time (multiplexing).
+                if ((time_running > 0) && (time_running < time_enabled)) {
+                    value = (uint64_t)((double)value * time_enabled / time_running);
+                }
+                counter_values.values[i] = value;
+            }
+            return true;
+#else
+            return false;
+#endif
+        }
+};
+
+// Every thread has its own counters. They are opened when the thread counts the first time
+// and closed when the thread ends. The counters of the measuring thread run all the time, the ones of the
+// worker threads only while they execute a chunk (see Performance_Counter_Worker_Scope).
+static thread_local Performance_Counter_Group thread_counter_group;
+
+static bool read_thread_counters (Performance_Counter_Values& counter_values)
+{
+    if (thread_counter_group.is_open() == false) {
+        if (thread_counter_group.open(true) == false) {
+            std::memset(&counter_values, 0, sizeof(Performance_Counter_Values));
+            return false;
+        }
+    }
+    return thread_counter_group.read(counter_values);
+}
+
+
+// ====================================== PERFORMANCE TEST INTERFACE ======================================
+
+bool initialize_performance_counters ()
+{
+    measuring_thread_id = std::this_thread::get_id();
+    for (int i = 0; i < _COUNTER_COUNT; i++) {
+        worker_totals[i] = 0;
+    }
+    Performance_Counter_Values counter_values;
+    performance_counters_active = read_thread_counters(counter_values);
+    if (performance_counters_active == false) {
+        std::cout << "Hardware performance counters are not available (perf_event_open failed), only the execution times are measured." << std::endl;
+        return false;
+    }
+    std::cout << "Hardware performance counters:";
+    for (int i = 0; i < _COUNTER_COUNT; i++) {
+        performance_counters_available[i] = thread_counter_group.is_opened((Performance_Counter)i);
+        std::cout << " " << to_string((Performance_Counter)i) << (performance_counters_available[i] ? "" : " (not available)");
+    }
+    std::cout << std::endl;
+    return true;
+}
+
+bool performance_counters_are_active ()
+{
+    return performance_counters_active;
+}
+
+bool performance_counter_is_available (Performance_Counter counter)
+{
+    return performance_counters_active && performance_counters_available[counter];
+}
+
+Performance_Counter_Values read_performance_counters ()
+{
+    Performance_Counter_Values counter_values;
+    if (performance_counters_active == false) {
+        std::memset(&counter_values, 0, sizeof(Performance_Counter_Values));
+        return counter_values;
+    }
+    read_thread_counters(counter_values);
+    for (int i = 0; i < _COUNTER_COUNT; i++) {
+        counter_values.values[i] += worker_totals[i].load(std::memory_order_acquire);
+    }
+    return counter_values;
+}
+
+void add_performance_counter_values (const std::string& function, Performance_Counter_Values& start)
+{
+    if (performance_counters_active == false) {
+        return;
+    }
+    Performance_Counter_Values end = read_performance_counters();
+    for (int i = 0; i < _COUNTER_COUNT; i++) {
+        end.values[i] -= start.values[i];
+    }
+    performance_counter_values[function].push_back(end);
+}
+
+
+// ====================================== WORKER SCOPE ======================================
+
+Performance_Counter_Worker_Scope::Performance_Counter_Worker_Scope ()
+{
+    // The measuring thread reads its own counters, so its chunks must not be added to the totals.
+    this->active = (performance_counters_active == true) && (std::this_thread::get_id() != measuring_thread_id);
+    if (this->active == false) {
+        return;
+    }
+    // The group is only opened by the first chunk of the thread, the following chunks (e.g. on the threads of a
+    // pool) just reset and enable it.
+    if ((thread_counter_group.is_open() == false) && (thread_counter_group.open(false) == false)) {
+        this->active = false;
+        return;
+    }
+    thread_counter_group.reset_and_enable();
+}
+
+Performance_Counter_Worker_Scope::~Performance_Counter_Worker_Scope ()
+{
+    if (this->active == false) {
+        return;
+    }
+    // The counters were reset at the start of the chunk, so they hold the events of the chunk only.
+    thread_counter_group.disable();
+    Performance_Counter_Values chunk_values;
+    if (thread_counter_group.read(chunk_values) == false) {
+        return;
+    }
+    for (int i = 0; i < _COUNTER_COUNT; i++) {
+        worker_totals[i].fetch_add(chunk_values.values[i], std::memory_order_release);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+// Hardware performance counters for the performance test. The execution time alone does not tell if a phase
+// is compute-bound or memory-bound, so the performance test can additionally count some hardware events per
+// measured function (see MEASURE_EXECUTION_TIME in performance_test.h).
+// The counters are read using perf_event_open (Linux only). Every thread opens its own counter group (so all
+// counters of a thread are scheduled together) once and keeps it until the thread ends. The worker threads of the
+// parallel for loops only reset, enable and read their group per chunk and add the events to global totals, so the
+// counts of a measured function include all its threads. Threads that only live for one parallel for loop would open
+// and close their group every time, so the runs that count the events execute the chunks on a thread pool. The
+// waiting thread executes chunks as well, so the pool needs one worker less than the number of threads.
+// If the counters are not available (e.g. other operating system, no PMU in a virtual machine or container,
+// perf_event_paranoid too restrictive), only the execution times are measured.
+
+// The counted hardware events.
+enum Performance_Counter
+{
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_LLC_LOAD_MISSES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_DTLB_LOAD_MISSES,
+    _COUNTER_COUNT
+};
+
+inline const char* to_string (Performance_Counter counter)
+{
+    switch (counter) {
+        case COUNTER_CYCLES:            return "cycles";
+        case COUNTER_INSTRUCTIONS:      return "instructions";
+        case COUNTER_LLC_LOAD_MISSES:   return "llc_load_misses";
+        case COUNTER_BRANCH_MISSES:     return "branch_misses";
+        case COUNTER_DTLB_LOAD_MISSES:  return "dtlb_load_misses";
+        default:                        return "unknown counter";
+    }
+}
+
+struct Performance_Counter_Values
+{
+    uint64_t values[_COUNTER_COUNT];
+};
+
+// The counted events of every measured function (one entry per call, like the execution times).
+extern std::unordered_map<std::string, std::vector<Performance_Counter_Values>> performance_counter_values;
+
+// Tries to open the counters for the calling thread (this should be the thread that measures, so normally the
+// main thread). Returns false if no counter is available, the performance test then only measures the time.
+bool initialize_performance_counters ();
+bool performance_counters_are_active ();
+// If a single counter is available (some virtual machines only support a few events).
+bool performance_counter_is_available (Performance_Counter counter);
+// The events counted so far by the calling thread plus the events of all finished worker chunks.
+Performance_Counter_Values read_performance_counters ();
+// Saves the events counted since start for the given function.
+void add_performance_counter_values (const std::string& function, Performance_Counter_Values& start);
+
+// Counts the events of a worker chunk and adds them to the totals when the chunk is done.
+// The chunks executed by the measuring thread itself are already included in its own counters.
+class Performance_Counter_Worker_Scope
+{
+    private:
+        bool active;
+
+    public:
+        Performance_Counter_Worker_Scope ();
+        ~Performance_Counter_Worker_Scope ();
+};
+
+#ifdef PERFORMANCE_TEST
+#define COUNT_WORKER_PERFORMANCE_EVENTS() Performance_Counter_Worker_Scope performance_counter_worker_scope
+#else
+#define COUNT_WORKER_PERFORMANCE_EVENTS()
+#endif
\ No newline at end of file
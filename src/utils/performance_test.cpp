@@ -0,0 +1,4 @@
+#include "performance_test.h"
+
+// For more details see performance_test.h:
+std::unordered_map<std::string, std::vector<long long>> execution_times;
\ No newline at end of file
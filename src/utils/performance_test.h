@@ -6,24 +6,46 @@
 #include <unordered_map>
 #include <vector>
 
+#include "trace.h"
+#include "performance_counters.h"
+#include "parallel_region_metrics.h"
+
 // Here we will define the following macro:
 // If we want to measure the performance of a given function, we not only execute it,
 // but also measure the execution time and save it to a dictionary. This will be used
 // to determine the time different functions take as well as to compare e.g., the brute
 // force implementation of the SPH algorithm against the spatial grid implementation.
 
-// The dictionary where we will save all the execution times.
+// The dictionary where we will save all the execution times. It is defined in performance_test.cpp.
 extern std::unordered_map<std::string, std::vector<long long>> execution_times;
 
 // The macro / function that measures the execution time and saves it into the dictionary.
+// If the hardware performance counters were initialized (see performance_counters.h), the counted
+// events are saved as well.
+// If the measured function is exactly one parallel region (see parallel_region_metrics.h), its imbalance factor
+// and utilisation are saved too.
+// If tracing is enabled (see trace.h), the measured function is also traced (with the same name).
 #ifdef PERFORMANCE_TEST
 #define MEASURE_EXECUTION_TIME(function_to_be_measured)\
     do {\
+        TRACE_SCOPE(#function_to_be_measured);\
+        Performance_Counter_Values counters_start = read_performance_counters();\
+        unsigned long long parallel_regions_start = number_of_finished_parallel_regions;\
         auto start = std::chrono::high_resolution_clock::now();\
         function_to_be_measured;\
         auto end = std::chrono::high_resolution_clock::now();\
         auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();\
         execution_times[#function_to_be_measured].push_back(duration);\
+        add_performance_counter_values(#function_to_be_measured, counters_start);\
+        if (number_of_finished_parallel_regions == parallel_regions_start + 1) {\
+            add_parallel_region_values(#function_to_be_measured, *last_parallel_region);\
+        }\
+    } while (false)
+#elif defined(TRACING)
+#define MEASURE_EXECUTION_TIME(function_to_be_measured)\
+    do {\
+        TRACE_SCOPE(#function_to_be_measured);\
+        function_to_be_measured;\
     } while (false)
 #else
 #define MEASURE_EXECUTION_TIME(function_to_be_measured) function_to_be_measured
@@ -31,22 +53,29 @@ extern std::unordered_map<std::string, std::vector<long long>> execution_times;
 
 // We will need a function that saves the data in a csv file.
 // The application should call this at the end.
-inline void save_exection_time_to_csv () 
+inline void save_exection_time_to_csv (const std::string filename = "./performance_data.csv") 
 {
     // Some defines, how we want to setup the csv file.
     const char cell_delimiter = ';';
     const char number_delimiter = ',';
 
     // Open the file where we want to save the data and check if something went wrong.
-    const std::string filename = "./performance_data.csv";
     std::ofstream file (filename);
     if (file.is_open() == false) {
         std::cout << "Failed to open file: '" << filename << "'." << std::endl;
         return;
     }
 
-    // Write the header row.
-    file << "function" << cell_delimiter << "execution_times" << std::endl;
+    // Write the header row. The hardware performance counters (if active) and the load balance of the parallel
+    // regions follow the execution times, so the performance analysis can still read the file.
+    file << "function" << cell_delimiter << "execution_times";
+    if (performance_counters_are_active() == true) {
+        for (int i = 0; i < _COUNTER_COUNT; i++) {
+            file << cell_delimiter << to_string((Performance_Counter)i);
+        }
+    }
+    file << cell_delimiter << "imbalance_factor" << cell_delimiter << "utilisation";
+    file << std::endl;
 
     // Write the data rows.
     for (const auto& pair : execution_times) {
@@ -64,6 +93,42 @@ inline void save_exection_time_to_csv ()
             }
         }
 
+        // Write the counted events (one column per counter). The cell stays empty if the counter
+        // is not available.
+        if (performance_counters_are_active() == true) {
+            const std::vector<Performance_Counter_Values>& counter_values = performance_counter_values[function_name];
+            for (int counter = 0; counter < _COUNTER_COUNT; counter++) {
+                file << cell_delimiter;
+                if (performance_counter_is_available((Performance_Counter)counter) == false) {
+                    continue;
+                }
+                for (size_t i = 0; i < counter_values.size(); i++) {
+                    file << counter_values[i].values[counter];
+                    if (i != counter_values.size() - 1) {
+                        file << number_delimiter;
+                    }
+                }
+            }
+        }
+
+        // Write the imbalance factors and the utilisations. The cells stay empty if the function is not a
+        // parallel region.
+        std::vector<Parallel_Region_Values> region_values = get_parallel_region_values(function_name);
+        file << cell_delimiter;
+        for (size_t i = 0; i < region_values.size(); i++) {
+            file << region_values[i].imbalance_factor;
+            if (i != region_values.size() - 1) {
+                file << number_delimiter;
+            }
+        }
+        file << cell_delimiter;
+        for (size_t i = 0; i < region_values.size(); i++) {
+            file << region_values[i].utilisation;
+            if (i != region_values.size() - 1) {
+                file << number_delimiter;
+            }
+        }
+
         // Next row.
         file << std::endl;
     }
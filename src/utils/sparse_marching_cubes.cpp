@@ -0,0 +1,510 @@
+#include "sparse_marching_cubes.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+#include "helper.h"
+#include "marching_cubes_tables.h"
+#include "marching_cubes_common.h"
+#include "trace.h"
+
+
+// ====================================== SPARSE MARCHING CUBES GENERATOR ======================================
+
+Sparse_Marching_Cubes_Generator::Sparse_Marching_Cubes_Generator ()
+{
+    this->particle_system = nullptr;
+    this->cube_edge_length = -1.0f;
+    this->new_cube_edge_length = MARCHING_CUBES_CUBE_EDGE_LENGTH;
+    this->isovalue = MARCHING_CUBES_ISOVALUE;
+    this->number_of_cells_x = 0;
+    this->number_of_cells_y = 0;
+    this->number_of_cells_z = 0;
+    this->number_of_bricks_x = 0;
+    this->number_of_bricks_y = 0;
+    this->number_of_bricks_z = 0;
+    this->number_of_bricks = 0;
+    this->number_of_pool_bricks = 0;
+    this->number_of_surface_bricks = 0;
+    this->generation_time = 0.0;
+}
+
+void Sparse_Marching_Cubes_Generator::parallel_for (void (Sparse_Marching_Cubes_Generator::* function)(unsigned int, unsigned int), int number_of_elements)
+{
+    // The elements are particles, bricks of the pool or surface bricks.
+    bool elements_are_particles = (function == &Sparse_Marching_Cubes_Generator::mark_bricks) ||
+        (function == &Sparse_Marching_Cubes_Generator::count_particles);
+    marching_cubes_parallel_for(this, function, number_of_elements, this->particle_system->number_of_threads, elements_are_particles,
+        this->parallel_region_statistics, this->get_region_name(function), "Sparse_Marching_Cubes_Generator worker", this->particle_system->thread_pool);
+}
+
+const char* Sparse_Marching_Cubes_Generator::get_region_name (void (Sparse_Marching_Cubes_Generator::* function)(unsigned int, unsigned int))
+{
+    if (function == &Sparse_Marching_Cubes_Generator::mark_bricks)          return "sparse_mark_bricks";
+    if (function == &Sparse_Marching_Cubes_Generator::clear_bricks)         return "sparse_clear_bricks";
+    if (function == &Sparse_Marching_Cubes_Generator::count_particles)      return "sparse_count_particles";
+    if (function == &Sparse_Marching_Cubes_Generator::find_full_bricks)     return "sparse_find_full_bricks";
+    if (function == &Sparse_Marching_Cubes_Generator::find_interior_bricks) return "sparse_find_interior_bricks";
+    if (function == &Sparse_Marching_Cubes_Generator::count_mesh_elements)  return "sparse_count_mesh_elements";
+    if (function == &Sparse_Marching_Cubes_Generator::create_mesh_vertices) return "sparse_create_mesh_vertices";
+    if (function == &Sparse_Marching_Cubes_Generator::create_mesh_triangles) return "sparse_create_mesh_triangles";
+    return "unknown region";
+}
+
+int Sparse_Marching_Cubes_Generator::get_number_of_chunks (int number_of_elements)
+{
+    return get_marching_cubes_number_of_chunks(this->particle_system->number_of_threads, number_of_elements);
+}
+
+int Sparse_Marching_Cubes_Generator::get_chunk_index (unsigned int index_start, int number_of_elements)
+{
+    return get_marching_cubes_chunk_index(index_start, number_of_elements, this->particle_system->number_of_threads);
+}
+
+
+// ====================================== INITIALIZATION FUNCTIONS ======================================
+
+void Sparse_Marching_Cubes_Generator::calculate_number_of_grid_cells ()
+{
+    // The same grid as the density estimator of the dense generator (one cell more around the simulation space).
+    Cuboid* simulation_space = this->particle_system->simulation_space;
+    this->number_of_cells_x = ceil((simulation_space->x_max - simulation_space->x_min) / this->cube_edge_length) + 2;
+    this->number_of_cells_y = ceil((simulation_space->y_max - simulation_space->y_min) / this->cube_edge_length) + 2;
+    this->number_of_cells_z = ceil((simulation_space->z_max - simulation_space->z_min) / this->cube_edge_length) + 2;
+    this->number_of_bricks_x = (this->number_of_cells_x + SPARSE_MARCHING_CUBES_BRICK_SIZE - 1) / SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    this->number_of_bricks_y = (this->number_of_cells_y + SPARSE_MARCHING_CUBES_BRICK_SIZE - 1) / SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    this->number_of_bricks_z = (this->number_of_cells_z + SPARSE_MARCHING_CUBES_BRICK_SIZE - 1) / SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    this->number_of_bricks = this->number_of_bricks_x * this->number_of_bricks_y * this->number_of_bricks_z;
+    // Replace the brick table (a std::atomic cannot be moved). No brick is allocated.
+    Tracked_Vector<std::atomic<int>, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES>(this->number_of_bricks).swap(this->brick_table);
+    for (std::atomic<int>& entry : this->brick_table) {
+        entry.store(-1, std::memory_order_relaxed);
+    }
+    this->pool_brick_keys.clear();
+    this->number_of_pool_bricks = 0;
+    this->number_of_surface_bricks = 0;
+}
+
+void Sparse_Marching_Cubes_Generator::simulation_space_changed ()
+{
+    // Like the dense generator: a negative edge length triggers the recalculation of the grid.
+    this->cube_edge_length = -1.0f;
+}
+
+inline int Sparse_Marching_Cubes_Generator::get_cell_index (glm::vec3 position, int& x, int& y, int& z)
+{
+    // The same discretization as Marching_Cubes_Generator::get_grid_key_density_estimator.
+    position = position + this->particle_system->particle_offset + glm::vec3(this->cube_edge_length);
+    x = (int)floor(position.x / this->cube_edge_length);
+    y = (int)floor(position.y / this->cube_edge_length);
+    z = (int)floor(position.z / this->cube_edge_length);
+    if ((x < 0) || (x >= this->number_of_cells_x) || (y < 0) || (y >= this->number_of_cells_y) ||
+        (z < 0) || (z >= this->number_of_cells_z)) {
+        return -1;
+    }
+    return x + y * this->number_of_cells_x + z * this->number_of_cells_x * this->number_of_cells_y;
+}
+
+inline int Sparse_Marching_Cubes_Generator::get_pool_index (int x, int y, int z)
+{
+    if ((x < 0) || (x >= this->number_of_cells_x) || (y < 0) || (y >= this->number_of_cells_y) ||
+        (z < 0) || (z >= this->number_of_cells_z)) {
+        return -1;
+    }
+    int brick_key = (x / SPARSE_MARCHING_CUBES_BRICK_SIZE) + (y / SPARSE_MARCHING_CUBES_BRICK_SIZE) * this->number_of_bricks_x +
+        (z / SPARSE_MARCHING_CUBES_BRICK_SIZE) * this->number_of_bricks_x * this->number_of_bricks_y;
+    int pool_brick = this->brick_table[brick_key].load(std::memory_order_relaxed);
+    if (pool_brick < 0) {
+        return -1;
+    }
+    return pool_brick * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE +
+        (x % SPARSE_MARCHING_CUBES_BRICK_SIZE) +
+        (y % SPARSE_MARCHING_CUBES_BRICK_SIZE) * SPARSE_MARCHING_CUBES_BRICK_SIZE +
+        (z % SPARSE_MARCHING_CUBES_BRICK_SIZE) * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+}
+
+inline int Sparse_Marching_Cubes_Generator::get_edge_table_index (int x, int y, int z)
+{
+    int cells_per_brick = SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    int pool_index = this->get_pool_index(x, y, z);
+    // Only called for the cells of surface bricks (an edge of the surface never starts in an interior brick).
+    return this->surface_brick_indices[pool_index / cells_per_brick] * cells_per_brick + pool_index % cells_per_brick;
+}
+
+
+// ====================================== BRICKS ======================================
+
+void Sparse_Marching_Cubes_Generator::mark_bricks (unsigned int index_start, unsigned int index_end)
+{
+    for (int i = index_start; i <= index_end; i++) {
+        int x, y, z;
+        if (this->get_cell_index(this->particle_system->particles.at(i).position, x, y, z) < 0) {
+            continue;
+        }
+        // The brick of the cell and the bricks of the cubes and edges that end in the cell (see the header).
+        for (int cell_z = std::max(z - 1, 0); cell_z <= z; cell_z++) {
+            for (int cell_y = std::max(y - 1, 0); cell_y <= y; cell_y++) {
+                for (int cell_x = std::max(x - 1, 0); cell_x <= x; cell_x++) {
+                    int brick_key = (cell_x / SPARSE_MARCHING_CUBES_BRICK_SIZE) + (cell_y / SPARSE_MARCHING_CUBES_BRICK_SIZE) * this->number_of_bricks_x +
+                        (cell_z / SPARSE_MARCHING_CUBES_BRICK_SIZE) * this->number_of_bricks_x * this->number_of_bricks_y;
+                    // Most particles mark a brick that is already marked, so only write if necessary (the cache line
+                    // stays shared between the threads).
+                    if (this->brick_table[brick_key].load(std::memory_order_relaxed) != 0) {
+                        this->brick_table[brick_key].store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Sparse_Marching_Cubes_Generator::clear_bricks (unsigned int index_start, unsigned int index_end)
+{
+    int cells_per_brick = SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    for (size_t i = (size_t)index_start * cells_per_brick; i < (size_t)(index_end + 1) * cells_per_brick; i++) {
+        this->brick_pool[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+void Sparse_Marching_Cubes_Generator::count_particles (unsigned int index_start, unsigned int index_end)
+{
+    for (int i = index_start; i <= index_end; i++) {
+        int x, y, z;
+        if (this->get_cell_index(this->particle_system->particles.at(i).position, x, y, z) < 0) {
+            continue;
+        }
+        this->brick_pool[this->get_pool_index(x, y, z)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+void Sparse_Marching_Cubes_Generator::find_full_bricks (unsigned int index_start, unsigned int index_end)
+{
+    int cells_per_brick = SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    for (int pool_brick = index_start; pool_brick <= index_end; pool_brick++) {
+        int brick_key = this->pool_brick_keys[pool_brick];
+        // A brick at the end of the grid has cells outside of it, which are never inside the fluid.
+        bool is_full = 
+            ((brick_key % this->number_of_bricks_x + 1) * SPARSE_MARCHING_CUBES_BRICK_SIZE <= this->number_of_cells_x) &&
+            (((brick_key / this->number_of_bricks_x) % this->number_of_bricks_y + 1) * SPARSE_MARCHING_CUBES_BRICK_SIZE <= this->number_of_cells_y) &&
+            ((brick_key / (this->number_of_bricks_x * this->number_of_bricks_y) + 1) * SPARSE_MARCHING_CUBES_BRICK_SIZE <= this->number_of_cells_z);
+        for (size_t i = (size_t)pool_brick * cells_per_brick; (is_full == true) && (i < (size_t)(pool_brick + 1) * cells_per_brick); i++) {
+            is_full = (this->brick_pool[i].load(std::memory_order_relaxed) >= this->isovalue);
+        }
+        this->pool_bricks_are_full[pool_brick] = is_full;
+    }
+}
+
+inline bool Sparse_Marching_Cubes_Generator::is_full_brick (int brick_x, int brick_y, int brick_z)
+{
+    if ((brick_x < 0) || (brick_x >= this->number_of_bricks_x) || (brick_y < 0) || (brick_y >= this->number_of_bricks_y) ||
+        (brick_z < 0) || (brick_z >= this->number_of_bricks_z)) {
+        return false;
+    }
+    int pool_brick = this->brick_table[brick_x + brick_y * this->number_of_bricks_x + 
+        brick_z * this->number_of_bricks_x * this->number_of_bricks_y].load(std::memory_order_relaxed);
+    return (pool_brick >= 0) && (this->pool_bricks_are_full[pool_brick] == true);
+}
+
+void Sparse_Marching_Cubes_Generator::find_interior_bricks (unsigned int index_start, unsigned int index_end)
+{
+    for (int pool_brick = index_start; pool_brick <= index_end; pool_brick++) {
+        int brick_key = this->pool_brick_keys[pool_brick];
+        int brick_x = brick_key % this->number_of_bricks_x;
+        int brick_y = (brick_key / this->number_of_bricks_x) % this->number_of_bricks_y;
+        int brick_z = brick_key / (this->number_of_bricks_x * this->number_of_bricks_y);
+        // The brick and its 26 neighbors (see the header), marked with -1 and numbered afterwards.
+        bool is_interior = true;
+        for (int z = brick_z - 1; (is_interior == true) && (z <= brick_z + 1); z++) {
+            for (int y = brick_y - 1; (is_interior == true) && (y <= brick_y + 1); y++) {
+                for (int x = brick_x - 1; (is_interior == true) && (x <= brick_x + 1); x++) {
+                    is_interior = this->is_full_brick(x, y, z);
+                }
+            }
+        }
+        this->surface_brick_indices[pool_brick] = (is_interior == true) ? -1 : 0;
+    }
+}
+
+
+// ====================================== MESH EXTRACTION ======================================
+
+inline float Sparse_Marching_Cubes_Generator::get_field_value (int x, int y, int z)
+{
+    int pool_index = this->get_pool_index(x, y, z);
+    if (pool_index < 0) {
+        return 0.0f;
+    }
+    return (float)this->brick_pool[pool_index].load(std::memory_order_relaxed);
+}
+
+inline bool Sparse_Marching_Cubes_Generator::is_crossing_edge (int x, int y, int z, int axis)
+{
+    float value_a = this->get_field_value(x, y, z);
+    float value_b = this->get_field_value(x + (axis == 0), y + (axis == 1), z + (axis == 2));
+    return (value_a < this->isovalue) != (value_b < this->isovalue);
+}
+
+inline int Sparse_Marching_Cubes_Generator::get_cube_index (int x, int y, int z)
+{
+    int cube_index = 0;
+    for (int vertex = 0; vertex < 8; vertex++) {
+        if (this->get_field_value(x + marching_cubes_vertex_offsets[vertex][0], y + marching_cubes_vertex_offsets[vertex][1],
+            z + marching_cubes_vertex_offsets[vertex][2]) < this->isovalue) {
+            cube_index |= (1 << vertex);
+        }
+    }
+    return cube_index;
+}
+
+glm::vec3 Sparse_Marching_Cubes_Generator::create_edge_vertex (int x, int y, int z, int axis, glm::vec3& normal)
+{
+    // The same grid and origin as the dense generator (see Marching_Cubes_Generator::get_grid_origin), so both meshes are the same.
+    auto get_field_value = [this] (int x, int y, int z) { return this->get_field_value(x, y, z); };
+    glm::vec3 origin = -this->particle_system->particle_offset - glm::vec3(this->cube_edge_length / 2);
+    return create_marching_cubes_edge_vertex(get_field_value, x, y, z, axis, this->number_of_cells_x, this->number_of_cells_y,
+        this->number_of_cells_z, origin, this->cube_edge_length, this->isovalue, normal);
+}
+
+void Sparse_Marching_Cubes_Generator::count_mesh_elements (unsigned int index_start, unsigned int index_end)
+{
+    int number_of_vertices = 0;
+    int number_of_triangles = 0;
+    for (int surface_brick = index_start; surface_brick <= index_end; surface_brick++) {
+        int brick_key = this->pool_brick_keys[this->surface_pool_bricks[surface_brick]];
+        int x_start = (brick_key % this->number_of_bricks_x) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int y_start = ((brick_key / this->number_of_bricks_x) % this->number_of_bricks_y) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int z_start = (brick_key / (this->number_of_bricks_x * this->number_of_bricks_y)) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int x_end = std::min(x_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_x);
+        int y_end = std::min(y_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_y);
+        int z_end = std::min(z_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_z);
+        for (int z = z_start; z < z_end; z++) {
+            for (int y = y_start; y < y_end; y++) {
+                for (int x = x_start; x < x_end; x++) {
+                    // The edges that start in the cell and the cube whose min corner is the cell.
+                    bool has_edge_x = (x < this->number_of_cells_x - 1);
+                    bool has_edge_y = (y < this->number_of_cells_y - 1);
+                    bool has_edge_z = (z < this->number_of_cells_z - 1);
+                    number_of_vertices += (has_edge_x == true) && (this->is_crossing_edge(x, y, z, 0) == true);
+                    number_of_vertices += (has_edge_y == true) && (this->is_crossing_edge(x, y, z, 1) == true);
+                    number_of_vertices += (has_edge_z == true) && (this->is_crossing_edge(x, y, z, 2) == true);
+                    if ((has_edge_x == false) || (has_edge_y == false) || (has_edge_z == false)) {
+                        continue;
+                    }
+                    int cube_index = this->get_cube_index(x, y, z);
+                    for (int i = 0; (i < 15) && (marching_cubes_triangle_table[cube_index][i] != -1); i += 3) {
+                        number_of_triangles++;
+                    }
+                }
+            }
+        }
+    }
+    int chunk_index = this->get_chunk_index(index_start, this->number_of_surface_bricks);
+    this->number_of_mesh_vertices_per_chunk.at(chunk_index) = number_of_vertices;
+    this->number_of_mesh_triangles_per_chunk.at(chunk_index) = number_of_triangles;
+}
+
+void Sparse_Marching_Cubes_Generator::create_mesh_vertices (unsigned int index_start, unsigned int index_end)
+{
+    int next_vertex_index = this->mesh_vertex_offset_per_chunk.at(this->get_chunk_index(index_start, this->number_of_surface_bricks));
+    for (int surface_brick = index_start; surface_brick <= index_end; surface_brick++) {
+        int brick_key = this->pool_brick_keys[this->surface_pool_bricks[surface_brick]];
+        int x_start = (brick_key % this->number_of_bricks_x) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int y_start = ((brick_key / this->number_of_bricks_x) % this->number_of_bricks_y) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int z_start = (brick_key / (this->number_of_bricks_x * this->number_of_bricks_y)) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int x_end = std::min(x_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_x);
+        int y_end = std::min(y_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_y);
+        int z_end = std::min(z_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_z);
+        // The same order as in count_mesh_elements.
+        for (int z = z_start; z < z_end; z++) {
+            for (int y = y_start; y < y_end; y++) {
+                for (int x = x_start; x < x_end; x++) {
+                    int* edge_vertices = this->edge_table.data() + 3 * (size_t)this->get_edge_table_index(x, y, z);
+                    int number_of_cells[3] = { this->number_of_cells_x, this->number_of_cells_y, this->number_of_cells_z };
+                    int cell[3] = { x, y, z };
+                    for (int axis = 0; axis < 3; axis++) {
+                        if ((cell[axis] < number_of_cells[axis] - 1) && (this->is_crossing_edge(x, y, z, axis) == true)) {
+                            this->mesh.positions[next_vertex_index] = this->create_edge_vertex(x, y, z, axis, this->mesh.normals[next_vertex_index]);
+                            edge_vertices[axis] = next_vertex_index;
+                            next_vertex_index++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Sparse_Marching_Cubes_Generator::create_mesh_triangles (unsigned int index_start, unsigned int index_end)
+{
+    int chunk_index = this->get_chunk_index(index_start, this->number_of_surface_bricks);
+    unsigned int* indices = this->mesh.indices.data() + 3 * (size_t)this->mesh_triangle_offset_per_chunk.at(chunk_index);
+    for (int surface_brick = index_start; surface_brick <= index_end; surface_brick++) {
+        int brick_key = this->pool_brick_keys[this->surface_pool_bricks[surface_brick]];
+        int x_start = (brick_key % this->number_of_bricks_x) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int y_start = ((brick_key / this->number_of_bricks_x) % this->number_of_bricks_y) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        int z_start = (brick_key / (this->number_of_bricks_x * this->number_of_bricks_y)) * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+        // The cubes of the brick (the last cells of the grid are no min corner of a cube).
+        int x_end = std::min(x_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_x - 1);
+        int y_end = std::min(y_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_y - 1);
+        int z_end = std::min(z_start + SPARSE_MARCHING_CUBES_BRICK_SIZE, this->number_of_cells_z - 1);
+        for (int z = z_start; z < z_end; z++) {
+            for (int y = y_start; y < y_end; y++) {
+                for (int x = x_start; x < x_end; x++) {
+                    int cube_index = this->get_cube_index(x, y, z);
+                    if (marching_cubes_edge_table[cube_index] == 0) {
+                        continue;
+                    }
+                    // The vertex of every crossed edge is in the edge table of the brick the edge starts in (which is a
+                    // surface brick, the other end of the edge is outside of the fluid).
+                    int edge_vertices[12];
+                    for (int edge = 0; edge < 12; edge++) {
+                        if ((marching_cubes_edge_table[cube_index] & (1 << edge)) == 0) {
+                            continue;
+                        }
+                        const int* offset_a = marching_cubes_vertex_offsets[marching_cubes_edge_vertices[edge][0]];
+                        const int* offset_b = marching_cubes_vertex_offsets[marching_cubes_edge_vertices[edge][1]];
+                        int axis = (offset_a[0] != offset_b[0]) ? 0 : ((offset_a[1] != offset_b[1]) ? 1 : 2);
+                        int edge_table_index = this->get_edge_table_index(x + std::min(offset_a[0], offset_b[0]), 
+                            y + std::min(offset_a[1], offset_b[1]), z + std::min(offset_a[2], offset_b[2]));
+                        edge_vertices[edge] = this->edge_table[3 * (size_t)edge_table_index + axis];
+                    }
+                    for (int i = 0; (i < 15) && (marching_cubes_triangle_table[cube_index][i] != -1); i += 3) {
+                        // The same winding as the dense mesh (A, C, B).
+                        *(indices++) = edge_vertices[marching_cubes_triangle_table[cube_index][i]];
+                        *(indices++) = edge_vertices[marching_cubes_triangle_table[cube_index][i + 2]];
+                        *(indices++) = edge_vertices[marching_cubes_triangle_table[cube_index][i + 1]];
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Sparse_Marching_Cubes_Generator::generate_mesh ()
+{
+    TRACE_SCOPE("Sparse_Marching_Cubes_Generator::generate_mesh");
+    auto start = std::chrono::steady_clock::now();
+    if (this->new_cube_edge_length < 0.0f) {
+        std::cout << "ERROR: Set the cube edge length for the marching cubes algorithm first." << std::endl;
+        return;
+    }
+    if (floats_are_same(this->cube_edge_length, this->new_cube_edge_length, MARCHING_CUBES_CUBE_EDGE_LENGTH_STEP) == false) {
+        this->cube_edge_length = this->new_cube_edge_length;
+        this->calculate_number_of_grid_cells();
+    }
+    int number_of_particles = this->particle_system->number_of_particles;
+    // Free the bricks of the last call and mark the ones of the particles.
+    for (int brick_key : this->pool_brick_keys) {
+        this->brick_table[brick_key].store(-1, std::memory_order_relaxed);
+    }
+    {
+        TRACE_SCOPE("Sparse_Marching_Cubes_Generator::mark_bricks");
+        this->parallel_for(&Sparse_Marching_Cubes_Generator::mark_bricks, number_of_particles);
+    }
+    // Number the marked bricks. The brick table has one entry per 512 cells, so this is not worth to parallelize.
+    this->pool_brick_keys.clear();
+    for (int brick_key = 0; brick_key < this->number_of_bricks; brick_key++) {
+        if (this->brick_table[brick_key].load(std::memory_order_relaxed) == 0) {
+            this->brick_table[brick_key].store(this->pool_brick_keys.size(), std::memory_order_relaxed);
+            this->pool_brick_keys.push_back(brick_key);
+        }
+    }
+    this->number_of_pool_bricks = this->pool_brick_keys.size();
+    // The pool only grows (by half of its size, like the vertex buffer of the renderer), otherwise the used bricks are cleared.
+    size_t number_of_pool_cells = (size_t)this->number_of_pool_bricks *
+        SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    if (number_of_pool_cells > this->brick_pool.size()) {
+        Tracked_Vector<std::atomic<int>, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES>(
+            std::max(number_of_pool_cells, this->brick_pool.size() + this->brick_pool.size() / 2)).swap(this->brick_pool);
+    }
+    else {
+        this->parallel_for(&Sparse_Marching_Cubes_Generator::clear_bricks, this->number_of_pool_bricks);
+    }
+    {
+        TRACE_SCOPE("Sparse_Marching_Cubes_Generator::count_particles");
+        this->parallel_for(&Sparse_Marching_Cubes_Generator::count_particles, number_of_particles);
+    }
+    // Skip the interior bricks and number the others (in the order of the pool, like the bricks of the pool).
+    {
+        TRACE_SCOPE("Sparse_Marching_Cubes_Generator::find_interior_bricks");
+        this->pool_bricks_are_full.resize(this->number_of_pool_bricks);
+        this->surface_brick_indices.resize(this->number_of_pool_bricks);
+        this->parallel_for(&Sparse_Marching_Cubes_Generator::find_full_bricks, this->number_of_pool_bricks);
+        this->parallel_for(&Sparse_Marching_Cubes_Generator::find_interior_bricks, this->number_of_pool_bricks);
+        this->surface_pool_bricks.clear();
+        for (int pool_brick = 0; pool_brick < this->number_of_pool_bricks; pool_brick++) {
+            if (this->surface_brick_indices[pool_brick] == 0) {
+                this->surface_brick_indices[pool_brick] = this->surface_pool_bricks.size();
+                this->surface_pool_bricks.push_back(pool_brick);
+            }
+        }
+        this->number_of_surface_bricks = this->surface_pool_bricks.size();
+    }
+    size_t number_of_surface_cells = (size_t)this->number_of_surface_bricks *
+        SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE * SPARSE_MARCHING_CUBES_BRICK_SIZE;
+    this->edge_table.resize(std::max(3 * number_of_surface_cells, this->edge_table.size()));
+
+    // Count the vertices and triangles of every chunk of bricks and calculate their offsets within the mesh.
+    TRACE_SCOPE("Sparse_Marching_Cubes_Generator::extract_mesh");
+    int number_of_chunks = this->get_number_of_chunks(this->number_of_surface_bricks);
+    this->number_of_mesh_vertices_per_chunk.assign(number_of_chunks, 0);
+    this->number_of_mesh_triangles_per_chunk.assign(number_of_chunks, 0);
+    this->parallel_for(&Sparse_Marching_Cubes_Generator::count_mesh_elements, this->number_of_surface_bricks);
+    this->mesh_vertex_offset_per_chunk.resize(number_of_chunks);
+    this->mesh_triangle_offset_per_chunk.resize(number_of_chunks);
+    int number_of_vertices = 0;
+    int number_of_triangles = 0;
+    for (int i = 0; i < number_of_chunks; i++) {
+        this->mesh_vertex_offset_per_chunk.at(i) = number_of_vertices;
+        this->mesh_triangle_offset_per_chunk.at(i) = number_of_triangles;
+        number_of_vertices += this->number_of_mesh_vertices_per_chunk.at(i);
+        number_of_triangles += this->number_of_mesh_triangles_per_chunk.at(i);
+    }
+    this->mesh.positions.resize(number_of_vertices);
+    this->mesh.normals.resize(number_of_vertices);
+    this->mesh.indices.resize(3 * (size_t)number_of_triangles);
+    // All vertices have to exist before the triangles look up the vertices of the neighboring bricks.
+    this->parallel_for(&Sparse_Marching_Cubes_Generator::create_mesh_vertices, this->number_of_surface_bricks);
+    this->parallel_for(&Sparse_Marching_Cubes_Generator::create_mesh_triangles, this->number_of_surface_bricks);
+    auto end = std::chrono::steady_clock::now();
+    this->generation_time = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() / 1000.0;
+}
+
+
+// ====================================== GETTER ======================================
+
+const Marching_Cubes_Mesh& Sparse_Marching_Cubes_Generator::get_mesh ()
+{
+    return this->mesh;
+}
+
+int Sparse_Marching_Cubes_Generator::get_number_of_pool_bricks ()
+{
+    return this->number_of_pool_bricks;
+}
+
+int Sparse_Marching_Cubes_Generator::get_number_of_surface_bricks ()
+{
+    return this->number_of_surface_bricks;
+}
+
+int Sparse_Marching_Cubes_Generator::get_number_of_bricks ()
+{
+    return this->number_of_bricks;
+}
+
+size_t Sparse_Marching_Cubes_Generator::get_memory_footprint ()
+{
+    return this->brick_table.capacity() * sizeof(std::atomic<int>) + this->pool_brick_keys.capacity() * sizeof(int) +
+        this->brick_pool.capacity() * sizeof(std::atomic<int>) + this->pool_bricks_are_full.capacity() * sizeof(unsigned char) +
+        this->surface_pool_bricks.capacity() * sizeof(int) + this->surface_brick_indices.capacity() * sizeof(int) + 
+        this->edge_table.capacity() * sizeof(int);
+}
+
+double Sparse_Marching_Cubes_Generator::get_generation_time ()
+{
+    return this->generation_time;
+}
\ No newline at end of file
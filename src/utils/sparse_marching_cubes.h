@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <atomic>
+
+#include "particle_system.h"
+#include "memory_accounting.h"
+#include "marching_cubes.h"
+
+// The cells of the density estimator are grouped into bricks of this many cells per axis (so a brick has 512 cells).
+// Larger bricks need a smaller brick table but allocate more empty cells around the fluid.
+#define SPARSE_MARCHING_CUBES_BRICK_SIZE        8
+
+// The dense Marching_Cubes_Generator allocates the density estimator and the marching cubes for the whole simulation
+// space, even if the fluid only fills a small part of it (e.g. scene 2). The sparse generator extracts the same surface
+// as Marching_Cubes_Generator::extract_mesh (the particle count as scalar field, the same grid and the same cubes), but
+// it only allocates the bricks of the density estimator that can contribute to the surface:
+// - A brick table with one entry per brick of the whole grid holds the index of the brick in the brick pool (or -1).
+// - Every particle marks the brick of its cell. A cell with particles is a vertex of the eight cubes whose min corner
+//   is the cell itself or one cell less along any axis, and the edges that end in the cell start there. So the bricks
+//   of these cells are marked as well. Then every cube and every edge the surface passes through starts in a brick of
+//   the pool (the isovalue is positive, so the surface only passes through cubes with particles).
+// - The marked bricks are numbered in the order of the brick table and the particles are counted into the pool.
+// - Every brick creates the vertices of the crossed edges that start in one of its cells and saves their indices in
+//   its part of the edge table. After all bricks are done, every brick creates the triangles of the cubes whose min
+//   corner is one of its cells, looking up the vertices of the edges that start in a neighboring brick in the edge
+//   table of that brick. So every vertex exists once and the mesh is crack-free without stitching.
+// This is a block-sparse dense grid, not a refining one: all bricks have the resolution of the dense grid, so the mesh is
+// the same as the one of the dense generator. The particles are counted before it is known which bricks are inside the
+// fluid, so the counts of the pool cover the whole fluid including its interior. A brick whose cells are all inside the
+// fluid (see is_full_brick) and whose 26 neighbors are full as well is an interior brick: every cell within two cells of
+// it is inside the fluid, so no crossed edge, cube or gradient of the surface reads it. The interior bricks are skipped
+// by the mesh extraction and get no part of the edge table (three ints per cell, three times the size of their counts).
+// So the counts grow with the volume of the fluid and the edge table and the extraction time with its surface, instead of
+// the volume of the simulation space. The bricks are numbered in
+// the same order by every thread count and the vertices and triangles of every chunk of bricks are counted first (like
+// the dense mesh extraction), so the mesh does not depend on the number of threads either.
+class Sparse_Marching_Cubes_Generator
+{
+    private:
+        // Parallel for loops (the elements are particles or bricks of the pool, see marching_cubes_parallel_for).
+        void parallel_for (void (Sparse_Marching_Cubes_Generator::* function)(unsigned int, unsigned int), int number_of_elements);
+        const char* get_region_name (void (Sparse_Marching_Cubes_Generator::* function)(unsigned int, unsigned int));
+        int get_number_of_chunks (int number_of_elements);
+        int get_chunk_index (unsigned int index_start, int number_of_elements);
+
+        // The grid of the density estimator (the same as the one of the dense generator).
+        float cube_edge_length;
+        int number_of_cells_x;
+        int number_of_cells_y;
+        int number_of_cells_z;
+        // The grid of the bricks.
+        int number_of_bricks_x;
+        int number_of_bricks_y;
+        int number_of_bricks_z;
+        int number_of_bricks;
+        // The index of every brick within the pool, -1 if it is not allocated. The particles mark the bricks in parallel,
+        // so the entries are atomics (and the vector is replaced instead of resized).
+        Tracked_Vector<std::atomic<int>, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES> brick_table;
+        // The keys of the allocated bricks (in the order of the pool).
+        Tracked_Vector<int, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES> pool_brick_keys;
+        // The number of particles per cell, one brick after another. Only grows, so it is replaced if it is too small.
+        Tracked_Vector<std::atomic<int>, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES> brick_pool;
+        int number_of_pool_bricks;
+        // If all cells of a brick of the pool are inside the fluid (one entry per brick of the pool).
+        Tracked_Vector<unsigned char, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES> pool_bricks_are_full;
+        // The bricks of the pool the mesh is extracted from (all but the interior bricks, see the header) and the index of
+        // every brick of the pool within them (-1 for an interior brick).
+        Tracked_Vector<int, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES> surface_pool_bricks;
+        Tracked_Vector<int, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES> surface_brick_indices;
+        int number_of_surface_bricks;
+        // The index of the vertex on the edge along x, y and z that starts in a cell, three ints per cell of the surface bricks.
+        Tracked_Vector<int, MEMORY_SUBSYSTEM_SPARSE_MARCHING_CUBES> edge_table;
+
+        // Like the dense mesh extraction, the vertices and triangles of every chunk are counted first.
+        Marching_Cubes_Mesh mesh;
+        std::vector<int> number_of_mesh_vertices_per_chunk;
+        std::vector<int> number_of_mesh_triangles_per_chunk;
+        std::vector<int> mesh_vertex_offset_per_chunk;
+        std::vector<int> mesh_triangle_offset_per_chunk;
+
+        // The time of the last generate_mesh call in milliseconds.
+        double generation_time;
+
+        // Calculates the grid and replaces the brick table (if the edge length or the simulation space changed).
+        void calculate_number_of_grid_cells ();
+        int get_cell_index (glm::vec3 position, int& x, int& y, int& z);
+        // The index of the cell within the pool, -1 if its brick is not allocated.
+        int get_pool_index (int x, int y, int z);
+        // The index of the cell within the edge table (the same cell order as the pool, but only the surface bricks).
+        int get_edge_table_index (int x, int y, int z);
+        // The chunk functions of the particles: mark the bricks and count the particles.
+        void mark_bricks (unsigned int index_start, unsigned int index_end);
+        void count_particles (unsigned int index_start, unsigned int index_end);
+        // Sets the counts of the given bricks of the pool to zero.
+        void clear_bricks (unsigned int index_start, unsigned int index_end);
+        // The chunk functions of the bricks of the pool: find the full bricks and the interior bricks (see the header).
+        void find_full_bricks (unsigned int index_start, unsigned int index_end);
+        void find_interior_bricks (unsigned int index_start, unsigned int index_end);
+        bool is_full_brick (int brick_x, int brick_y, int brick_z);
+        // The particle count of a cell (zero outside of the allocated bricks and outside of the grid).
+        float get_field_value (int x, int y, int z);
+        bool is_crossing_edge (int x, int y, int z, int axis);
+        int get_cube_index (int x, int y, int z);
+        glm::vec3 create_edge_vertex (int x, int y, int z, int axis, glm::vec3& normal);
+        // The chunk functions of the surface bricks (see above).
+        void count_mesh_elements (unsigned int index_start, unsigned int index_end);
+        void create_mesh_vertices (unsigned int index_start, unsigned int index_end);
+        void create_mesh_triangles (unsigned int index_start, unsigned int index_end);
+
+    public:
+        Sparse_Marching_Cubes_Generator ();
+
+        Particle_System* particle_system;
+        // The same as for the dense generator.
+        float new_cube_edge_length;
+        float isovalue;
+        // Has to be called if the simulation space changed.
+        void simulation_space_changed ();
+
+        // Counts the particles into the bricks and extracts the surface.
+        void generate_mesh ();
+
+        const Marching_Cubes_Mesh& get_mesh ();
+        // The number of allocated bricks, the number of them the mesh is extracted from (the others are inside the fluid)
+        // and the number of all bricks of the grid.
+        int get_number_of_pool_bricks ();
+        int get_number_of_surface_bricks ();
+        int get_number_of_bricks ();
+        // The bytes of the brick table, the pool, the tables of the surface bricks and the edge table (without the mesh).
+        size_t get_memory_footprint ();
+        double get_generation_time ();
+
+        // The per-thread work, idle times and load imbalance of every parallel for loop.
+        Parallel_Region_Statistics parallel_region_statistics;
+};
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "thread_pool.h"
+
+
+Thread_Pool::Thread_Pool (int number_of_threads)
+{
+    this->stop = false;
+    this->number_of_running_tasks = 0;
+    this->workers.reserve(number_of_threads);
+    for (int i = 0; i < number_of_threads; i++) {
+        this->workers.emplace_back(&Thread_Pool::work, this);
+    }
+}
+
+Thread_Pool::~Thread_Pool ()
+{
+    this->wait_until_idle();
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->stop = true;
+    lock.unlock();
+    this->condition_changed.notify_all();
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+}
+
+int Thread_Pool::get_number_of_threads ()
+{
+    return this->workers.size();
+}
+
+void Thread_Pool::submit_job (std::function<void()> job)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->jobs.push_back(std::move(job));
+    lock.unlock();
+    this->condition_changed.notify_all();
+}
+
+void Thread_Pool::submit_chunk (Task_Group& task_group, std::function<void()> chunk)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    task_group.number_of_pending_tasks++;
+    this->chunks.emplace_back(std::move(chunk), &task_group);
+    lock.unlock();
+    this->condition_changed.notify_all();
+}
+
+void Thread_Pool::execute_chunk (std::pair<std::function<void()>, Task_Group*>& chunk)
+{
+    chunk.first();
+    std::unique_lock<std::mutex> lock(this->mutex);
+    chunk.second->number_of_pending_tasks--;
+    this->number_of_running_tasks--;
+    lock.unlock();
+    // Someone may wait for the group (or for the pool to be idle).
+    this->condition_changed.notify_all();
+}
+
+void Thread_Pool::wait (Task_Group& task_group)
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (task_group.number_of_pending_tasks > 0) {
+        if (this->chunks.empty() == false) {
+            // Help with the chunks instead of sleeping.
+            std::pair<std::function<void()>, Task_Group*> chunk = std::move(this->chunks.front());
+            this->chunks.pop_front();
+            this->number_of_running_tasks++;
+            lock.unlock();
+            this->execute_chunk(chunk);
+            lock.lock();
+            continue;
+        }
+        // The remaining chunks of the group are executed by other threads.
+        this->condition_changed.wait(lock, [this, &task_group] () {
+            return (task_group.number_of_pending_tasks == 0) || (this->chunks.empty() == false);
+        });
+    }
+}
+
+void Thread_Pool::wait_until_idle ()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->condition_changed.wait(lock, [this] () {
+        return this->jobs.empty() && this->chunks.empty() && (this->number_of_running_tasks == 0);
+    });
+}
+
+void Thread_Pool::work ()
+{
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->condition_changed.wait(lock, [this] () {
+            return (this->stop == true) || (this->chunks.empty() == false) || (this->jobs.empty() == false);
+        });
+        // The chunks first, they belong to a simulation that is already running.
+        if (this->chunks.empty() == false) {
+            std::pair<std::function<void()>, Task_Group*> chunk = std::move(this->chunks.front());
+            this->chunks.pop_front();
+            this->number_of_running_tasks++;
+            lock.unlock();
+            this->execute_chunk(chunk);
+            lock.lock();
+        }
+        else if (this->jobs.empty() == false) {
+            std::function<void()> job = std::move(this->jobs.front());
+            this->jobs.pop_front();
+            this->number_of_running_tasks++;
+            lock.unlock();
+            job();
+            lock.lock();
+            this->number_of_running_tasks--;
+            this->condition_changed.notify_all();
+        }
+        else if (this->stop == true) {
+            return;
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// A pool of worker threads shared by several particle systems (see the ensemble runner). Without a pool, every
+// parallel for loop of a particle system starts and joins its own threads, so two particle systems in the same
+// process each start their threads and compete for the cores. With a pool, the whole work of the process runs on
+// a fixed number of threads.
+// There are two kinds of tasks:
+// - Jobs are long tasks, e.g. a whole simulation of an ensemble member.
+// - Chunks are the chunks of a parallel for loop. They are executed before any job, so a simulation that is
+//   already running is finished before a new one is started.
+// Chunks belong to a task group. The thread that waits for a group does not sleep but executes chunks (of any
+// group) until its group is done, so a job that waits for its own chunks never blocks a worker (and a pool with
+// a single thread works as well). A waiting thread never starts a job, otherwise the chunks of its group would
+// have to wait for a whole simulation.
+
+// Counts the chunks of a group that are not finished yet. It is only accessed by the pool (with its mutex locked).
+struct Task_Group
+{
+    int number_of_pending_tasks = 0;
+};
+
+class Thread_Pool
+{
+    private:
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> jobs;
+        std::deque<std::pair<std::function<void()>, Task_Group*>> chunks;
+        bool stop;
+        // The number of tasks that are being executed at the moment (for wait_until_idle).
+        int number_of_running_tasks;
+        std::mutex mutex;
+        // Notified if a task was added or a group is done.
+        std::condition_variable condition_changed;
+
+        // The function executed by the worker threads.
+        void work ();
+        // Executes a chunk and marks it as done in its group. The mutex has to be unlocked.
+        void execute_chunk (std::pair<std::function<void()>, Task_Group*>& chunk);
+
+    public:
+        Thread_Pool (int number_of_threads);
+        // Waits until all tasks are done and joins the workers.
+        ~Thread_Pool ();
+
+        int get_number_of_threads ();
+        // Adds a job. It is executed as soon as a worker has no chunks to execute.
+        void submit_job (std::function<void()> job);
+        // Adds a chunk of the group.
+        void submit_chunk (Task_Group& task_group, std::function<void()> chunk);
+        // Returns when all chunks of the group are done. Meanwhile, the calling thread executes chunks itself.
+        void wait (Task_Group& task_group);
+        // Returns when there are no tasks left and no worker executes a task anymore.
+        void wait_until_idle ();
+};
\ No newline at end of file
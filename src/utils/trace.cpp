@@ -0,0 +1,182 @@
+#include "trace.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+
+#ifdef TRACE_USE_TSC
+#include <x86intrin.h>
+#endif
+
+
+// ====================================== BUFFER MANAGEMENT ======================================
+
+// All buffers ever created and the ones that are not used by a thread at the moment.
+// The mutex is only locked when a thread traces for the first time and when it ends.
+static std::vector<std::unique_ptr<Trace_Buffer>> trace_buffers;
+static std::vector<Trace_Buffer*> free_trace_buffers;
+static std::mutex mutex_trace_buffers;
+
+// The reference point of the timestamps. The trace starts at zero.
+static const std::chrono::steady_clock::time_point trace_start_time = std::chrono::steady_clock::now();
+#ifdef TRACE_USE_TSC
+static const uint64_t trace_start_ticks = __rdtsc();
+#endif
+
+// Hands the buffer back when the thread ends.
+struct Trace_Thread_Handle
+{
+    Trace_Buffer* buffer = nullptr;
+
+    ~Trace_Thread_Handle ()
+    {
+        if (this->buffer != nullptr) {
+            std::unique_lock<std::mutex> lock(mutex_trace_buffers);
+            free_trace_buffers.push_back(this->buffer);
+        }
+    }
+};
+
+static thread_local Trace_Thread_Handle trace_thread_handle;
+
+Trace_Buffer* get_trace_buffer ()
+{
+    if (trace_thread_handle.buffer == nullptr) {
+        std::unique_lock<std::mutex> lock(mutex_trace_buffers);
+        if (free_trace_buffers.empty() == false) {
+            // Reuse the buffer with the lowest lane, so the trace shows as few lanes as possible.
+            auto lowest = free_trace_buffers.begin();
+            for (auto it = free_trace_buffers.begin(); it != free_trace_buffers.end(); it++) {
+                if ((*it)->lane < (*lowest)->lane) {
+                    lowest = it;
+                }
+            }
+            trace_thread_handle.buffer = *lowest;
+            free_trace_buffers.erase(lowest);
+        }
+        else {
+            trace_buffers.push_back(std::make_unique<Trace_Buffer>());
+            trace_thread_handle.buffer = trace_buffers.back().get();
+            trace_thread_handle.buffer->lane = trace_buffers.size() - 1;
+            trace_thread_handle.buffer->number_of_written_events = 0;
+        }
+    }
+    return trace_thread_handle.buffer;
+}
+
+
+// ====================================== TRACING ======================================
+
+uint64_t trace_timestamp ()
+{
+#ifdef TRACE_USE_TSC
+    return __rdtsc() - trace_start_ticks;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start_time).count();
+#endif
+}
+
+void trace_event (Trace_Buffer* buffer, const char* name, uint64_t start, uint64_t end, int64_t argument_0, int64_t argument_1)
+{
+    // Only this thread writes into the buffer, so a relaxed read is enough. The release store makes
+    // sure the event is written before it is counted.
+    uint64_t index = buffer->number_of_written_events.load(std::memory_order_relaxed);
+    Trace_Event& event = buffer->events[index & (TRACE_BUFFER_CAPACITY - 1)];
+    event.name = name;
+    event.start = start;
+    event.end = end;
+    event.argument_0 = argument_0;
+    event.argument_1 = argument_1;
+    buffer->number_of_written_events.store(index + 1, std::memory_order_release);
+}
+
+void clear_trace ()
+{
+    std::unique_lock<std::mutex> lock(mutex_trace_buffers);
+    for (auto& buffer : trace_buffers) {
+        buffer->number_of_written_events.store(0, std::memory_order_release);
+    }
+}
+
+
+// ====================================== EXPORT ======================================
+
+// Converts a timestamp to microseconds (the unit of the Chrome trace event format).
+static double timestamp_to_microseconds (uint64_t timestamp, double nanoseconds_per_tick)
+{
+    return (timestamp * nanoseconds_per_tick) / 1000.0;
+}
+
+bool save_trace_to_json (const std::string filename)
+{
+#ifndef TRACING
+    std::cout << "Tracing is disabled. Build with -DTRACING to trace the simulation." << std::endl;
+    return false;
+#endif
+    // Calculate how many nanoseconds a tick of the timestamp is.
+    double nanoseconds_per_tick = 1.0;
+#ifdef TRACE_USE_TSC
+    uint64_t elapsed_ticks = __rdtsc() - trace_start_ticks;
+    double elapsed_nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - trace_start_time).count();
+    if (elapsed_ticks > 0) {
+        nanoseconds_per_tick = elapsed_nanoseconds / elapsed_ticks;
+    }
+#endif
+
+    std::ofstream file (filename);
+    if (file.is_open() == false) {
+        std::cout << "Failed to open file: '" << filename << "'." << std::endl;
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(mutex_trace_buffers);
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[" << std::endl;
+    bool first_event = true;
+    unsigned long long number_of_events = 0;
+    unsigned long long number_of_overwritten_events = 0;
+    for (auto& buffer : trace_buffers) {
+        // Name the lane. The first lane is used by the thread that opened the first scope (the main thread).
+        file << (first_event ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << buffer->lane 
+            << ",\"args\":{\"name\":\"" << ((buffer->lane == 0) ? "main" : "worker ") ;
+        if (buffer->lane > 0) {
+            file << buffer->lane;
+        }
+        file << "\"}}";
+        first_event = false;
+        // Only the last TRACE_BUFFER_CAPACITY events are still in the ring buffer.
+        uint64_t number_of_written_events = buffer->number_of_written_events.load(std::memory_order_acquire);
+        uint64_t first_index = (number_of_written_events > TRACE_BUFFER_CAPACITY) ? number_of_written_events - TRACE_BUFFER_CAPACITY : 0;
+        number_of_overwritten_events += first_index;
+        for (uint64_t i = first_index; i < number_of_written_events; i++) {
+            const Trace_Event& event = buffer->events[i & (TRACE_BUFFER_CAPACITY - 1)];
+            // Complete events ("X") have a start and a duration.
+            file << ",\n{\"name\":\"";
+            for (const char* character = event.name; *character != '\0'; character++) {
+                if ((*character == '"') || (*character == '\\')) {
+                    file << '\\';
+                }
+                file << *character;
+            }
+            file << "\",\"cat\":\"rtgp\",\"ph\":\"X\",\"pid\":0,\"tid\":" << buffer->lane 
+                << ",\"ts\":" << timestamp_to_microseconds(event.start, nanoseconds_per_tick) 
+                << ",\"dur\":" << timestamp_to_microseconds(event.end - event.start, nanoseconds_per_tick);
+            if (event.argument_0 >= 0) {
+                file << ",\"args\":{\"index_start\":" << event.argument_0 << ",\"index_end\":" << event.argument_1 << "}";
+            }
+            file << "}";
+            number_of_events++;
+        }
+    }
+    file << std::endl << "]}" << std::endl;
+    file.close();
+    std::cout << "Trace with " << number_of_events << " spans saved to: '" << filename << "'";
+    if (number_of_overwritten_events > 0) {
+        std::cout << " (" << number_of_overwritten_events << " older spans were overwritten)";
+    }
+    std::cout << std::endl;
+    return true;
+}
\ No newline at end of file
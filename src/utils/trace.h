@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <atomic>
+#include <cstdint>
+
+// A low overhead tracing of the simulation phases with nanosecond resolution. The traced spans can be
+// exported as Chrome trace event json file, which can be opened with Perfetto (https://ui.perfetto.dev)
+// or chrome://tracing.
+// Every thread writes its spans into its own ring buffer, so no locking is needed while tracing. If a buffer
+// is full, the oldest spans are overwritten. The parallel for loops create new threads for every call, so the
+// buffers are not bound to a thread but handed back when a thread ends and reused by the next one. Every buffer
+// is shown as its own "thread" (lane) in the trace.
+// Tracing is only compiled in if TRACING is defined (see CMakeLists.txt). Otherwise the macros below
+// expand to nothing and tracing has no cost at all.
+// If TRACE_USE_TSC is defined as well, the timestamps are taken from the time stamp counter of the CPU
+// (x86 only) instead of the steady clock. Reading it is cheaper, the ticks are converted to nanoseconds
+// when the trace is exported.
+#define TRACE_DEFAULT_FILENAME          "./trace.json"
+// The number of spans a ring buffer can hold (a power of two).
+#define TRACE_BUFFER_CAPACITY           (1 << 16)
+
+// A traced span. The name needs to be a string literal (only the pointer is stored).
+// The arguments are optional, e.g. the parallel for loops store the chunk they worked on.
+struct Trace_Event
+{
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    int64_t argument_0;
+    int64_t argument_1;
+};
+
+// The ring buffer of one lane. Only one thread writes into it at a time.
+struct Trace_Buffer
+{
+    unsigned int lane;
+    Trace_Event events[TRACE_BUFFER_CAPACITY];
+    // The number of spans written so far. It is only increased by the writing thread, the export
+    // reads it to know which events are valid.
+    std::atomic<uint64_t> number_of_written_events;
+};
+
+// Returns the current timestamp (steady clock nanoseconds or time stamp counter ticks).
+uint64_t trace_timestamp ();
+// Returns the ring buffer of the calling thread (a free buffer is assigned on the first call of a thread).
+Trace_Buffer* get_trace_buffer ();
+// Writes a span into the given ring buffer.
+void trace_event (Trace_Buffer* buffer, const char* name, uint64_t start, uint64_t end, int64_t argument_0 = -1, int64_t argument_1 = -1);
+// Removes all traced spans. Only call this while no other thread is tracing.
+void clear_trace ();
+// Writes all traced spans into a Chrome trace event json file. Only call this while no other thread is tracing.
+bool save_trace_to_json (const std::string filename = TRACE_DEFAULT_FILENAME);
+
+// The scope traces the time from its creation to the end of the enclosing block.
+class Trace_Scope
+{
+    private:
+        Trace_Buffer* buffer;
+        const char* name;
+        uint64_t start;
+        int64_t argument_0;
+        int64_t argument_1;
+
+    public:
+        Trace_Scope (const char* name, int64_t argument_0 = -1, int64_t argument_1 = -1)
+        {
+            // The buffer is assigned when the scope is opened. So the thread that opens the first scope
+            // (normally the main thread) gets the first lane, even if the worker threads end their spans earlier.
+            this->buffer = get_trace_buffer();
+            this->name = name;
+            this->argument_0 = argument_0;
+            this->argument_1 = argument_1;
+            this->start = trace_timestamp();
+        }
+
+        ~Trace_Scope ()
+        {
+            trace_event(this->buffer, this->name, this->start, trace_timestamp(), this->argument_0, this->argument_1);
+        }
+};
+
+#define TRACE_CONCATENATE_INNER(a, b) a ## b
+#define TRACE_CONCATENATE(a, b) TRACE_CONCATENATE_INNER(a, b)
+
+#ifdef TRACING
+// Traces the rest of the enclosing block.
+#define TRACE_SCOPE(name) Trace_Scope TRACE_CONCATENATE(trace_scope_, __LINE__) (name)
+// Traces the rest of the enclosing block and stores the range (e.g. of a chunk) with it.
+#define TRACE_SCOPE_RANGE(name, index_start, index_end) Trace_Scope TRACE_CONCATENATE(trace_scope_, __LINE__) (name, index_start, index_end)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_RANGE(name, index_start, index_end)
+#endif
\ No newline at end of file
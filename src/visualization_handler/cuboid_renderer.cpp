@@ -0,0 +1,80 @@
+#include "cuboid_renderer.h"
+
+#include "../utils/debug.h"
+
+
+Cuboid_Renderer::Cuboid_Renderer ()
+{
+    this->vertex_array_object = 0;
+    this->vertex_buffer_object = 0;
+    this->index_buffer_object = 0;
+    // The order of the vertices is given by Cuboid::get_vertices().
+    this->indices = std::vector<GLuint> {
+        0, 1, 2,    // back face triangle 1
+        2, 3, 1,    // back face triangle 2
+        0, 4, 5,    // bottom face triangle 1
+        5, 1, 0,    // bootom face triangle 2
+        4, 5, 7,    // front face triangle 1
+        7, 6, 4,    // front face triangle 2
+        6, 7, 3,    // top face triangle 1
+        3, 2, 6,    // top face triangle 2
+        0, 2, 6,    // left face triangle 1
+        6, 4, 0,    // left face triangle 2
+        1, 3, 7,    // right face triangle 1
+        7, 5, 1     // right face triangle 2
+    };
+}
+
+void Cuboid_Renderer::generate_gpu_resources ()
+{
+    // Generate the OpenGL buffers.
+    GLCall( glGenVertexArrays(1, &this->vertex_array_object) );
+    GLCall( glGenBuffers(1, &this->vertex_buffer_object) );
+    GLCall( glGenBuffers(1, &this->index_buffer_object) );
+
+    // Make vertex array object active.  
+    GLCall( glBindVertexArray(this->vertex_array_object) );
+    // Reserve the memory for the eight corners. The data is copied with every draw call.
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
+    GLCall( glBufferData(GL_ARRAY_BUFFER, sizeof(glm::vec3) * 8, nullptr, GL_DYNAMIC_DRAW) );
+    // Copy the indices into the index buffer object.
+    GLCall( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer_object) );
+    GLCall( glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * this->indices.size(), &this->indices[0], GL_STATIC_DRAW) );
+    // Describe the vertex buffer layout.
+    GLCall( glEnableVertexAttribArray(0) );
+    GLCall( glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (GLvoid*)0) );
+    // Unbind.
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    GLCall( glBindVertexArray(0) );
+}
+
+void Cuboid_Renderer::draw (Cuboid& cuboid, bool unbind)
+{
+    // The buffers are created with the first draw call (we need an OpenGL context for this).
+    if (this->vertex_array_object == 0) {
+        this->generate_gpu_resources();
+    }
+    // Upload the corners of the cuboid.
+    std::vector<glm::vec3> vertices = cuboid.get_vertices();
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
+    GLCall( glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glm::vec3) * vertices.size(), &vertices[0]) );
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    // Draw.
+    GLCall( glBindVertexArray(this->vertex_array_object) );
+    GLCall( glDrawElements(GL_TRIANGLES, this->indices.size(), GL_UNSIGNED_INT, 0) );
+    // In order to save a few unbind-calls, do this only if neccessary. 
+    // In our case, the visualization handler will handle the unbinding, so normally we will not unbind here.
+    if (unbind == true) {
+        GLCall( glBindVertexArray(0) );
+    }
+}
+
+void Cuboid_Renderer::free_gpu_resources ()
+{
+    if (this->vertex_array_object > 0) {
+        GLCall( glDeleteVertexArrays(1, &this->vertex_array_object) );
+        GLCall( glDeleteBuffers(1, &this->vertex_buffer_object) );
+        GLCall( glDeleteBuffers(1, &this->index_buffer_object) );
+        this->vertex_array_object = 0;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "../utils/cuboid.h"
+
+// The cuboid renderer draws cuboids (the simulation space and the starting positions of the fluid).
+// All cuboids have the same topology, so one set of OpenGL buffers is enough. The eight corners of the
+// cuboid to be drawn are uploaded with every draw call.
+class Cuboid_Renderer
+{
+    private:
+        GLuint vertex_buffer_object;
+        GLuint index_buffer_object;
+        GLuint vertex_array_object;
+        std::vector<GLuint> indices;
+
+        void generate_gpu_resources ();
+
+    public:
+        Cuboid_Renderer ();
+
+        // Draws the cuboid. Note that the shader will be selected and activated by the visualization handler.
+        void draw (Cuboid& cuboid, bool unbind = false);
+        // Deletes the GPU ressources (vertex array, vertex buffer, index buffer).
+        void free_gpu_resources ();
+};
\ No newline at end of file
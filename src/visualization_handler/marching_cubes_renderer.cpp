@@ -0,0 +1,138 @@
+#include "marching_cubes_renderer.h"
+
+#include <algorithm>
+
+#include "../utils/debug.h"
+#include "../utils/frame_profiler.h"
+#include "../utils/memory_accounting.h"
+
+
+Marching_Cubes_Renderer::Marching_Cubes_Renderer ()
+{
+    this->vertex_array_object = 0;
+    this->vertex_buffer_object = 0;
+    this->buffer_capacity = 0;
+    this->number_of_marching_cubes = 0;
+    this->uploaded_generation = 0;
+}
+
+void Marching_Cubes_Renderer::allocate_vertex_buffer (int capacity)
+{
+    memory_accounting.memory_freed(MEMORY_SUBSYSTEM_GPU_MARCHING_CUBES_BUFFERS, this->get_gpu_memory_footprint());
+    this->buffer_capacity = capacity;
+    // The data is uploaded afterwards, the vertex array keeps pointing to the same buffer.
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
+    GLCall( glBufferData(GL_ARRAY_BUFFER, sizeof(Marching_Cube) * this->buffer_capacity, NULL, GL_DYNAMIC_DRAW) );
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    // The buffers are not on our heap, so tell the memory accounting about them.
+    memory_accounting.memory_allocated(MEMORY_SUBSYSTEM_GPU_MARCHING_CUBES_BUFFERS, this->get_gpu_memory_footprint());
+}
+
+void Marching_Cubes_Renderer::generate_gpu_resources ()
+{
+    // Generate the OpenGL buffers for the marching cubes. The cubes are drawn as points in the order of the
+    // vertex buffer, so no index buffer is needed.
+    GLCall( glGenVertexArrays(1, &this->vertex_array_object) );
+    GLCall( glGenBuffers(1, &this->vertex_buffer_object) );
+
+    // Make vertex array object active.  
+    GLCall( glBindVertexArray(this->vertex_array_object) );
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
+
+    // Describe the vertex buffer layout of a marching cube (see Marching_Cube).
+    unsigned int index = 0;
+    // Index of the cube within the grid (an integer attribute, the shaders derive the position from it).
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribIPointer(index, 1, GL_INT, sizeof(Marching_Cube), (GLvoid*)(offsetof(Marching_Cube, cube_index))) );
+    index++;
+    // Vertex values 0 - 3 (half floats, converted to floats by the GPU).
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 4, GL_HALF_FLOAT, GL_FALSE, sizeof(Marching_Cube), (GLvoid*)(offsetof(Marching_Cube, vertex_values))) );
+    index++;
+    // Vertex values 4 - 7.
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 4, GL_HALF_FLOAT, GL_FALSE, sizeof(Marching_Cube), (GLvoid*)(offsetof(Marching_Cube, vertex_values) + 4 * sizeof(unsigned short))) );
+    index++;
+
+    // Unbind.
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    GLCall( glBindVertexArray(0) );
+}
+
+void Marching_Cubes_Renderer::draw (Marching_Cubes_Generator& marching_cubes_generator, bool unbind)
+{
+    {
+        PROFILE_PHASE(PROFILER_PHASE_BUFFER_UPLOAD);
+        if (this->vertex_array_object == 0) {
+            this->generate_gpu_resources();
+        }
+        // Update the marching cubes data in the vertex buffer object.
+        // But only if the data changed.
+        if (this->uploaded_generation != marching_cubes_generator.get_generation()) {
+            this->number_of_marching_cubes = marching_cubes_generator.get_number_of_active_marching_cubes();
+            // If the buffer holds the previous generation, only the range of the active cubes that changed since then
+            // has to be uploaded (see incremental updates of the Marching_Cubes_Generator).
+            int upload_begin = 0;
+            int upload_end = this->number_of_marching_cubes;
+            if ((this->uploaded_generation > 0) && (this->uploaded_generation + 1 == marching_cubes_generator.get_generation())) {
+                upload_begin = marching_cubes_generator.get_changed_active_marching_cubes_begin();
+                upload_end = marching_cubes_generator.get_changed_active_marching_cubes_end();
+            }
+            // Grow the buffer by half of its size, so a surface that grows slowly does not create a new buffer every frame.
+            // The new buffer is empty, so everything is uploaded.
+            if (this->number_of_marching_cubes > this->buffer_capacity) {
+                this->allocate_vertex_buffer(std::max(this->number_of_marching_cubes, this->buffer_capacity + this->buffer_capacity / 2));
+                upload_begin = 0;
+                upload_end = this->number_of_marching_cubes;
+            }
+            if (upload_end > upload_begin) {
+                GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
+                GLCall( glBufferSubData(GL_ARRAY_BUFFER, sizeof(Marching_Cube) * upload_begin, sizeof(Marching_Cube) * (upload_end - upload_begin), 
+                    marching_cubes_generator.get_active_marching_cubes().data() + upload_begin) );
+                GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+            }
+            this->uploaded_generation = marching_cubes_generator.get_generation();
+        }
+    }
+    if (this->number_of_marching_cubes == 0) {
+        return;
+    }
+    // Draw the marching cubes using the vertex array object.
+    GLCall( glBindVertexArray(this->vertex_array_object) );
+    GLCall( glDrawArrays(GL_POINTS, 0, this->number_of_marching_cubes) );
+    // In order to save a few unbind-calls, do this only if neccessary. 
+    // In our case, the visualization handler will handle the unbinding, so normally we will not unbind here.
+    if (unbind == true) {
+        GLCall( glBindVertexArray(0) );
+    }
+}
+
+void Marching_Cubes_Renderer::set_grid_uniforms (Shader& shader, Marching_Cubes_Generator& marching_cubes_generator)
+{
+    shader.set_uniform_1f("u_cube_edge_length", marching_cubes_generator.cube_edge_length);
+    shader.set_uniform_3fv("u_grid_origin", marching_cubes_generator.get_grid_origin());
+    shader.set_uniform_1i("u_number_of_cells_x", marching_cubes_generator.get_number_of_cells_x_marching_cubes());
+    shader.set_uniform_1i("u_number_of_cells_y", marching_cubes_generator.get_number_of_cells_y_marching_cubes());
+}
+
+void Marching_Cubes_Renderer::free_gpu_resources ()
+{
+    if (this->vertex_array_object > 0) {
+        memory_accounting.memory_freed(MEMORY_SUBSYSTEM_GPU_MARCHING_CUBES_BUFFERS, this->get_gpu_memory_footprint());
+        GLCall( glDeleteVertexArrays(1, &this->vertex_array_object) );
+        GLCall( glDeleteBuffers(1, &this->vertex_buffer_object) );
+        this->vertex_array_object = 0;
+        this->buffer_capacity = 0;
+        this->number_of_marching_cubes = 0;
+        // Upload the marching cubes again with the next draw call.
+        this->uploaded_generation = 0;
+    }
+}
+
+size_t Marching_Cubes_Renderer::get_gpu_memory_footprint ()
+{
+    if (this->vertex_array_object == 0) {
+        return 0;
+    }
+    return this->buffer_capacity * sizeof(Marching_Cube);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "../utils/marching_cubes.h"
+#include "shader.h"
+
+// The marching cubes renderer owns the OpenGL resources needed to draw the marching cubes. The triangles
+// of the surface are generated in the geometry shader. Since the marching cubes also hold the information
+// about their position in space (their index in the grid), the same buffers are used to draw the grid (with another shader).
+// Both shaders need the uniforms of the grid to derive the positions (see set_grid_uniforms).
+// Only the active cubes of the generator (the cubes the surface passes through) are uploaded and drawn, so
+// the upload and the work of the GPU depend on the area of the surface and not on the volume of the grid.
+class Marching_Cubes_Renderer
+{
+    private:
+        GLuint vertex_array_object;
+        GLuint vertex_buffer_object;
+        // The number of marching cubes the vertex buffer has space for. The number of active cubes changes
+        // every frame, the buffer is only created again if they do not fit anymore.
+        int buffer_capacity;
+        // The number of active cubes in the vertex buffer.
+        int number_of_marching_cubes;
+        // The generation of the marching cubes uploaded the last time (see Marching_Cubes_Generator).
+        unsigned long long uploaded_generation;
+
+        // Creates the vertex array and describes the layout of the vertex buffer.
+        void generate_gpu_resources ();
+        // Creates the data store of the vertex buffer with space for the given number of marching cubes.
+        void allocate_vertex_buffer (int capacity);
+
+    public:
+        Marching_Cubes_Renderer ();
+
+        // Uploads the marching cubes (only if they changed) and draws them. Note that the shader will be 
+        // selected and activated by the visualization handler.
+        void draw (Marching_Cubes_Generator& marching_cubes_generator, bool unbind = false);
+        // Sets the edge length, the origin and the number of cubes of the grid. The shader has to be in use.
+        void set_grid_uniforms (Shader& shader, Marching_Cubes_Generator& marching_cubes_generator);
+        // The size of the vertex buffer in bytes.
+        size_t get_gpu_memory_footprint ();
+        // Deletes the GPU ressources (vertex array, vertex buffer).
+        void free_gpu_resources ();
+};
\ No newline at end of file
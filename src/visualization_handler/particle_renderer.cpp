@@ -0,0 +1,126 @@
+#include "particle_renderer.h"
+
+#include <numeric>
+
+#include "../utils/debug.h"
+#include "../utils/frame_profiler.h"
+#include "../utils/memory_accounting.h"
+
+
+Particle_Renderer::Particle_Renderer ()
+{
+    this->vertex_array_object = 0;
+    this->vertex_buffer_object = 0;
+    this->index_buffer_object = 0;
+    this->number_of_particles = 0;
+}
+
+void Particle_Renderer::generate_gpu_resources (Particle_System& particle_system)
+{
+    // Clear the buffers if there is something to clear.
+    this->free_gpu_resources();
+    this->number_of_particles = particle_system.number_of_particles;
+
+    // Generate the OpenGL buffers for the particle system.
+    GLCall( glGenVertexArrays(1, &this->vertex_array_object) );
+    GLCall( glGenBuffers(1, &this->vertex_buffer_object) );
+    GLCall( glGenBuffers(1, &this->index_buffer_object) );
+
+    // Make vertex array object active.  
+    GLCall( glBindVertexArray(this->vertex_array_object) );
+
+    // Copy the data into the vertex buffer object.
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
+    GLCall( glBufferData(GL_ARRAY_BUFFER, sizeof(Particle) * this->number_of_particles, &particle_system.particles.at(0), GL_STATIC_DRAW) );
+
+    // Copy the indices into the index buffer object.
+    GLCall( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->index_buffer_object) );
+    // The indices are simply 0 to n - 1 (allocate them at once instead of pushing them back one by one).
+    this->particle_indices.resize(this->number_of_particles);
+    std::iota(this->particle_indices.begin(), this->particle_indices.end(), 0);
+    GLCall( glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * this->number_of_particles, &this->particle_indices.at(0), GL_STATIC_DRAW) );
+    // The buffers are not on our heap, so tell the memory accounting about them.
+    memory_accounting.memory_allocated(MEMORY_SUBSYSTEM_GPU_PARTICLE_BUFFERS, this->get_gpu_memory_footprint());
+
+    // Describe the vertex buffer layout of a particle.
+    describe_particle_memory_layout();
+
+    // Unbind.
+    GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    GLCall( glBindVertexArray(0) );
+}
+
+void Particle_Renderer::draw (Particle_System& particle_system, bool unbind)
+{
+    if (particle_system.number_of_particles == 0) {
+        return;
+    }
+    {
+        PROFILE_PHASE(PROFILER_PHASE_BUFFER_UPLOAD);
+        // Create the buffers if the number of particles changed.
+        if ((this->vertex_array_object == 0) || (this->number_of_particles != particle_system.number_of_particles)) {
+            this->generate_gpu_resources(particle_system);
+        }
+        // Update the particles data in the vertex buffer object.
+        GLCall( glBindBuffer(GL_ARRAY_BUFFER, this->vertex_buffer_object) );
+        GLCall( glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(Particle) * this->number_of_particles, &particle_system.particles.at(0)) );
+        GLCall( glBindBuffer(GL_ARRAY_BUFFER, 0) );
+    }
+    // Draw the particles using the vertex array object.
+    GLCall( glBindVertexArray(this->vertex_array_object) );
+    GLCall( glDrawElements(GL_POINTS, this->number_of_particles, GL_UNSIGNED_INT, 0) );
+    // In order to save a few unbind-calls, do this only if neccessary. 
+    // In our case, the visualization handler will handle the unbinding, so normally we will not unbind here.
+    if (unbind == true) {
+        GLCall( glBindVertexArray(0) );
+    }
+}
+
+void Particle_Renderer::free_gpu_resources ()
+{
+    if (this->vertex_array_object > 0) {
+        memory_accounting.memory_freed(MEMORY_SUBSYSTEM_GPU_PARTICLE_BUFFERS, this->get_gpu_memory_footprint());
+        GLCall( glDeleteVertexArrays(1, &this->vertex_array_object) );
+        GLCall( glDeleteBuffers(1, &this->vertex_buffer_object) );
+        GLCall( glDeleteBuffers(1, &this->index_buffer_object) );
+        this->vertex_array_object = 0;
+    }
+}
+
+void describe_particle_memory_layout ()
+{
+    // Describe the vertex buffer layout.
+    unsigned int index = 0;
+    // Position.
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)0) );
+    index++;
+    // Density.
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)(offsetof(Particle, density))) );
+    index++;
+    // Pressure.
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 1, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)(offsetof(Particle, pressure))) );
+    index++;
+    // Velocity.
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)(offsetof(Particle, velocity))) );
+    index++;
+    // Acceleration.
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)(offsetof(Particle, acceleration))) );
+    index++;
+    // Old acceleration.
+    GLCall( glEnableVertexAttribArray(index) );
+    GLCall( glVertexAttribPointer(index, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), (GLvoid*)(offsetof(Particle, old_acceleration))) );
+    index++;
+}
+
+size_t Particle_Renderer::get_gpu_memory_footprint ()
+{
+    if (this->vertex_array_object == 0) {
+        return 0;
+    }
+    return this->number_of_particles * (sizeof(Particle) + sizeof(unsigned int));
+}
\ No newline at end of file
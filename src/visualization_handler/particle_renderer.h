@@ -0,0 +1,38 @@
+#pragma once
+
+#include <GL/glew.h>
+#include <vector>
+
+#include "../utils/particle_system.h"
+
+// The particle renderer owns the OpenGL resources needed to draw the particles of a particle system.
+// The particle system itself does not know anything about OpenGL, so it can also be used without an
+// OpenGL context (e.g. by the headless simulation).
+class Particle_Renderer
+{
+    private:
+        GLuint vertex_array_object;
+        GLuint vertex_buffer_object;
+        GLuint index_buffer_object;
+        std::vector<unsigned int> particle_indices;
+        // The number of particles the buffers were created for. If the particle system has a different
+        // number of particles (e.g. a new scene was loaded), the buffers are created again.
+        unsigned int number_of_particles;
+
+        // Creates the vertex array, vertex and index buffer for the particles.
+        void generate_gpu_resources (Particle_System& particle_system);
+
+    public:
+        Particle_Renderer ();
+
+        // Uploads the current particles and draws them. Note that the shader will be selected and activated
+        // by the visualization handler.
+        void draw (Particle_System& particle_system, bool unbind = false);
+        // The size of the vertex and index buffer in bytes.
+        size_t get_gpu_memory_footprint ();
+        // Deletes the GPU ressources (vertex array, vertex buffer, index buffer).
+        void free_gpu_resources ();
+};
+
+// Describe the layout for the vertex buffer object.
+void describe_particle_memory_layout ();
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp>
 #include <sstream>
+#include <algorithm>
 
 #include "../imgui/imgui.h"
 #include "../imgui/imgui_impl_glfw.h"
@@ -13,12 +14,18 @@
 
 #include "../utils/cuboid.h"
 #include "../utils/debug.h"
+#include "../utils/frame_profiler.h"
+#include "../utils/helper.h"
+#include "../utils/memory_accounting.h"
 
 Visualization_Handler::Visualization_Handler ()
 {
     // At the start, the pointer to the GLFW window will be set to NULL.
     // Make sure to pass the pointer to the window before calling visualize().
     this->window = nullptr;
+    this->simulation_recorder = nullptr;
+    this->simulation_replayer = nullptr;
+    this->initial_state_cache = nullptr;
     // Calculate the aspect ratio and the projection matrix.
     this->update_window_size(WINDOW_DEFAULT_WIDTH, WINDOW_DEFAULT_HEIGHT);
     // Set the initial draw settings.
@@ -122,6 +129,13 @@ void Visualization_Handler::delete_shaders ()
     }
 }
 
+void Visualization_Handler::free_gpu_resources ()
+{
+    this->particle_renderer.free_gpu_resources();
+    this->cuboid_renderer.free_gpu_resources();
+    this->marching_cubes_renderer.free_gpu_resources();
+}
+
 void Visualization_Handler::update_external_force_position ()
 {
     // This function calculates from the cursors position the ray vector and gives it to the particle system
@@ -225,11 +239,33 @@ void Visualization_Handler::show_imgui_window ()
     if (ImGui::CollapsingHeader("Marching cube settings")) {
         ImGui::Checkbox("show marching cube surface", &this->draw_marching_cubes_surface);
         ImGui::Checkbox("wireframe mode", &this->draw_marching_cubes_surface_wireframe);
-        ImGui::Checkbox("show grid", &this->draw_marching_cubes_grid);
+        // Only the cubes the surface passes through are drawn (see Marching_Cubes_Renderer).
+        ImGui::Checkbox("show grid (active cubes)", &this->draw_marching_cubes_grid);
+        ImGui::Text("active cubes: %s / %s", 
+            to_string_with_separator((unsigned int)this->marching_cube_generator.get_number_of_active_marching_cubes()).c_str(),
+            to_string_with_separator((unsigned int)this->marching_cube_generator.get_number_of_marching_cubes()).c_str());
         ImGui::DragFloat("grid size", &this->marching_cube_generator.new_cube_edge_length, 
             MARCHING_CUBES_CUBE_EDGE_LENGTH_STEP, MARCHING_CUBES_CUBE_EDGE_LENGTH_MIN, MARCHING_CUBES_CUBE_EDGE_LENGTH_MAX, "%.4f");
         ImGui::DragFloat("isovalue", &this->marching_cube_generator.isovalue, 
             MARCHING_CUBES_ISOVALUE_STEP, MARCHING_CUBES_ISOVALUE_MIN, MARCHING_CUBES_ISOVALUE_MAX, "%.3f");
+        // The smooth color field allows a larger grid size than the particle count.
+        ImGui::Text("scalar field");
+        for (int i = 0; i < static_cast<int>(Scalar_Field_Mode::_SCALAR_FIELD_MODE_COUNT); i++) {
+            if (ImGui::Selectable(to_string(static_cast<Scalar_Field_Mode>(i)), i == this->marching_cube_generator.scalar_field_mode)) {
+                this->marching_cube_generator.scalar_field_mode = static_cast<Scalar_Field_Mode>(i);
+            }
+        }
+        // How the particles are counted per cell (AUTO chooses by the number of cells and particles).
+        ImGui::Text("density estimation (used: %s)", to_string(this->marching_cube_generator.used_density_estimation_mode));
+        for (int i = 0; i < static_cast<int>(Density_Estimation_Mode::_DENSITY_ESTIMATION_MODE_COUNT); i++) {
+            if (ImGui::Selectable(to_string(static_cast<Density_Estimation_Mode>(i)), i == this->marching_cube_generator.density_estimation_mode)) {
+                this->marching_cube_generator.density_estimation_mode = static_cast<Density_Estimation_Mode>(i);
+            }
+        }
+        // Only the particles that moved to another cell are counted again (see Marching_Cubes_Generator).
+        ImGui::Checkbox("incremental updates", &this->marching_cube_generator.incremental_updates);
+        ImGui::Text("updated cubes: %s", 
+            to_string_with_separator((unsigned int)this->marching_cube_generator.get_number_of_updated_marching_cubes()).c_str());
     }
     ImGui::End();
 
@@ -253,8 +289,84 @@ void Visualization_Handler::show_imgui_window ()
             0.1f, SIMULATION_NUMBER_OF_THREADS_MIN, SIMULATION_NUMBER_OF_THREADS_MAX, 
             "%d", ImGuiSliderFlags_AlwaysClamp);
     }
+    // Select the seeding pattern of the initial particles (it is used when the scene is loaded the next time).
+    if (ImGui::CollapsingHeader("Seeding pattern (applied on reload)")) {
+        for (int i = 0; i < static_cast<int>(Seeding_Pattern::_SEEDING_PATTERN_COUNT); i++) {
+            if (ImGui::Selectable(to_string(static_cast<Seeding_Pattern>(i)), i == this->particle_system->seeding_pattern)) {
+                this->particle_system->seeding_pattern = static_cast<Seeding_Pattern>(i);
+            }
+        }
+        // Start with the relaxed particles (the first load of a configuration relaxes them, later loads use the cache).
+        ImGui::Checkbox("relaxed initial state", &this->initial_state_cache->is_active);
+    }
     ImGui::End();
 
+    // Replay of a recording.
+    bool replay_is_running = (this->simulation_replayer != nullptr) && (this->simulation_replayer->is_open == true);
+    if (replay_is_running == true) {
+        ImGui::SetNextWindowSize(ImVec2(250, 220), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowPos(ImVec2(20, 530), ImGuiCond_FirstUseEver);
+        ImGui::Begin("Replay", NULL);
+        if (ImGui::Button((this->simulation_replayer->is_playing == true) ? "pause" : "play")) {
+            this->simulation_replayer->toggle_pause_resume();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("<")) {
+            this->simulation_replayer->step_backward();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button(">")) {
+            this->simulation_replayer->step_forward();
+        }
+        // Scrubbing: dragging the slider seeks to the selected frame.
+        int frame = this->simulation_replayer->get_current_frame();
+        if (ImGui::SliderInt("frame", &frame, 0, this->simulation_replayer->get_number_of_frames() - 1)) {
+            this->simulation_replayer->seek(frame);
+        }
+        ImGui::DragFloat("speed", &this->simulation_replayer->playback_speed, 
+            REPLAY_PLAYBACK_SPEED_STEP, REPLAY_PLAYBACK_SPEED_MIN, REPLAY_PLAYBACK_SPEED_MAX, "%.2f", 
+            ImGuiSliderFlags_AlwaysClamp);
+        ImGui::Text("file: %s", this->simulation_replayer->get_filename().c_str());
+        ImGui::Text("decoded chunks in cache: %u", this->simulation_replayer->get_number_of_cached_chunks());
+        ImGui::Text("chunks prefetched: %llu", this->simulation_replayer->chunks_prefetched.load());
+        ImGui::Text("cache hits / misses: %llu / %llu", this->simulation_replayer->cache_hits.load(), 
+            this->simulation_replayer->cache_misses.load());
+        ImGui::End();
+    }
+
+    // Recording of the simulation. Not available during a replay since we would overwrite the replayed file.
+    if ((this->simulation_recorder != nullptr) && (replay_is_running == false)) {
+        ImGui::SetNextWindowSize(ImVec2(250, 220), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowPos(ImVec2(20, 530), ImGuiCond_FirstUseEver);
+        ImGui::Begin("Recording", NULL);
+        if (this->simulation_recorder->is_recording == true) {
+            if (ImGui::Button("stop recording")) {
+                this->simulation_recorder->stop_recording();
+            }
+        }
+        else {
+            if (ImGui::Button("start recording")) {
+                this->simulation_recorder->start_recording();
+            }
+        }
+        ImGui::DragFloat("velocity precision", &this->simulation_recorder->velocity_precision, 
+            RECORDER_VELOCITY_PRECISION_STEP, RECORDER_VELOCITY_PRECISION_MIN, RECORDER_VELOCITY_PRECISION_MAX, "%.4f", 
+            ImGuiSliderFlags_AlwaysClamp);
+        Recording_Statistics& statistics = this->simulation_recorder->statistics;
+        ImGui::Text("frames recorded: %llu", statistics.frames_recorded.load());
+        ImGui::Text("frames written: %llu", statistics.frames_written.load());
+        ImGui::Text("written: %.2f MiB", statistics.written_bytes.load() / (1024.0f * 1024.0f));
+        ImGui::Text("compression ratio: %.2f", statistics.get_compression_ratio());
+        ImGui::Text("queue depth: %u (max. %u)", statistics.queue_depth.load(), statistics.max_queue_depth.load());
+        ImGui::Text("simulation stalls: %llu (%.1f ms)", statistics.stall_count.load(), statistics.stall_time_ns.load() / 1.0e6f);
+        ImGui::End();
+    }
+
+    // The load balance of the parallel regions.
+    this->show_performance_window();
+    // The live profiler.
+    this->show_profiler_window();
+
     // At last we print the information about the key bindings from the input handler to the screen using imgui.
     ImGui::SetNextWindowSize(ImVec2(300, 240), ImGuiCond_FirstUseEver);
     ImGui::SetNextWindowPos(ImVec2(700, 450), ImGuiCond_FirstUseEver);
@@ -282,6 +394,203 @@ void Visualization_Handler::show_imgui_window ()
     ImGui::End();
 }
 
+// Every phase gets its own hue.
+ImVec4 get_profiler_phase_color (Profiler_Phase phase)
+{
+    float r, g, b;
+    ImGui::ColorConvertHSVtoRGB((float)phase / (float)_PROFILER_PHASE_COUNT, 0.6f, 0.9f, r, g, b);
+    return ImVec4(r, g, b, 1.0f);
+}
+
+void Visualization_Handler::show_parallel_region_table (const char* label, Parallel_Region_Statistics& statistics)
+{
+    static ImGuiTableFlags table_flags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders;
+    if (ImGui::BeginTable(label, 5, table_flags)) {
+        ImGui::TableSetupColumn("region", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("threads");
+        ImGui::TableSetupColumn("imbalance");
+        ImGui::TableSetupColumn("utilisation");
+        ImGui::TableSetupColumn("idle [us]");
+        ImGui::TableHeadersRow();
+        for (auto& pair : statistics.regions) {
+            Parallel_Region_Metrics& region = pair.second;
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            // The tree node shows the work and the times of every thread of the last execution.
+            bool open = ImGui::TreeNodeEx(region.name, ImGuiTreeNodeFlags_SpanFullWidth);
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%u / %u", region.number_of_threads_launched, region.number_of_threads_requested);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.2f (avg. %.2f)", region.imbalance_factor, region.average_imbalance_factor);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.0f%% (avg. %.0f%%)", region.utilisation * 100.0, region.average_utilisation * 100.0);
+            ImGui::TableSetColumnIndex(4);
+            ImGui::Text("%.1f", region.idle_time / 1000.0);
+            if (open == true) {
+                for (size_t i = 0; i < region.threads.size(); i++) {
+                    Parallel_Thread_Metrics& thread = region.threads[i];
+                    ImGui::TableNextRow();
+                    ImGui::TableSetColumnIndex(0);
+                    ImGui::Text("thread %zu: %u elements, %u particles", i, thread.number_of_elements, thread.number_of_particles);
+                    ImGui::TableSetColumnIndex(2);
+                    ImGui::Text("busy %.1f us", (thread.end - thread.start) / 1000.0);
+                    ImGui::TableSetColumnIndex(3);
+                    ImGui::Text("start %.1f us", thread.start / 1000.0);
+                    ImGui::TableSetColumnIndex(4);
+                    ImGui::Text("%.1f", thread.idle_time / 1000.0);
+                }
+                ImGui::TreePop();
+            }
+        }
+        ImGui::EndTable();
+    }
+}
+
+void Visualization_Handler::show_performance_window ()
+{
+    ImGui::SetNextWindowSize(ImVec2(560, 300), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowPos(ImVec2(20, 760), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    // Nothing to do if the window is collapsed.
+    if (ImGui::Begin("Performance", NULL) == false) {
+        ImGui::End();
+        return;
+    }
+    ImGui::TextWrapped("imbalance = longest / mean busy time of the threads, utilisation = busy time / (requested threads * duration)");
+    ImGui::SetNextItemOpen(true, ImGuiCond_Appearing);
+    if (ImGui::CollapsingHeader("Simulation")) {
+        this->show_parallel_region_table("Simulation parallel regions", this->particle_system->parallel_region_statistics);
+    }
+    ImGui::SetNextItemOpen(true, ImGuiCond_Appearing);
+    if (ImGui::CollapsingHeader("Marching cubes")) {
+        this->show_parallel_region_table("Marching cubes parallel regions", this->marching_cube_generator.parallel_region_statistics);
+    }
+    if (ImGui::Button("reset")) {
+        this->particle_system->parallel_region_statistics.clear();
+        this->marching_cube_generator.parallel_region_statistics.clear();
+    }
+    ImGui::End();
+}
+
+void Visualization_Handler::show_profiler_window ()
+{
+    ImGui::SetNextWindowSize(ImVec2(460, 520), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowPos(ImVec2(1010, 20), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowCollapsed(true, ImGuiCond_FirstUseEver);
+    // The profiler only collects data while the window is visible, so a collapsed window costs nothing.
+    frame_profiler.is_active = ImGui::Begin("Profiler", NULL);
+    if (frame_profiler.is_active == false) {
+        ImGui::End();
+        return;
+    }
+    ImGui::DragInt("window (frames)", &frame_profiler.window_size, 1.0f, PROFILER_WINDOW_SIZE_MIN, PROFILER_WINDOW_SIZE_MAX, 
+        "%d", ImGuiSliderFlags_AlwaysClamp);
+    unsigned int number_of_frames = frame_profiler.get_number_of_frames_in_window();
+    Profiler_Statistics frame_time = frame_profiler.get_frame_time_statistics();
+
+    // The phases of the frames within the window as stacked bars (the newest frame on the right).
+    // The plot is scaled to the 99th percentile of the frame time, so single slow frames do not squeeze the rest.
+    ImVec2 plot_size = ImVec2(ImGui::GetContentRegionAvail().x, 150.0f);
+    ImVec2 plot_origin = ImGui::GetCursorScreenPos();
+    ImDrawList* draw_list = ImGui::GetWindowDrawList();
+    draw_list->AddRectFilled(plot_origin, ImVec2(plot_origin.x + plot_size.x, plot_origin.y + plot_size.y), IM_COL32(30, 30, 30, 255));
+    float plot_max_time = (frame_time.p99 > 0.0f) ? frame_time.p99 * 1.1f : 1.0f;
+    float bar_width = plot_size.x / frame_profiler.window_size;
+    float bar_x = plot_origin.x + plot_size.x - number_of_frames * bar_width;
+    for (unsigned int i = 0; i < number_of_frames; i++) {
+        const Profiler_Frame& frame = frame_profiler.get_frame_in_window(i);
+        float bar_y = plot_origin.y + plot_size.y;
+        for (int phase = 0; phase < _PROFILER_PHASE_COUNT; phase++) {
+            float bar_height = std::min(frame.phase_times[phase] / plot_max_time * plot_size.y, bar_y - plot_origin.y);
+            draw_list->AddRectFilled(ImVec2(bar_x, bar_y - bar_height), ImVec2(bar_x + bar_width, bar_y), 
+                ImGui::ColorConvertFloat4ToU32(get_profiler_phase_color((Profiler_Phase)phase)));
+            bar_y -= bar_height;
+        }
+        bar_x += bar_width;
+    }
+    ImGui::Dummy(plot_size);
+    ImGui::Text("plot height: %.2f ms", plot_max_time);
+
+    // The statistics of every phase over the window.
+    static ImGuiTableFlags table_flags = ImGuiTableFlags_SizingFixedFit | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders;
+    if (ImGui::BeginTable("Profiler phases", 4, table_flags)) {
+        ImGui::TableSetupColumn("phase [ms]", ImGuiTableColumnFlags_WidthStretch);
+        ImGui::TableSetupColumn("min");
+        ImGui::TableSetupColumn("avg");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableHeadersRow();
+        for (int phase = 0; phase < _PROFILER_PHASE_COUNT; phase++) {
+            Profiler_Statistics statistics = frame_profiler.get_statistics((Profiler_Phase)phase);
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::ColorButton("##color", get_profiler_phase_color((Profiler_Phase)phase), ImGuiColorEditFlags_NoTooltip, ImVec2(10, 10));
+            ImGui::SameLine();
+            ImGui::TextUnformatted(to_string((Profiler_Phase)phase));
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.3f", statistics.min);
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.3f", statistics.average);
+            ImGui::TableSetColumnIndex(3);
+            ImGui::Text("%.3f", statistics.p99);
+        }
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::TextUnformatted("frame");
+        ImGui::TableSetColumnIndex(1);
+        ImGui::Text("%.3f", frame_time.min);
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%.3f", frame_time.average);
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%.3f", frame_time.p99);
+        ImGui::EndTable();
+    }
+    ImGui::Text("simulation throughput: %s particles/s", to_string_with_separator((unsigned int)frame_profiler.get_simulation_throughput()).c_str());
+
+    if (ImGui::Button("reset")) {
+        frame_profiler.clear();
+    }
+
+    // The memory of the subsystems (see memory_accounting.h).
+    if (ImGui::CollapsingHeader("Memory")) {
+        if (ImGui::BeginTable("Memory subsystems", 3, table_flags)) {
+            ImGui::TableSetupColumn("subsystem [MiB]", ImGuiTableColumnFlags_WidthStretch);
+            ImGui::TableSetupColumn("current");
+            ImGui::TableSetupColumn("peak");
+            ImGui::TableHeadersRow();
+            for (int i = 0; i < _MEMORY_SUBSYSTEM_COUNT; i++) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(to_string((Memory_Subsystem)i));
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.2f", memory_accounting.get_current_bytes((Memory_Subsystem)i) / (1024.0f * 1024.0f));
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.2f", memory_accounting.get_peak_bytes((Memory_Subsystem)i) / (1024.0f * 1024.0f));
+            }
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted("total");
+            ImGui::TableSetColumnIndex(1);
+            ImGui::Text("%.2f", memory_accounting.get_total_current_bytes() / (1024.0f * 1024.0f));
+            ImGui::TableSetColumnIndex(2);
+            ImGui::Text("%.2f", memory_accounting.get_total_peak_bytes() / (1024.0f * 1024.0f));
+            ImGui::EndTable();
+        }
+        if (ImGui::Button("reset peaks")) {
+            memory_accounting.reset_peaks();
+        }
+        // The budget is checked before a scene is loaded (also when the number of particles changes).
+        int budget_mib = memory_accounting.get_budget() / (1024 * 1024);
+        if (ImGui::SliderInt("budget [MiB]", &budget_mib, MEMORY_BUDGET_MIB_MIN, MEMORY_BUDGET_MIB_MAX, "%d", ImGuiSliderFlags_Logarithmic)) {
+            memory_accounting.budget = (size_t)budget_mib * 1024 * 1024;
+        }
+        for (int i = 0; i < static_cast<int>(_MEMORY_BUDGET_MODE_COUNT); i++) {
+            if (ImGui::Selectable(to_string(static_cast<Memory_Budget_Mode>(i)), i == memory_accounting.budget_mode))
+                memory_accounting.budget_mode = static_cast<Memory_Budget_Mode>(i);
+        }
+    }
+    ImGui::End();
+}
+
 
 void Visualization_Handler::visualize ()
 {
@@ -310,109 +619,119 @@ void Visualization_Handler::visualize ()
         this->frame_counter = 0;
     }
     
-    // Get the view matrix.
-    glm::mat4 view_matrix = camera.get_view_matrix();
-
-    // Visualize the cuboids if desired.
-    if ((this->draw_simulation_space == true)|| (this->draw_fluid_starting_positions == true)) {
-        // Wireframe mode.
-        GLCall( glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) );
-        // Activate the desired shader program.
-        this->cuboid_shader->use_program();
-        // Set the projection matrix and the view matrix.
-        this->cuboid_shader->set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
-        this->cuboid_shader->set_uniform_mat4fv("u_view_matrix", view_matrix);
-    }
-    // Visualize the simulation space.
-    if (this->draw_simulation_space == true) {
-        this->cuboid_shader->set_uniform_4fv("u_color", this->color_simulation_space);
-        this->simulation_space->draw();
-    }
-    // Visualize the starting positions of the fluid.
-    if (this->draw_fluid_starting_positions == true) {
-        for (int i = 0; i < this->fluid_start_positions->size(); i++) {
-            this->cuboid_shader->set_uniform_4fv("u_color", this->color_fluid_starting_positions);
-            this->fluid_start_positions->at(i).draw();
-        }
-    }
-    // Undo some things that need to be undone one of the cuboids were drawn.
-    if ((this->draw_simulation_space == true)|| (this->draw_fluid_starting_positions == true)) {
-        // Deactivate wireframe mode.
-        GLCall( glPolygonMode(GL_FRONT_AND_BACK, GL_FILL) );
-    }
-
-    // Visualize the particles.
-    if (this->draw_particles == true) {
-        // Activate the desired shader program.
-        this->fluid_shaders[this->current_fluid_shader].use_program();
-        // Set the projection matrix and the view matrix.
-        this->fluid_shaders[this->current_fluid_shader].set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
-        this->fluid_shaders[this->current_fluid_shader].set_uniform_mat4fv("u_view_matrix", view_matrix);
-        // Set the aspect ratio.
-        this->fluid_shaders[this->current_fluid_shader].set_uniform_1f("u_aspect_ratio", this->aspect_ratio);
-        // Draw the particles.
-        this->particle_system->draw();
-    }
-
-    // Determine if we need to calculate the marching cubes.
-    if ((this->draw_marching_cubes_grid == true) || (this->draw_marching_cubes_surface == true)) {
-        // Calculate the marching cubes.
-        this->marching_cube_generator.generate_marching_cubes();
-    }
-
-    // Visualize the marching cubes grid.
-    if (this->draw_marching_cubes_grid == true) {
-        // Activate the desired shader program.
-        this->marching_cube_grid_shader->use_program();
-        // Set the projection matrix and the view matrix.
-        this->marching_cube_grid_shader->set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
-        this->marching_cube_grid_shader->set_uniform_mat4fv("u_view_matrix", view_matrix);
-        // Set the cubes edge length.
-        this->marching_cube_grid_shader->set_uniform_1f("u_cube_edge_length", this->marching_cube_generator.cube_edge_length);
-        // Draw the grid.
-        this->marching_cube_generator.draw();
-    }
-
-    // Visualize the surface generated by the marching cubes.
-    if (this->draw_marching_cubes_surface == true) {
-        // Check if we want to draw in wireframe mode.
-        if (this->draw_marching_cubes_surface_wireframe == true) {
-            // The marching cubes surface need to be rendered in 
+    // Draw the scene. The buffer uploads and the marching cubes are measured as phases of their own.
+    {
+        PROFILE_PHASE(PROFILER_PHASE_DRAW);
+        // Get the view matrix.
+        glm::mat4 view_matrix = camera.get_view_matrix();
+
+        // Visualize the cuboids if desired.
+        if ((this->draw_simulation_space == true)|| (this->draw_fluid_starting_positions == true)) {
+            // Wireframe mode.
             GLCall( glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) );
+            // Activate the desired shader program.
+            this->cuboid_shader->use_program();
+            // Set the projection matrix and the view matrix.
+            this->cuboid_shader->set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
+            this->cuboid_shader->set_uniform_mat4fv("u_view_matrix", view_matrix);
+        }
+        // Visualize the simulation space.
+        if (this->draw_simulation_space == true) {
+            this->cuboid_shader->set_uniform_4fv("u_color", this->color_simulation_space);
+            this->cuboid_renderer.draw(*this->simulation_space);
+        }
+        // Visualize the starting positions of the fluid.
+        if (this->draw_fluid_starting_positions == true) {
+            for (int i = 0; i < this->fluid_start_positions->size(); i++) {
+                this->cuboid_shader->set_uniform_4fv("u_color", this->color_fluid_starting_positions);
+                this->cuboid_renderer.draw(this->fluid_start_positions->at(i));
+            }
         }
-        // Activate the desired shader program.
-        this->marching_cube_shader->use_program();
-        // Set the projection matrix and the view matrix.
-        this->marching_cube_shader->set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
-        this->marching_cube_shader->set_uniform_mat4fv("u_view_matrix", view_matrix);
-        // Set the cubes edge length.
-        this->marching_cube_shader->set_uniform_1f("u_cube_edge_length", this->marching_cube_generator.cube_edge_length);
-        // Set the isovalue to be used in the marching cubes algorithm.
-        this->marching_cube_shader->set_uniform_1f("u_isovalue", this->marching_cube_generator.isovalue);
-        // Draw the surface of the fluid.
-        this->marching_cube_generator.draw();
-        // Deactivate the wireframe mode if necessary.
-        // We only need to deactivate it if the simulation space and the starting positions of the fluid
-        // will not be drawn because then the next draw call goes to the particles.
-        if ((this->draw_marching_cubes_surface_wireframe == true) && 
-            ((this->draw_simulation_space == false) && (this->draw_fluid_starting_positions == false))) {
+        // Undo some things that need to be undone one of the cuboids were drawn.
+        if ((this->draw_simulation_space == true)|| (this->draw_fluid_starting_positions == true)) {
+            // Deactivate wireframe mode.
             GLCall( glPolygonMode(GL_FRONT_AND_BACK, GL_FILL) );
         }
-    }
 
-    // Unbind.
-    GLCall( glBindVertexArray(0) );
+        // Visualize the particles.
+        if (this->draw_particles == true) {
+            // Activate the desired shader program.
+            this->fluid_shaders[this->current_fluid_shader].use_program();
+            // Set the projection matrix and the view matrix.
+            this->fluid_shaders[this->current_fluid_shader].set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
+            this->fluid_shaders[this->current_fluid_shader].set_uniform_mat4fv("u_view_matrix", view_matrix);
+            // Set the aspect ratio.
+            this->fluid_shaders[this->current_fluid_shader].set_uniform_1f("u_aspect_ratio", this->aspect_ratio);
+            // Draw the particles.
+            this->particle_renderer.draw(*this->particle_system);
+        }
+
+        // Determine if we need to calculate the marching cubes.
+        if ((this->draw_marching_cubes_grid == true) || (this->draw_marching_cubes_surface == true)) {
+            // Calculate the marching cubes.
+            PROFILE_PHASE(PROFILER_PHASE_MARCHING_CUBES);
+            this->marching_cube_generator.generate_marching_cubes();
+        }
+
+        // Visualize the marching cubes grid.
+        if (this->draw_marching_cubes_grid == true) {
+            // Activate the desired shader program.
+            this->marching_cube_grid_shader->use_program();
+            // Set the projection matrix and the view matrix.
+            this->marching_cube_grid_shader->set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
+            this->marching_cube_grid_shader->set_uniform_mat4fv("u_view_matrix", view_matrix);
+            // Set the cubes edge length and the rest of the grid (the positions of the cubes are derived from their indices).
+            this->marching_cubes_renderer.set_grid_uniforms(*this->marching_cube_grid_shader, this->marching_cube_generator);
+            // Draw the grid.
+            this->marching_cubes_renderer.draw(this->marching_cube_generator);
+        }
+
+        // Visualize the surface generated by the marching cubes.
+        if (this->draw_marching_cubes_surface == true) {
+            // Check if we want to draw in wireframe mode.
+            if (this->draw_marching_cubes_surface_wireframe == true) {
+                // The marching cubes surface need to be rendered in 
+                GLCall( glPolygonMode(GL_FRONT_AND_BACK, GL_LINE) );
+            }
+            // Activate the desired shader program.
+            this->marching_cube_shader->use_program();
+            // Set the projection matrix and the view matrix.
+            this->marching_cube_shader->set_uniform_mat4fv("u_projection_matrix", this->projection_matrix);
+            this->marching_cube_shader->set_uniform_mat4fv("u_view_matrix", view_matrix);
+            // Set the cubes edge length and the rest of the grid (the positions of the cubes are derived from their indices).
+            this->marching_cubes_renderer.set_grid_uniforms(*this->marching_cube_shader, this->marching_cube_generator);
+            // Set the isovalue to be used in the marching cubes algorithm.
+            this->marching_cube_shader->set_uniform_1f("u_isovalue", this->marching_cube_generator.isovalue);
+            // Draw the surface of the fluid.
+            this->marching_cubes_renderer.draw(this->marching_cube_generator);
+            // Deactivate the wireframe mode if necessary.
+            // We only need to deactivate it if the simulation space and the starting positions of the fluid
+            // will not be drawn because then the next draw call goes to the particles.
+            if ((this->draw_marching_cubes_surface_wireframe == true) && 
+                ((this->draw_simulation_space == false) && (this->draw_fluid_starting_positions == false))) {
+                GLCall( glPolygonMode(GL_FRONT_AND_BACK, GL_FILL) );
+            }
+        }
+
+        // Unbind.
+        GLCall( glBindVertexArray(0) );
+    }
 
     // Set up and draw the imgui window.
     // Start the Dear ImGui frame.
-    ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplGlfw_NewFrame();
-    ImGui::NewFrame();
-    this->show_imgui_window();
-    ImGui::Render();
-    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    {
+        PROFILE_PHASE(PROFILER_PHASE_IMGUI);
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+        this->show_imgui_window();
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+    }
 
     // Swap front and back buffers.
     glfwSwapBuffers(this->window);
+    // The frame is done (the profiler only collects data while its window is visible).
+    frame_profiler.end_frame(this->particle_system->number_of_particles);
 }
 
@@ -7,7 +7,13 @@
 #include "camera.h"
 #include "../utils/cuboid.h"
 #include "../utils/particle_system.h"
-#include "marching_cubes.h"
+#include "../simulation_handler/simulation_recorder.h"
+#include "../simulation_handler/simulation_replayer.h"
+#include "../simulation_handler/initial_state_cache.h"
+#include "../utils/marching_cubes.h"
+#include "particle_renderer.h"
+#include "cuboid_renderer.h"
+#include "marching_cubes_renderer.h"
 
 // Project related defines.
 #define WINDOW_DEFAULT_NAME         "RTGP - Fluid Simulation"
@@ -51,6 +57,11 @@ class Visualization_Handler
         // The shader for the marching cubes grid and the marching cubes generated surfaces.
         Shader* marching_cube_grid_shader;
         Shader* marching_cube_shader;
+        // The OpenGL resources for drawing the particles, the cuboids and the marching cubes. The simulation
+        // related classes (including the marching cubes generator) do not own any OpenGL resources.
+        Particle_Renderer particle_renderer;
+        Cuboid_Renderer cuboid_renderer;
+        Marching_Cubes_Renderer marching_cubes_renderer;
         // The projection matrix. It will use the values defined above in the define section.
         int window_width;
         int window_height;
@@ -84,6 +95,11 @@ class Visualization_Handler
 
         // Imgui window.
         void show_imgui_window ();
+        // The load balance of the parallel regions of the particle system and the marching cubes.
+        void show_performance_window ();
+        void show_parallel_region_table (const char* label, Parallel_Region_Statistics& statistics);
+        // The rolling phase timings of the frame profiler, the memory footprint and the throughput.
+        void show_profiler_window ();
 
     public:
         // A reference to the GLFW window. It will be created in the application handler and
@@ -94,6 +110,13 @@ class Visualization_Handler
         Cuboid *simulation_space;
         std::vector<Cuboid> *fluid_start_positions;
         Particle_System *particle_system;
+        // The recorder is owned by the simulation handler. We only need it to show its state
+        // and statistics in the imgui window.
+        Simulation_Recorder *simulation_recorder;
+        // The same applies to the replayer. Its window is only shown during a replay.
+        Simulation_Replayer *simulation_replayer;
+        // The cache of the relaxed initial states (only to switch it on and off).
+        Initial_State_Cache *initial_state_cache;
         // Our camera that handles the calculation of the view matrix.
         // It is an arc ball camera.
         Camera camera;
@@ -123,6 +146,8 @@ class Visualization_Handler
         // Shader related functions.
         bool initialize_shaders ();
         void delete_shaders ();
+        // Deletes the GPU ressources of the renderers and the marching cubes.
+        void free_gpu_resources ();
 
         // A function to update the window width and height. We need this for the projection matrix.
         void update_window_size (int width, int height);